@@ -0,0 +1,111 @@
+#include "layout/layout.h"
+#include "css/stylesheet.h"
+#include "css/style.h"
+#include "core/thread_pool.h"
+#include "dom/dom.h"
+#include "html/parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// First style and layout pass benchmark
+// Builds a page of about 100k elements and times the first resolve and
+// layout on the calling thread and on thread pools of growing size. The
+// page is parsed afresh for every run, since a second pass would reuse the
+// first one's results.
+
+#define SECTIONS 10000              // Ten elements each
+#define VIEWPORT_WIDTH 1024.0f
+
+static const char page_css[] =
+    "section { margin: 8px 2% } h2 { font-size: 1.5em } .note { color: #555; padding: 4px }"
+    "li + li { font-style: italic } .tag { display: inline-block; padding: 0 2px; border: 1px solid gray }";
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static char* build_page(void) {
+    size_t size = (size_t)SECTIONS * 320 + 32;
+    char* html = (char*)malloc(size);
+    if (!html) {
+        return NULL;
+    }
+    size_t used = (size_t)snprintf(html, size, "<html><body>");
+    for (int s = 0; s < SECTIONS; s++) {
+        used += (size_t)snprintf(html + used, size - used,
+                                 "<section><h2>Section %d</h2>"
+                                 "<p class=\"note\">Some text that wraps across a few lines of the column,"
+                                 " with <em>emphasis</em> and <span class=\"tag\">tags</span>.</p>"
+                                 "<ul><li>first</li><li>second</li><li>third</li></ul>"
+                                 "<div><b>bold</b></div></section>",
+                                 s);
+    }
+    snprintf(html + used, size - used, "</body></html>");
+    return html;
+}
+
+// Time one first pass; returns seconds, or a negative value on failure
+static double measure(const char* html, ThreadPool* pool, LayoutStats* stats) {
+    DOMDocument* doc = dom_document_create();
+    if (!doc || html_parser_parse(doc, html) != 0) {
+        dom_document_destroy(doc);
+        return -1.0;
+    }
+    StyleEngine* styles = style_engine_create(doc);
+    LayoutEngine* layout = styles ? layout_engine_create(doc, styles) : NULL;
+    CSSStylesheet* sheet = css_stylesheet_parse(page_css, sizeof(page_css) - 1);
+    double seconds = -1.0;
+    if (layout && sheet && style_engine_add_stylesheet(styles, sheet) == 0) {
+        sheet = NULL;
+        style_engine_set_thread_pool(styles, pool);
+        layout_engine_set_thread_pool(layout, pool);
+
+        double start = now_seconds();
+        if (layout_engine_layout(layout, VIEWPORT_WIDTH) == 0) {
+            seconds = now_seconds() - start;
+            layout_engine_get_stats(layout, stats);
+        }
+    }
+
+    css_stylesheet_destroy(sheet);
+    layout_engine_destroy(layout);
+    style_engine_destroy(styles);
+    dom_document_destroy(doc);
+    return seconds;
+}
+
+int main(void) {
+    char* html = build_page();
+    if (!html) {
+        return 1;
+    }
+
+    const int thread_counts[] = { 0, 2, 4, 8 };
+    printf("%-10s%12s%12s%12s\n", "threads", "ms", "boxes", "lines");
+    for (size_t i = 0; i < sizeof(thread_counts) / sizeof(thread_counts[0]); i++) {
+        ThreadPool* pool = thread_counts[i] ? thread_pool_create(thread_counts[i]) : NULL;
+        if (thread_counts[i] && !pool) {
+            continue;
+        }
+
+        // Best of three
+        LayoutStats stats = { 0 };
+        double best = -1.0;
+        for (int run = 0; run < 3; run++) {
+            double seconds = measure(html, pool, &stats);
+            if (seconds >= 0.0 && (best < 0.0 || seconds < best)) {
+                best = seconds;
+            }
+        }
+        printf("%-10d%12.1f%12zu%12zu\n", thread_counts[i] ? thread_counts[i] : 1, best * 1000.0,
+               stats.boxes_laid_out, stats.lines);
+        thread_pool_destroy(pool);
+    }
+
+    free(html);
+    return 0;
+}
@@ -1,12 +1,18 @@
 #ifndef JUST_BROWSE_ENGINE_H
 #define JUST_BROWSE_ENGINE_H
 
+#include "js/js_engine.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 // Browser engine initialization and lifecycle
 typedef struct BrowserEngine BrowserEngine;
+typedef struct JSBytecodeCache JSBytecodeCache;
+typedef struct JSCompilePool JSCompilePool;
+typedef struct JSEnginePool JSEnginePool;
+typedef struct ThreadPool ThreadPool;
 
 /**
  * Initialize the browser engine
@@ -14,6 +20,21 @@ typedef struct BrowserEngine BrowserEngine;
  */
 BrowserEngine* browser_engine_init(void);
 
+/**
+ * Initialize the browser engine with JS runtime limits
+ * @param js_config Memory limit, GC threshold and stack size, or NULL for defaults
+ * @return Pointer to the engine instance, or NULL on failure
+ */
+BrowserEngine* browser_engine_init_with_config(const JSEngineConfig* js_config);
+
+/**
+ * Initialize the browser engine with a JS engine taken from a pool. The JS
+ * engine goes back to the pool when the browser engine is destroyed.
+ * @param pool The JS engine pool (not owned; must outlive the engine)
+ * @return Pointer to the engine instance, or NULL on failure
+ */
+BrowserEngine* browser_engine_init_with_pool(JSEnginePool* pool);
+
 /**
  * Destroy the browser engine and free resources
  * @param engine The engine instance to destroy
@@ -21,21 +42,108 @@ BrowserEngine* browser_engine_init(void);
 void browser_engine_destroy(BrowserEngine* engine);
 
 /**
- * Load HTML content into the engine
+ * Load HTML content into the engine. Inline classic scripts are run in
+ * document order once parsing completes, followed by inline module scripts.
  * @param engine The engine instance
  * @param html HTML content to load
  * @return 0 on success, -1 on failure
  */
 int browser_engine_load_html(BrowserEngine* engine, const char* html);
 
+/**
+ * Compile scripts found during HTML loading on a pool of worker threads,
+ * overlapping compilation with parsing and with each other
+ * @param engine The engine instance
+ * @param pool The compile pool (not owned; must outlive the engine), or NULL to compile on the main thread
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_set_compile_pool(BrowserEngine* engine, JSCompilePool* pool);
+
 /**
  * Execute JavaScript code in the engine context
  * @param engine The engine instance
  * @param script JavaScript code to execute
- * @return 0 on success, -1 on failure
+ * @return 0 on success, JS_ENGINE_BUDGET_EXCEEDED if a budget ran out, -1 on other failures
  */
 int browser_engine_execute_script(BrowserEngine* engine, const char* script);
 
+/**
+ * Execute an ES module in the engine context
+ * @param engine The engine instance
+ * @param source The module source
+ * @param filename The module name, used to resolve relative imports
+ * @return 0 on success, JS_ENGINE_BUDGET_EXCEEDED if a budget ran out, -1 on other failures
+ */
+int browser_engine_execute_module(BrowserEngine* engine, const char* source, const char* filename);
+
+/**
+ * Get the error of the last script that failed to compile or run
+ * @param engine The engine instance
+ * @return The error message, or NULL if the last script succeeded
+ */
+const char* browser_engine_get_error(BrowserEngine* engine);
+
+/**
+ * Set where imported modules are loaded from
+ * @param engine The engine instance
+ * @param provider The provider, or NULL to disable imports
+ * @param user_data Passed to the provider
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_set_module_provider(BrowserEngine* engine, JSModuleProvider provider, void* user_data);
+
+/**
+ * Run timers, animation frames and microtasks until the page is idle. The
+ * virtual clock jumps straight to each next timer rather than sleeping.
+ * @param engine The engine instance
+ * @param timeout_ms Virtual time allowed before giving up
+ * @return 0 when idle, 1 if work is still pending at the timeout,
+ *         JS_ENGINE_BUDGET_EXCEEDED if a budget ran out, -1 on failure
+ */
+int browser_engine_run_until_idle(BrowserEngine* engine, uint64_t timeout_ms);
+
+/**
+ * Advance the virtual clock, running whatever falls due on the way
+ * @param engine The engine instance
+ * @param ms Milliseconds to advance
+ * @return 0 on success, JS_ENGINE_BUDGET_EXCEEDED if a budget ran out, -1 on failure
+ */
+int browser_engine_advance_time(BrowserEngine* engine, uint64_t ms);
+
+/**
+ * Route console output to a sink instead of stdout
+ * @param engine The engine instance
+ * @param sink The sink, or NULL for stdout
+ * @param user_data Passed to the sink
+ * @param capacity Console buffer size in bytes (0 for the default)
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_set_console_sink(BrowserEngine* engine, JSConsoleSink sink, void* user_data, size_t capacity);
+
+/**
+ * Get the number of console messages dropped because the buffer was full
+ * @param engine The engine instance
+ * @return The drop count
+ */
+uint64_t browser_engine_console_dropped(BrowserEngine* engine);
+
+/**
+ * Set script execution budgets. The page budget restarts with each
+ * browser_engine_load_html.
+ * @param engine The engine instance
+ * @param budget The budgets, or NULL to remove them
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_set_script_budget(BrowserEngine* engine, const JSEngineBudget* budget);
+
+/**
+ * Share a bytecode cache with the engine's script execution
+ * @param engine The engine instance
+ * @param cache The cache (not owned; must outlive the engine), or NULL to disable
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_set_bytecode_cache(BrowserEngine* engine, JSBytecodeCache* cache);
+
 /**
  * Render the current page
  * @param engine The engine instance
@@ -43,6 +151,63 @@ int browser_engine_execute_script(BrowserEngine* engine, const char* script);
  */
 int browser_engine_render(BrowserEngine* engine);
 
+/**
+ * Rasterize frames on a pool of worker threads
+ * @param engine The engine instance
+ * @param pool The thread pool (not owned; must outlive the engine), or NULL to rasterize on the calling thread
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_set_raster_pool(BrowserEngine* engine, ThreadPool* pool);
+
+/**
+ * Resolve styles and lay out on a pool of worker threads
+ * @param engine The engine instance
+ * @param pool The thread pool (not owned; must outlive the engine), or NULL to use the calling thread
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_set_layout_pool(BrowserEngine* engine, ThreadPool* pool);
+
+/**
+ * Get JS heap statistics for the engine. explicit_gc_count and
+ * explicit_gc_time_ns cover only the collections the engine asks for
+ * (browser_engine_run_gc, and the one when a pooled engine is reset), not
+ * those QuickJS runs on its own as the heap grows.
+ * @param engine The engine instance
+ * @param stats Output parameter for the statistics
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_get_heap_stats(BrowserEngine* engine, JSEngineHeapStats* stats);
+
+/**
+ * Run a full JS garbage collection, e.g. between tasks
+ * @param engine The engine instance
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_run_gc(BrowserEngine* engine);
+
+/**
+ * Start the sampling JS profiler
+ * @param engine The engine instance
+ * @param interval_us Sampling interval in microseconds (0 for the default)
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_profiler_start(BrowserEngine* engine, uint32_t interval_us);
+
+/**
+ * Stop the sampling JS profiler, keeping its samples
+ * @param engine The engine instance
+ * @return 0 on success, -1 on failure
+ */
+int browser_engine_profiler_stop(BrowserEngine* engine);
+
+/**
+ * Export the profile
+ * @param engine The engine instance
+ * @param json Nonzero for JSON, zero for collapsed-stack text
+ * @return Newly allocated profile (caller frees), or NULL on failure
+ */
+char* browser_engine_profiler_export(BrowserEngine* engine, int json);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,58 @@
+#ifndef JUST_BROWSE_THREAD_POOL_H
+#define JUST_BROWSE_THREAD_POOL_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ThreadPool ThreadPool;
+
+/**
+ * Task callback run by thread_pool_parallel_for
+ * @param context The context passed to thread_pool_parallel_for
+ * @param index Index of the task, in [0, count)
+ * @param worker Index of the thread running the task, in [0, thread_pool_get_worker_count)
+ */
+typedef void (*ThreadPoolTask)(void* context, size_t index, int worker);
+
+/**
+ * Create a work-stealing thread pool. Each worker owns a deque of task
+ * indices and steals from the others once its own deque runs dry.
+ * @param thread_count Number of worker threads, or <= 0 for one per CPU
+ * @return Pointer to the pool, or NULL on failure
+ */
+ThreadPool* thread_pool_create(int thread_count);
+
+/**
+ * Destroy a thread pool, joining its threads
+ * @param pool The pool to destroy
+ */
+void thread_pool_destroy(ThreadPool* pool);
+
+/**
+ * Get the number of threads that may run tasks, including the caller of
+ * thread_pool_parallel_for
+ * @param pool The pool
+ * @return Worker count, or 1 if pool is NULL
+ */
+int thread_pool_get_worker_count(ThreadPool* pool);
+
+/**
+ * Run task(context, i, worker) for every i in [0, count) and wait for all of
+ * them. The calling thread takes part in the work. Calls from several
+ * threads at once are serialized, so a task must not call back into the pool.
+ * @param pool The pool, or NULL to run every task on the calling thread
+ * @param count Number of tasks
+ * @param task Task callback
+ * @param context Opaque pointer passed to the task
+ * @return 0 on success, -1 on failure
+ */
+int thread_pool_parallel_for(ThreadPool* pool, size_t count, ThreadPoolTask task, void* context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_THREAD_POOL_H
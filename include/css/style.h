@@ -0,0 +1,164 @@
+#ifndef JUST_BROWSE_CSS_STYLE_H
+#define JUST_BROWSE_CSS_STYLE_H
+
+#include "css/stylesheet.h"
+#include "dom/dom.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct StyleEngine StyleEngine;
+typedef struct ThreadPool ThreadPool;
+
+typedef struct {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+    uint8_t a;
+} CSSColor;
+
+typedef enum {
+    CSS_DISPLAY_INLINE,
+    CSS_DISPLAY_BLOCK,
+    CSS_DISPLAY_INLINE_BLOCK,
+    CSS_DISPLAY_NONE
+} CSSDisplay;
+
+typedef enum {
+    CSS_FONT_STYLE_NORMAL,
+    CSS_FONT_STYLE_ITALIC
+} CSSFontStyle;
+
+typedef enum {
+    CSS_TEXT_ALIGN_LEFT,
+    CSS_TEXT_ALIGN_RIGHT,
+    CSS_TEXT_ALIGN_CENTER,
+    CSS_TEXT_ALIGN_JUSTIFY
+} CSSTextAlign;
+
+typedef enum {
+    CSS_WHITE_SPACE_NORMAL,
+    CSS_WHITE_SPACE_NOWRAP,
+    CSS_WHITE_SPACE_PRE,
+    CSS_WHITE_SPACE_PRE_WRAP,
+    CSS_WHITE_SPACE_PRE_LINE
+} CSSWhiteSpace;
+
+typedef enum {
+    CSS_LENGTH_AUTO,
+    CSS_LENGTH_PX,
+    CSS_LENGTH_PERCENT,         // Of the containing block, resolved by layout
+    CSS_LENGTH_NUMBER           // Multiple of font_size (line_height only)
+} CSSLengthType;
+
+typedef struct {
+    CSSLengthType type;
+    float value;
+} CSSLength;
+
+/**
+ * Computed values of one element. Styles are immutable and interned:
+ * elements with equal computed values share one ComputedStyle, so two
+ * styles are equal exactly when their pointers are. Sides are ordered
+ * top, right, bottom, left.
+ */
+typedef struct {
+    CSSDisplay display;
+    CSSColor color;
+    CSSColor background_color;
+    float font_size;                // px
+    int font_weight;                // 1-1000; 400 is normal, 700 bold
+    CSSFontStyle font_style;
+    CSSLength line_height;          // px or a multiple of font_size
+    CSSTextAlign text_align;
+    CSSWhiteSpace white_space;
+    CSSLength width;
+    CSSLength height;
+    CSSLength margin[4];
+    CSSLength padding[4];
+    float border_width[4];          // px; 0 on sides without a border style
+    CSSColor border_color;
+} ComputedStyle;
+
+// Counters for the most recent style_engine_resolve
+typedef struct {
+    size_t elements_styled;         // Elements whose style was recomputed
+    size_t styles_shared;           // ...of which reused a sibling's style
+    size_t selectors_tested;        // Selector match attempts
+    size_t unique_styles;           // Distinct styles alive after the pass
+} StyleStats;
+
+/**
+ * Create a style engine for a document. The engine keeps each element's
+ * computed style on the element through dom_document_set_style_cache and
+ * becomes the document's mutation observer, so a document can have only
+ * one style engine at a time. A built-in user
+ * agent stylesheet is always applied first.
+ * @param doc The document (not owned; must outlive the engine)
+ * @return Pointer to the engine, or NULL on failure
+ */
+StyleEngine* style_engine_create(DOMDocument* doc);
+
+/**
+ * Destroy a style engine, releasing every style stored on the document
+ * @param engine The engine to destroy
+ */
+void style_engine_destroy(StyleEngine* engine);
+
+/**
+ * Add an author stylesheet after the ones already added
+ * @param engine The engine
+ * @param sheet The stylesheet (ownership passes to the engine on success)
+ * @return 0 on success, -1 on failure
+ */
+int style_engine_add_stylesheet(StyleEngine* engine, CSSStylesheet* sheet);
+
+/**
+ * Remove all author stylesheets
+ * @param engine The engine
+ */
+void style_engine_clear_stylesheets(StyleEngine* engine);
+
+/**
+ * Bring every element's computed style up to date. The engine observes the
+ * document, so only elements a mutation since the last resolve could have
+ * affected are recomputed; a stylesheet change recomputes all of them.
+ * Elements whose ancestor is display: none get no style.
+ * @param engine The engine
+ * @return 0 on success, -1 on failure
+ */
+int style_engine_resolve(StyleEngine* engine);
+
+/**
+ * Restyle independent subtrees on a thread pool. The result of a resolve,
+ * counters included, is the same as on a single thread.
+ * @param engine The engine
+ * @param pool The pool (not owned; must outlive the engine), or NULL to resolve on the calling thread
+ * @return 0 on success, -1 on failure
+ */
+int style_engine_set_thread_pool(StyleEngine* engine, ThreadPool* pool);
+
+/**
+ * Get the computed style of an element as of the last resolve
+ * @param engine The engine
+ * @param element The element
+ * @return The style (valid until the next resolve), or NULL if it has none
+ */
+const ComputedStyle* style_engine_get_style(StyleEngine* engine, DOMElement* element);
+
+/**
+ * Get counters for the most recent resolve
+ * @param engine The engine
+ * @param stats Output parameter for the counters
+ * @return 0 on success, -1 on failure
+ */
+int style_engine_get_stats(StyleEngine* engine, StyleStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_CSS_STYLE_H
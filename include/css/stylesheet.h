@@ -0,0 +1,44 @@
+#ifndef JUST_BROWSE_CSS_STYLESHEET_H
+#define JUST_BROWSE_CSS_STYLESHEET_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Parsed CSS. Selectors support type, universal, #id, .class, attribute
+// selectors ([a], [a=v], [a~=v], [a|=v], [a^=v], [a$=v], [a*=v]), the
+// :first-child, :last-child, :only-child, :root and :empty pseudo-classes
+// and all four combinators. Rules the parser does not understand (other
+// pseudo-classes, pseudo-elements, at-rules) are skipped as a whole, and
+// unknown or invalid declarations are dropped, as CSS error handling
+// requires.
+typedef struct CSSStylesheet CSSStylesheet;
+
+/**
+ * Parse a stylesheet
+ * @param text The CSS source (need not be NUL-terminated)
+ * @param length Length of the source in bytes
+ * @return Pointer to the stylesheet, or NULL on failure
+ */
+CSSStylesheet* css_stylesheet_parse(const char* text, size_t length);
+
+/**
+ * Destroy a stylesheet
+ * @param sheet The stylesheet to destroy
+ */
+void css_stylesheet_destroy(CSSStylesheet* sheet);
+
+/**
+ * Get the number of rules that survived parsing
+ * @param sheet The stylesheet
+ * @return The rule count
+ */
+size_t css_stylesheet_get_rule_count(const CSSStylesheet* sheet);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_CSS_STYLESHEET_H
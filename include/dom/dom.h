@@ -1,6 +1,9 @@
 #ifndef JUST_BROWSE_DOM_H
 #define JUST_BROWSE_DOM_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -9,15 +12,88 @@ extern "C" {
 typedef struct DOMDocument DOMDocument;
 typedef struct DOMNode DOMNode;
 typedef struct DOMElement DOMElement;
+typedef struct HTMLTape HTMLTape;
+typedef struct DOMCollection DOMCollection;
 
 // Node types
 typedef enum {
     NODE_ELEMENT = 1,
     NODE_TEXT = 3,
     NODE_COMMENT = 8,
-    NODE_DOCUMENT = 9
+    NODE_DOCUMENT = 9,
+    NODE_DOCUMENT_FRAGMENT = 11
 } DOMNodeType;
 
+// Positions for dom_element_insert_adjacent_html
+typedef enum {
+    DOM_ADJACENT_BEFORE_BEGIN,    // Before the element
+    DOM_ADJACENT_AFTER_BEGIN,     // Before its first child
+    DOM_ADJACENT_BEFORE_END,      // After its last child
+    DOM_ADJACENT_AFTER_END        // After the element
+} DOMAdjacentPosition;
+
+// Live collection kinds
+typedef enum {
+    DOM_COLLECTION_CHILD_NODES,   // All children of the root
+    DOM_COLLECTION_CHILDREN,      // Element children of the root
+    DOM_COLLECTION_BY_TAG_NAME,   // Descendant elements by tag ("*" for all)
+    DOM_COLLECTION_BY_CLASS_NAME  // Descendant elements carrying every class
+} DOMCollectionKind;
+
+/**
+ * Called when a cached script string is no longer valid
+ */
+typedef void (*DOMScriptCacheRelease)(void* value, void* user_data);
+
+/**
+ * Called when paint output cached on a node is no longer valid
+ */
+typedef void (*DOMPaintCacheRelease)(void* value, void* user_data);
+
+/**
+ * Called when a computed style stored on a node is no longer needed
+ */
+typedef void (*DOMStyleCacheRelease)(void* value, void* user_data);
+
+/**
+ * Called when layout results stored on a node are no longer needed
+ */
+typedef void (*DOMLayoutCacheRelease)(void* value, void* user_data);
+
+typedef enum {
+    DOM_MUTATION_ATTRIBUTE,         // An attribute of target is about to change
+    DOM_MUTATION_CHILD_LIST,        // Children were added to or removed from target
+    DOM_MUTATION_CHARACTER_DATA     // The text of a text node changed
+} DOMMutationType;
+
+/**
+ * A change to the tree, as reported to the document's mutation observer
+ */
+typedef struct {
+    DOMMutationType type;
+    DOMNode* target;
+    DOMNode* added;                 // Child list: the one inserted node, or NULL
+    DOMNode* removed;               // Child list: the one removed node, or NULL
+    const char* name;               // Attribute: the name (not NUL-terminated)
+    size_t name_length;
+    const char* old_value;          // Attribute: current value, NULL if unset
+    size_t old_value_length;
+    const char* value;              // Attribute: the value being set
+    size_t value_length;
+} DOMMutation;
+
+/**
+ * Called for every mutation of the document's tree. A child list record
+ * with neither added nor removed set means any of target's children may
+ * have changed.
+ */
+typedef void (*DOMMutationCallback)(const DOMMutation* mutation, void* user_data);
+
+// Style recalculation marks, see dom_node_mark_style_dirty
+#define DOM_STYLE_DIRTY_SELF 0x1        // The node's own style is stale
+#define DOM_STYLE_DIRTY_SUBTREE 0x2     // The node's and all descendants' styles are stale
+#define DOM_STYLE_DIRTY_CHILDREN 0x4    // Some descendant is marked
+
 /**
  * Create a new DOM document
  * @return Pointer to the document, or NULL on failure
@@ -25,7 +101,8 @@ typedef enum {
 DOMDocument* dom_document_create(void);
 
 /**
- * Destroy a DOM document and all its nodes
+ * Destroy a DOM document and all its nodes, including nodes that were
+ * created but never attached. Script bindings must be released first.
  * @param doc The document to destroy
  */
 void dom_document_destroy(DOMDocument* doc);
@@ -38,6 +115,40 @@ void dom_document_destroy(DOMDocument* doc);
  */
 DOMElement* dom_document_create_element(DOMDocument* doc, const char* tag_name);
 
+/**
+ * Create an element in the document from a tag name of known length
+ * @param doc The document
+ * @param tag_name The tag name (need not be NUL-terminated)
+ * @param tag_len Length of the tag name in bytes
+ * @return Pointer to the element, or NULL on failure
+ */
+DOMElement* dom_document_create_element_len(DOMDocument* doc, const char* tag_name, size_t tag_len);
+
+/**
+ * Create a text node in the document
+ * @param doc The document
+ * @param text The text
+ * @return Pointer to the node (detached), or NULL on failure
+ */
+DOMNode* dom_document_create_text_node(DOMDocument* doc, const char* text);
+
+/**
+ * Create a text node in the document from a string of known length
+ * @param doc The document
+ * @param text The text (need not be NUL-terminated)
+ * @param len Length of the text in bytes
+ * @return Pointer to the node (detached), or NULL on failure
+ */
+DOMNode* dom_document_create_text_node_len(DOMDocument* doc, const char* text, size_t len);
+
+/**
+ * Create an empty document fragment. Inserting a fragment moves all of
+ * its children in one splice and leaves it empty.
+ * @param doc The document
+ * @return Pointer to the fragment (detached), or NULL on failure
+ */
+DOMNode* dom_document_create_fragment(DOMDocument* doc);
+
 /**
  * Get the document element (root element)
  * @param doc The document
@@ -45,6 +156,25 @@ DOMElement* dom_document_create_element(DOMDocument* doc, const char* tag_name);
  */
 DOMElement* dom_document_get_element(DOMDocument* doc);
 
+/**
+ * Attach a structural tape to an empty document for lazy materialization.
+ * Only the document element is built up front; the rest of the tree is
+ * materialized on demand as lookups and traversals touch it.
+ * @param doc The document (must not have a document element yet)
+ * @param tape The tape (ownership passes to the document on success)
+ * @return 0 on success, -1 on failure
+ */
+int dom_document_attach_tape(DOMDocument* doc, HTMLTape* tape);
+
+/**
+ * Materialize a node's whole subtree, after which traversing it no longer
+ * modifies the document. Threads may only read a subtree concurrently
+ * once it is materialized.
+ * @param node The node
+ * @return 0 on success, -1 on failure
+ */
+int dom_node_materialize(DOMNode* node);
+
 /**
  * Get element by ID
  * @param doc The document
@@ -53,6 +183,15 @@ DOMElement* dom_document_get_element(DOMDocument* doc);
  */
 DOMElement* dom_document_get_element_by_id(DOMDocument* doc, const char* id);
 
+/**
+ * Get element by ID of known length
+ * @param doc The document
+ * @param id The element ID (need not be NUL-terminated)
+ * @param id_len Length of the ID in bytes
+ * @return Pointer to the element, or NULL if not found
+ */
+DOMElement* dom_document_get_element_by_id_len(DOMDocument* doc, const char* id, size_t id_len);
+
 /**
  * Append a child node to a parent node
  * @param parent The parent node
@@ -61,6 +200,186 @@ DOMElement* dom_document_get_element_by_id(DOMDocument* doc, const char* id);
  */
 int dom_node_append_child(DOMNode* parent, DOMNode* child);
 
+/**
+ * Insert a child node before a reference child. The child is first
+ * removed from wherever it currently is.
+ * @param parent The parent node
+ * @param child The node to insert (must not be an ancestor of parent)
+ * @param reference A child of parent, or NULL to append
+ * @return 0 on success, -1 on failure
+ */
+int dom_node_insert_before(DOMNode* parent, DOMNode* child, DOMNode* reference);
+
+/**
+ * Remove a child node from its parent. The node stays owned by the
+ * document as a detached root until released or re-inserted.
+ * @param parent The parent node
+ * @param child The child to remove
+ * @return 0 on success, -1 if child is not a child of parent
+ */
+int dom_node_remove_child(DOMNode* parent, DOMNode* child);
+
+/**
+ * Get the parent of a node
+ * @param node The node
+ * @return The parent, or NULL for roots and detached nodes
+ */
+DOMNode* dom_node_get_parent(DOMNode* node);
+
+/**
+ * Get the first child of a node
+ * @param node The node
+ * @return The first child, or NULL if there are none
+ */
+DOMNode* dom_node_get_first_child(DOMNode* node);
+
+/**
+ * Get the last child of a node
+ * @param node The node
+ * @return The last child, or NULL if there are none
+ */
+DOMNode* dom_node_get_last_child(DOMNode* node);
+
+/**
+ * Get the next sibling of a node
+ * @param node The node
+ * @return The next sibling, or NULL if there is none
+ */
+DOMNode* dom_node_get_next_sibling(DOMNode* node);
+
+/**
+ * Get the previous sibling of a node
+ * @param node The node
+ * @return The previous sibling, or NULL if there is none
+ */
+DOMNode* dom_node_get_previous_sibling(DOMNode* node);
+
+/**
+ * Get the document a node belongs to
+ * @param node The node
+ * @return The owner document (the document itself for a document node)
+ */
+DOMDocument* dom_node_get_owner_document(DOMNode* node);
+
+/**
+ * Get the node name: the tag name for elements, "#text" or "#document"
+ * @param node The node
+ * @return The node name
+ */
+const char* dom_node_get_name(DOMNode* node);
+
+/**
+ * Get the concatenated text of a node and its descendants
+ * @param node The node
+ * @return Newly allocated string (caller must free), or NULL on failure
+ */
+char* dom_node_get_text_content(DOMNode* node);
+
+/**
+ * Set the text of a node. Elements have their children replaced by a
+ * single text node (none for an empty string).
+ * @param node The node
+ * @param text The new text
+ * @return 0 on success, -1 on failure
+ */
+int dom_node_set_text_content(DOMNode* node, const char* text);
+
+/**
+ * Set the text of a node from a string of known length
+ * @param node The node
+ * @param text The new text (need not be NUL-terminated)
+ * @param len Length of the text in bytes
+ * @return 0 on success, -1 on failure
+ */
+int dom_node_set_text_content_len(DOMNode* node, const char* text, size_t len);
+
+/**
+ * Get the data of a text node without copying it
+ * @param node The text node
+ * @param len Output parameter for the length in bytes (may be NULL)
+ * @return The text, or NULL if node is not a text node
+ */
+const char* dom_node_get_value(DOMNode* node, size_t* len);
+
+/**
+ * Get the mutation version of a document. Every change to the tree or to
+ * attributes increments it, so cached query results can be validated.
+ * @param doc The document
+ * @return The current version
+ */
+uint64_t dom_document_get_version(DOMDocument* doc);
+
+/**
+ * Let a script engine cache its string objects on attribute values and
+ * text nodes. Every string cached under a previous hook is released
+ * through that hook first; pass NULL to drop the cache entirely.
+ * @param doc The document
+ * @param release Called with each cached string once it goes stale
+ * @param user_data Passed to release
+ */
+void dom_document_set_script_cache(DOMDocument* doc, DOMScriptCacheRelease release, void* user_data);
+
+/**
+ * Get the cached script string for an attribute value
+ * @param element The element
+ * @param name The attribute name (need not be NUL-terminated)
+ * @param name_len Length of the name in bytes
+ * @return The cached string, or NULL if none is cached
+ */
+void* dom_element_get_attribute_script_value(DOMElement* element, const char* name, size_t name_len);
+
+/**
+ * Cache a script string for an attribute value. The DOM owns the
+ * reference from here on and releases it when the value changes.
+ * @param element The element
+ * @param name The attribute name (need not be NUL-terminated)
+ * @param name_len Length of the name in bytes
+ * @param value The script string
+ * @return 0 on success, -1 if the attribute is missing or no hook is set
+ */
+int dom_element_set_attribute_script_value(DOMElement* element, const char* name, size_t name_len, void* value);
+
+/**
+ * Get the cached script string for a text node's data
+ * @param node The text node
+ * @return The cached string, or NULL if none is cached
+ */
+void* dom_node_get_script_value(DOMNode* node);
+
+/**
+ * Cache a script string for a text node's data. The DOM owns the
+ * reference from here on and releases it when the data changes.
+ * @param node The text node
+ * @param value The script string
+ * @return 0 on success, -1 if node is not a text node or no hook is set
+ */
+int dom_node_set_script_value(DOMNode* node, void* value);
+
+/**
+ * Get the script binding associated with a node
+ * @param node The node
+ * @return The binding (e.g. a JS wrapper object), or NULL if none is alive
+ */
+void* dom_node_get_binding(DOMNode* node);
+
+/**
+ * Associate a script binding with a node. The DOM holds it as a weak
+ * back-reference and never dereferences it; a node whose subtree holds a
+ * binding is kept alive as a detached root when the tree drops it.
+ * @param node The node
+ * @param binding The binding, or NULL to clear it
+ */
+void dom_node_set_binding(DOMNode* node, void* binding);
+
+/**
+ * Release a node after its binding was cleared. If the node's tree is
+ * detached from the document and no node in it has a binding, the whole
+ * tree is destroyed.
+ * @param node The node
+ * @return 1 if the tree was destroyed, 0 if it is still referenced
+ */
+int dom_node_release(DOMNode* node);
+
 /**
  * Get the node type
  * @param node The node
@@ -77,6 +396,18 @@ DOMNodeType dom_node_get_type(DOMNode* node);
  */
 int dom_element_set_attribute(DOMElement* element, const char* name, const char* value);
 
+/**
+ * Set an attribute on an element from strings of known length
+ * @param element The element
+ * @param name The attribute name (need not be NUL-terminated)
+ * @param name_len Length of the name in bytes
+ * @param value The attribute value (need not be NUL-terminated)
+ * @param value_len Length of the value in bytes
+ * @return 0 on success, -1 on failure
+ */
+int dom_element_set_attribute_len(DOMElement* element, const char* name, size_t name_len,
+                                  const char* value, size_t value_len);
+
 /**
  * Get an attribute from an element
  * @param element The element
@@ -85,6 +416,17 @@ int dom_element_set_attribute(DOMElement* element, const char* name, const char*
  */
 const char* dom_element_get_attribute(DOMElement* element, const char* name);
 
+/**
+ * Get an attribute and its length from an element
+ * @param element The element
+ * @param name The attribute name (need not be NUL-terminated)
+ * @param name_len Length of the name in bytes
+ * @param value_len Output parameter for the value length (may be NULL)
+ * @return The attribute value, or NULL if not found
+ */
+const char* dom_element_get_attribute_len(DOMElement* element, const char* name, size_t name_len,
+                                          size_t* value_len);
+
 /**
  * Get the tag name of an element
  * @param element The element
@@ -93,13 +435,34 @@ const char* dom_element_get_attribute(DOMElement* element, const char* name);
 const char* dom_element_get_tag_name(DOMElement* element);
 
 /**
- * Set the inner HTML of an element
+ * Set the inner HTML of an element. The markup is parsed into a fragment
+ * that replaces the element's children.
  * @param element The element
  * @param html The HTML content
  * @return 0 on success, -1 on failure
  */
 int dom_element_set_inner_html(DOMElement* element, const char* html);
 
+/**
+ * Set the inner HTML of an element from a string of known length
+ * @param element The element
+ * @param html The HTML content (need not be NUL-terminated)
+ * @param len Length of the content in bytes
+ * @return 0 on success, -1 on failure
+ */
+int dom_element_set_inner_html_len(DOMElement* element, const char* html, size_t len);
+
+/**
+ * Parse markup and insert the nodes relative to an element
+ * @param element The element
+ * @param position Where the nodes go
+ * @param html The HTML content (need not be NUL-terminated)
+ * @param len Length of the content in bytes
+ * @return 0 on success, -1 on failure (the outside positions need a parent element)
+ */
+int dom_element_insert_adjacent_html(DOMElement* element, DOMAdjacentPosition position,
+                                     const char* html, size_t len);
+
 /**
  * Event callback type
  */
@@ -132,6 +495,178 @@ int dom_element_trigger_event(DOMElement* element, const char* event_type);
  */
 DOMElement* dom_element_query_selector(DOMElement* element, const char* selector);
 
+/**
+ * Create a live collection over a subtree. Matches are found lazily and
+ * cached until the document's mutation version changes.
+ * @param root The node the collection is rooted at (not owned)
+ * @param kind What the collection selects
+ * @param name Tag name or space-separated class names for the by-name kinds
+ * @return Pointer to the collection, or NULL on failure
+ */
+DOMCollection* dom_collection_create(DOMNode* root, DOMCollectionKind kind, const char* name);
+
+/**
+ * Destroy a live collection
+ * @param collection The collection to destroy
+ */
+void dom_collection_destroy(DOMCollection* collection);
+
+/**
+ * Get the number of nodes in a collection
+ * @param collection The collection
+ * @return The length
+ */
+size_t dom_collection_length(DOMCollection* collection);
+
+/**
+ * Get a node of a collection by index, walking only as far as needed
+ * @param collection The collection
+ * @param index The index
+ * @return The node, or NULL if index is out of range
+ */
+DOMNode* dom_collection_item(DOMCollection* collection, size_t index);
+
+/**
+ * Get the root node of a collection
+ * @param collection The collection
+ * @return The root node
+ */
+DOMNode* dom_collection_get_root(DOMCollection* collection);
+
+/**
+ * Let a painter cache its output (e.g. a display list) per node. Any
+ * mutation releases the cache of the mutated node and of every ancestor,
+ * so unrelated subtrees keep theirs. Caches stored under a previous hook
+ * are released through that hook first; pass NULL to drop them all.
+ * @param doc The document
+ * @param release Called with each cached value once it goes stale
+ * @param user_data Passed to release
+ */
+void dom_document_set_paint_cache(DOMDocument* doc, DOMPaintCacheRelease release, void* user_data);
+
+/**
+ * Get the paint output cached for a node's subtree
+ * @param node The node
+ * @return The cached value, or NULL if none is cached
+ */
+void* dom_node_get_paint_cache(DOMNode* node);
+
+/**
+ * Cache paint output for a node's subtree. The DOM owns the value from here
+ * on and releases it once the subtree changes.
+ * @param node The node
+ * @param value The value to cache
+ * @return 0 on success, -1 if no paint cache hook is set
+ */
+int dom_node_set_paint_cache(DOMNode* node, void* value);
+
+/**
+ * Let a style engine keep a computed style per node. Unlike paint caches,
+ * styles survive mutations; the style engine decides when to recompute
+ * them. Styles stored under a previous hook are released through that
+ * hook first; pass NULL to drop them all.
+ * @param doc The document
+ * @param release Called with each stored style once its node goes away
+ * @param user_data Passed to release
+ */
+void dom_document_set_style_cache(DOMDocument* doc, DOMStyleCacheRelease release, void* user_data);
+
+/**
+ * Get the computed style stored on a node
+ * @param node The node
+ * @return The stored style, or NULL if none is stored
+ */
+void* dom_node_get_style_cache(DOMNode* node);
+
+/**
+ * Store a computed style on a node, releasing the previous one. The DOM
+ * owns the value from here on.
+ * @param node The node
+ * @param value The style, or NULL to clear it
+ * @return 0 on success, -1 if no style cache hook is set
+ */
+int dom_node_set_style_cache(DOMNode* node, void* value);
+
+/**
+ * Let a layout engine keep layout results per node. Like styles, they
+ * survive mutations: a mutation marks the node and its ancestors layout
+ * dirty instead (see dom_node_mark_layout_dirty). Results stored under a
+ * previous hook are released through that hook first; pass NULL to drop
+ * them all.
+ * @param doc The document
+ * @param release Called with each stored value once its node goes away
+ * @param user_data Passed to release
+ */
+void dom_document_set_layout_cache(DOMDocument* doc, DOMLayoutCacheRelease release, void* user_data);
+
+/**
+ * Get the layout results stored on a node
+ * @param node The node
+ * @return The stored value, or NULL if none is stored
+ */
+void* dom_node_get_layout_cache(DOMNode* node);
+
+/**
+ * Store layout results on a node, releasing the previous value. The DOM
+ * owns the value from here on.
+ * @param node The node
+ * @param value The value, or NULL to clear it
+ * @return 0 on success, -1 if no layout cache hook is set
+ */
+int dom_node_set_layout_cache(DOMNode* node, void* value);
+
+/**
+ * Mark a node and all of its ancestors as needing layout. Every mutation
+ * does this for the mutated node; a style engine does it for elements
+ * whose computed style changed.
+ * @param node The node
+ */
+void dom_node_mark_layout_dirty(DOMNode* node);
+
+/**
+ * Check whether a node or anything below it needs layout
+ * @param node The node
+ * @return 1 if marked, 0 otherwise
+ */
+int dom_node_get_layout_dirty(DOMNode* node);
+
+/**
+ * Clear a node's layout dirty mark
+ * @param node The node
+ */
+void dom_node_clear_layout_dirty(DOMNode* node);
+
+/**
+ * Observe mutations of a document. Only one observer can be set; setting
+ * another replaces it.
+ * @param doc The document
+ * @param callback Called for every mutation, or NULL to stop observing
+ * @param user_data Passed to callback
+ */
+void dom_document_set_mutation_observer(DOMDocument* doc, DOMMutationCallback callback, void* user_data);
+
+/**
+ * Mark a node's style for recalculation. Every ancestor is marked with
+ * DOM_STYLE_DIRTY_CHILDREN, so a style engine can find marked nodes
+ * without visiting clean subtrees.
+ * @param node The node
+ * @param flags DOM_STYLE_DIRTY_SELF and/or DOM_STYLE_DIRTY_SUBTREE
+ */
+void dom_node_mark_style_dirty(DOMNode* node, unsigned int flags);
+
+/**
+ * Get the style recalculation marks of a node
+ * @param node The node
+ * @return DOM_STYLE_DIRTY_* flags
+ */
+unsigned int dom_node_get_style_dirty(DOMNode* node);
+
+/**
+ * Clear the style recalculation marks of a node
+ * @param node The node
+ */
+void dom_node_clear_style_dirty(DOMNode* node);
+
 #ifdef __cplusplus
 }
 #endif
@@ -6,6 +6,16 @@ extern "C" {
 #endif
 
 #include "dom/dom.h"
+#include <stddef.h>
+
+/**
+ * Called for each <script> element as soon as its body has been parsed
+ * @param script The script element
+ * @param source The script body (not NUL-terminated; valid during the call)
+ * @param length Length of the body in bytes
+ * @param user_data User data passed to the parser
+ */
+typedef void (*HTMLScriptCallback)(DOMElement* script, const char* source, size_t length, void* user_data);
 
 /**
  * Parse HTML string and create DOM tree
@@ -15,6 +25,42 @@ extern "C" {
  */
 int html_parser_parse(DOMDocument* document, const char* html);
 
+/**
+ * Parse HTML and hand each <script> body to a callback while parsing
+ * continues, so script compilation can overlap with the parse
+ * @param document The document to populate
+ * @param html The HTML string to parse
+ * @param callback Called for each script element in document order
+ * @param user_data User data passed to the callback
+ * @return 0 on success, -1 on failure
+ */
+int html_parser_parse_with_scripts(DOMDocument* document, const char* html,
+                                   HTMLScriptCallback callback, void* user_data);
+
+/**
+ * Parse an HTML fragment into a new document fragment node, as innerHTML
+ * and insertAdjacentHTML do. Scripts in the fragment are not reported.
+ * @param document The document that owns the new nodes
+ * @param context Tag name of the element the fragment is parsed for
+ *        (script and style take their content as text), or NULL
+ * @param html The markup (need not be NUL-terminated)
+ * @param length Length of the markup in bytes
+ * @return The fragment (detached, owned by the document), or NULL on failure
+ */
+DOMNode* html_parser_parse_fragment(DOMDocument* document, const char* context,
+                                    const char* html, size_t length);
+
+/**
+ * Parse HTML lazily: record a structural tape in one pass and materialize
+ * DOM nodes only when a subtree is first touched (getElementById,
+ * querySelector, traversal or JavaScript). Suited to extraction jobs that
+ * only read a small part of the tree.
+ * @param document The document to populate (must be empty)
+ * @param html The HTML string to parse
+ * @return 0 on success, -1 on failure
+ */
+int html_parser_parse_lazy(DOMDocument* document, const char* html);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,118 @@
+#ifndef JUST_BROWSE_HTML_TAPE_H
+#define JUST_BROWSE_HTML_TAPE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Sentinel returned by the tape search functions when nothing matches
+#define HTML_TAPE_NONE UINT32_MAX
+
+// Tape entry kinds
+typedef enum {
+    HTML_TAPE_ELEMENT = 1,
+    HTML_TAPE_TEXT = 2
+} HTMLTapeKind;
+
+/**
+ * Attribute record: byte ranges into the tape's source copy
+ */
+typedef struct {
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t value_offset;
+    uint32_t value_length;
+} HTMLTapeAttribute;
+
+/**
+ * One structural token. Elements record their tag name range and the
+ * index just past their subtree (where the matching close tag sits), so
+ * a whole subtree can be skipped in O(1). Text entries record the trimmed
+ * text range and always have end == index + 1.
+ */
+typedef struct {
+    uint32_t offset;       // Tag name or text start in source
+    uint32_t length;       // Tag name or text length
+    uint32_t end;          // Index one past the last entry of this subtree
+    uint32_t attr_first;   // First attribute in the attribute table
+    uint16_t attr_count;
+    uint8_t kind;          // HTMLTapeKind
+    uint8_t reserved;
+} HTMLTapeEntry;
+
+/**
+ * Compact structural tape produced by a single lexical pass over HTML.
+ * Entries are in document order; entry 0 is the document element.
+ */
+typedef struct HTMLTape {
+    char* source;
+    size_t source_length;
+    HTMLTapeEntry* entries;
+    uint32_t entry_count;
+    uint32_t entry_capacity;
+    HTMLTapeAttribute* attrs;
+    uint32_t attr_count;
+    uint32_t attr_capacity;
+} HTMLTape;
+
+/**
+ * Build a structural tape from HTML
+ * @param html The HTML string (copied into the tape)
+ * @param length Length of the HTML string in bytes
+ * @return Pointer to the tape, or NULL on failure
+ */
+HTMLTape* html_tape_build(const char* html, size_t length);
+
+/**
+ * Destroy a tape
+ * @param tape The tape to destroy
+ */
+void html_tape_destroy(HTMLTape* tape);
+
+/**
+ * Find the first element in [first, end) whose attribute equals a value
+ * @param tape The tape
+ * @param first First entry index to examine
+ * @param end Index one past the last entry to examine
+ * @param name The attribute name
+ * @param value The attribute value to match exactly
+ * @return The entry index, or HTML_TAPE_NONE if not found
+ */
+uint32_t html_tape_find_attribute(const HTMLTape* tape, uint32_t first, uint32_t end,
+                                  const char* name, const char* value);
+
+/**
+ * Find the first element in [first, end) whose attribute equals a value,
+ * with explicit lengths
+ * @param tape The tape
+ * @param first First entry index to examine
+ * @param end Index one past the last entry to examine
+ * @param name The attribute name
+ * @param name_len Length of the name in bytes
+ * @param value The attribute value to match exactly
+ * @param value_len Length of the value in bytes
+ * @return The entry index, or HTML_TAPE_NONE if not found
+ */
+uint32_t html_tape_find_attribute_len(const HTMLTape* tape, uint32_t first, uint32_t end,
+                                      const char* name, size_t name_len,
+                                      const char* value, size_t value_len);
+
+/**
+ * Find the first element in [first, end) matching a simple selector
+ * @param tape The tape
+ * @param first First entry index to examine
+ * @param end Index one past the last entry to examine
+ * @param selector The selector (tag, #id or .class, as dom_element_query_selector)
+ * @return The entry index, or HTML_TAPE_NONE if not found
+ */
+uint32_t html_tape_find_selector(const HTMLTape* tape, uint32_t first, uint32_t end,
+                                 const char* selector);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_HTML_TAPE_H
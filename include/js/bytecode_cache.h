@@ -0,0 +1,113 @@
+#ifndef JUST_BROWSE_BYTECODE_CACHE_H
+#define JUST_BROWSE_BYTECODE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Forward declarations
+typedef struct JSBytecodeCache JSBytecodeCache;
+typedef struct JSBytecodeEntry JSBytecodeEntry;
+
+/**
+ * Content hash identifying a compiled script
+ */
+typedef struct {
+    uint64_t hi;
+    uint64_t lo;
+} JSBytecodeKey;
+
+/**
+ * Cache configuration. Zero budgets select the defaults.
+ */
+typedef struct {
+    size_t memory_budget;   // Bytes kept in the in-memory LRU tier
+    const char* disk_path;  // Directory for the on-disk tier, or NULL to disable it
+    size_t disk_budget;     // Bytes kept in the on-disk tier
+} JSBytecodeCacheConfig;
+
+/**
+ * Cache counters
+ */
+typedef struct {
+    uint64_t memory_hits;
+    uint64_t disk_hits;
+    uint64_t misses;
+    uint64_t stores;
+    uint64_t evictions;
+    size_t memory_bytes;
+    size_t disk_bytes;
+} JSBytecodeCacheStats;
+
+/**
+ * Create a bytecode cache. The cache is thread-safe and meant to be shared
+ * by every engine in the process.
+ * @param config The configuration, or NULL for defaults (memory tier only)
+ * @return Pointer to the cache, or NULL on failure
+ */
+JSBytecodeCache* js_bytecode_cache_create(const JSBytecodeCacheConfig* config);
+
+/**
+ * Destroy a bytecode cache. All acquired entries must have been released.
+ * @param cache The cache to destroy
+ */
+void js_bytecode_cache_destroy(JSBytecodeCache* cache);
+
+/**
+ * Compute the cache key for a script
+ * @param source The script source
+ * @param length Length of the source in bytes
+ * @param filename The filename the script is compiled under (part of the key)
+ * @return The key
+ */
+JSBytecodeKey js_bytecode_cache_key(const char* source, size_t length, const char* filename);
+
+/**
+ * Look up compiled bytecode, consulting the memory tier and then the disk
+ * tier. Disk hits are mapped with mmap and promoted into the memory tier.
+ * @param cache The cache
+ * @param key The key
+ * @return An entry to be released with js_bytecode_cache_release, or NULL on miss
+ */
+JSBytecodeEntry* js_bytecode_cache_acquire(JSBytecodeCache* cache, JSBytecodeKey key);
+
+/**
+ * Get the bytecode held by an acquired entry
+ * @param entry The entry
+ * @param size Output parameter for the bytecode size
+ * @return Pointer to the bytecode (valid until the entry is released)
+ */
+const uint8_t* js_bytecode_entry_data(const JSBytecodeEntry* entry, size_t* size);
+
+/**
+ * Release an entry returned by js_bytecode_cache_acquire
+ * @param cache The cache
+ * @param entry The entry
+ */
+void js_bytecode_cache_release(JSBytecodeCache* cache, JSBytecodeEntry* entry);
+
+/**
+ * Store compiled bytecode in both tiers
+ * @param cache The cache
+ * @param key The key
+ * @param data The bytecode (copied)
+ * @param size Size of the bytecode in bytes
+ * @return 0 on success, -1 on failure
+ */
+int js_bytecode_cache_store(JSBytecodeCache* cache, JSBytecodeKey key, const uint8_t* data, size_t size);
+
+/**
+ * Get cache counters
+ * @param cache The cache
+ * @param stats Output parameter for the counters
+ */
+void js_bytecode_cache_get_stats(JSBytecodeCache* cache, JSBytecodeCacheStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_BYTECODE_CACHE_H
@@ -0,0 +1,68 @@
+#ifndef JUST_BROWSE_ENGINE_POOL_H
+#define JUST_BROWSE_ENGINE_POOL_H
+
+#include "js/js_engine.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Forward declarations
+typedef struct JSEnginePool JSEnginePool;
+
+/**
+ * Pool usage counters
+ */
+typedef struct {
+    size_t idle;            // Engines ready to hand out
+    size_t hits;            // Acquires served from the pool
+    size_t misses;          // Acquires that had to build an engine
+    size_t discarded;       // Released engines destroyed (pool full or reset failed)
+} JSEnginePoolStats;
+
+/**
+ * Create a pool of pre-initialized JS engines. The pool is thread-safe,
+ * but an engine must be used on the thread that created it, as QuickJS
+ * records the stack base at runtime creation.
+ * @param capacity Maximum number of idle engines kept
+ * @param prewarm Number of engines built up front (clamped to capacity)
+ * @param config Runtime limits applied to every engine, or NULL for defaults
+ * @return Pointer to the pool, or NULL on failure
+ */
+JSEnginePool* js_engine_pool_create(size_t capacity, size_t prewarm, const JSEngineConfig* config);
+
+/**
+ * Destroy a pool and every idle engine in it. Acquired engines must have
+ * been released or destroyed.
+ * @param pool The pool to destroy
+ */
+void js_engine_pool_destroy(JSEnginePool* pool);
+
+/**
+ * Take a pristine engine from the pool, building one if the pool is empty
+ * @param pool The pool
+ * @return The engine, or NULL on failure
+ */
+JSEngine* js_engine_pool_acquire(JSEnginePool* pool);
+
+/**
+ * Return an engine to the pool. The engine is reset here so the next
+ * acquire does no setup work.
+ * @param pool The pool
+ * @param engine The engine (may be bound to a document that is still alive)
+ */
+void js_engine_pool_release(JSEnginePool* pool, JSEngine* engine);
+
+/**
+ * Get pool counters
+ * @param pool The pool
+ * @param stats Output parameter for the counters
+ */
+void js_engine_pool_get_stats(JSEnginePool* pool, JSEnginePoolStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_ENGINE_POOL_H
@@ -1,6 +1,9 @@
 #ifndef JUST_BROWSE_JS_ENGINE_H
 #define JUST_BROWSE_JS_ENGINE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -8,6 +11,91 @@ extern "C" {
 // Forward declarations
 typedef struct JSEngine JSEngine;
 typedef struct DOMDocument DOMDocument;
+typedef struct JSBytecodeCache JSBytecodeCache;
+
+/**
+ * Runtime limits. Zero fields keep the QuickJS defaults.
+ */
+typedef struct {
+    size_t memory_limit;    // Heap limit in bytes; allocations past it throw
+    size_t gc_threshold;    // Heap growth in bytes that triggers an automatic GC
+    size_t max_stack_size;  // Native stack budget in bytes for JS execution
+} JSEngineConfig;
+
+/**
+ * Execution budgets. Zero fields are unlimited. Instructions are counted
+ * in interrupt ticks of about 10000 QuickJS operations, so instruction
+ * budgets are enforced at that granularity.
+ */
+typedef struct {
+    uint64_t eval_time_ns;          // Wall time allowed for one eval
+    uint64_t eval_instructions;     // Operations allowed for one eval
+    uint64_t page_time_ns;          // Wall time allowed across the page's evals
+    uint64_t page_instructions;     // Operations allowed across the page's evals
+} JSEngineBudget;
+
+// Returned by evals stopped because a budget ran out
+#define JS_ENGINE_BUDGET_EXCEEDED -2
+
+/**
+ * Console message severity
+ */
+typedef enum {
+    JS_CONSOLE_DEBUG,
+    JS_CONSOLE_LOG,             // console.log and console.info
+    JS_CONSOLE_WARN,
+    JS_CONSOLE_ERROR
+} JSConsoleLevel;
+
+/**
+ * Receives console output in batches, one call per message
+ * @param level The message severity
+ * @param message The formatted message (not NUL-terminated)
+ * @param length Length of the message in bytes
+ * @param user_data The pointer given to js_engine_set_console_sink
+ */
+typedef void (*JSConsoleSink)(JSConsoleLevel level, const char* message, size_t length, void* user_data);
+
+/**
+ * Supplies module sources to the module loader
+ * @param module_name The resolved module name (relative specifiers are
+ *                    already resolved against the importing module)
+ * @param length Output parameter for the source length in bytes
+ * @param user_data The pointer given to js_engine_set_module_provider
+ * @return The source in a buffer from malloc (the engine frees it), or NULL if not found
+ */
+typedef char* (*JSModuleProvider)(const char* module_name, size_t* length, void* user_data);
+
+/**
+ * Heap breakdown from JS_ComputeMemoryUsage plus GC accounting
+ */
+typedef struct {
+    int64_t malloc_size;        // Bytes allocated by the runtime
+    int64_t malloc_limit;       // Configured limit (-1 when unlimited)
+    int64_t memory_used_size;   // Bytes in use including allocator overhead
+    int64_t malloc_count;
+    int64_t atom_count;
+    int64_t atom_size;
+    int64_t str_count;
+    int64_t str_size;
+    int64_t obj_count;
+    int64_t obj_size;
+    int64_t prop_count;
+    int64_t prop_size;
+    int64_t shape_count;
+    int64_t shape_size;
+    int64_t js_func_count;
+    int64_t js_func_size;
+    int64_t js_func_code_size;
+    int64_t c_func_count;
+    int64_t array_count;
+    int64_t fast_array_count;
+    int64_t fast_array_elements;
+    int64_t binary_object_count;
+    int64_t binary_object_size;
+    uint64_t explicit_gc_count;     // Collections run by js_engine_run_gc (not QuickJS's own)
+    uint64_t explicit_gc_time_ns;   // Time spent in those collections
+} JSEngineHeapStats;
 
 /**
  * Initialize the JavaScript engine (QuickJS)
@@ -15,12 +103,30 @@ typedef struct DOMDocument DOMDocument;
  */
 JSEngine* js_engine_init(void);
 
+/**
+ * Initialize the JavaScript engine with runtime limits
+ * @param config The limits, or NULL for QuickJS defaults
+ * @return Pointer to the JS engine instance, or NULL on failure
+ */
+JSEngine* js_engine_init_with_config(const JSEngineConfig* config);
+
 /**
  * Destroy the JavaScript engine
  * @param engine The JS engine instance to destroy
  */
 void js_engine_destroy(JSEngine* engine);
 
+/**
+ * Return the engine to its pristine state: the context is replaced with a
+ * fresh one (DOM prototypes and console installed, no document bound) while
+ * the runtime is kept. Wrappers from the old context are finalized before
+ * this returns. The bytecode cache, module provider and console sink are
+ * dropped along with the page that set them.
+ * @param engine The JS engine instance
+ * @return 0 on success, -1 on failure (the engine must then be destroyed)
+ */
+int js_engine_reset(JSEngine* engine);
+
 /**
  * Bind DOM to the JavaScript engine
  * This creates the document object and DOM APIs in JavaScript context
@@ -34,10 +140,188 @@ int js_engine_bind_dom(JSEngine* engine, DOMDocument* document);
  * Evaluate JavaScript code
  * @param engine The JS engine instance
  * @param script The JavaScript code to evaluate
- * @return 0 on success, -1 on failure
+ * @return 0 on success, JS_ENGINE_BUDGET_EXCEEDED if a budget ran out, -1 on other failures
  */
 int js_engine_eval(JSEngine* engine, const char* script);
 
+/**
+ * Evaluate an ES module. Imports are fetched through the module provider.
+ * Module bytecode is cached (in the shared bytecode cache when set, else
+ * per engine), so later pages reuse a compiled dependency graph.
+ * @param engine The JS engine instance
+ * @param source The module source
+ * @param filename The module name, used to resolve relative imports
+ * @return 0 on success, JS_ENGINE_BUDGET_EXCEEDED if a budget ran out, -1 on other failures
+ */
+int js_engine_eval_module(JSEngine* engine, const char* source, const char* filename);
+
+/**
+ * Set where the module loader gets module sources from
+ * @param engine The JS engine instance
+ * @param provider The provider, or NULL to disable imports
+ * @param user_data Passed to the provider
+ * @return 0 on success, -1 on failure
+ */
+int js_engine_set_module_provider(JSEngine* engine, JSModuleProvider provider, void* user_data);
+
+/**
+ * Run a script previously compiled to bytecode (e.g. by a compile pool)
+ * @param engine The JS engine instance
+ * @param bytecode Serialized bytecode from JS_WriteObject
+ * @param size Size of the bytecode in bytes
+ * @return 0 on success, JS_ENGINE_BUDGET_EXCEEDED if a budget ran out, -1 on other failures
+ */
+int js_engine_eval_bytecode(JSEngine* engine, const uint8_t* bytecode, size_t size);
+
+/**
+ * Get the engine's virtual clock, which drives setTimeout, setInterval and
+ * requestAnimationFrame. It only moves when the embedder advances it.
+ * @param engine The JS engine instance
+ * @return Milliseconds since the page's event loop started
+ */
+uint64_t js_engine_now(JSEngine* engine);
+
+/**
+ * Move the virtual clock forward, running timers and animation frames that
+ * fall due along the way in time order. Microtasks are drained after each.
+ * @param engine The JS engine instance
+ * @param ms Milliseconds to advance
+ * @return 0 on success, JS_ENGINE_BUDGET_EXCEEDED if a budget ran out, -1 on failure
+ */
+int js_engine_advance_time(JSEngine* engine, uint64_t ms);
+
+/**
+ * Run the event loop until no timers or animation frames are pending,
+ * fast-forwarding the virtual clock instead of sleeping
+ * @param engine The JS engine instance
+ * @param timeout_ms Virtual time allowed before giving up
+ * @return 0 when idle, 1 if work is still pending at the timeout,
+ *         JS_ENGINE_BUDGET_EXCEEDED if a budget ran out, -1 on failure
+ */
+int js_engine_run_until_idle(JSEngine* engine, uint64_t timeout_ms);
+
+/**
+ * Compile scripts through a shared bytecode cache. Evaluated scripts are
+ * compiled once, serialized, and reused by every engine using the cache.
+ * @param engine The JS engine instance
+ * @param cache The cache (not owned; must outlive the engine), or NULL to disable
+ * @return 0 on success, -1 on failure
+ */
+int js_engine_set_bytecode_cache(JSEngine* engine, JSBytecodeCache* cache);
+
+/**
+ * Set execution budgets, enforced through the QuickJS interrupt handler.
+ * An eval that runs out is terminated (try/catch cannot intercept it) and
+ * the engine stays usable. Once the page budget is spent, evals fail
+ * immediately until js_engine_reset_page_budget is called. Budgets are
+ * kept across js_engine_reset.
+ * @param engine The JS engine instance
+ * @param budget The budgets, or NULL to remove them
+ * @return 0 on success, -1 on failure
+ */
+int js_engine_set_budget(JSEngine* engine, const JSEngineBudget* budget);
+
+/**
+ * Start a new page: forget time and instructions charged to the page budget
+ * @param engine The JS engine instance
+ */
+void js_engine_reset_page_budget(JSEngine* engine);
+
+/**
+ * Run a full garbage collection now. Collections QuickJS triggers on its
+ * own when the GC threshold is crossed are not observable and are not
+ * counted; an embedder that wants GC kept out of script execution can set
+ * a high threshold and call this between tasks.
+ * @param engine The JS engine instance
+ * @return 0 on success, -1 on failure
+ */
+int js_engine_run_gc(JSEngine* engine);
+
+/**
+ * Get heap statistics. This walks the whole heap; call it for reporting,
+ * not on hot paths. The GC counters cover only collections run through
+ * js_engine_run_gc; QuickJS does not report the ones it triggers itself
+ * as allocations cross the GC threshold.
+ * @param engine The JS engine instance
+ * @param stats Output parameter for the statistics
+ * @return 0 on success, -1 on failure
+ */
+int js_engine_get_heap_stats(JSEngine* engine, JSEngineHeapStats* stats);
+
+/**
+ * Start sampling the JS stack. A shared SIGPROF timer (a clock check under
+ * WASM) marks when a sample is due and the interrupt handler captures the
+ * running stack, so only script execution is sampled. When several engines
+ * profile at once the timer runs at the rate of the first one started.
+ * @param engine The JS engine instance
+ * @param interval_us Sampling interval in microseconds (0 for 1000)
+ * @return 0 on success, -1 on failure or if already profiling
+ */
+int js_engine_profiler_start(JSEngine* engine, uint32_t interval_us);
+
+/**
+ * Stop sampling. Collected samples are kept until cleared.
+ * @param engine The JS engine instance
+ * @return 0 on success, -1 if not profiling
+ */
+int js_engine_profiler_stop(JSEngine* engine);
+
+/**
+ * Discard collected samples
+ * @param engine The JS engine instance
+ */
+void js_engine_profiler_clear(JSEngine* engine);
+
+/**
+ * Get the number of samples collected
+ * @param engine The JS engine instance
+ * @return The sample count
+ */
+uint64_t js_engine_profiler_sample_count(JSEngine* engine);
+
+/**
+ * Export samples as collapsed stacks ("outer;inner;leaf count" per line),
+ * the input format of flamegraph tools
+ * @param engine The JS engine instance
+ * @return Newly allocated text (caller frees), or NULL on failure
+ */
+char* js_engine_profiler_export_collapsed(JSEngine* engine);
+
+/**
+ * Export samples as JSON: per-function self and total counts plus
+ * per-stack counts
+ * @param engine The JS engine instance
+ * @return Newly allocated JSON (caller frees), or NULL on failure
+ */
+char* js_engine_profiler_export_json(JSEngine* engine);
+
+/**
+ * Route console output to a sink. Messages are buffered per engine and
+ * flushed after each script or task; messages that do not fit in the
+ * buffer are dropped and counted. Without a sink each batch is written to
+ * stdout in a single call.
+ * @param engine The JS engine instance
+ * @param sink The sink, or NULL for stdout
+ * @param user_data Passed to the sink
+ * @param capacity Buffer size in bytes (0 for 64 KiB)
+ * @return 0 on success, -1 on failure
+ */
+int js_engine_set_console_sink(JSEngine* engine, JSConsoleSink sink, void* user_data, size_t capacity);
+
+/**
+ * Deliver buffered console messages now
+ * @param engine The JS engine instance
+ * @return 0 on success, -1 on failure
+ */
+int js_engine_flush_console(JSEngine* engine);
+
+/**
+ * Get the number of console messages dropped because the buffer was full
+ * @param engine The JS engine instance
+ * @return The drop count
+ */
+uint64_t js_engine_console_dropped(JSEngine* engine);
+
 /**
  * Get the last error message
  * @param engine The JS engine instance
@@ -45,6 +329,15 @@ int js_engine_eval(JSEngine* engine, const char* script);
  */
 const char* js_engine_get_error(JSEngine* engine);
 
+/**
+ * Record an error raised outside the engine, such as a script that failed
+ * to compile off-thread, as the last error
+ * @param engine The JS engine instance
+ * @param message The error message
+ * @return 0 on success, -1 on failure
+ */
+int js_engine_set_error(JSEngine* engine, const char* message);
+
 #ifdef __cplusplus
 }
 #endif
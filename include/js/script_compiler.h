@@ -0,0 +1,79 @@
+#ifndef JUST_BROWSE_SCRIPT_COMPILER_H
+#define JUST_BROWSE_SCRIPT_COMPILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Forward declarations
+typedef struct JSCompilePool JSCompilePool;
+typedef struct JSCompileJob JSCompileJob;
+typedef struct JSBytecodeCache JSBytecodeCache;
+
+/**
+ * Create a pool of compiler threads. Each worker owns a private QuickJS
+ * runtime and compiles submitted scripts to serialized bytecode.
+ * @param thread_count Number of worker threads (<= 0 picks the CPU count)
+ * @return Pointer to the pool, or NULL on failure
+ */
+JSCompilePool* js_compile_pool_create(int thread_count);
+
+/**
+ * Destroy a compile pool. Outstanding jobs are finished first.
+ * @param pool The pool to destroy
+ */
+void js_compile_pool_destroy(JSCompilePool* pool);
+
+/**
+ * Let workers consult and fill a bytecode cache
+ * @param pool The pool
+ * @param cache The cache (not owned), or NULL to disable
+ */
+void js_compile_pool_set_bytecode_cache(JSCompilePool* pool, JSBytecodeCache* cache);
+
+/**
+ * Queue a script for compilation
+ * @param pool The pool
+ * @param source The script source (copied)
+ * @param length Length of the source in bytes
+ * @param filename The filename used for compilation
+ * @return The job, or NULL on failure
+ */
+JSCompileJob* js_compile_pool_submit(JSCompilePool* pool, const char* source, size_t length, const char* filename);
+
+/**
+ * Block until a job has finished
+ * @param job The job
+ * @return 0 if the script compiled, -1 on a compile error
+ */
+int js_compile_job_wait(JSCompileJob* job);
+
+/**
+ * Get the serialized bytecode of a finished job
+ * @param job The job
+ * @param size Output parameter for the bytecode size
+ * @return Pointer to the bytecode, or NULL if compilation failed
+ */
+const uint8_t* js_compile_job_bytecode(JSCompileJob* job, size_t* size);
+
+/**
+ * Get the compile error of a finished job
+ * @param job The job
+ * @return The error message, or NULL if compilation succeeded
+ */
+const char* js_compile_job_error(JSCompileJob* job);
+
+/**
+ * Free a job. Waits for it to finish if it is still queued or running.
+ * @param job The job
+ */
+void js_compile_job_free(JSCompileJob* job);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_SCRIPT_COMPILER_H
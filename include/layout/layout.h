@@ -0,0 +1,159 @@
+#ifndef JUST_BROWSE_LAYOUT_H
+#define JUST_BROWSE_LAYOUT_H
+
+#include "css/style.h"
+#include "dom/dom.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct LayoutEngine LayoutEngine;
+typedef struct ThreadPool ThreadPool;
+
+typedef struct {
+    float x;
+    float y;
+    float width;
+    float height;
+} LayoutRect;
+
+/**
+ * Box geometry of an element in document coordinates. Sides are ordered
+ * top, right, bottom, left. Inline elements report the union of their text
+ * fragments as both boxes and zero edges.
+ */
+typedef struct {
+    LayoutRect border_box;
+    LayoutRect content_box;
+    float margin[4];
+    float border[4];
+    float padding[4];
+} LayoutGeometry;
+
+/**
+ * A piece of a line box: a run of text from one text node, or an atomic
+ * inline box (an inline-block element)
+ */
+typedef struct {
+    DOMNode* node;                  // Text node, or the inline-block element
+    const ComputedStyle* style;     // Style the text is drawn with
+    LayoutRect rect;                // Document coordinates
+    const char* text;               // Whitespace-processed text (not NUL-terminated); NULL for boxes
+    size_t length;
+    size_t line;                    // Line index within the block container
+} LayoutFragment;
+
+// Counters for the most recent layout_engine_layout
+typedef struct {
+    size_t boxes_laid_out;          // Element boxes whose layout was recomputed
+    size_t boxes_reused;            // Clean subtrees whose cached layout was kept
+    size_t lines;                   // Line boxes built
+} LayoutStats;
+
+/**
+ * Measure the advance width of a run of text
+ * @param text The text (not NUL-terminated)
+ * @param length Length in bytes
+ * @param style Style of the text
+ * @param user_data The pointer passed to layout_engine_set_text_measure
+ * @return Width in px
+ */
+typedef float (*LayoutMeasureText)(const char* text, size_t length, const ComputedStyle* style, void* user_data);
+
+/**
+ * Create a layout engine for a document. Boxes are kept on the elements
+ * through dom_document_set_layout_cache, so a document can have only one
+ * layout engine at a time. Until a measure function is set, every
+ * character advances by half the font size.
+ * @param doc The document (not owned; must outlive the engine)
+ * @param styles Style engine of the document (not owned; must outlive the engine)
+ * @return Pointer to the engine, or NULL on failure
+ */
+LayoutEngine* layout_engine_create(DOMDocument* doc, StyleEngine* styles);
+
+/**
+ * Destroy a layout engine, releasing every box stored on the document
+ * @param engine The engine to destroy
+ */
+void layout_engine_destroy(LayoutEngine* engine);
+
+/**
+ * Set the function text is measured with. Everything is laid out again on
+ * the next layout.
+ * @param engine The engine
+ * @param measure The function, or NULL for the built-in metrics
+ * @param user_data Passed to measure
+ * @return 0 on success, -1 on failure
+ */
+int layout_engine_set_text_measure(LayoutEngine* engine, LayoutMeasureText measure, void* user_data);
+
+/**
+ * Lay out independent block subtrees on a thread pool. Boxes and counters
+ * come out the same as on a single thread. The text measure function is
+ * then called from several threads at once.
+ * @param engine The engine
+ * @param pool The pool (not owned; must outlive the engine), or NULL to lay out on the calling thread
+ * @return 0 on success, -1 on failure
+ */
+int layout_engine_set_thread_pool(LayoutEngine* engine, ThreadPool* pool);
+
+/**
+ * Resolve styles and bring the layout up to date. Only subtrees whose
+ * layout dirty mark is set (by a mutation or a style change) or whose
+ * containing block width changed are laid out again; everything else
+ * keeps its cached boxes and is only moved into place.
+ * @param engine The engine
+ * @param viewport_width Width of the initial containing block in px
+ * @return 0 on success, -1 on failure
+ */
+int layout_engine_layout(LayoutEngine* engine, float viewport_width);
+
+/**
+ * Get the height of the laid out document
+ * @param engine The engine
+ * @return Height in px
+ */
+float layout_engine_get_document_height(LayoutEngine* engine);
+
+/**
+ * Get an element's box geometry as of the last layout
+ * @param engine The engine
+ * @param element The element
+ * @param geometry Output parameter for the geometry
+ * @return 0 on success, -1 if the element has no box or the layout is out of date
+ */
+int layout_engine_get_geometry(LayoutEngine* engine, DOMElement* element, LayoutGeometry* geometry);
+
+/**
+ * Get the number of line box fragments of a block container
+ * @param engine The engine
+ * @param element The block container
+ * @return The fragment count (0 if it has no inline content or no box)
+ */
+size_t layout_engine_get_fragment_count(LayoutEngine* engine, DOMElement* element);
+
+/**
+ * Get a line box fragment of a block container
+ * @param engine The engine
+ * @param element The block container
+ * @param index Fragment index, in line order
+ * @param fragment Output parameter for the fragment (text stays valid until the next layout)
+ * @return 0 on success, -1 on failure
+ */
+int layout_engine_get_fragment(LayoutEngine* engine, DOMElement* element, size_t index, LayoutFragment* fragment);
+
+/**
+ * Get counters for the most recent layout
+ * @param engine The engine
+ * @param stats Output parameter for the counters
+ * @return 0 on success, -1 on failure
+ */
+int layout_engine_get_stats(LayoutEngine* engine, LayoutStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_LAYOUT_H
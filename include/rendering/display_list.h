@@ -0,0 +1,155 @@
+#ifndef JUST_BROWSE_DISPLAY_LIST_H
+#define JUST_BROWSE_DISPLAY_LIST_H
+
+#include "rendering/renderer.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Retained list of drawing ops recorded by paint. Lists can be cached per
+// node or subtree, replayed into a frame at an offset and scale, and
+// serialized for offline re-rasterization.
+typedef struct DisplayList DisplayList;
+
+/**
+ * Create an empty display list
+ * @return Pointer to the list, or NULL on failure
+ */
+DisplayList* display_list_create(void);
+
+/**
+ * Destroy a display list
+ * @param list The list to destroy
+ */
+void display_list_destroy(DisplayList* list);
+
+/**
+ * Drop every op, keeping the allocation for re-recording
+ * @param list The list
+ */
+void display_list_clear(DisplayList* list);
+
+/**
+ * Get the number of recorded ops
+ * @param list The list
+ * @return Op count, or 0 if list is NULL
+ */
+size_t display_list_get_count(const DisplayList* list);
+
+/**
+ * Get the union of the areas the list paints
+ * @param list The list
+ * @param bounds Output parameter for the bounds
+ * @return 0 on success, -1 if the list is empty or NULL
+ */
+int display_list_get_bounds(const DisplayList* list, RenderRect* bounds);
+
+/**
+ * Record a solid rectangle
+ * @param list The list
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param color Fill color, blended source-over
+ * @return 0 on success, -1 on failure
+ */
+int display_list_fill_rect(DisplayList* list, int x, int y, int width, int height, RenderColor color);
+
+/**
+ * Record a linear gradient rectangle
+ * @param list The list
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param from Color at the left or top edge
+ * @param to Color at the right or bottom edge
+ * @param direction Axis the gradient runs along
+ * @return 0 on success, -1 on failure
+ */
+int display_list_fill_gradient(DisplayList* list, int x, int y, int width, int height,
+                               RenderColor from, RenderColor to, RenderGradientDirection direction);
+
+/**
+ * Record a border drawn inside a rectangle
+ * @param list The list
+ * @param x Left edge of the border box
+ * @param y Top edge of the border box
+ * @param width Width of the border box
+ * @param height Height of the border box
+ * @param widths Side widths indexed by RenderSide
+ * @param color Border color
+ * @return 0 on success, -1 on failure
+ */
+int display_list_stroke_border(DisplayList* list, int x, int y, int width, int height,
+                               const int widths[4], RenderColor color);
+
+/**
+ * Record a glyph blit: an 8-bit coverage mask tinted with a color
+ * @param list The list
+ * @param x Left edge of the glyph bitmap
+ * @param y Top edge of the glyph bitmap
+ * @param mask Coverage values, one byte per pixel (not copied; must outlive the list)
+ * @param width Mask width in pixels
+ * @param height Mask height in pixels
+ * @param stride Bytes per mask row
+ * @param color Text color
+ * @return 0 on success, -1 on failure
+ */
+int display_list_draw_glyph(DisplayList* list, int x, int y, const unsigned char* mask,
+                            int width, int height, int stride, RenderColor color);
+
+/**
+ * Record an image scaled to a rectangle with nearest-neighbour sampling
+ * @param list The list
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width Destination width in pixels
+ * @param height Destination height in pixels
+ * @param pixels Non-premultiplied RGBA source (not copied; must outlive the list)
+ * @param image_width Source width in pixels
+ * @param image_height Source height in pixels
+ * @param stride Bytes per source row
+ * @return 0 on success, -1 on failure
+ */
+int display_list_draw_image(DisplayList* list, int x, int y, int width, int height,
+                            const unsigned char* pixels, int image_width, int image_height, int stride);
+
+/**
+ * Replay another list's ops into this one, scaled about the origin and
+ * then translated. Glyph masks and images are shared with the source, so it
+ * must outlive any list it was appended to.
+ * @param list The destination list
+ * @param source The list to replay
+ * @param dx Horizontal offset in pixels, applied after scaling
+ * @param dy Vertical offset in pixels, applied after scaling
+ * @param scale Scale factor, 1.0 to replay at the recorded size
+ * @return 0 on success, -1 on failure
+ */
+int display_list_append(DisplayList* list, const DisplayList* source, int dx, int dy, float scale);
+
+/**
+ * Serialize a list, including the glyph masks and images it draws
+ * @param list The list
+ * @param size Output parameter for the size of the serialized data
+ * @return malloc'd serialized data (caller frees), or NULL on failure
+ */
+unsigned char* display_list_serialize(const DisplayList* list, size_t* size);
+
+/**
+ * Rebuild a list from display_list_serialize output. The new list owns
+ * copies of all pixel data.
+ * @param data Serialized data
+ * @param size Size of the data in bytes
+ * @return Pointer to the list, or NULL if the data is malformed
+ */
+DisplayList* display_list_deserialize(const unsigned char* data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_DISPLAY_LIST_H
@@ -0,0 +1,93 @@
+#ifndef JUST_BROWSE_FONT_H
+#define JUST_BROWSE_FONT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pen positions are rounded to this many steps per pixel when rasterizing
+#define FONT_SUBPIXEL_STEPS 4
+
+/**
+ * A font to draw and measure text with. There is one built-in face: an 8x8
+ * bitmap outline scaled to any size with area-coverage antialiasing, made
+ * bold by widening strokes and italic by shearing.
+ */
+typedef struct {
+    float size;         // px (em size)
+    int weight;         // 1-1000; 600 and up is drawn bold
+    int italic;
+} FontSpec;
+
+// Placement of a glyph's coverage mask relative to the pen on the baseline
+typedef struct {
+    int width;          // Mask size in px; 0 for blank glyphs
+    int height;
+    int left;           // Columns from the pen to the mask's left edge
+    int top;            // Rows from the baseline up to the mask's top edge
+    float advance;      // px
+} FontGlyphMetrics;
+
+/**
+ * Get the height above the baseline that glyphs reach
+ * @param font The font
+ * @return Ascent in px
+ */
+float font_get_ascent(const FontSpec* font);
+
+/**
+ * Get the depth below the baseline that descenders reach
+ * @param font The font
+ * @return Descent in px
+ */
+float font_get_descent(const FontSpec* font);
+
+/**
+ * Get the advance width of a character. Characters outside printable ASCII
+ * are drawn as a box; whitespace advances like a space.
+ * @param font The font
+ * @param codepoint Unicode code point
+ * @return Advance in px
+ */
+float font_get_advance(const FontSpec* font, uint32_t codepoint);
+
+/**
+ * Get the mask size and placement of a character
+ * @param font The font
+ * @param codepoint Unicode code point
+ * @param subpixel Horizontal pen offset in 1/FONT_SUBPIXEL_STEPS px (0 to FONT_SUBPIXEL_STEPS - 1)
+ * @param metrics Output parameter for the metrics
+ * @return 0 on success, -1 on failure
+ */
+int font_get_glyph_metrics(const FontSpec* font, uint32_t codepoint, int subpixel, FontGlyphMetrics* metrics);
+
+/**
+ * Rasterize a character into an 8-bit coverage mask of the size reported
+ * by font_get_glyph_metrics
+ * @param font The font
+ * @param codepoint Unicode code point
+ * @param subpixel Horizontal pen offset in 1/FONT_SUBPIXEL_STEPS px
+ * @param mask Output buffer of at least height rows
+ * @param stride Bytes per mask row (at least the width)
+ * @return 0 on success, -1 on failure
+ */
+int font_rasterize_glyph(const FontSpec* font, uint32_t codepoint, int subpixel, unsigned char* mask, int stride);
+
+/**
+ * Decode the UTF-8 character at an offset. Malformed bytes decode as
+ * U+FFFD, one byte at a time.
+ * @param text The text (not NUL-terminated)
+ * @param length Length in bytes
+ * @param offset Offset to decode at; advanced past the character
+ * @return The code point
+ */
+uint32_t font_decode_utf8(const char* text, size_t length, size_t* offset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_FONT_H
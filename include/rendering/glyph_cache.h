@@ -0,0 +1,100 @@
+#ifndef JUST_BROWSE_GLYPH_CACHE_H
+#define JUST_BROWSE_GLYPH_CACHE_H
+
+#include "rendering/font.h"
+#include "rendering/renderer.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct GlyphCache GlyphCache;
+
+// A rasterized glyph. The mask lives in an atlas page and stays valid until
+// the page is evicted, which never happens to pages used in the current or
+// the previous frame.
+typedef struct {
+    const unsigned char* mask;      // 8-bit coverage; NULL for blank glyphs
+    int width;
+    int height;
+    int stride;                     // Bytes per mask row (the atlas page width)
+    int left;                       // Columns from the pen to the mask's left edge
+    int top;                        // Rows from the baseline up to the mask's top edge
+    float advance;                  // px
+} CachedGlyph;
+
+typedef struct {
+    size_t hits;
+    size_t misses;                  // Glyphs rasterized
+    size_t evictions;               // Atlas pages cleared for reuse
+    size_t glyphs;                  // Glyphs currently cached
+    size_t pages;                   // Atlas pages allocated
+} GlyphCacheStats;
+
+/**
+ * Create a glyph cache. Glyphs are keyed by font size, weight, style,
+ * code point and subpixel pen offset, and packed into square 8-bit atlas
+ * pages on shelves. Once max_pages are full, the least recently used page
+ * is cleared and refilled; if every page holds glyphs still on screen, a
+ * page is added beyond the limit instead. A cache is used from one thread.
+ * @param page_size Width and height of an atlas page in px (0 for 256)
+ * @param max_pages Pages to keep before evicting (0 for 8)
+ * @return Pointer to the cache, or NULL on failure
+ */
+GlyphCache* glyph_cache_create(int page_size, size_t max_pages);
+
+/**
+ * Destroy a glyph cache. Masks handed out become invalid.
+ * @param cache The cache to destroy
+ */
+void glyph_cache_destroy(GlyphCache* cache);
+
+/**
+ * Start a new frame. Pages used only before the previous frame become
+ * candidates for eviction; call this once per renderer_render.
+ * @param cache The cache
+ */
+void glyph_cache_begin_frame(GlyphCache* cache);
+
+/**
+ * Look up a glyph, rasterizing it into an atlas page on a miss
+ * @param cache The cache
+ * @param font The font
+ * @param codepoint Unicode code point
+ * @param subpixel Horizontal pen offset in 1/FONT_SUBPIXEL_STEPS px
+ * @param glyph Output parameter for the glyph
+ * @return 0 on success, -1 on failure (including glyphs larger than a page)
+ */
+int glyph_cache_get(GlyphCache* cache, const FontSpec* font, uint32_t codepoint, int subpixel, CachedGlyph* glyph);
+
+/**
+ * Record a line of text as glyph draws straight from the atlas. The pen
+ * starts at x and is snapped to the nearest subpixel step for each glyph.
+ * @param cache The cache
+ * @param renderer The renderer to record into
+ * @param x Pen position of the first glyph in px
+ * @param baseline Baseline position in px
+ * @param text UTF-8 text (not NUL-terminated)
+ * @param length Length in bytes
+ * @param font The font
+ * @param color Text color
+ * @param advance Output parameter for the width of the text, or NULL
+ * @return 0 on success, -1 on failure
+ */
+int glyph_cache_draw_text(GlyphCache* cache, Renderer* renderer, float x, int baseline, const char* text,
+                          size_t length, const FontSpec* font, RenderColor color, float* advance);
+
+/**
+ * Get cache counters
+ * @param cache The cache
+ * @param stats Output parameter for the counters
+ */
+void glyph_cache_get_stats(GlyphCache* cache, GlyphCacheStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_GLYPH_CACHE_H
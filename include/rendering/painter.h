@@ -0,0 +1,60 @@
+#ifndef JUST_BROWSE_PAINTER_H
+#define JUST_BROWSE_PAINTER_H
+
+#include "css/style.h"
+#include "dom/dom.h"
+#include "layout/layout.h"
+#include "rendering/glyph_cache.h"
+#include "rendering/renderer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Painter Painter;
+
+/**
+ * Create a painter, which turns a laid-out document into renderer draw
+ * commands. It keeps a glyph cache, so text rasterized for one frame is
+ * reused by the next. A painter is used from one thread.
+ * @return Pointer to the painter, or NULL on failure
+ */
+Painter* painter_create(void);
+
+/**
+ * Destroy a painter. Glyph masks recorded by it become invalid, so clear
+ * the renderer's commands first if they may be rendered again.
+ * @param painter The painter to destroy
+ */
+void painter_destroy(Painter* painter);
+
+/**
+ * Record a document as of its last layout, replacing the renderer's draw
+ * commands. Elements paint in tree order: each block or inline-block its
+ * background and border, then the text on its lines, then its children.
+ * Inline elements paint only their text. Elements without a current
+ * layout are skipped along with their subtree. Call once per
+ * renderer_render; unchanged boxes record unchanged commands, so the
+ * renderer repaints only what moved or changed.
+ * @param painter The painter
+ * @param renderer The renderer to record into
+ * @param doc The document
+ * @param styles The style engine the document was laid out with
+ * @param layout The layout engine holding the document's boxes
+ * @return 0 on success, -1 on failure
+ */
+int painter_paint(Painter* painter, Renderer* renderer, DOMDocument* doc, StyleEngine* styles,
+                  LayoutEngine* layout);
+
+/**
+ * Get the painter's glyph cache counters
+ * @param painter The painter
+ * @param stats Output parameter for the counters
+ */
+void painter_get_glyph_stats(Painter* painter, GlyphCacheStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_PAINTER_H
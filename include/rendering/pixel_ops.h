@@ -0,0 +1,132 @@
+#ifndef JUST_BROWSE_PIXEL_OPS_H
+#define JUST_BROWSE_PIXEL_OPS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Pixel kernels used by the rasterizer. Pixels are 4 bytes in R, G, B, A
+// memory order; "premultiplied" means each color channel has already been
+// scaled by alpha. Every kernel has a portable version plus SSE2 and AVX2
+// versions on x86, picked at runtime; all versions produce identical bytes.
+
+typedef enum {
+    PIXEL_ISA_SCALAR,
+    PIXEL_ISA_SSE2,
+    PIXEL_ISA_AVX2
+} PixelISA;
+
+/**
+ * Get the instruction set the kernels currently run on
+ * @return The active instruction set
+ */
+PixelISA pixel_ops_get_isa(void);
+
+/**
+ * Switch the kernels to another instruction set (for tests and benchmarks).
+ * Not thread-safe; call before rendering starts.
+ * @param isa Instruction set to use
+ * @return 0 on success, -1 if the CPU or build does not support it
+ */
+int pixel_ops_set_isa(PixelISA isa);
+
+/**
+ * Get a printable name for an instruction set
+ * @param isa The instruction set
+ * @return Static name string
+ */
+const char* pixel_ops_isa_name(PixelISA isa);
+
+/**
+ * Fill pixels with one value
+ * @param dst Destination pixels
+ * @param count Number of pixels
+ * @param pixel The 4-byte pixel to store
+ */
+void pixel_fill(uint8_t* dst, size_t count, const uint8_t pixel[4]);
+
+/**
+ * Blend one premultiplied color source-over a run of premultiplied pixels
+ * @param dst Destination pixels, updated in place
+ * @param count Number of pixels
+ * @param color Premultiplied source color
+ */
+void pixel_blend_solid(uint8_t* dst, size_t count, const uint8_t color[4]);
+
+/**
+ * Blend premultiplied source pixels source-over premultiplied destination pixels
+ * @param dst Destination pixels, updated in place
+ * @param src Source pixels
+ * @param count Number of pixels
+ */
+void pixel_blend_over(uint8_t* dst, const uint8_t* src, size_t count);
+
+/**
+ * Blend a premultiplied color through an 8-bit coverage mask (glyph blits)
+ * @param dst Destination pixels, updated in place
+ * @param mask Coverage per pixel
+ * @param count Number of pixels
+ * @param color Premultiplied source color
+ */
+void pixel_blend_mask(uint8_t* dst, const uint8_t* mask, size_t count, const uint8_t color[4]);
+
+/**
+ * Premultiply straight-alpha pixels; dst may equal src
+ * @param dst Destination pixels
+ * @param src Source pixels
+ * @param count Number of pixels
+ */
+void pixel_premultiply(uint8_t* dst, const uint8_t* src, size_t count);
+
+/**
+ * Swap the first and third channel (RGBA to BGRA and back); dst may equal src
+ * @param dst Destination pixels
+ * @param src Source pixels
+ * @param count Number of pixels
+ */
+void pixel_swap_rb(uint8_t* dst, const uint8_t* src, size_t count);
+
+/**
+ * Drop the alpha channel
+ * @param dst Destination, 3 bytes per pixel
+ * @param src Source, 4 bytes per pixel
+ * @param count Number of pixels
+ */
+void pixel_rgba_to_rgb(uint8_t* dst, const uint8_t* src, size_t count);
+
+/**
+ * Add an opaque alpha channel
+ * @param dst Destination, 4 bytes per pixel
+ * @param src Source, 3 bytes per pixel
+ * @param count Number of pixels
+ */
+void pixel_rgb_to_rgba(uint8_t* dst, const uint8_t* src, size_t count);
+
+/**
+ * Bilinearly scale premultiplied pixels. Only a window of the scaled image
+ * is produced, so a tile can scale just the part it covers.
+ * @param dst Destination for the window's top-left pixel
+ * @param dst_stride Bytes per destination row
+ * @param x Left edge of the window within the scaled image
+ * @param y Top edge of the window within the scaled image
+ * @param width Window width in pixels
+ * @param height Window height in pixels
+ * @param scaled_width Width of the whole scaled image
+ * @param scaled_height Height of the whole scaled image
+ * @param src Source pixels
+ * @param src_width Source width in pixels
+ * @param src_height Source height in pixels
+ * @param src_stride Bytes per source row
+ */
+void pixel_scale_bilinear(uint8_t* dst, size_t dst_stride, int x, int y, int width, int height,
+                          int scaled_width, int scaled_height,
+                          const uint8_t* src, int src_width, int src_height, size_t src_stride);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_PIXEL_OPS_H
@@ -1,6 +1,9 @@
 #ifndef JUST_BROWSE_RENDERER_H
 #define JUST_BROWSE_RENDERER_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -8,6 +11,44 @@ extern "C" {
 // Forward declarations
 typedef struct Renderer Renderer;
 typedef struct DOMDocument DOMDocument;
+typedef struct ThreadPool ThreadPool;
+typedef struct DisplayList DisplayList;
+
+// Non-premultiplied RGBA color
+typedef struct {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    unsigned char a;
+} RenderColor;
+
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} RenderRect;
+
+typedef enum {
+    RENDER_GRADIENT_HORIZONTAL,
+    RENDER_GRADIENT_VERTICAL
+} RenderGradientDirection;
+
+// A finished frame as seen by the consumer thread
+typedef struct {
+    const unsigned char* pixels;    // Premultiplied RGBA; NULL before the first frame
+    int width;
+    int height;
+    uint64_t sequence;              // Number of the render that produced it, from 1
+} RenderFrame;
+
+// Border sides, in the order used by renderer_stroke_border
+typedef enum {
+    RENDER_SIDE_TOP,
+    RENDER_SIDE_RIGHT,
+    RENDER_SIDE_BOTTOM,
+    RENDER_SIDE_LEFT
+} RenderSide;
 
 /**
  * Initialize the renderer (RmlUi-based)
@@ -24,7 +65,12 @@ Renderer* renderer_init(int width, int height);
 void renderer_destroy(Renderer* renderer);
 
 /**
- * Render a DOM document
+ * Render a DOM document. The frame is drawn from the recorded draw
+ * commands, which painter_paint records for a laid-out document. The
+ * framebuffer is split into tiles, the commands are binned per tile, and tiles are rasterized in parallel
+ * on the renderer's thread pool. Only damaged regions are cleared and
+ * repainted: commands that changed since the previous frame, plus anything
+ * passed to renderer_add_damage. Every render is numbered, from 1.
  * @param renderer The renderer instance
  * @param document The DOM document to render
  * @return 0 on success, -1 on failure
@@ -32,7 +78,131 @@ void renderer_destroy(Renderer* renderer);
 int renderer_render(Renderer* renderer, DOMDocument* document);
 
 /**
- * Resize the viewport
+ * Render into three buffers so another thread can read finished frames
+ * while the next one is painted. Each render paints a back buffer, then
+ * swaps it into a handoff slot with one atomic exchange; the consumer
+ * swaps the slot against its own buffer with renderer_acquire_frame.
+ * Neither side waits or copies, and the renderer drops frames the consumer
+ * did not take. Must not be called while a consumer is reading frames.
+ * @param renderer The renderer instance
+ * @param enabled Nonzero for three buffers, zero for one
+ * @return 0 on success, -1 on failure
+ */
+int renderer_set_triple_buffering(Renderer* renderer, int enabled);
+
+/**
+ * Take the newest finished frame (consumer thread). Lock-free; may run
+ * concurrently with anything except renderer_set_triple_buffering,
+ * renderer_resize and renderer_destroy. Only one thread may consume.
+ * @param renderer The renderer instance
+ * @param frame Output parameter for the frame; its pixels stay valid and unchanged until the next call
+ * @return 1 if a newer frame was taken, 0 if none was finished since the last call, -1 on failure (including when not triple buffered)
+ */
+int renderer_acquire_frame(Renderer* renderer, RenderFrame* frame);
+
+/**
+ * Get the number of the last render
+ * @param renderer The renderer instance
+ * @return The frame sequence number (0 before the first render)
+ */
+uint64_t renderer_get_frame_sequence(Renderer* renderer);
+
+/**
+ * Rasterize tiles on a thread pool
+ * @param renderer The renderer instance
+ * @param pool The pool (not owned; must outlive the renderer), or NULL to rasterize on the calling thread
+ * @return 0 on success, -1 on failure
+ */
+int renderer_set_thread_pool(Renderer* renderer, ThreadPool* pool);
+
+/**
+ * Set the color every tile is cleared to before drawing (transparent by default)
+ * @param renderer The renderer instance
+ * @param color Clear color
+ * @return 0 on success, -1 on failure
+ */
+int renderer_set_clear_color(Renderer* renderer, RenderColor color);
+
+/**
+ * Drop all recorded draw commands
+ * @param renderer The renderer instance
+ */
+void renderer_clear_commands(Renderer* renderer);
+
+/**
+ * Record a solid rectangle
+ * @param renderer The renderer instance
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param color Fill color, blended source-over
+ * @return 0 on success, -1 on failure
+ */
+int renderer_fill_rect(Renderer* renderer, int x, int y, int width, int height, RenderColor color);
+
+/**
+ * Record a linear gradient rectangle
+ * @param renderer The renderer instance
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @param from Color at the left or top edge
+ * @param to Color at the right or bottom edge
+ * @param direction Axis the gradient runs along
+ * @return 0 on success, -1 on failure
+ */
+int renderer_fill_gradient(Renderer* renderer, int x, int y, int width, int height,
+                           RenderColor from, RenderColor to, RenderGradientDirection direction);
+
+/**
+ * Record a border drawn inside a rectangle
+ * @param renderer The renderer instance
+ * @param x Left edge of the border box
+ * @param y Top edge of the border box
+ * @param width Width of the border box
+ * @param height Height of the border box
+ * @param widths Side widths indexed by RenderSide
+ * @param color Border color
+ * @return 0 on success, -1 on failure
+ */
+int renderer_stroke_border(Renderer* renderer, int x, int y, int width, int height,
+                           const int widths[4], RenderColor color);
+
+/**
+ * Record a glyph blit: an 8-bit coverage mask tinted with a color
+ * @param renderer The renderer instance
+ * @param x Left edge of the glyph bitmap
+ * @param y Top edge of the glyph bitmap
+ * @param mask Coverage values, one byte per pixel (not copied; must stay valid until the commands are cleared)
+ * @param width Mask width in pixels
+ * @param height Mask height in pixels
+ * @param stride Bytes per mask row
+ * @param color Text color
+ * @return 0 on success, -1 on failure
+ */
+int renderer_draw_glyph(Renderer* renderer, int x, int y, const unsigned char* mask,
+                        int width, int height, int stride, RenderColor color);
+
+/**
+ * Record an image scaled to a rectangle with nearest-neighbour sampling
+ * @param renderer The renderer instance
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width Destination width in pixels
+ * @param height Destination height in pixels
+ * @param pixels Non-premultiplied RGBA source (not copied; must stay valid until the commands are cleared)
+ * @param image_width Source width in pixels
+ * @param image_height Source height in pixels
+ * @param stride Bytes per source row
+ * @return 0 on success, -1 on failure
+ */
+int renderer_draw_image(Renderer* renderer, int x, int y, int width, int height,
+                        const unsigned char* pixels, int image_width, int image_height, int stride);
+
+/**
+ * Resize the viewport. Frames held by the consumer become invalid.
  * @param renderer The renderer instance
  * @param width New viewport width
  * @param height New viewport height
@@ -41,11 +211,47 @@ int renderer_render(Renderer* renderer, DOMDocument* document);
 int renderer_resize(Renderer* renderer, int width, int height);
 
 /**
- * Get the rendered output buffer (for WASM)
+ * Replay a retained display list (see rendering/display_list.h) into the
+ * frame. A list replayed unchanged at the same offset costs no repaint.
+ * @param renderer The renderer instance
+ * @param list The list to replay; its glyph masks and images must stay valid until the commands are cleared
+ * @param dx Horizontal offset in pixels
+ * @param dy Vertical offset in pixels
+ * @return 0 on success, -1 on failure
+ */
+int renderer_draw_display_list(Renderer* renderer, const DisplayList* list, int dx, int dy);
+
+/**
+ * Mark a region for repainting on the next render, e.g. when image pixels
+ * changed behind an unchanged draw command
+ * @param renderer The renderer instance
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @return 0 on success, -1 on failure
+ */
+int renderer_add_damage(Renderer* renderer, int x, int y, int width, int height);
+
+/**
+ * Get the regions the last render changed against the frame before it, so
+ * consumers can upload or copy only what changed. Rectangles are clipped
+ * to the viewport and never overlap; the list is empty when nothing
+ * changed.
+ * @param renderer The renderer instance
+ * @param count Output parameter for the number of rectangles
+ * @return Pointer to the rectangles (valid until the next render or resize), or NULL on failure
+ */
+const RenderRect* renderer_get_damage(Renderer* renderer, size_t* count);
+
+/**
+ * Get the buffer holding the last rendered frame (for WASM). When triple
+ * buffered it is read-only and may be shared with the consumer; it is not
+ * painted again until the render after next.
  * @param renderer The renderer instance
  * @param width Output parameter for buffer width
  * @param height Output parameter for buffer height
- * @return Pointer to the RGBA pixel buffer, or NULL on failure
+ * @return Pointer to the premultiplied RGBA pixel buffer, or NULL on failure
  */
 const unsigned char* renderer_get_buffer(Renderer* renderer, int* width, int* height);
 
@@ -0,0 +1,77 @@
+#ifndef JUST_BROWSE_TEXT_RUN_CACHE_H
+#define JUST_BROWSE_TEXT_RUN_CACHE_H
+
+#include "rendering/font.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TextRunCache TextRunCache;
+
+typedef struct {
+    size_t hits;
+    size_t misses;                  // Runs measured
+    size_t evictions;
+    size_t runs;                    // Runs currently cached
+} TextRunCacheStats;
+
+/**
+ * Create a cache of measured text runs, keyed by the text and the font
+ * size, weight and style. Each run keeps its total width and the advance
+ * of every character, so repeated words and labels are measured once. The
+ * least recently used run is dropped once max_runs are cached. All
+ * functions may be called from several threads at once.
+ * @param max_runs Runs to keep (0 for 4096)
+ * @return Pointer to the cache, or NULL on failure
+ */
+TextRunCache* text_run_cache_create(size_t max_runs);
+
+/**
+ * Destroy a text run cache
+ * @param cache The cache to destroy
+ */
+void text_run_cache_destroy(TextRunCache* cache);
+
+/**
+ * Measure a run of text
+ * @param cache The cache
+ * @param text UTF-8 text (not NUL-terminated)
+ * @param length Length in bytes
+ * @param font The font
+ * @return Width in px (0 on failure)
+ */
+float text_run_cache_measure(TextRunCache* cache, const char* text, size_t length, const FontSpec* font);
+
+/**
+ * Get the advance of every character of a run
+ * @param cache The cache
+ * @param text UTF-8 text (not NUL-terminated)
+ * @param length Length in bytes
+ * @param font The font
+ * @param advances Output array for the advances in px, or NULL to only count
+ * @param capacity Size of the advances array; extra characters are not copied
+ * @return Number of characters in the run
+ */
+size_t text_run_cache_get_advances(TextRunCache* cache, const char* text, size_t length, const FontSpec* font,
+                                   float* advances, size_t capacity);
+
+/**
+ * Drop every cached run
+ * @param cache The cache
+ */
+void text_run_cache_clear(TextRunCache* cache);
+
+/**
+ * Get cache counters
+ * @param cache The cache
+ * @param stats Output parameter for the counters
+ */
+void text_run_cache_get_stats(TextRunCache* cache, TextRunCacheStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JUST_BROWSE_TEXT_RUN_CACHE_H
@@ -2,19 +2,64 @@
 #include "dom/dom.h"
 #include "js/js_engine.h"
 #include "rendering/renderer.h"
+#include "rendering/painter.h"
+#include "rendering/text_run_cache.h"
+#include "css/style.h"
+#include "layout/layout.h"
 #include "html/parser.h"
+#include "js/script_compiler.h"
+#include "js/engine_pool.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 struct BrowserEngine {
     DOMDocument* document;
+    StyleEngine* style;
+    LayoutEngine* layout;
+    TextRunCache* text_runs;    // Layout text measurement
     JSEngine* js_engine;
     Renderer* renderer;
+    Painter* painter;           // Records the laid-out document into the renderer
+    JSCompilePool* compile_pool;
+    JSEnginePool* js_pool;      // Owner of js_engine when set
     int viewport_width;
     int viewport_height;
 };
 
-BrowserEngine* browser_engine_init(void) {
+// Scripts found while parsing, kept in document order
+typedef struct {
+    JSCompileJob* job;   // Set when compiled off-thread
+    char* source;        // Set when compiled on the main thread
+    int module;          // Module scripts are deferred until classic scripts ran
+} PendingScript;
+
+typedef struct {
+    BrowserEngine* engine;
+    PendingScript* scripts;
+    size_t count;
+    size_t capacity;
+} ScriptCollector;
+
+// Measure layout text with the built-in font through the run cache
+static float measure_text(const char* text, size_t length, const ComputedStyle* style, void* user_data) {
+    FontSpec font;
+    font.size = style->font_size;
+    font.weight = style->font_weight;
+    font.italic = style->font_style == CSS_FONT_STYLE_ITALIC;
+    return text_run_cache_measure((TextRunCache*)user_data, text, length, &font);
+}
+
+// Hand the JS engine back to the pool it came from, or destroy it
+static void release_js_engine(BrowserEngine* engine) {
+    if (engine->js_pool) {
+        js_engine_pool_release(engine->js_pool, engine->js_engine);
+    } else {
+        js_engine_destroy(engine->js_engine);
+    }
+}
+
+static BrowserEngine* browser_engine_create(JSEnginePool* js_pool, const JSEngineConfig* js_config) {
     BrowserEngine* engine = (BrowserEngine*)malloc(sizeof(BrowserEngine));
     if (!engine) {
         return NULL;
@@ -23,6 +68,8 @@ BrowserEngine* browser_engine_init(void) {
     // Initialize with default viewport size
     engine->viewport_width = 1024;
     engine->viewport_height = 768;
+    engine->compile_pool = NULL;
+    engine->js_pool = js_pool;
 
     // Create DOM document
     engine->document = dom_document_create();
@@ -31,9 +78,37 @@ BrowserEngine* browser_engine_init(void) {
         return NULL;
     }
 
+    engine->style = style_engine_create(engine->document);
+    if (!engine->style) {
+        dom_document_destroy(engine->document);
+        free(engine);
+        return NULL;
+    }
+
+    engine->layout = layout_engine_create(engine->document, engine->style);
+    if (!engine->layout) {
+        style_engine_destroy(engine->style);
+        dom_document_destroy(engine->document);
+        free(engine);
+        return NULL;
+    }
+
+    engine->text_runs = text_run_cache_create(0);
+    if (!engine->text_runs) {
+        layout_engine_destroy(engine->layout);
+        style_engine_destroy(engine->style);
+        dom_document_destroy(engine->document);
+        free(engine);
+        return NULL;
+    }
+    layout_engine_set_text_measure(engine->layout, measure_text, engine->text_runs);
+
     // Initialize JavaScript engine
-    engine->js_engine = js_engine_init();
+    engine->js_engine = js_pool ? js_engine_pool_acquire(js_pool) : js_engine_init_with_config(js_config);
     if (!engine->js_engine) {
+        layout_engine_destroy(engine->layout);
+        text_run_cache_destroy(engine->text_runs);
+        style_engine_destroy(engine->style);
         dom_document_destroy(engine->document);
         free(engine);
         return NULL;
@@ -41,7 +116,10 @@ BrowserEngine* browser_engine_init(void) {
 
     // Bind DOM to JavaScript
     if (js_engine_bind_dom(engine->js_engine, engine->document) != 0) {
-        js_engine_destroy(engine->js_engine);
+        release_js_engine(engine);
+        layout_engine_destroy(engine->layout);
+        text_run_cache_destroy(engine->text_runs);
+        style_engine_destroy(engine->style);
         dom_document_destroy(engine->document);
         free(engine);
         return NULL;
@@ -50,7 +128,22 @@ BrowserEngine* browser_engine_init(void) {
     // Initialize renderer
     engine->renderer = renderer_init(engine->viewport_width, engine->viewport_height);
     if (!engine->renderer) {
-        js_engine_destroy(engine->js_engine);
+        release_js_engine(engine);
+        layout_engine_destroy(engine->layout);
+        text_run_cache_destroy(engine->text_runs);
+        style_engine_destroy(engine->style);
+        dom_document_destroy(engine->document);
+        free(engine);
+        return NULL;
+    }
+
+    engine->painter = painter_create();
+    if (!engine->painter) {
+        renderer_destroy(engine->renderer);
+        release_js_engine(engine);
+        layout_engine_destroy(engine->layout);
+        text_run_cache_destroy(engine->text_runs);
+        style_engine_destroy(engine->style);
         dom_document_destroy(engine->document);
         free(engine);
         return NULL;
@@ -59,16 +152,46 @@ BrowserEngine* browser_engine_init(void) {
     return engine;
 }
 
+BrowserEngine* browser_engine_init(void) {
+    return browser_engine_create(NULL, NULL);
+}
+
+BrowserEngine* browser_engine_init_with_config(const JSEngineConfig* js_config) {
+    return browser_engine_create(NULL, js_config);
+}
+
+BrowserEngine* browser_engine_init_with_pool(JSEnginePool* pool) {
+    if (!pool) {
+        return NULL;
+    }
+    return browser_engine_create(pool, NULL);
+}
+
 void browser_engine_destroy(BrowserEngine* engine) {
     if (!engine) {
         return;
     }
 
+    // The renderer goes before the painter: its commands point into the
+    // painter's glyph atlas
     if (engine->renderer) {
         renderer_destroy(engine->renderer);
     }
+    if (engine->painter) {
+        painter_destroy(engine->painter);
+    }
+    // The JS engine goes first: its wrappers point into the document
     if (engine->js_engine) {
-        js_engine_destroy(engine->js_engine);
+        release_js_engine(engine);
+    }
+    if (engine->layout) {
+        layout_engine_destroy(engine->layout);
+    }
+    if (engine->text_runs) {
+        text_run_cache_destroy(engine->text_runs);
+    }
+    if (engine->style) {
+        style_engine_destroy(engine->style);
     }
     if (engine->document) {
         dom_document_destroy(engine->document);
@@ -76,13 +199,156 @@ void browser_engine_destroy(BrowserEngine* engine) {
     free(engine);
 }
 
+enum {
+    SCRIPT_IGNORED,
+    SCRIPT_CLASSIC,
+    SCRIPT_MODULE
+};
+
+static int script_kind(DOMElement* script) {
+    // External scripts need a resource loader, which the engine lacks
+    if (dom_element_get_attribute(script, "src")) {
+        return SCRIPT_IGNORED;
+    }
+
+    const char* type = dom_element_get_attribute(script, "type");
+    if (!type || type[0] == '\0' ||
+        strcasecmp(type, "text/javascript") == 0 ||
+        strcasecmp(type, "application/javascript") == 0) {
+        return SCRIPT_CLASSIC;
+    }
+    if (strcasecmp(type, "module") == 0) {
+        return SCRIPT_MODULE;
+    }
+    return SCRIPT_IGNORED;
+}
+
+// Parser callback: start compiling each script while parsing continues
+static void collect_script(DOMElement* script, const char* source, size_t length, void* user_data) {
+    ScriptCollector* collector = (ScriptCollector*)user_data;
+
+    int kind = script_kind(script);
+    if (kind == SCRIPT_IGNORED) {
+        return;
+    }
+
+    if (collector->count >= collector->capacity) {
+        size_t new_capacity = collector->capacity ? collector->capacity * 2 : 8;
+        PendingScript* scripts = (PendingScript*)realloc(collector->scripts, new_capacity * sizeof(PendingScript));
+        if (!scripts) {
+            return;
+        }
+        collector->scripts = scripts;
+        collector->capacity = new_capacity;
+    }
+
+    PendingScript* pending = &collector->scripts[collector->count];
+    pending->job = NULL;
+    pending->source = NULL;
+    pending->module = kind == SCRIPT_MODULE;
+
+    // Modules compile on the main thread, where imports can be resolved
+    if (collector->engine->compile_pool && !pending->module) {
+        pending->job = js_compile_pool_submit(collector->engine->compile_pool, source, length, "<script>");
+    }
+    if (!pending->job) {
+        pending->source = (char*)malloc(length + 1);
+        if (!pending->source) {
+            return;
+        }
+        memcpy(pending->source, source, length);
+        pending->source[length] = '\0';
+    }
+
+    collector->count++;
+}
+
+// Replace the author stylesheets with the page's <style> elements
+static void collect_stylesheets(BrowserEngine* engine) {
+    style_engine_clear_stylesheets(engine->style);
+
+    DOMCollection* styles = dom_collection_create((DOMNode*)engine->document, DOM_COLLECTION_BY_TAG_NAME, "style");
+    if (!styles) {
+        return;
+    }
+    size_t count = dom_collection_length(styles);
+    for (size_t i = 0; i < count; i++) {
+        char* text = dom_node_get_text_content(dom_collection_item(styles, i));
+        if (!text) {
+            continue;
+        }
+        CSSStylesheet* sheet = css_stylesheet_parse(text, strlen(text));
+        free(text);
+        if (sheet && style_engine_add_stylesheet(engine->style, sheet) != 0) {
+            css_stylesheet_destroy(sheet);
+        }
+    }
+    dom_collection_destroy(styles);
+}
+
 int browser_engine_load_html(BrowserEngine* engine, const char* html) {
     if (!engine || !html) {
         return -1;
     }
 
+    // A new page starts with a fresh page budget
+    js_engine_reset_page_budget(engine->js_engine);
+
     // Use the HTML parser to create the DOM tree
-    return html_parser_parse(engine->document, html);
+    ScriptCollector collector;
+    memset(&collector, 0, sizeof(collector));
+    collector.engine = engine;
+
+    int result = html_parser_parse_with_scripts(engine->document, html, collect_script, &collector);
+
+    // Run classic scripts in document order, then the deferred module
+    // scripts; a script that fails does not stop the rest
+    for (size_t i = 0; i < collector.count; i++) {
+        PendingScript* pending = &collector.scripts[i];
+        if (pending->module) {
+            continue;
+        }
+        if (pending->job) {
+            size_t size;
+            const uint8_t* bytecode = js_compile_job_bytecode(pending->job, &size);
+            if (result == 0 && bytecode) {
+                js_engine_eval_bytecode(engine->js_engine, bytecode, size);
+            } else if (result == 0) {
+                // Reported like a syntax error in a script compiled inline
+                const char* error = js_compile_job_error(pending->job);
+                js_engine_set_error(engine->js_engine, error ? error : "script failed to compile");
+            }
+            js_compile_job_free(pending->job);
+        } else {
+            if (result == 0) {
+                js_engine_eval(engine->js_engine, pending->source);
+            }
+            free(pending->source);
+        }
+    }
+    for (size_t i = 0; i < collector.count; i++) {
+        PendingScript* pending = &collector.scripts[i];
+        if (!pending->module) {
+            continue;
+        }
+        if (result == 0) {
+            js_engine_eval_module(engine->js_engine, pending->source, "<script>");
+        }
+        free(pending->source);
+    }
+    free(collector.scripts);
+
+    collect_stylesheets(engine);
+    return result;
+}
+
+int browser_engine_set_compile_pool(BrowserEngine* engine, JSCompilePool* pool) {
+    if (!engine) {
+        return -1;
+    }
+
+    engine->compile_pool = pool;
+    return 0;
 }
 
 int browser_engine_execute_script(BrowserEngine* engine, const char* script) {
@@ -93,10 +359,148 @@ int browser_engine_execute_script(BrowserEngine* engine, const char* script) {
     return js_engine_eval(engine->js_engine, script);
 }
 
+int browser_engine_run_until_idle(BrowserEngine* engine, uint64_t timeout_ms) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_run_until_idle(engine->js_engine, timeout_ms);
+}
+
+int browser_engine_advance_time(BrowserEngine* engine, uint64_t ms) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_advance_time(engine->js_engine, ms);
+}
+
+int browser_engine_set_script_budget(BrowserEngine* engine, const JSEngineBudget* budget) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_set_budget(engine->js_engine, budget);
+}
+
+int browser_engine_execute_module(BrowserEngine* engine, const char* source, const char* filename) {
+    if (!engine || !source || !filename) {
+        return -1;
+    }
+
+    return js_engine_eval_module(engine->js_engine, source, filename);
+}
+
+const char* browser_engine_get_error(BrowserEngine* engine) {
+    if (!engine) {
+        return NULL;
+    }
+
+    return js_engine_get_error(engine->js_engine);
+}
+
+int browser_engine_set_module_provider(BrowserEngine* engine, JSModuleProvider provider, void* user_data) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_set_module_provider(engine->js_engine, provider, user_data);
+}
+
+int browser_engine_set_bytecode_cache(BrowserEngine* engine, JSBytecodeCache* cache) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_set_bytecode_cache(engine->js_engine, cache);
+}
+
 int browser_engine_render(BrowserEngine* engine) {
     if (!engine) {
         return -1;
     }
 
+    if (layout_engine_layout(engine->layout, (float)engine->viewport_width) != 0 ||
+        painter_paint(engine->painter, engine->renderer, engine->document, engine->style, engine->layout) != 0) {
+        return -1;
+    }
     return renderer_render(engine->renderer, engine->document);
 }
+
+int browser_engine_set_raster_pool(BrowserEngine* engine, ThreadPool* pool) {
+    if (!engine) {
+        return -1;
+    }
+
+    return renderer_set_thread_pool(engine->renderer, pool);
+}
+
+int browser_engine_set_layout_pool(BrowserEngine* engine, ThreadPool* pool) {
+    if (!engine) {
+        return -1;
+    }
+
+    if (style_engine_set_thread_pool(engine->style, pool) != 0) {
+        return -1;
+    }
+    return layout_engine_set_thread_pool(engine->layout, pool);
+}
+
+int browser_engine_get_heap_stats(BrowserEngine* engine, JSEngineHeapStats* stats) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_get_heap_stats(engine->js_engine, stats);
+}
+
+int browser_engine_run_gc(BrowserEngine* engine) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_run_gc(engine->js_engine);
+}
+
+int browser_engine_profiler_start(BrowserEngine* engine, uint32_t interval_us) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_profiler_start(engine->js_engine, interval_us);
+}
+
+int browser_engine_profiler_stop(BrowserEngine* engine) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_profiler_stop(engine->js_engine);
+}
+
+char* browser_engine_profiler_export(BrowserEngine* engine, int json) {
+    if (!engine) {
+        return NULL;
+    }
+
+    if (json) {
+        return js_engine_profiler_export_json(engine->js_engine);
+    }
+    return js_engine_profiler_export_collapsed(engine->js_engine);
+}
+
+int browser_engine_set_console_sink(BrowserEngine* engine, JSConsoleSink sink, void* user_data, size_t capacity) {
+    if (!engine) {
+        return -1;
+    }
+
+    return js_engine_set_console_sink(engine->js_engine, sink, user_data, capacity);
+}
+
+uint64_t browser_engine_console_dropped(BrowserEngine* engine) {
+    if (!engine) {
+        return 0;
+    }
+
+    return js_engine_console_dropped(engine->js_engine);
+}
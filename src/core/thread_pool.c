@@ -0,0 +1,245 @@
+#include "core/thread_pool.h"
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Work-stealing pool for data-parallel loops
+// Every participant (the workers plus the calling thread) owns a deque
+// holding a contiguous range of task indices. Owners take indices from the
+// front so neighbouring tasks run back to back; an idle participant steals
+// the back half of another's range.
+
+#define MAX_POOL_THREADS 64
+
+typedef struct {
+    pthread_mutex_t lock;
+    size_t head;
+    size_t tail;
+    char padding[64];   // Keep deques on separate cache lines
+} WorkDeque;
+
+typedef struct {
+    ThreadPool* pool;
+    int index;
+} PoolWorker;
+
+struct ThreadPool {
+    pthread_t threads[MAX_POOL_THREADS];
+    PoolWorker workers[MAX_POOL_THREADS];
+    int thread_count;
+    WorkDeque* deques;          // thread_count + 1; the last belongs to the caller
+    pthread_mutex_t submit_lock;
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    unsigned long generation;   // Bumped once per parallel_for
+    int active;                 // Workers still inside the current loop
+    int shutting_down;
+    ThreadPoolTask task;
+    void* context;
+};
+
+static int deque_pop(WorkDeque* deque, size_t* index) {
+    int found = 0;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->head < deque->tail) {
+        *index = deque->head++;
+        found = 1;
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static int steal(ThreadPool* pool, int self) {
+    int participants = pool->thread_count + 1;
+
+    for (int i = 1; i < participants; i++) {
+        WorkDeque* victim = &pool->deques[(self + i) % participants];
+        size_t head = 0;
+        size_t tail = 0;
+
+        pthread_mutex_lock(&victim->lock);
+        size_t available = victim->tail - victim->head;
+        if (available > 0) {
+            size_t taken = (available + 1) / 2;
+            tail = victim->tail;
+            head = tail - taken;
+            victim->tail = head;
+        }
+        pthread_mutex_unlock(&victim->lock);
+
+        if (head < tail) {
+            WorkDeque* own = &pool->deques[self];
+            pthread_mutex_lock(&own->lock);
+            own->head = head;
+            own->tail = tail;
+            pthread_mutex_unlock(&own->lock);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void work_loop(ThreadPool* pool, int self) {
+    WorkDeque* own = &pool->deques[self];
+    size_t index;
+
+    // Every index sits in some deque or with the thread that just stole it,
+    // so one empty pass means the rest is already being handled
+    for (;;) {
+        while (deque_pop(own, &index)) {
+            pool->task(pool->context, index, self);
+        }
+        if (!steal(pool, self)) {
+            return;
+        }
+    }
+}
+
+static void* worker_main(void* arg) {
+    PoolWorker* worker = (PoolWorker*)arg;
+    ThreadPool* pool = worker->pool;
+    unsigned long seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->generation == seen && !pool->shutting_down) {
+            pthread_cond_wait(&pool->start, &pool->lock);
+        }
+        if (pool->shutting_down) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        seen = pool->generation;
+        pthread_mutex_unlock(&pool->lock);
+
+        work_loop(pool, worker->index);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0) {
+            pthread_cond_signal(&pool->done);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return NULL;
+}
+
+ThreadPool* thread_pool_create(int thread_count) {
+    if (thread_count <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 0 ? (int)cpus : 1;
+    }
+    if (thread_count > MAX_POOL_THREADS) {
+        thread_count = MAX_POOL_THREADS;
+    }
+
+    ThreadPool* pool = (ThreadPool*)calloc(1, sizeof(ThreadPool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->deques = (WorkDeque*)calloc((size_t)thread_count + 1, sizeof(WorkDeque));
+    if (!pool->deques) {
+        free(pool);
+        return NULL;
+    }
+    for (int i = 0; i <= thread_count; i++) {
+        pthread_mutex_init(&pool->deques[i].lock, NULL);
+    }
+
+    pthread_mutex_init(&pool->submit_lock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->start, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    // Deque slots beyond the threads actually started stay empty, so the
+    // caller's deque is always at index thread_count of the allocation
+    for (int i = 0; i < thread_count; i++) {
+        pool->workers[i].pool = pool;
+        pool->workers[i].index = i;
+        if (pthread_create(&pool->threads[i], NULL, worker_main, &pool->workers[i]) != 0) {
+            break;
+        }
+        pool->thread_count++;
+    }
+
+    if (pool->thread_count == 0) {
+        thread_pool_destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void thread_pool_destroy(ThreadPool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = 1;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    for (int i = 0; i <= pool->thread_count; i++) {
+        pthread_mutex_destroy(&pool->deques[i].lock);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->start);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->submit_lock);
+    free(pool->deques);
+    free(pool);
+}
+
+int thread_pool_get_worker_count(ThreadPool* pool) {
+    return pool ? pool->thread_count + 1 : 1;
+}
+
+int thread_pool_parallel_for(ThreadPool* pool, size_t count, ThreadPoolTask task, void* context) {
+    if (!task) {
+        return -1;
+    }
+
+    if (!pool || count <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(context, i, 0);
+        }
+        return 0;
+    }
+
+    pthread_mutex_lock(&pool->submit_lock);
+
+    // Hand every participant an even slice up front; stealing evens out
+    // whatever imbalance the tasks themselves have
+    int participants = pool->thread_count + 1;
+    for (int i = 0; i < participants; i++) {
+        pool->deques[i].head = count * (size_t)i / (size_t)participants;
+        pool->deques[i].tail = count * (size_t)(i + 1) / (size_t)participants;
+    }
+    pool->task = task;
+    pool->context = context;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->active = pool->thread_count;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->start);
+    pthread_mutex_unlock(&pool->lock);
+
+    work_loop(pool, pool->thread_count);
+
+    // Workers may still be finishing stolen tasks
+    pthread_mutex_lock(&pool->lock);
+    while (pool->active > 0) {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_unlock(&pool->submit_lock);
+    return 0;
+}
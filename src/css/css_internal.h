@@ -0,0 +1,160 @@
+#ifndef JUST_BROWSE_CSS_INTERNAL_H
+#define JUST_BROWSE_CSS_INTERNAL_H
+
+// Parsed stylesheet layout shared by the css/ translation units; not installed
+
+#include "css/stylesheet.h"
+#include "css/style.h"
+#include <stdint.h>
+
+typedef enum {
+    CSS_MATCH_EXISTS,       // [name]
+    CSS_MATCH_EQUALS,       // [name=value]
+    CSS_MATCH_INCLUDES,     // [name~=value]
+    CSS_MATCH_DASH,         // [name|=value]
+    CSS_MATCH_PREFIX,       // [name^=value]
+    CSS_MATCH_SUFFIX,       // [name$=value]
+    CSS_MATCH_SUBSTRING     // [name*=value]
+} CSSAttributeMatch;
+
+typedef struct {
+    char* name;
+    char* value;
+    CSSAttributeMatch match;
+} CSSAttributeSelector;
+
+// Structural pseudo-classes, as bit flags
+#define CSS_PSEUDO_FIRST_CHILD 0x1
+#define CSS_PSEUDO_LAST_CHILD 0x2
+#define CSS_PSEUDO_ROOT 0x4
+#define CSS_PSEUDO_EMPTY 0x8
+
+typedef enum {
+    CSS_COMBINATOR_NONE,        // Leftmost compound
+    CSS_COMBINATOR_DESCENDANT,
+    CSS_COMBINATOR_CHILD,
+    CSS_COMBINATOR_ADJACENT,    // +
+    CSS_COMBINATOR_SIBLING      // ~
+} CSSCombinator;
+
+typedef struct {
+    char* tag;                  // Lowercase; NULL matches any element
+    char* id;
+    char** classes;
+    size_t class_count;
+    CSSAttributeSelector* attributes;
+    size_t attribute_count;
+    unsigned int pseudo;
+    CSSCombinator combinator;   // Relation to the compound on the left
+} CSSCompound;
+
+typedef struct {
+    CSSCompound* compounds;     // Left to right; the last one is the subject
+    size_t count;
+    uint32_t specificity;       // ids << 20 | classes << 10 | tags
+} CSSSelector;
+
+typedef enum {
+    CSS_PROP_DISPLAY,
+    CSS_PROP_COLOR,
+    CSS_PROP_BACKGROUND_COLOR,
+    CSS_PROP_FONT_SIZE,
+    CSS_PROP_FONT_WEIGHT,
+    CSS_PROP_FONT_STYLE,
+    CSS_PROP_LINE_HEIGHT,
+    CSS_PROP_TEXT_ALIGN,
+    CSS_PROP_WHITE_SPACE,
+    CSS_PROP_WIDTH,
+    CSS_PROP_HEIGHT,
+    CSS_PROP_MARGIN_TOP,
+    CSS_PROP_MARGIN_RIGHT,
+    CSS_PROP_MARGIN_BOTTOM,
+    CSS_PROP_MARGIN_LEFT,
+    CSS_PROP_PADDING_TOP,
+    CSS_PROP_PADDING_RIGHT,
+    CSS_PROP_PADDING_BOTTOM,
+    CSS_PROP_PADDING_LEFT,
+    CSS_PROP_BORDER_TOP_WIDTH,
+    CSS_PROP_BORDER_RIGHT_WIDTH,
+    CSS_PROP_BORDER_BOTTOM_WIDTH,
+    CSS_PROP_BORDER_LEFT_WIDTH,
+    CSS_PROP_BORDER_TOP_STYLE,
+    CSS_PROP_BORDER_RIGHT_STYLE,
+    CSS_PROP_BORDER_BOTTOM_STYLE,
+    CSS_PROP_BORDER_LEFT_STYLE,
+    CSS_PROP_BORDER_COLOR,
+    CSS_PROP_COUNT
+} CSSProperty;
+
+typedef enum {
+    CSS_VALUE_KEYWORD,          // Property-specific enum in keyword
+    CSS_VALUE_LENGTH,           // number in unit
+    CSS_VALUE_PERCENT,
+    CSS_VALUE_NUMBER,
+    CSS_VALUE_AUTO,
+    CSS_VALUE_COLOR,
+    CSS_VALUE_CURRENT_COLOR,
+    CSS_VALUE_INHERIT,
+    CSS_VALUE_INITIAL,
+    CSS_VALUE_UNSET
+} CSSValueType;
+
+typedef enum {
+    CSS_UNIT_PX,
+    CSS_UNIT_EM,
+    CSS_UNIT_REM
+} CSSUnit;
+
+// Keywords that need the parent's value to compute
+#define CSS_FONT_WEIGHT_BOLDER 1
+#define CSS_FONT_WEIGHT_LIGHTER 2
+
+// Border style keywords; only "none or not" affects computed values
+#define CSS_BORDER_STYLE_NONE 0
+#define CSS_BORDER_STYLE_VISIBLE 1
+
+typedef struct {
+    CSSValueType type;
+    int keyword;
+    float number;
+    CSSUnit unit;
+    CSSColor color;
+} CSSValue;
+
+typedef struct {
+    CSSProperty property;
+    CSSValue value;
+    int important;
+} CSSDeclaration;
+
+typedef struct {
+    CSSSelector* selectors;
+    size_t selector_count;
+    CSSDeclaration* declarations;
+    size_t declaration_count;
+} CSSRule;
+
+struct CSSStylesheet {
+    CSSRule* rules;
+    size_t count;
+    size_t capacity;
+};
+
+/**
+ * Parse a declaration block (a style attribute, or the inside of a rule)
+ * @param text The declarations (need not be NUL-terminated)
+ * @param length Length in bytes
+ * @param count Output parameter for the number of declarations
+ * @return Newly allocated declarations (caller must free; NULL when there
+ *         are none)
+ */
+CSSDeclaration* css_parse_declarations(const char* text, size_t length, size_t* count);
+
+/**
+ * Check whether a property is inherited by default
+ * @param property The property
+ * @return 1 if inherited, 0 otherwise
+ */
+int css_property_inherited(CSSProperty property);
+
+#endif // JUST_BROWSE_CSS_INTERNAL_H
@@ -0,0 +1,1828 @@
+#include "css_internal.h"
+#include "core/thread_pool.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+// Style engine
+// Stylesheets are compiled into a rule set that buckets every selector by
+// its rightmost id, else class, else tag, so an element only tests the
+// rules that could possibly match it. Matched declarations are cascaded
+// (origin, specificity, source order, !important) and computed into an
+// immutable ComputedStyle, interned in a hash table so equal styles share
+// one reference-counted object. Before any matching, an element looks at
+// its most recent element siblings: one that would provably match the same
+// rules hands over its style unchanged.
+//
+// Styles are kept up to date incrementally. The engine observes the
+// document and turns each mutation into style marks on the elements whose
+// style it could change, looked up in invalidation sets compiled from the
+// stylesheets: for every class, id and attribute name, whether a change
+// affects the element itself, its descendants or its later siblings.
+// Resolving then only visits marked paths.
+//
+// With a thread pool, a resolve restyles level by level on the calling
+// thread until it has enough independent subtrees, then restyles those on
+// the workers. Workers only read the document and the engine: results are
+// logged per subtree and new styles interned in a per-worker table, and
+// both are merged on the calling thread in document order, so the outcome
+// is the same as a single-threaded resolve.
+
+#define SHARING_CANDIDATES 8
+#define TASKS_PER_WORKER 4          // Subtrees to gather per worker before going parallel
+#define INITIAL_FONT_SIZE 16.0f
+
+// Invalidation set flags: whose style a change of a class, id or attribute
+// on an element can affect
+#define INVALIDATE_SELF 0x1
+#define INVALIDATE_DESCENDANTS 0x2
+#define INVALIDATE_SIBLINGS 0x4     // Later siblings and their descendants
+
+enum {
+    ORIGIN_USER_AGENT,
+    ORIGIN_AUTHOR
+};
+
+// Defaults for HTML elements, applied before any author stylesheet
+static const char user_agent_css[] =
+    "html, body, div, p, h1, h2, h3, h4, h5, h6, ul, ol, li, dl, dt, dd, pre, blockquote,"
+    " address, section, article, header, footer, nav, main, aside, figure, figcaption,"
+    " form, fieldset, table, tr, hr, center, details, summary { display: block }"
+    "head, script, style, title, meta, link, base, template, noscript { display: none }"
+    "[hidden] { display: none }"
+    "img { display: inline-block }"
+    "td, th { display: inline-block }"
+    "body { margin: 8px }"
+    "p, blockquote, ul, ol, dl, pre, figure { margin-top: 1em; margin-bottom: 1em }"
+    "blockquote, figure { margin-left: 40px; margin-right: 40px }"
+    "dd { margin-left: 40px }"
+    "ul, ol { padding-left: 40px }"
+    "h1 { font-size: 2em; margin: 0.67em 0 }"
+    "h2 { font-size: 1.5em; margin: 0.83em 0 }"
+    "h3 { font-size: 1.17em; margin: 1em 0 }"
+    "h4 { margin: 1.33em 0 }"
+    "h5 { font-size: 0.83em; margin: 1.67em 0 }"
+    "h6 { font-size: 0.67em; margin: 2.33em 0 }"
+    "h1, h2, h3, h4, h5, h6, b, strong, th { font-weight: bold }"
+    "i, em, cite, var, dfn, address { font-style: italic }"
+    "pre { white-space: pre }"
+    "center { text-align: center }"
+    "small { font-size: smaller }"
+    "big { font-size: larger }"
+    "a { color: #0000ee }"
+    "hr { border: 1px inset gray; margin: 0.5em 0 }";
+
+typedef struct {
+    const CSSRule* rule;
+    const CSSSelector* selector;
+    uint64_t priority;          // Origin, then specificity, then source order
+} RuleEntry;
+
+typedef struct RuleBucket {
+    char* key;
+    uint32_t hash;
+    RuleEntry* entries;
+    size_t count;
+    size_t capacity;
+    int sibling_sensitive;      // A rule here depends on the element's siblings
+    unsigned int invalidation;  // INVALIDATE_* flags for a change of the key
+    struct RuleBucket* next;
+} RuleBucket;
+
+typedef struct {
+    RuleBucket** slots;
+    size_t slot_count;          // Power of two, or 0 while empty
+    size_t count;
+    int fold_case;              // Tag names compare case-insensitively
+} RuleMap;
+
+typedef struct {
+    RuleMap ids;
+    RuleMap classes;
+    RuleMap tags;
+    RuleBucket universal;
+    RuleMap attributes;         // Invalidation sets only; holds no rules
+    char** attribute_names;     // Attributes tested on a selector's subject
+    size_t attribute_count;
+    unsigned int position_invalidation; // For an element whose siblings changed
+    unsigned int empty_invalidation;    // For an element whose :empty state changed
+} RuleSet;
+
+// Interned computed style
+typedef struct SharedStyle {
+    ComputedStyle style;        // First, so a ComputedStyle* converts back
+    size_t refs;                // One per element holding it
+    uint32_t hash;
+    struct SharedStyle* merged; // Worker-created style: the engine's copy after the merge
+    struct SharedStyle* next;
+} SharedStyle;
+
+// Hash set of interned styles
+typedef struct {
+    SharedStyle** slots;
+    size_t slot_count;          // Power of two, or 0 while empty
+    size_t count;
+} StyleTable;
+
+// A result a worker logs instead of writing it to the document
+typedef struct {
+    DOMNode* node;
+    SharedStyle* style;         // NULL: drop the styles below node (display: none)
+} StyleWrite;
+
+// A subtree whose element children are restyled as a unit
+typedef struct {
+    DOMNode* node;
+    const ComputedStyle* parent;
+    int force;
+    StyleWrite* writes;         // Logged results, in document order
+    size_t write_count;
+    size_t write_capacity;
+    int failed;
+} StyleTask;
+
+typedef struct {
+    StyleTask* tasks;
+    size_t count;
+    size_t capacity;
+} StyleTaskList;
+
+typedef struct {
+    const char* start;
+    size_t length;
+} ClassToken;
+
+// Scratch state for one traversal
+typedef struct {
+    RuleEntry* matched;
+    size_t matched_count;
+    size_t matched_capacity;
+    ClassToken* classes;
+    size_t class_capacity;
+    StyleStats stats;
+
+    StyleTable local;           // Worker: styles created since the last merge
+    StyleTask* task;            // Worker: where results are logged
+    StyleTaskList* deferred;    // Subtrees left for the workers instead of descending
+} StyleContext;
+
+struct StyleEngine {
+    DOMDocument* doc;
+    CSSStylesheet* user_agent;
+    CSSStylesheet** sheets;
+    size_t sheet_count;
+    size_t sheet_capacity;
+    RuleSet rules;
+    int rules_dirty;
+
+    StyleTable styles;
+
+    int full_restyle;           // Marks are meaningless; restyle everything
+    float root_font_size;       // For rem units
+    StyleContext context;
+
+    ThreadPool* pool;
+    StyleContext* workers;      // One per pool worker
+    int worker_count;
+    StyleTaskList levels[2];    // Subtrees of the current and the next level
+};
+
+static uint32_t hash_bytes(const void* data, size_t length, int fold_case) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= fold_case ? (unsigned char)tolower(bytes[i]) : bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Rule maps
+
+static RuleBucket* rule_map_find(const RuleMap* map, const char* key, size_t length) {
+    if (map->slot_count == 0) {
+        return NULL;
+    }
+    uint32_t hash = hash_bytes(key, length, map->fold_case);
+    for (RuleBucket* bucket = map->slots[hash & (map->slot_count - 1)]; bucket; bucket = bucket->next) {
+        if (bucket->hash != hash || strlen(bucket->key) != length) {
+            continue;
+        }
+        if (map->fold_case ? strncasecmp(bucket->key, key, length) == 0 : memcmp(bucket->key, key, length) == 0) {
+            return bucket;
+        }
+    }
+    return NULL;
+}
+
+static int rule_map_grow(RuleMap* map) {
+    size_t slot_count = map->slot_count ? map->slot_count * 2 : 16;
+    RuleBucket** slots = (RuleBucket**)calloc(slot_count, sizeof(RuleBucket*));
+    if (!slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < map->slot_count; i++) {
+        RuleBucket* bucket = map->slots[i];
+        while (bucket) {
+            RuleBucket* next = bucket->next;
+            bucket->next = slots[bucket->hash & (slot_count - 1)];
+            slots[bucket->hash & (slot_count - 1)] = bucket;
+            bucket = next;
+        }
+    }
+    free(map->slots);
+    map->slots = slots;
+    map->slot_count = slot_count;
+    return 0;
+}
+
+static RuleBucket* rule_map_get(RuleMap* map, const char* key) {
+    size_t length = strlen(key);
+    RuleBucket* bucket = rule_map_find(map, key, length);
+    if (bucket) {
+        return bucket;
+    }
+    if (map->count >= map->slot_count && rule_map_grow(map) != 0) {
+        return NULL;
+    }
+
+    bucket = (RuleBucket*)calloc(1, sizeof(RuleBucket));
+    if (!bucket) {
+        return NULL;
+    }
+    bucket->key = strdup(key);
+    if (!bucket->key) {
+        free(bucket);
+        return NULL;
+    }
+    bucket->hash = hash_bytes(key, length, map->fold_case);
+    bucket->next = map->slots[bucket->hash & (map->slot_count - 1)];
+    map->slots[bucket->hash & (map->slot_count - 1)] = bucket;
+    map->count++;
+    return bucket;
+}
+
+static void rule_map_clear(RuleMap* map) {
+    for (size_t i = 0; i < map->slot_count; i++) {
+        RuleBucket* bucket = map->slots[i];
+        while (bucket) {
+            RuleBucket* next = bucket->next;
+            free(bucket->key);
+            free(bucket->entries);
+            free(bucket);
+            bucket = next;
+        }
+    }
+    free(map->slots);
+    map->slots = NULL;
+    map->slot_count = 0;
+    map->count = 0;
+}
+
+static int bucket_push(RuleBucket* bucket, const RuleEntry* entry) {
+    if (bucket->count == bucket->capacity) {
+        size_t capacity = bucket->capacity ? bucket->capacity * 2 : 4;
+        RuleEntry* entries = (RuleEntry*)realloc(bucket->entries, capacity * sizeof(RuleEntry));
+        if (!entries) {
+            return -1;
+        }
+        bucket->entries = entries;
+        bucket->capacity = capacity;
+    }
+    bucket->entries[bucket->count++] = *entry;
+    return 0;
+}
+
+static void rule_set_clear(RuleSet* rules) {
+    rule_map_clear(&rules->ids);
+    rule_map_clear(&rules->classes);
+    rule_map_clear(&rules->tags);
+    rule_map_clear(&rules->attributes);
+    free(rules->universal.entries);
+    memset(&rules->universal, 0, sizeof(RuleBucket));
+    for (size_t i = 0; i < rules->attribute_count; i++) {
+        free(rules->attribute_names[i]);
+    }
+    free(rules->attribute_names);
+    rules->attribute_names = NULL;
+    rules->attribute_count = 0;
+    rules->position_invalidation = 0;
+    rules->empty_invalidation = 0;
+}
+
+// Whether two siblings that agree on tag, classes and attributes could
+// still match the selector differently: anything in the sibling-connected
+// chain ending at the subject (pseudo-classes, + and ~) looks beyond them
+static int selector_sibling_sensitive(const CSSSelector* selector) {
+    for (size_t i = selector->count; i-- > 0;) {
+        const CSSCompound* compound = &selector->compounds[i];
+        if (compound->pseudo) {
+            return 1;
+        }
+        if (compound->combinator == CSS_COMBINATOR_ADJACENT || compound->combinator == CSS_COMBINATOR_SIBLING) {
+            return 1;
+        }
+        if (compound->combinator != CSS_COMBINATOR_NONE) {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static int rule_set_note_attribute(RuleSet* rules, const char* name) {
+    for (size_t i = 0; i < rules->attribute_count; i++) {
+        if (strcmp(rules->attribute_names[i], name) == 0) {
+            return 0;
+        }
+    }
+    char* copy = strdup(name);
+    char** names = copy ? (char**)realloc(rules->attribute_names, (rules->attribute_count + 1) * sizeof(char*)) : NULL;
+    if (!names) {
+        free(copy);
+        return -1;
+    }
+    names[rules->attribute_count++] = copy;
+    rules->attribute_names = names;
+    return 0;
+}
+
+static int invalidate_on(RuleMap* map, const char* key, unsigned int flags) {
+    RuleBucket* bucket = rule_map_get(map, key);
+    if (!bucket) {
+        return -1;
+    }
+    bucket->invalidation |= flags;
+    return 0;
+}
+
+// Record what a change of each class, id and attribute in the selector can
+// restyle. A feature of the subject affects the element itself; one further
+// left affects descendants or later siblings, depending on the combinator
+// that leads away from its compound.
+static int rule_set_add_invalidation(RuleSet* rules, const CSSSelector* selector) {
+    for (size_t i = 0; i < selector->count; i++) {
+        const CSSCompound* compound = &selector->compounds[i];
+        unsigned int flags = INVALIDATE_SELF;
+        if (i + 1 < selector->count) {
+            CSSCombinator next = selector->compounds[i + 1].combinator;
+            flags = next == CSS_COMBINATOR_ADJACENT || next == CSS_COMBINATOR_SIBLING ? INVALIDATE_SIBLINGS
+                                                                                      : INVALIDATE_DESCENDANTS;
+        }
+        if ((compound->pseudo & (CSS_PSEUDO_FIRST_CHILD | CSS_PSEUDO_LAST_CHILD)) ||
+            compound->combinator == CSS_COMBINATOR_ADJACENT || compound->combinator == CSS_COMBINATOR_SIBLING) {
+            rules->position_invalidation |= flags;
+        }
+        if (compound->pseudo & CSS_PSEUDO_EMPTY) {
+            rules->empty_invalidation |= flags;
+        }
+
+        if (compound->id && invalidate_on(&rules->ids, compound->id, flags) != 0) {
+            return -1;
+        }
+        for (size_t c = 0; c < compound->class_count; c++) {
+            if (invalidate_on(&rules->classes, compound->classes[c], flags) != 0) {
+                return -1;
+            }
+        }
+        for (size_t a = 0; a < compound->attribute_count; a++) {
+            if (invalidate_on(&rules->attributes, compound->attributes[a].name, flags) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int rule_set_add(RuleSet* rules, const CSSRule* rule, const CSSSelector* selector, uint64_t priority) {
+    const CSSCompound* subject = &selector->compounds[selector->count - 1];
+    RuleBucket* bucket;
+    if (subject->id) {
+        bucket = rule_map_get(&rules->ids, subject->id);
+    } else if (subject->class_count > 0) {
+        bucket = rule_map_get(&rules->classes, subject->classes[0]);
+    } else if (subject->tag) {
+        bucket = rule_map_get(&rules->tags, subject->tag);
+    } else {
+        bucket = &rules->universal;
+    }
+    if (!bucket) {
+        return -1;
+    }
+
+    RuleEntry entry = { rule, selector, priority };
+    if (bucket_push(bucket, &entry) != 0) {
+        return -1;
+    }
+    if (selector_sibling_sensitive(selector)) {
+        bucket->sibling_sensitive = 1;
+    }
+    for (size_t i = 0; i < subject->attribute_count; i++) {
+        if (rule_set_note_attribute(rules, subject->attributes[i].name) != 0) {
+            return -1;
+        }
+    }
+    return rule_set_add_invalidation(rules, selector);
+}
+
+static int rule_set_add_sheet(RuleSet* rules, const CSSStylesheet* sheet, int origin, uint32_t* order) {
+    for (size_t r = 0; r < sheet->count; r++) {
+        const CSSRule* rule = &sheet->rules[r];
+        for (size_t s = 0; s < rule->selector_count; s++) {
+            const CSSSelector* selector = &rule->selectors[s];
+            uint64_t priority = (uint64_t)origin << 62 | (uint64_t)selector->specificity << 32 | (*order)++;
+            if (rule_set_add(rules, rule, selector, priority) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static int rebuild_rules(StyleEngine* engine) {
+    RuleSet* rules = &engine->rules;
+    rule_set_clear(rules);
+    rules->tags.fold_case = 1;
+
+    uint32_t order = 0;
+    if (rule_set_add_sheet(rules, engine->user_agent, ORIGIN_USER_AGENT, &order) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < engine->sheet_count; i++) {
+        if (rule_set_add_sheet(rules, engine->sheets[i], ORIGIN_AUTHOR, &order) != 0) {
+            return -1;
+        }
+    }
+    engine->rules_dirty = 0;
+    return 0;
+}
+
+// Interned styles
+
+static void style_unlink(StyleTable* table, SharedStyle* style) {
+    SharedStyle** link = &table->slots[style->hash & (table->slot_count - 1)];
+    while (*link != style) {
+        link = &(*link)->next;
+    }
+    *link = style->next;
+    table->count--;
+}
+
+// DOM release hook: an element dropped its reference
+static void style_release(void* value, void* user_data) {
+    StyleEngine* engine = (StyleEngine*)user_data;
+    SharedStyle* style = (SharedStyle*)value;
+    if (--style->refs == 0) {
+        style_unlink(&engine->styles, style);
+        free(style);
+    }
+}
+
+static int style_table_grow(StyleTable* table) {
+    size_t slot_count = table->slot_count ? table->slot_count * 2 : 64;
+    SharedStyle** slots = (SharedStyle**)calloc(slot_count, sizeof(SharedStyle*));
+    if (!slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < table->slot_count; i++) {
+        SharedStyle* style = table->slots[i];
+        while (style) {
+            SharedStyle* next = style->next;
+            style->next = slots[style->hash & (slot_count - 1)];
+            slots[style->hash & (slot_count - 1)] = style;
+            style = next;
+        }
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slot_count = slot_count;
+    return 0;
+}
+
+static SharedStyle* style_table_find(const StyleTable* table, const ComputedStyle* computed, uint32_t hash) {
+    if (table->slot_count == 0) {
+        return NULL;
+    }
+    for (SharedStyle* style = table->slots[hash & (table->slot_count - 1)]; style; style = style->next) {
+        if (style->hash == hash && memcmp(&style->style, computed, sizeof(ComputedStyle)) == 0) {
+            return style;
+        }
+    }
+    return NULL;
+}
+
+// Link a style in; the table must have a free slot
+static void style_table_insert(StyleTable* table, SharedStyle* style) {
+    style->next = table->slots[style->hash & (table->slot_count - 1)];
+    table->slots[style->hash & (table->slot_count - 1)] = style;
+    table->count++;
+}
+
+static void style_table_clear(StyleTable* table) {
+    for (size_t i = 0; i < table->slot_count; i++) {
+        SharedStyle* style = table->slots[i];
+        while (style) {
+            SharedStyle* next = style->next;
+            free(style);
+            style = next;
+        }
+        table->slots[i] = NULL;
+    }
+    table->count = 0;
+}
+
+// Find or create the shared copy of a style; the caller gets no reference.
+// Workers leave the engine's table alone and add new styles to their own.
+static SharedStyle* style_intern(StyleEngine* engine, StyleContext* context, const ComputedStyle* computed) {
+    uint32_t hash = hash_bytes(computed, sizeof(ComputedStyle), 0);
+    SharedStyle* style = style_table_find(&engine->styles, computed, hash);
+    StyleTable* table = &engine->styles;
+    if (!style && context->task) {
+        table = &context->local;
+        style = style_table_find(table, computed, hash);
+    }
+    if (style) {
+        return style;
+    }
+    if (table->count >= table->slot_count && style_table_grow(table) != 0) {
+        return NULL;
+    }
+
+    style = (SharedStyle*)malloc(sizeof(SharedStyle));
+    if (!style) {
+        return NULL;
+    }
+    style->style = *computed;
+    style->refs = 0;
+    style->hash = hash;
+    style->merged = NULL;
+    style_table_insert(table, style);
+    return style;
+}
+
+// Store a style on a node, taking a reference
+static int store_style(DOMNode* node, SharedStyle* style) {
+    if ((SharedStyle*)dom_node_get_style_cache(node) == style) {
+        return 0;
+    }
+    style->refs++;
+    if (dom_node_set_style_cache(node, style) != 0) {
+        style->refs--;
+        return -1;
+    }
+    return 0;
+}
+
+// Drop the styles and marks of everything below a display: none element
+static void clear_styles(DOMNode* node) {
+    for (DOMNode* child = dom_node_get_first_child(node); child; child = dom_node_get_next_sibling(child)) {
+        if (dom_node_get_type(child) == NODE_ELEMENT) {
+            if (dom_node_get_style_cache(child)) {
+                dom_node_set_style_cache(child, NULL);
+            }
+            dom_node_clear_style_dirty(child);
+            clear_styles(child);
+        }
+    }
+}
+
+// Selector matching
+
+static DOMNode* parent_element(DOMNode* node) {
+    DOMNode* parent = dom_node_get_parent(node);
+    return parent && dom_node_get_type(parent) == NODE_ELEMENT ? parent : NULL;
+}
+
+static DOMNode* previous_element(DOMNode* node) {
+    do {
+        node = dom_node_get_previous_sibling(node);
+    } while (node && dom_node_get_type(node) != NODE_ELEMENT);
+    return node;
+}
+
+static DOMNode* next_element(DOMNode* node) {
+    do {
+        node = dom_node_get_next_sibling(node);
+    } while (node && dom_node_get_type(node) != NODE_ELEMENT);
+    return node;
+}
+
+static int is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+// Whitespace-separated token search, for class lists and ~=
+static int list_contains(const char* list, size_t list_length, const char* token, size_t token_length) {
+    size_t i = 0;
+    while (i < list_length) {
+        while (i < list_length && is_space(list[i])) {
+            i++;
+        }
+        size_t start = i;
+        while (i < list_length && !is_space(list[i])) {
+            i++;
+        }
+        if (i - start == token_length && token_length > 0 && memcmp(list + start, token, token_length) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int match_attribute(DOMElement* element, const CSSAttributeSelector* attribute) {
+    size_t length;
+    const char* value = dom_element_get_attribute_len(element, attribute->name, strlen(attribute->name), &length);
+    if (!value) {
+        return 0;
+    }
+    if (attribute->match == CSS_MATCH_EXISTS) {
+        return 1;
+    }
+
+    size_t wanted = strlen(attribute->value);
+    switch (attribute->match) {
+        case CSS_MATCH_EQUALS:
+            return length == wanted && memcmp(value, attribute->value, length) == 0;
+        case CSS_MATCH_INCLUDES:
+            return list_contains(value, length, attribute->value, wanted);
+        case CSS_MATCH_DASH:
+            return length >= wanted && memcmp(value, attribute->value, wanted) == 0 &&
+                   (length == wanted || value[wanted] == '-');
+        case CSS_MATCH_PREFIX:
+            return wanted > 0 && length >= wanted && memcmp(value, attribute->value, wanted) == 0;
+        case CSS_MATCH_SUFFIX:
+            return wanted > 0 && length >= wanted && memcmp(value + length - wanted, attribute->value, wanted) == 0;
+        case CSS_MATCH_SUBSTRING:
+            for (size_t i = 0; wanted > 0 && i + wanted <= length; i++) {
+                if (memcmp(value + i, attribute->value, wanted) == 0) {
+                    return 1;
+                }
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static int is_empty(DOMNode* node) {
+    for (DOMNode* child = dom_node_get_first_child(node); child; child = dom_node_get_next_sibling(child)) {
+        DOMNodeType type = dom_node_get_type(child);
+        size_t length = 0;
+        if (type == NODE_ELEMENT || (type == NODE_TEXT && dom_node_get_value(child, &length) && length > 0)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int match_compound(const CSSCompound* compound, DOMNode* node) {
+    DOMElement* element = (DOMElement*)node;
+    if (compound->tag && strcasecmp(dom_element_get_tag_name(element), compound->tag) != 0) {
+        return 0;
+    }
+    if (compound->id) {
+        size_t length;
+        const char* id = dom_element_get_attribute_len(element, "id", 2, &length);
+        if (!id || length != strlen(compound->id) || memcmp(id, compound->id, length) != 0) {
+            return 0;
+        }
+    }
+    if (compound->class_count > 0) {
+        size_t length;
+        const char* list = dom_element_get_attribute_len(element, "class", 5, &length);
+        if (!list) {
+            return 0;
+        }
+        for (size_t i = 0; i < compound->class_count; i++) {
+            if (!list_contains(list, length, compound->classes[i], strlen(compound->classes[i]))) {
+                return 0;
+            }
+        }
+    }
+    for (size_t i = 0; i < compound->attribute_count; i++) {
+        if (!match_attribute(element, &compound->attributes[i])) {
+            return 0;
+        }
+    }
+    if (compound->pseudo) {
+        if ((compound->pseudo & CSS_PSEUDO_FIRST_CHILD) && previous_element(node)) {
+            return 0;
+        }
+        if ((compound->pseudo & CSS_PSEUDO_LAST_CHILD) && next_element(node)) {
+            return 0;
+        }
+        if (compound->pseudo & CSS_PSEUDO_ROOT) {
+            DOMNode* parent = dom_node_get_parent(node);
+            if (!parent || dom_node_get_type(parent) != NODE_DOCUMENT) {
+                return 0;
+            }
+        }
+        if ((compound->pseudo & CSS_PSEUDO_EMPTY) && !is_empty(node)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Match compounds[0..index] with compounds[index] against node, right to left
+static int match_selector(const CSSSelector* selector, size_t index, DOMNode* node) {
+    if (!match_compound(&selector->compounds[index], node)) {
+        return 0;
+    }
+    if (index == 0) {
+        return 1;
+    }
+
+    switch (selector->compounds[index].combinator) {
+        case CSS_COMBINATOR_CHILD: {
+            DOMNode* parent = parent_element(node);
+            return parent && match_selector(selector, index - 1, parent);
+        }
+        case CSS_COMBINATOR_DESCENDANT:
+            for (DOMNode* ancestor = parent_element(node); ancestor; ancestor = parent_element(ancestor)) {
+                if (match_selector(selector, index - 1, ancestor)) {
+                    return 1;
+                }
+            }
+            return 0;
+        case CSS_COMBINATOR_ADJACENT: {
+            DOMNode* sibling = previous_element(node);
+            return sibling && match_selector(selector, index - 1, sibling);
+        }
+        case CSS_COMBINATOR_SIBLING:
+            for (DOMNode* sibling = previous_element(node); sibling; sibling = previous_element(sibling)) {
+                if (match_selector(selector, index - 1, sibling)) {
+                    return 1;
+                }
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static int context_push_match(StyleContext* context, const RuleEntry* entry) {
+    if (context->matched_count == context->matched_capacity) {
+        size_t capacity = context->matched_capacity ? context->matched_capacity * 2 : 32;
+        RuleEntry* matched = (RuleEntry*)realloc(context->matched, capacity * sizeof(RuleEntry));
+        if (!matched) {
+            return -1;
+        }
+        context->matched = matched;
+        context->matched_capacity = capacity;
+    }
+    context->matched[context->matched_count++] = *entry;
+    return 0;
+}
+
+static int match_bucket(StyleContext* context, const RuleBucket* bucket, DOMNode* node) {
+    if (!bucket) {
+        return 0;
+    }
+    for (size_t i = 0; i < bucket->count; i++) {
+        const RuleEntry* entry = &bucket->entries[i];
+        context->stats.selectors_tested++;
+        if (match_selector(entry->selector, entry->selector->count - 1, node) &&
+            context_push_match(context, entry) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Split an element's class attribute, dropping duplicates so no bucket is
+// matched twice
+static size_t split_classes(StyleContext* context, const char* list, size_t length) {
+    size_t count = 0;
+    size_t i = 0;
+    while (i < length) {
+        while (i < length && is_space(list[i])) {
+            i++;
+        }
+        size_t start = i;
+        while (i < length && !is_space(list[i])) {
+            i++;
+        }
+        if (i == start) {
+            break;
+        }
+
+        int duplicate = 0;
+        for (size_t c = 0; c < count; c++) {
+            if (context->classes[c].length == i - start && memcmp(context->classes[c].start, list + start, i - start) == 0) {
+                duplicate = 1;
+                break;
+            }
+        }
+        if (duplicate) {
+            continue;
+        }
+        if (count == context->class_capacity) {
+            size_t capacity = context->class_capacity ? context->class_capacity * 2 : 8;
+            ClassToken* classes = (ClassToken*)realloc(context->classes, capacity * sizeof(ClassToken));
+            if (!classes) {
+                return (size_t)-1;
+            }
+            context->classes = classes;
+            context->class_capacity = capacity;
+        }
+        context->classes[count].start = list + start;
+        context->classes[count].length = i - start;
+        count++;
+    }
+    return count;
+}
+
+// Collect every rule matching an element, in cascade order
+static int collect_matches(StyleEngine* engine, StyleContext* context, DOMNode* node) {
+    const RuleSet* rules = &engine->rules;
+    DOMElement* element = (DOMElement*)node;
+    context->matched_count = 0;
+
+    size_t length;
+    const char* id = dom_element_get_attribute_len(element, "id", 2, &length);
+    if (id && length > 0 && match_bucket(context, rule_map_find(&rules->ids, id, length), node) != 0) {
+        return -1;
+    }
+
+    const char* list = dom_element_get_attribute_len(element, "class", 5, &length);
+    if (list && rules->classes.count > 0) {
+        size_t count = split_classes(context, list, length);
+        if (count == (size_t)-1) {
+            return -1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            const RuleBucket* bucket = rule_map_find(&rules->classes, context->classes[i].start, context->classes[i].length);
+            if (match_bucket(context, bucket, node) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    const char* tag = dom_element_get_tag_name(element);
+    if (match_bucket(context, rule_map_find(&rules->tags, tag, strlen(tag)), node) != 0 ||
+        match_bucket(context, &rules->universal, node) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_priority(const void* a, const void* b) {
+    uint64_t left = ((const RuleEntry*)a)->priority;
+    uint64_t right = ((const RuleEntry*)b)->priority;
+    return left < right ? -1 : left > right;
+}
+
+// Computing values
+
+static void initial_style(ComputedStyle* style) {
+    memset(style, 0, sizeof(ComputedStyle));
+    style->display = CSS_DISPLAY_INLINE;
+    style->color.a = 255;
+    style->font_size = INITIAL_FONT_SIZE;
+    style->font_weight = 400;
+    style->line_height.type = CSS_LENGTH_NUMBER;
+    style->line_height.value = 1.2f;
+    style->width.type = CSS_LENGTH_AUTO;
+    style->height.type = CSS_LENGTH_AUTO;
+    for (int side = 0; side < 4; side++) {
+        style->margin[side].type = CSS_LENGTH_PX;
+        style->padding[side].type = CSS_LENGTH_PX;
+    }
+}
+
+enum {
+    USE_VALUE,
+    USE_INHERIT,
+    USE_INITIAL
+};
+
+static int value_action(const CSSValue* value, CSSProperty property, const ComputedStyle* parent) {
+    if (!value || value->type == CSS_VALUE_UNSET) {
+        return css_property_inherited(property) && parent ? USE_INHERIT : USE_INITIAL;
+    }
+    if (value->type == CSS_VALUE_INHERIT) {
+        return parent ? USE_INHERIT : USE_INITIAL;
+    }
+    return value->type == CSS_VALUE_INITIAL ? USE_INITIAL : USE_VALUE;
+}
+
+static float length_px(const CSSValue* value, float font_size, float root_font_size) {
+    switch (value->unit) {
+        case CSS_UNIT_EM:
+            return value->number * font_size;
+        case CSS_UNIT_REM:
+            return value->number * root_font_size;
+        default:
+            return value->number;
+    }
+}
+
+static CSSLength compute_length(const CSSValue* value, float font_size, float root_font_size) {
+    CSSLength length;
+    length.type = CSS_LENGTH_AUTO;
+    length.value = 0.0f;
+    if (value->type == CSS_VALUE_PERCENT) {
+        length.type = CSS_LENGTH_PERCENT;
+        length.value = value->number;
+    } else if (value->type == CSS_VALUE_LENGTH) {
+        length.type = CSS_LENGTH_PX;
+        length.value = length_px(value, font_size, root_font_size);
+    }
+    // No negative zero, so equal styles stay byte-identical
+    length.value += 0.0f;
+    return length;
+}
+
+static CSSColor compute_color(const CSSValue* value, CSSColor current) {
+    return value->type == CSS_VALUE_COLOR ? value->color : current;
+}
+
+static int relative_weight(int keyword, int parent) {
+    if (keyword == CSS_FONT_WEIGHT_BOLDER) {
+        return parent < 350 ? 400 : parent < 550 ? 700 : 900;
+    }
+    return parent < 550 ? 100 : parent < 750 ? 400 : 700;
+}
+
+static void compute_style(const CSSValue* const* specified, const ComputedStyle* parent, int is_root,
+                          float root_font_size, ComputedStyle* out) {
+    ComputedStyle initial;
+    initial_style(&initial);
+    initial_style(out);
+    const ComputedStyle* inherit = parent ? parent : &initial;
+
+    // Font size first: em units everywhere else depend on it
+    const CSSValue* value = specified[CSS_PROP_FONT_SIZE];
+    switch (value_action(value, CSS_PROP_FONT_SIZE, parent)) {
+        case USE_INHERIT:
+            out->font_size = inherit->font_size;
+            break;
+        case USE_VALUE:
+            if (value->type == CSS_VALUE_PERCENT) {
+                out->font_size = value->number * inherit->font_size / 100.0f;
+            } else {
+                out->font_size = length_px(value, inherit->font_size, root_font_size);
+            }
+            break;
+        default:
+            break;
+    }
+    float font_size = out->font_size;
+
+    value = specified[CSS_PROP_COLOR];
+    switch (value_action(value, CSS_PROP_COLOR, parent)) {
+        case USE_INHERIT:
+            out->color = inherit->color;
+            break;
+        case USE_VALUE:
+            out->color = compute_color(value, inherit->color);
+            break;
+        default:
+            break;
+    }
+
+    value = specified[CSS_PROP_FONT_WEIGHT];
+    switch (value_action(value, CSS_PROP_FONT_WEIGHT, parent)) {
+        case USE_INHERIT:
+            out->font_weight = inherit->font_weight;
+            break;
+        case USE_VALUE:
+            out->font_weight = value->type == CSS_VALUE_KEYWORD ? relative_weight(value->keyword, inherit->font_weight)
+                                                                : (int)value->number;
+            break;
+        default:
+            break;
+    }
+
+    value = specified[CSS_PROP_LINE_HEIGHT];
+    switch (value_action(value, CSS_PROP_LINE_HEIGHT, parent)) {
+        case USE_INHERIT:
+            out->line_height = inherit->line_height;
+            break;
+        case USE_VALUE:
+            if (value->type == CSS_VALUE_NUMBER) {
+                out->line_height.type = CSS_LENGTH_NUMBER;
+                out->line_height.value = value->number;
+            } else if (value->type == CSS_VALUE_PERCENT) {
+                out->line_height.type = CSS_LENGTH_PX;
+                out->line_height.value = value->number * font_size / 100.0f;
+            } else {
+                out->line_height = compute_length(value, font_size, root_font_size);
+            }
+            break;
+        default:
+            break;
+    }
+
+    // Keyword properties
+    static const struct {
+        CSSProperty property;
+        size_t offset;
+    } keywords[] = {
+        { CSS_PROP_DISPLAY, offsetof(ComputedStyle, display) },
+        { CSS_PROP_FONT_STYLE, offsetof(ComputedStyle, font_style) },
+        { CSS_PROP_TEXT_ALIGN, offsetof(ComputedStyle, text_align) },
+        { CSS_PROP_WHITE_SPACE, offsetof(ComputedStyle, white_space) }
+    };
+    for (size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+        value = specified[keywords[i].property];
+        int* field = (int*)((char*)out + keywords[i].offset);
+        switch (value_action(value, keywords[i].property, parent)) {
+            case USE_INHERIT:
+                *field = *(const int*)((const char*)inherit + keywords[i].offset);
+                break;
+            case USE_VALUE:
+                *field = value->keyword;
+                break;
+            default:
+                break;
+        }
+    }
+    // The root element always generates a block
+    if (is_root && out->display != CSS_DISPLAY_NONE) {
+        out->display = CSS_DISPLAY_BLOCK;
+    }
+
+    // Box lengths
+    static const struct {
+        CSSProperty property;
+        size_t offset;
+    } lengths[] = {
+        { CSS_PROP_WIDTH, offsetof(ComputedStyle, width) },
+        { CSS_PROP_HEIGHT, offsetof(ComputedStyle, height) },
+        { CSS_PROP_MARGIN_TOP, offsetof(ComputedStyle, margin[0]) },
+        { CSS_PROP_MARGIN_RIGHT, offsetof(ComputedStyle, margin[1]) },
+        { CSS_PROP_MARGIN_BOTTOM, offsetof(ComputedStyle, margin[2]) },
+        { CSS_PROP_MARGIN_LEFT, offsetof(ComputedStyle, margin[3]) },
+        { CSS_PROP_PADDING_TOP, offsetof(ComputedStyle, padding[0]) },
+        { CSS_PROP_PADDING_RIGHT, offsetof(ComputedStyle, padding[1]) },
+        { CSS_PROP_PADDING_BOTTOM, offsetof(ComputedStyle, padding[2]) },
+        { CSS_PROP_PADDING_LEFT, offsetof(ComputedStyle, padding[3]) }
+    };
+    for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        value = specified[lengths[i].property];
+        CSSLength* field = (CSSLength*)((char*)out + lengths[i].offset);
+        switch (value_action(value, lengths[i].property, parent)) {
+            case USE_INHERIT:
+                *field = *(const CSSLength*)((const char*)inherit + lengths[i].offset);
+                break;
+            case USE_VALUE:
+                *field = compute_length(value, font_size, root_font_size);
+                break;
+            default:
+                break;
+        }
+    }
+
+    // Border widths collapse to 0 on sides without a style
+    for (int side = 0; side < 4; side++) {
+        const CSSValue* style = specified[CSS_PROP_BORDER_TOP_STYLE + side];
+        int visible = 0;
+        switch (value_action(style, (CSSProperty)(CSS_PROP_BORDER_TOP_STYLE + side), parent)) {
+            case USE_INHERIT:
+                visible = inherit->border_width[side] > 0.0f;
+                break;
+            case USE_VALUE:
+                visible = style->keyword == CSS_BORDER_STYLE_VISIBLE;
+                break;
+            default:
+                break;
+        }
+        if (!visible) {
+            continue;
+        }
+
+        value = specified[CSS_PROP_BORDER_TOP_WIDTH + side];
+        switch (value_action(value, (CSSProperty)(CSS_PROP_BORDER_TOP_WIDTH + side), parent)) {
+            case USE_INHERIT:
+                out->border_width[side] = inherit->border_width[side];
+                break;
+            case USE_VALUE:
+                out->border_width[side] = length_px(value, font_size, root_font_size) + 0.0f;
+                break;
+            default:
+                out->border_width[side] = 3.0f;
+                break;
+        }
+    }
+
+    value = specified[CSS_PROP_BACKGROUND_COLOR];
+    switch (value_action(value, CSS_PROP_BACKGROUND_COLOR, parent)) {
+        case USE_INHERIT:
+            out->background_color = inherit->background_color;
+            break;
+        case USE_VALUE:
+            out->background_color = compute_color(value, out->color);
+            break;
+        default:
+            break;
+    }
+
+    // Initially currentColor
+    value = specified[CSS_PROP_BORDER_COLOR];
+    switch (value_action(value, CSS_PROP_BORDER_COLOR, parent)) {
+        case USE_INHERIT:
+            out->border_color = inherit->border_color;
+            break;
+        case USE_VALUE:
+            out->border_color = compute_color(value, out->color);
+            break;
+        default:
+            out->border_color = out->color;
+            break;
+    }
+}
+
+static void apply_declarations(const CSSValue** specified, const CSSDeclaration* declarations, size_t count,
+                               int important) {
+    for (size_t i = 0; i < count; i++) {
+        if (declarations[i].important == important) {
+            specified[declarations[i].property] = &declarations[i].value;
+        }
+    }
+}
+
+// Match, cascade and compute an element's style
+static SharedStyle* resolve_style(StyleEngine* engine, StyleContext* context, DOMNode* node,
+                                  const ComputedStyle* parent, int is_root) {
+    if (collect_matches(engine, context, node) != 0) {
+        return NULL;
+    }
+    if (context->matched_count > 1) {
+        qsort(context->matched, context->matched_count, sizeof(RuleEntry), compare_priority);
+    }
+
+    size_t inline_count = 0;
+    CSSDeclaration* inline_declarations = NULL;
+    size_t length;
+    const char* inline_style = dom_element_get_attribute_len((DOMElement*)node, "style", 5, &length);
+    if (inline_style) {
+        inline_declarations = css_parse_declarations(inline_style, length, &inline_count);
+    }
+
+    // Normal declarations in cascade order, then the style attribute, then
+    // the same again for !important
+    const CSSValue* specified[CSS_PROP_COUNT] = { 0 };
+    for (int important = 0; important <= 1; important++) {
+        for (size_t i = 0; i < context->matched_count; i++) {
+            const CSSRule* rule = context->matched[i].rule;
+            apply_declarations(specified, rule->declarations, rule->declaration_count, important);
+        }
+        apply_declarations(specified, inline_declarations, inline_count, important);
+    }
+
+    ComputedStyle computed;
+    compute_style(specified, parent, is_root, engine->root_font_size, &computed);
+    free(inline_declarations);
+    return style_intern(engine, context, &computed);
+}
+
+static int same_attribute(DOMElement* a, DOMElement* b, const char* name) {
+    size_t name_length = strlen(name);
+    size_t a_length, b_length;
+    const char* a_value = dom_element_get_attribute_len(a, name, name_length, &a_length);
+    const char* b_value = dom_element_get_attribute_len(b, name, name_length, &b_length);
+    if (!a_value || !b_value) {
+        return a_value == b_value;
+    }
+    return a_length == b_length && memcmp(a_value, b_value, a_length) == 0;
+}
+
+// Whether an element may take a sibling's style at all: no inline style,
+// no id any rule mentions, and no rule it could match that looks at its
+// position among its siblings
+static int sharing_allowed(StyleEngine* engine, StyleContext* context, DOMNode* node) {
+    const RuleSet* rules = &engine->rules;
+    DOMElement* element = (DOMElement*)node;
+    if (dom_element_get_attribute_len(element, "style", 5, NULL)) {
+        return 0;
+    }
+
+    size_t length;
+    const char* id = dom_element_get_attribute_len(element, "id", 2, &length);
+    if (id && rule_map_find(&rules->ids, id, length)) {
+        return 0;
+    }
+    if (rules->universal.sibling_sensitive) {
+        return 0;
+    }
+    const char* tag = dom_element_get_tag_name(element);
+    const RuleBucket* bucket = rule_map_find(&rules->tags, tag, strlen(tag));
+    if (bucket && bucket->sibling_sensitive) {
+        return 0;
+    }
+
+    const char* list = dom_element_get_attribute_len(element, "class", 5, &length);
+    if (list && rules->classes.count > 0) {
+        size_t count = split_classes(context, list, length);
+        if (count == (size_t)-1) {
+            return 0;
+        }
+        for (size_t i = 0; i < count; i++) {
+            bucket = rule_map_find(&rules->classes, context->classes[i].start, context->classes[i].length);
+            if (bucket && bucket->sibling_sensitive) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+// A preceding sibling can hand over its style when it has the same tag,
+// classes and tested attributes: with the same parent and ancestors, every
+// rule then matches both or neither
+static int can_share(StyleEngine* engine, DOMNode* node, DOMNode* candidate) {
+    DOMElement* element = (DOMElement*)node;
+    DOMElement* other = (DOMElement*)candidate;
+    if (strcasecmp(dom_element_get_tag_name(element), dom_element_get_tag_name(other)) != 0) {
+        return 0;
+    }
+    if (!same_attribute(element, other, "class") || !same_attribute(element, other, "style")) {
+        return 0;
+    }
+
+    // Ids no rule mentions are irrelevant, but one that is mentioned
+    // excludes the element from sharing altogether
+    size_t length;
+    const char* id = dom_element_get_attribute_len(other, "id", 2, &length);
+    if (id && rule_map_find(&engine->rules.ids, id, length)) {
+        return 0;
+    }
+    for (size_t i = 0; i < engine->rules.attribute_count; i++) {
+        if (!same_attribute(element, other, engine->rules.attribute_names[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Whether descendants styled against the old style need restyling
+static int descendants_affected(const SharedStyle* old, const SharedStyle* style) {
+    if (old == style) {
+        return 0;
+    }
+    if (!old) {
+        return 1;
+    }
+    const ComputedStyle* a = &old->style;
+    const ComputedStyle* b = &style->style;
+    return a->display != b->display || memcmp(&a->color, &b->color, sizeof(CSSColor)) != 0 ||
+           a->font_size != b->font_size || a->font_weight != b->font_weight || a->font_style != b->font_style ||
+           a->line_height.type != b->line_height.type || a->line_height.value != b->line_height.value ||
+           a->text_align != b->text_align || a->white_space != b->white_space;
+}
+
+static int task_push_write(StyleTask* task, DOMNode* node, SharedStyle* style) {
+    if (task->write_count == task->write_capacity) {
+        size_t capacity = task->write_capacity ? task->write_capacity * 2 : 64;
+        StyleWrite* writes = (StyleWrite*)realloc(task->writes, capacity * sizeof(StyleWrite));
+        if (!writes) {
+            return -1;
+        }
+        task->writes = writes;
+        task->write_capacity = capacity;
+    }
+    task->writes[task->write_count].node = node;
+    task->writes[task->write_count].style = style;
+    task->write_count++;
+    return 0;
+}
+
+// Queue a subtree, keeping the log buffer of the slot it reuses
+static int task_list_push(StyleTaskList* list, DOMNode* node, const ComputedStyle* parent, int force) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        StyleTask* tasks = (StyleTask*)realloc(list->tasks, capacity * sizeof(StyleTask));
+        if (!tasks) {
+            return -1;
+        }
+        memset(tasks + list->capacity, 0, (capacity - list->capacity) * sizeof(StyleTask));
+        list->tasks = tasks;
+        list->capacity = capacity;
+    }
+    StyleTask* task = &list->tasks[list->count++];
+    task->node = node;
+    task->parent = parent;
+    task->force = force;
+    task->write_count = 0;
+    task->failed = 0;
+    return 0;
+}
+
+static void task_list_clear(StyleTaskList* list) {
+    for (size_t i = 0; i < list->capacity; i++) {
+        free(list->tasks[i].writes);
+    }
+    free(list->tasks);
+    memset(list, 0, sizeof(StyleTaskList));
+}
+
+// Restyle the element children of parent_node that are marked, or all of
+// them when force is set, and descend wherever something below is marked
+static int resolve_children(StyleEngine* engine, StyleContext* context, DOMNode* parent_node,
+                            const ComputedStyle* parent, int force) {
+    DOMNode* candidates[SHARING_CANDIDATES];
+    SharedStyle* candidate_styles[SHARING_CANDIDATES];  // Workers have not stored theirs yet
+    size_t candidate_count = 0;
+    size_t next_candidate = 0;
+    int is_root = dom_node_get_type(parent_node) == NODE_DOCUMENT;
+
+    for (DOMNode* child = dom_node_get_first_child(parent_node); child; child = dom_node_get_next_sibling(child)) {
+        if (dom_node_get_type(child) != NODE_ELEMENT) {
+            continue;
+        }
+
+        unsigned int dirty = dom_node_get_style_dirty(child);
+        dom_node_clear_style_dirty(child);
+        SharedStyle* old = (SharedStyle*)dom_node_get_style_cache(child);
+        SharedStyle* style = old;
+        if (force || !old || (dirty & (DOM_STYLE_DIRTY_SELF | DOM_STYLE_DIRTY_SUBTREE))) {
+            style = NULL;
+            if (candidate_count > 0 && sharing_allowed(engine, context, child)) {
+                for (size_t i = 0; i < candidate_count && !style; i++) {
+                    size_t slot = (next_candidate + SHARING_CANDIDATES - 1 - i) % SHARING_CANDIDATES;
+                    if (can_share(engine, child, candidates[slot])) {
+                        style = candidate_styles[slot];
+                    }
+                }
+                if (style) {
+                    context->stats.styles_shared++;
+                }
+            }
+            if (!style) {
+                style = resolve_style(engine, context, child, parent, is_root);
+            }
+            if (!style) {
+                return -1;
+            }
+            context->stats.elements_styled++;
+        }
+
+        // Decide before storing, which may free the old style
+        int force_children = force || (dirty & DOM_STYLE_DIRTY_SUBTREE) || descendants_affected(old, style);
+        if (is_root) {
+            // rem units everywhere follow the root's font size
+            force_children |= old && old->style.font_size != style->style.font_size;
+            engine->root_font_size = style->style.font_size;
+        }
+        if (context->task) {
+            if (task_push_write(context->task, child, style) != 0) {
+                return -1;
+            }
+        } else {
+            if (old != style) {
+                dom_node_mark_layout_dirty(child);
+            }
+            if (store_style(child, style) != 0) {
+                return -1;
+            }
+        }
+
+        candidates[next_candidate] = child;
+        candidate_styles[next_candidate] = style;
+        next_candidate = (next_candidate + 1) % SHARING_CANDIDATES;
+        if (candidate_count < SHARING_CANDIDATES) {
+            candidate_count++;
+        }
+
+        if (style->style.display == CSS_DISPLAY_NONE) {
+            if (!context->task) {
+                clear_styles(child);
+            } else if (task_push_write(context->task, child, NULL) != 0) {
+                return -1;
+            }
+        } else if (force_children || (dirty & DOM_STYLE_DIRTY_CHILDREN)) {
+            int result = context->deferred
+                             ? task_list_push(context->deferred, child, &style->style, force_children)
+                             : resolve_children(engine, context, child, &style->style, force_children);
+            if (result != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+// Parallel resolve
+
+static void resolve_task(void* user_data, size_t index, int worker) {
+    StyleEngine* engine = (StyleEngine*)user_data;
+    StyleContext* context = &engine->workers[worker];
+    StyleTask* task = &engine->levels[0].tasks[index];
+    context->task = task;
+    task->failed = resolve_children(engine, context, task->node, task->parent, task->force) != 0;
+    context->task = NULL;
+}
+
+// Move the styles the workers created into the engine's table, pointing
+// each one that duplicates a style already there (or made by another
+// worker) at that copy; the duplicates go on the retired list
+static int merge_worker_styles(StyleEngine* engine, SharedStyle** retired) {
+    size_t needed = engine->styles.count;
+    for (int w = 0; w < engine->worker_count; w++) {
+        needed += engine->workers[w].local.count;
+    }
+    while (needed > engine->styles.slot_count) {
+        if (style_table_grow(&engine->styles) != 0) {
+            return -1;
+        }
+    }
+
+    for (int w = 0; w < engine->worker_count; w++) {
+        StyleTable* local = &engine->workers[w].local;
+        for (size_t i = 0; i < local->slot_count; i++) {
+            SharedStyle* style = local->slots[i];
+            while (style) {
+                SharedStyle* next = style->next;
+                style->merged = style_table_find(&engine->styles, &style->style, style->hash);
+                if (style->merged) {
+                    style->next = *retired;
+                    *retired = style;
+                } else {
+                    style->merged = style;
+                    style_table_insert(&engine->styles, style);
+                }
+                style = next;
+            }
+            local->slots[i] = NULL;
+        }
+        local->count = 0;
+    }
+    return 0;
+}
+
+// Apply the logged results of every task in document order
+static int apply_tasks(StyleEngine* engine, StyleTaskList* list) {
+    int failed = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        failed |= list->tasks[i].failed;
+    }
+    for (int w = 0; w < engine->worker_count; w++) {
+        StyleStats* stats = &engine->workers[w].stats;
+        engine->context.stats.elements_styled += stats->elements_styled;
+        engine->context.stats.styles_shared += stats->styles_shared;
+        engine->context.stats.selectors_tested += stats->selectors_tested;
+        memset(stats, 0, sizeof(StyleStats));
+    }
+
+    SharedStyle* retired = NULL;
+    if (failed || merge_worker_styles(engine, &retired) != 0) {
+        for (int w = 0; w < engine->worker_count; w++) {
+            style_table_clear(&engine->workers[w].local);
+        }
+        failed = 1;
+    } else {
+        // Every new style is referenced before any old one is released:
+        // storing a style may free one a later write still needs
+        for (size_t i = 0; i < list->count; i++) {
+            StyleTask* task = &list->tasks[i];
+            for (size_t j = 0; j < task->write_count; j++) {
+                SharedStyle* style = task->writes[j].style;
+                if (style) {
+                    if (style->merged) {
+                        style = style->merged;
+                    }
+                    style->refs++;
+                    task->writes[j].style = style;
+                }
+            }
+        }
+        for (size_t i = 0; i < list->count; i++) {
+            StyleTask* task = &list->tasks[i];
+            for (size_t j = 0; j < task->write_count; j++) {
+                DOMNode* node = task->writes[j].node;
+                SharedStyle* style = task->writes[j].style;
+                if (!style) {
+                    clear_styles(node);
+                    continue;
+                }
+                // The reference taken above passes to the node
+                if ((SharedStyle*)dom_node_get_style_cache(node) == style) {
+                    style->refs--;
+                    continue;
+                }
+                dom_node_mark_layout_dirty(node);
+                if (dom_node_set_style_cache(node, style) != 0) {
+                    style->refs--;
+                    failed = 1;
+                }
+            }
+        }
+    }
+
+    while (retired) {
+        SharedStyle* next = retired->next;
+        free(retired);
+        retired = next;
+    }
+    return failed ? -1 : 0;
+}
+
+// Restyle level by level on the calling thread until there are enough
+// independent subtrees to keep the workers busy, then restyle those on the
+// pool. Each level's subtrees are queued by the level above.
+static int resolve_parallel(StyleEngine* engine, DOMNode* root, int force) {
+    StyleTaskList* current = &engine->levels[0];
+    StyleTaskList* next = &engine->levels[1];
+    size_t target = (size_t)engine->worker_count * TASKS_PER_WORKER;
+
+    current->count = 0;
+    if (task_list_push(current, root, NULL, force) != 0) {
+        return -1;
+    }
+    while (current->count > 0 && current->count < target) {
+        next->count = 0;
+        engine->context.deferred = next;
+        for (size_t i = 0; i < current->count; i++) {
+            StyleTask* task = &current->tasks[i];
+            if (resolve_children(engine, &engine->context, task->node, task->parent, task->force) != 0) {
+                engine->context.deferred = NULL;
+                return -1;
+            }
+        }
+        engine->context.deferred = NULL;
+        StyleTaskList swap = *current;
+        *current = *next;
+        *next = swap;
+    }
+    if (current->count == 0) {
+        return 0;
+    }
+
+    // Workers must not materialize lazily parsed nodes
+    for (size_t i = 0; i < current->count; i++) {
+        if (dom_node_materialize(current->tasks[i].node) != 0) {
+            return -1;
+        }
+    }
+    if (thread_pool_parallel_for(engine->pool, current->count, resolve_task, engine) != 0) {
+        return -1;
+    }
+    return apply_tasks(engine, current);
+}
+
+// Invalidation
+
+static void invalidate(DOMNode* node, unsigned int flags) {
+    if (flags & INVALIDATE_DESCENDANTS) {
+        dom_node_mark_style_dirty(node, DOM_STYLE_DIRTY_SUBTREE);
+    } else if (flags & INVALIDATE_SELF) {
+        dom_node_mark_style_dirty(node, DOM_STYLE_DIRTY_SELF);
+    }
+    if (flags & INVALIDATE_SIBLINGS) {
+        for (DOMNode* sibling = next_element(node); sibling; sibling = next_element(sibling)) {
+            dom_node_mark_style_dirty(sibling, DOM_STYLE_DIRTY_SUBTREE);
+        }
+    }
+}
+
+static void invalidate_key(DOMNode* node, const RuleMap* map, const char* key, size_t length) {
+    const RuleBucket* bucket = length > 0 ? rule_map_find(map, key, length) : NULL;
+    if (bucket) {
+        invalidate(node, bucket->invalidation);
+    }
+}
+
+// Invalidate for every class in one list but not the other
+static void invalidate_classes(DOMNode* node, const RuleMap* classes, const char* list, size_t length,
+                               const char* other, size_t other_length) {
+    size_t i = 0;
+    while (i < length) {
+        while (i < length && is_space(list[i])) {
+            i++;
+        }
+        size_t start = i;
+        while (i < length && !is_space(list[i])) {
+            i++;
+        }
+        if (i > start && !list_contains(other, other_length, list + start, i - start)) {
+            invalidate_key(node, classes, list + start, i - start);
+        }
+    }
+}
+
+// The children of node changed: its :empty state may have, and so may the
+// position of each child among its siblings
+static void invalidate_structure(const RuleSet* rules, DOMNode* node, int elements_changed) {
+    if (rules->empty_invalidation && dom_node_get_type(node) == NODE_ELEMENT) {
+        invalidate(node, rules->empty_invalidation);
+    }
+    if (rules->position_invalidation && elements_changed) {
+        for (DOMNode* child = dom_node_get_first_child(node); child; child = dom_node_get_next_sibling(child)) {
+            if (dom_node_get_type(child) == NODE_ELEMENT) {
+                invalidate(child, rules->position_invalidation);
+            }
+        }
+    }
+}
+
+// Mutation observer: mark what the mutation can restyle
+static void style_mutated(const DOMMutation* mutation, void* user_data) {
+    StyleEngine* engine = (StyleEngine*)user_data;
+    if (engine->full_restyle) {
+        return;
+    }
+
+    DOMNode* target = mutation->target;
+    const RuleSet* rules = &engine->rules;
+    switch (mutation->type) {
+        case DOM_MUTATION_ATTRIBUTE: {
+            const char* name = mutation->name;
+            size_t length = mutation->name_length;
+            const char* old_value = mutation->old_value ? mutation->old_value : "";
+            if (length == 5 && memcmp(name, "style", 5) == 0) {
+                dom_node_mark_style_dirty(target, DOM_STYLE_DIRTY_SELF);
+            } else if (length == 5 && memcmp(name, "class", 5) == 0) {
+                invalidate_classes(target, &rules->classes, old_value, mutation->old_value_length,
+                                   mutation->value, mutation->value_length);
+                invalidate_classes(target, &rules->classes, mutation->value, mutation->value_length,
+                                   old_value, mutation->old_value_length);
+            } else if (length == 2 && memcmp(name, "id", 2) == 0) {
+                invalidate_key(target, &rules->ids, old_value, mutation->old_value_length);
+                invalidate_key(target, &rules->ids, mutation->value, mutation->value_length);
+            }
+            // Attribute selectors, including ones on class and id
+            invalidate_key(target, &rules->attributes, name, length);
+            break;
+        }
+        case DOM_MUTATION_CHILD_LIST: {
+            DOMNode* child = mutation->added ? mutation->added : mutation->removed;
+            if (mutation->added) {
+                dom_node_mark_style_dirty(mutation->added, DOM_STYLE_DIRTY_SUBTREE);
+            } else if (!mutation->removed) {
+                dom_node_mark_style_dirty(target, DOM_STYLE_DIRTY_SUBTREE);
+            }
+            invalidate_structure(rules, target, !child || dom_node_get_type(child) == NODE_ELEMENT);
+            break;
+        }
+        case DOM_MUTATION_CHARACTER_DATA:
+            // Only :empty looks at text
+            if (dom_node_get_parent(target)) {
+                invalidate_structure(rules, dom_node_get_parent(target), 0);
+            }
+            break;
+    }
+}
+
+StyleEngine* style_engine_create(DOMDocument* doc) {
+    if (!doc) {
+        return NULL;
+    }
+
+    StyleEngine* engine = (StyleEngine*)calloc(1, sizeof(StyleEngine));
+    if (!engine) {
+        return NULL;
+    }
+    engine->doc = doc;
+    engine->root_font_size = INITIAL_FONT_SIZE;
+    engine->rules_dirty = 1;
+    engine->full_restyle = 1;
+    engine->user_agent = css_stylesheet_parse(user_agent_css, sizeof(user_agent_css) - 1);
+    if (!engine->user_agent) {
+        free(engine);
+        return NULL;
+    }
+
+    dom_document_set_style_cache(doc, style_release, engine);
+    dom_document_set_mutation_observer(doc, style_mutated, engine);
+    return engine;
+}
+
+void style_engine_destroy(StyleEngine* engine) {
+    if (!engine) {
+        return;
+    }
+
+    dom_document_set_mutation_observer(engine->doc, NULL, NULL);
+    // Hands every stored style back through style_release
+    dom_document_set_style_cache(engine->doc, NULL, NULL);
+    style_table_clear(&engine->styles);
+    free(engine->styles.slots);
+    style_engine_set_thread_pool(engine, NULL);
+    task_list_clear(&engine->levels[0]);
+    task_list_clear(&engine->levels[1]);
+
+    rule_set_clear(&engine->rules);
+    style_engine_clear_stylesheets(engine);
+    free(engine->sheets);
+    css_stylesheet_destroy(engine->user_agent);
+    free(engine->context.matched);
+    free(engine->context.classes);
+    free(engine);
+}
+
+int style_engine_add_stylesheet(StyleEngine* engine, CSSStylesheet* sheet) {
+    if (!engine || !sheet) {
+        return -1;
+    }
+
+    if (engine->sheet_count == engine->sheet_capacity) {
+        size_t capacity = engine->sheet_capacity ? engine->sheet_capacity * 2 : 4;
+        CSSStylesheet** sheets = (CSSStylesheet**)realloc(engine->sheets, capacity * sizeof(CSSStylesheet*));
+        if (!sheets) {
+            return -1;
+        }
+        engine->sheets = sheets;
+        engine->sheet_capacity = capacity;
+    }
+    engine->sheets[engine->sheet_count++] = sheet;
+    engine->rules_dirty = 1;
+    return 0;
+}
+
+void style_engine_clear_stylesheets(StyleEngine* engine) {
+    if (!engine) {
+        return;
+    }
+
+    for (size_t i = 0; i < engine->sheet_count; i++) {
+        css_stylesheet_destroy(engine->sheets[i]);
+    }
+    engine->sheet_count = 0;
+    engine->rules_dirty = 1;
+}
+
+int style_engine_resolve(StyleEngine* engine) {
+    if (!engine) {
+        return -1;
+    }
+
+    memset(&engine->context.stats, 0, sizeof(StyleStats));
+    if (engine->rules_dirty) {
+        // New rules invalidate every style, and invalidation sets built from
+        // a half-built rule set cannot be trusted
+        engine->full_restyle = 1;
+        if (rebuild_rules(engine) != 0) {
+            return -1;
+        }
+    }
+
+    DOMNode* root = (DOMNode*)engine->doc;
+    unsigned int dirty = dom_node_get_style_dirty(root);
+    dom_node_clear_style_dirty(root);
+    if (engine->full_restyle || dirty) {
+        // A traversal that fails part way has cleared marks on elements it
+        // did not restyle, so until it succeeds only a full restyle is safe
+        int force = engine->full_restyle || (dirty & (DOM_STYLE_DIRTY_SELF | DOM_STYLE_DIRTY_SUBTREE));
+        engine->full_restyle = 1;
+        if (force) {
+            engine->root_font_size = INITIAL_FONT_SIZE;
+        }
+        int result = engine->worker_count > 1 ? resolve_parallel(engine, root, force)
+                                               : resolve_children(engine, &engine->context, root, NULL, force);
+        if (result != 0) {
+            return -1;
+        }
+        engine->full_restyle = 0;
+    }
+
+    engine->context.stats.unique_styles = engine->styles.count;
+    return 0;
+}
+
+int style_engine_set_thread_pool(StyleEngine* engine, ThreadPool* pool) {
+    if (!engine) {
+        return -1;
+    }
+
+    int worker_count = pool ? thread_pool_get_worker_count(pool) : 0;
+    StyleContext* workers = NULL;
+    if (worker_count > 1) {
+        workers = (StyleContext*)calloc((size_t)worker_count, sizeof(StyleContext));
+        if (!workers) {
+            return -1;
+        }
+    }
+
+    for (int w = 0; w < engine->worker_count; w++) {
+        StyleContext* context = &engine->workers[w];
+        free(context->matched);
+        free(context->classes);
+        free(context->local.slots);
+    }
+    free(engine->workers);
+    engine->pool = workers ? pool : NULL;
+    engine->workers = workers;
+    engine->worker_count = workers ? worker_count : 0;
+    return 0;
+}
+
+const ComputedStyle* style_engine_get_style(StyleEngine* engine, DOMElement* element) {
+    if (!engine || !element) {
+        return NULL;
+    }
+
+    SharedStyle* style = (SharedStyle*)dom_node_get_style_cache((DOMNode*)element);
+    return style ? &style->style : NULL;
+}
+
+int style_engine_get_stats(StyleEngine* engine, StyleStats* stats) {
+    if (!engine || !stats) {
+        return -1;
+    }
+
+    *stats = engine->context.stats;
+    return 0;
+}
@@ -0,0 +1,1309 @@
+#include "css_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+// CSS parser
+// A single forward scan splits the source into rules, each rule into a
+// selector list and a declaration block. Values are parsed into typed
+// CSSValues up front and shorthands are expanded into longhands, so the
+// cascade never looks at text again.
+
+#define MAX_VALUE_TOKENS 8
+
+// A whitespace-separated piece of a declaration value
+typedef struct {
+    const char* start;
+    size_t length;
+} ValueToken;
+
+typedef struct {
+    CSSDeclaration* items;
+    size_t count;
+    size_t capacity;
+} DeclarationList;
+
+static const char* skip_space(const char* p, const char* end) {
+    for (;;) {
+        while (p < end && isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (p + 1 < end && p[0] == '/' && p[1] == '*') {
+            const char* close = p + 2;
+            while (close + 1 < end && !(close[0] == '*' && close[1] == '/')) {
+                close++;
+            }
+            p = close + 1 < end ? close + 2 : end;
+            continue;
+        }
+        return p;
+    }
+}
+
+// Skip a quoted string starting at its opening quote
+static const char* skip_string(const char* p, const char* end) {
+    char quote = *p++;
+    while (p < end && *p != quote) {
+        if (*p == '\\' && p + 1 < end) {
+            p++;
+        }
+        p++;
+    }
+    return p < end ? p + 1 : end;
+}
+
+// Find the first of two stop characters outside strings, comments and
+// brackets; returns end when there is none
+static const char* scan_until(const char* p, const char* end, char stop, char alternate) {
+    int depth = 0;
+    while (p < end) {
+        char c = *p;
+        if (depth == 0 && (c == stop || c == alternate)) {
+            return p;
+        }
+        if (c == '"' || c == '\'') {
+            p = skip_string(p, end);
+            continue;
+        }
+        if (c == '/' && p + 1 < end && p[1] == '*') {
+            p = skip_space(p, end);
+            continue;
+        }
+        if (c == '\\' && p + 1 < end) {
+            p += 2;
+            continue;
+        }
+        if (c == '(' || c == '[' || c == '{') {
+            depth++;
+        } else if ((c == ')' || c == ']' || c == '}') && depth > 0) {
+            depth--;
+        }
+        p++;
+    }
+    return end;
+}
+
+static const char* trim_end(const char* start, const char* end) {
+    while (end > start && isspace((unsigned char)end[-1])) {
+        end--;
+    }
+    return end;
+}
+
+static int is_ident_char(char c) {
+    return isalnum((unsigned char)c) || c == '-' || c == '_' || (unsigned char)c >= 0x80 || c == '\\';
+}
+
+// Read an identifier, resolving backslash escapes of single characters
+static char* read_ident(const char** cursor, const char* end, int lowercase) {
+    const char* p = *cursor;
+    size_t length = 0;
+    while (p < end && is_ident_char(*p)) {
+        if (*p == '\\') {
+            if (p + 1 >= end) {
+                break;
+            }
+            p++;
+        }
+        p++;
+        length++;
+    }
+    if (length == 0) {
+        return NULL;
+    }
+
+    char* ident = (char*)malloc(length + 1);
+    if (!ident) {
+        return NULL;
+    }
+    size_t i = 0;
+    for (p = *cursor; i < length; p++) {
+        if (*p == '\\') {
+            p++;
+        }
+        ident[i++] = lowercase ? (char)tolower((unsigned char)*p) : *p;
+    }
+    ident[length] = '\0';
+    *cursor = p;
+    return ident;
+}
+
+static int push_string(char*** items, size_t* count, char* value) {
+    char** grown = (char**)realloc(*items, (*count + 1) * sizeof(char*));
+    if (!grown) {
+        free(value);
+        return -1;
+    }
+    grown[(*count)++] = value;
+    *items = grown;
+    return 0;
+}
+
+static void compound_free(CSSCompound* compound) {
+    free(compound->tag);
+    free(compound->id);
+    for (size_t i = 0; i < compound->class_count; i++) {
+        free(compound->classes[i]);
+    }
+    free(compound->classes);
+    for (size_t i = 0; i < compound->attribute_count; i++) {
+        free(compound->attributes[i].name);
+        free(compound->attributes[i].value);
+    }
+    free(compound->attributes);
+}
+
+static void selector_free(CSSSelector* selector) {
+    for (size_t i = 0; i < selector->count; i++) {
+        compound_free(&selector->compounds[i]);
+    }
+    free(selector->compounds);
+}
+
+static void rule_free(CSSRule* rule) {
+    for (size_t i = 0; i < rule->selector_count; i++) {
+        selector_free(&rule->selectors[i]);
+    }
+    free(rule->selectors);
+    free(rule->declarations);
+}
+
+// [name], [name=value], [name~="value"], ...; cursor is past the '['
+static int parse_attribute(const char** cursor, const char* end, CSSCompound* compound) {
+    const char* p = skip_space(*cursor, end);
+    CSSAttributeSelector attribute;
+    memset(&attribute, 0, sizeof(attribute));
+
+    attribute.name = read_ident(&p, end, 1);
+    if (!attribute.name) {
+        return -1;
+    }
+    p = skip_space(p, end);
+
+    attribute.match = CSS_MATCH_EXISTS;
+    if (p < end && *p != ']') {
+        static const char operators[] = "~|^$*";
+        const char* op = *p ? strchr(operators, *p) : NULL;
+        if (op && p + 1 < end && p[1] == '=') {
+            attribute.match = (CSSAttributeMatch)(CSS_MATCH_INCLUDES + (op - operators));
+            p += 2;
+        } else if (*p == '=') {
+            attribute.match = CSS_MATCH_EQUALS;
+            p++;
+        } else {
+            free(attribute.name);
+            return -1;
+        }
+
+        p = skip_space(p, end);
+        if (p < end && (*p == '"' || *p == '\'')) {
+            const char* close = skip_string(p, end);
+            size_t length = (size_t)(close - p) - 2;
+            if (close > end || close - p < 2 || close[-1] != *p) {
+                free(attribute.name);
+                return -1;
+            }
+            attribute.value = (char*)malloc(length + 1);
+            if (attribute.value) {
+                memcpy(attribute.value, p + 1, length);
+                attribute.value[length] = '\0';
+            }
+            p = close;
+        } else {
+            attribute.value = read_ident(&p, end, 0);
+        }
+        if (!attribute.value) {
+            free(attribute.name);
+            return -1;
+        }
+        p = skip_space(p, end);
+    }
+
+    if (p >= end || *p != ']') {
+        free(attribute.name);
+        free(attribute.value);
+        return -1;
+    }
+
+    CSSAttributeSelector* grown = (CSSAttributeSelector*)realloc(compound->attributes,
+        (compound->attribute_count + 1) * sizeof(CSSAttributeSelector));
+    if (!grown) {
+        free(attribute.name);
+        free(attribute.value);
+        return -1;
+    }
+    grown[compound->attribute_count++] = attribute;
+    compound->attributes = grown;
+    *cursor = p + 1;
+    return 0;
+}
+
+static int parse_pseudo(const char** cursor, const char* end, CSSCompound* compound) {
+    const char* p = *cursor;
+    // Pseudo-elements never match an element
+    if (p < end && *p == ':') {
+        return -1;
+    }
+    char* name = read_ident(&p, end, 1);
+    if (!name) {
+        return -1;
+    }
+
+    static const struct {
+        const char* name;
+        unsigned int flags;
+    } pseudo_classes[] = {
+        { "first-child", CSS_PSEUDO_FIRST_CHILD },
+        { "last-child", CSS_PSEUDO_LAST_CHILD },
+        { "only-child", CSS_PSEUDO_FIRST_CHILD | CSS_PSEUDO_LAST_CHILD },
+        { "root", CSS_PSEUDO_ROOT },
+        { "empty", CSS_PSEUDO_EMPTY }
+    };
+    unsigned int flags = 0;
+    for (size_t i = 0; i < sizeof(pseudo_classes) / sizeof(pseudo_classes[0]); i++) {
+        if (strcmp(name, pseudo_classes[i].name) == 0) {
+            flags = pseudo_classes[i].flags;
+            break;
+        }
+    }
+    free(name);
+
+    // Dynamic and functional pseudo-classes are unsupported; the rule is
+    // dropped rather than applied unconditionally
+    if (!flags || (p < end && *p == '(')) {
+        return -1;
+    }
+    compound->pseudo |= flags;
+    *cursor = p;
+    return 0;
+}
+
+static int parse_compound(const char** cursor, const char* end, CSSCompound* compound) {
+    const char* p = *cursor;
+    memset(compound, 0, sizeof(CSSCompound));
+
+    int any = 0;
+    if (p < end && *p == '*') {
+        p++;
+        any = 1;
+    } else if (p < end && is_ident_char(*p)) {
+        compound->tag = read_ident(&p, end, 1);
+        if (!compound->tag) {
+            return -1;
+        }
+        any = 1;
+    }
+
+    while (p < end) {
+        int result = 0;
+        if (*p == '#') {
+            p++;
+            char* id = read_ident(&p, end, 0);
+            if (!id) {
+                result = -1;
+            } else if (!compound->id) {
+                compound->id = id;
+            } else {
+                // A second id must also match; check it as an attribute
+                CSSAttributeSelector* grown = (CSSAttributeSelector*)realloc(compound->attributes,
+                    (compound->attribute_count + 1) * sizeof(CSSAttributeSelector));
+                char* name = strdup("id");
+                if (!grown || !name) {
+                    compound->attributes = grown ? grown : compound->attributes;
+                    free(name);
+                    free(id);
+                    result = -1;
+                } else {
+                    grown[compound->attribute_count].name = name;
+                    grown[compound->attribute_count].value = id;
+                    grown[compound->attribute_count].match = CSS_MATCH_EQUALS;
+                    compound->attribute_count++;
+                    compound->attributes = grown;
+                }
+            }
+        } else if (*p == '.') {
+            p++;
+            char* name = read_ident(&p, end, 0);
+            result = name ? push_string(&compound->classes, &compound->class_count, name) : -1;
+        } else if (*p == '[') {
+            p++;
+            result = parse_attribute(&p, end, compound);
+        } else if (*p == ':') {
+            p++;
+            result = parse_pseudo(&p, end, compound);
+        } else {
+            break;
+        }
+        if (result != 0) {
+            compound_free(compound);
+            return -1;
+        }
+        any = 1;
+    }
+
+    if (!any) {
+        compound_free(compound);
+        return -1;
+    }
+    *cursor = p;
+    return 0;
+}
+
+static void compound_specificity(const CSSCompound* compound, uint32_t* ids, uint32_t* classes, uint32_t* tags) {
+    *ids += compound->id ? 1 : 0;
+    *classes += (uint32_t)(compound->class_count + compound->attribute_count);
+    for (unsigned int flags = compound->pseudo; flags; flags &= flags - 1) {
+        (*classes)++;
+    }
+    *tags += compound->tag ? 1 : 0;
+}
+
+static int parse_selector(const char* start, const char* end, CSSSelector* selector) {
+    memset(selector, 0, sizeof(CSSSelector));
+    const char* p = start;
+    CSSCombinator pending = CSS_COMBINATOR_NONE;
+    int explicit_combinator = 0;
+
+    for (;;) {
+        const char* before = p;
+        p = skip_space(p, end);
+        int spaced = p != before;
+        if (p >= end) {
+            break;
+        }
+
+        if (*p == '>' || *p == '+' || *p == '~') {
+            if (selector->count == 0 || explicit_combinator) {
+                selector_free(selector);
+                return -1;
+            }
+            pending = *p == '>' ? CSS_COMBINATOR_CHILD :
+                      *p == '+' ? CSS_COMBINATOR_ADJACENT : CSS_COMBINATOR_SIBLING;
+            explicit_combinator = 1;
+            p++;
+            continue;
+        }
+
+        if (selector->count > 0 && !explicit_combinator) {
+            if (!spaced) {
+                selector_free(selector);
+                return -1;
+            }
+            pending = CSS_COMBINATOR_DESCENDANT;
+        }
+
+        CSSCompound compound;
+        if (parse_compound(&p, end, &compound) != 0) {
+            selector_free(selector);
+            return -1;
+        }
+        compound.combinator = selector->count > 0 ? pending : CSS_COMBINATOR_NONE;
+
+        CSSCompound* grown = (CSSCompound*)realloc(selector->compounds, (selector->count + 1) * sizeof(CSSCompound));
+        if (!grown) {
+            compound_free(&compound);
+            selector_free(selector);
+            return -1;
+        }
+        grown[selector->count++] = compound;
+        selector->compounds = grown;
+        pending = CSS_COMBINATOR_NONE;
+        explicit_combinator = 0;
+    }
+
+    if (selector->count == 0 || explicit_combinator) {
+        selector_free(selector);
+        return -1;
+    }
+
+    uint32_t ids = 0, classes = 0, tags = 0;
+    for (size_t i = 0; i < selector->count; i++) {
+        compound_specificity(&selector->compounds[i], &ids, &classes, &tags);
+    }
+    ids = ids > 1023 ? 1023 : ids;
+    classes = classes > 1023 ? 1023 : classes;
+    tags = tags > 1023 ? 1023 : tags;
+    selector->specificity = ids << 20 | classes << 10 | tags;
+    return 0;
+}
+
+// Any invalid selector invalidates the whole list
+static int parse_selector_list(const char* start, const char* end, CSSRule* rule) {
+    const char* p = start;
+    while (p < end) {
+        const char* comma = scan_until(p, end, ',', ',');
+        CSSSelector selector;
+        if (parse_selector(p, comma, &selector) != 0) {
+            return -1;
+        }
+        CSSSelector* grown = (CSSSelector*)realloc(rule->selectors, (rule->selector_count + 1) * sizeof(CSSSelector));
+        if (!grown) {
+            selector_free(&selector);
+            return -1;
+        }
+        grown[rule->selector_count++] = selector;
+        rule->selectors = grown;
+        if (comma >= end) {
+            break;
+        }
+        p = comma + 1;
+        if (p >= end) {
+            return -1;
+        }
+    }
+    return rule->selector_count > 0 ? 0 : -1;
+}
+
+// Values
+
+static int token_is(const ValueToken* token, const char* word) {
+    return strlen(word) == token->length && strncasecmp(token->start, word, token->length) == 0;
+}
+
+// Parse a plain decimal number; returns the characters consumed, 0 if none
+static size_t parse_number(const char* p, size_t length, float* out) {
+    size_t i = 0;
+    float sign = 1.0f;
+    if (i < length && (p[i] == '+' || p[i] == '-')) {
+        sign = p[i] == '-' ? -1.0f : 1.0f;
+        i++;
+    }
+    double value = 0.0;
+    size_t digits = 0;
+    while (i < length && isdigit((unsigned char)p[i])) {
+        value = value * 10.0 + (p[i] - '0');
+        i++;
+        digits++;
+    }
+    if (i < length && p[i] == '.') {
+        double scale = 0.1;
+        i++;
+        while (i < length && isdigit((unsigned char)p[i])) {
+            value += (p[i] - '0') * scale;
+            scale *= 0.1;
+            i++;
+            digits++;
+        }
+    }
+    if (digits == 0) {
+        return 0;
+    }
+    *out = sign * (float)value;
+    return i;
+}
+
+// Lengths with their unit; unitless 0 is always a length
+static int parse_length(const ValueToken* token, CSSValue* value, int allow_percent, int allow_negative) {
+    float number;
+    size_t used = parse_number(token->start, token->length, &number);
+    if (used == 0) {
+        return -1;
+    }
+    if (number < 0 && !allow_negative) {
+        return -1;
+    }
+
+    ValueToken unit = { token->start + used, token->length - used };
+    static const struct {
+        const char* name;
+        float px;
+    } absolute_units[] = {
+        { "px", 1.0f }, { "pt", 96.0f / 72.0f }, { "pc", 16.0f },
+        { "in", 96.0f }, { "cm", 96.0f / 2.54f }, { "mm", 96.0f / 25.4f }
+    };
+
+    memset(value, 0, sizeof(CSSValue));
+    value->type = CSS_VALUE_LENGTH;
+    if (unit.length == 0) {
+        if (number != 0.0f) {
+            return -1;
+        }
+        value->number = 0.0f;
+        return 0;
+    }
+    if (unit.length == 1 && unit.start[0] == '%') {
+        if (!allow_percent) {
+            return -1;
+        }
+        value->type = CSS_VALUE_PERCENT;
+        value->number = number;
+        return 0;
+    }
+    if (token_is(&unit, "em")) {
+        value->unit = CSS_UNIT_EM;
+        value->number = number;
+        return 0;
+    }
+    if (token_is(&unit, "rem")) {
+        value->unit = CSS_UNIT_REM;
+        value->number = number;
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(absolute_units) / sizeof(absolute_units[0]); i++) {
+        if (token_is(&unit, absolute_units[i].name)) {
+            value->number = number * absolute_units[i].px;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = (char)tolower((unsigned char)c);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+static uint8_t clamp_channel(float value) {
+    if (value <= 0.0f) {
+        return 0;
+    }
+    if (value >= 255.0f) {
+        return 255;
+    }
+    return (uint8_t)(value + 0.5f);
+}
+
+// rgb()/rgba() arguments: numbers or percentages, comma or space separated
+static int parse_rgb(const char* p, const char* end, CSSColor* color) {
+    float channels[4] = { 0, 0, 0, 1.0f };
+    int count = 0;
+    while (count < 4) {
+        while (p < end && (isspace((unsigned char)*p) || *p == ',' || *p == '/')) {
+            p++;
+        }
+        if (p >= end) {
+            break;
+        }
+        float number;
+        size_t used = parse_number(p, (size_t)(end - p), &number);
+        if (used == 0) {
+            return -1;
+        }
+        p += used;
+        if (p < end && *p == '%') {
+            number = count < 3 ? number * 2.55f : number / 100.0f;
+            p++;
+        }
+        channels[count++] = number;
+    }
+    if (count < 3 || skip_space(p, end) != end) {
+        return -1;
+    }
+    color->r = clamp_channel(channels[0]);
+    color->g = clamp_channel(channels[1]);
+    color->b = clamp_channel(channels[2]);
+    color->a = clamp_channel(channels[3] * 255.0f);
+    return 0;
+}
+
+static int parse_color(const ValueToken* token, CSSValue* value) {
+    static const struct {
+        const char* name;
+        CSSColor color;
+    } named_colors[] = {
+        { "black", { 0, 0, 0, 255 } }, { "silver", { 192, 192, 192, 255 } },
+        { "gray", { 128, 128, 128, 255 } }, { "grey", { 128, 128, 128, 255 } },
+        { "white", { 255, 255, 255, 255 } }, { "maroon", { 128, 0, 0, 255 } },
+        { "red", { 255, 0, 0, 255 } }, { "purple", { 128, 0, 128, 255 } },
+        { "fuchsia", { 255, 0, 255, 255 } }, { "magenta", { 255, 0, 255, 255 } },
+        { "green", { 0, 128, 0, 255 } }, { "lime", { 0, 255, 0, 255 } },
+        { "olive", { 128, 128, 0, 255 } }, { "yellow", { 255, 255, 0, 255 } },
+        { "navy", { 0, 0, 128, 255 } }, { "blue", { 0, 0, 255, 255 } },
+        { "teal", { 0, 128, 128, 255 } }, { "aqua", { 0, 255, 255, 255 } },
+        { "cyan", { 0, 255, 255, 255 } }, { "orange", { 255, 165, 0, 255 } },
+        { "pink", { 255, 192, 203, 255 } }, { "brown", { 165, 42, 42, 255 } },
+        { "gold", { 255, 215, 0, 255 } }, { "lightgray", { 211, 211, 211, 255 } },
+        { "lightgrey", { 211, 211, 211, 255 } }, { "darkgray", { 169, 169, 169, 255 } },
+        { "darkgrey", { 169, 169, 169, 255 } }, { "whitesmoke", { 245, 245, 245, 255 } },
+        { "transparent", { 0, 0, 0, 0 } }
+    };
+
+    memset(value, 0, sizeof(CSSValue));
+    value->type = CSS_VALUE_COLOR;
+
+    const char* p = token->start;
+    size_t length = token->length;
+    if (length > 1 && p[0] == '#') {
+        int digits[8];
+        size_t count = length - 1;
+        if (count != 3 && count != 4 && count != 6 && count != 8) {
+            return -1;
+        }
+        for (size_t i = 0; i < count; i++) {
+            digits[i] = hex_digit(p[i + 1]);
+            if (digits[i] < 0) {
+                return -1;
+            }
+        }
+        uint8_t channels[4] = { 0, 0, 0, 255 };
+        for (size_t i = 0; i < count / (count > 4 ? 2 : 1); i++) {
+            channels[i] = count > 4 ? (uint8_t)(digits[i * 2] * 16 + digits[i * 2 + 1]) : (uint8_t)(digits[i] * 17);
+        }
+        value->color.r = channels[0];
+        value->color.g = channels[1];
+        value->color.b = channels[2];
+        value->color.a = channels[3];
+        return 0;
+    }
+
+    const char* paren = memchr(p, '(', length);
+    if (paren && p[length - 1] == ')') {
+        ValueToken name = { p, (size_t)(paren - p) };
+        if (token_is(&name, "rgb") || token_is(&name, "rgba")) {
+            return parse_rgb(paren + 1, p + length - 1, &value->color);
+        }
+        return -1;
+    }
+
+    if (token_is(token, "currentcolor")) {
+        value->type = CSS_VALUE_CURRENT_COLOR;
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(named_colors) / sizeof(named_colors[0]); i++) {
+        if (token_is(token, named_colors[i].name)) {
+            value->color = named_colors[i].color;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+typedef struct {
+    const char* name;
+    int keyword;
+} Keyword;
+
+static int parse_keyword(const ValueToken* token, const Keyword* keywords, size_t count, CSSValue* value) {
+    for (size_t i = 0; i < count; i++) {
+        if (token_is(token, keywords[i].name)) {
+            memset(value, 0, sizeof(CSSValue));
+            value->type = CSS_VALUE_KEYWORD;
+            value->keyword = keywords[i].keyword;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#define KEYWORDS(table, token, value) parse_keyword(token, table, sizeof(table) / sizeof(table[0]), value)
+
+// Layout is block or inline only for now, so other display types map to
+// the closest of those
+static const Keyword display_keywords[] = {
+    { "inline", CSS_DISPLAY_INLINE }, { "block", CSS_DISPLAY_BLOCK },
+    { "inline-block", CSS_DISPLAY_INLINE_BLOCK }, { "none", CSS_DISPLAY_NONE },
+    { "list-item", CSS_DISPLAY_BLOCK }, { "flow-root", CSS_DISPLAY_BLOCK },
+    { "flex", CSS_DISPLAY_BLOCK }, { "grid", CSS_DISPLAY_BLOCK },
+    { "table", CSS_DISPLAY_BLOCK }, { "table-row", CSS_DISPLAY_BLOCK },
+    { "table-row-group", CSS_DISPLAY_BLOCK }, { "table-header-group", CSS_DISPLAY_BLOCK },
+    { "table-footer-group", CSS_DISPLAY_BLOCK }, { "table-cell", CSS_DISPLAY_INLINE_BLOCK },
+    { "inline-flex", CSS_DISPLAY_INLINE_BLOCK }, { "inline-grid", CSS_DISPLAY_INLINE_BLOCK },
+    { "inline-table", CSS_DISPLAY_INLINE_BLOCK }
+};
+
+static const Keyword font_style_keywords[] = {
+    { "normal", CSS_FONT_STYLE_NORMAL }, { "italic", CSS_FONT_STYLE_ITALIC },
+    { "oblique", CSS_FONT_STYLE_ITALIC }
+};
+
+static const Keyword text_align_keywords[] = {
+    { "left", CSS_TEXT_ALIGN_LEFT }, { "right", CSS_TEXT_ALIGN_RIGHT },
+    { "center", CSS_TEXT_ALIGN_CENTER }, { "justify", CSS_TEXT_ALIGN_JUSTIFY },
+    { "start", CSS_TEXT_ALIGN_LEFT }, { "end", CSS_TEXT_ALIGN_RIGHT }
+};
+
+static const Keyword white_space_keywords[] = {
+    { "normal", CSS_WHITE_SPACE_NORMAL }, { "nowrap", CSS_WHITE_SPACE_NOWRAP },
+    { "pre", CSS_WHITE_SPACE_PRE }, { "pre-wrap", CSS_WHITE_SPACE_PRE_WRAP },
+    { "pre-line", CSS_WHITE_SPACE_PRE_LINE }, { "break-spaces", CSS_WHITE_SPACE_PRE_WRAP }
+};
+
+static const Keyword border_style_keywords[] = {
+    { "none", CSS_BORDER_STYLE_NONE }, { "hidden", CSS_BORDER_STYLE_NONE },
+    { "solid", CSS_BORDER_STYLE_VISIBLE }, { "dashed", CSS_BORDER_STYLE_VISIBLE },
+    { "dotted", CSS_BORDER_STYLE_VISIBLE }, { "double", CSS_BORDER_STYLE_VISIBLE },
+    { "groove", CSS_BORDER_STYLE_VISIBLE }, { "ridge", CSS_BORDER_STYLE_VISIBLE },
+    { "inset", CSS_BORDER_STYLE_VISIBLE }, { "outset", CSS_BORDER_STYLE_VISIBLE }
+};
+
+static const Keyword font_weight_keywords[] = {
+    { "bolder", CSS_FONT_WEIGHT_BOLDER }, { "lighter", CSS_FONT_WEIGHT_LIGHTER }
+};
+
+static void set_length_px(CSSValue* value, float px) {
+    memset(value, 0, sizeof(CSSValue));
+    value->type = CSS_VALUE_LENGTH;
+    value->number = px;
+}
+
+static void set_number(CSSValue* value, CSSValueType type, float number) {
+    memset(value, 0, sizeof(CSSValue));
+    value->type = type;
+    value->number = number;
+}
+
+static int parse_font_size(const ValueToken* token, CSSValue* value) {
+    static const struct {
+        const char* name;
+        float px;
+    } sizes[] = {
+        { "xx-small", 9.0f }, { "x-small", 10.0f }, { "small", 13.0f }, { "medium", 16.0f },
+        { "large", 18.0f }, { "x-large", 24.0f }, { "xx-large", 32.0f }, { "xxx-large", 48.0f }
+    };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        if (token_is(token, sizes[i].name)) {
+            set_length_px(value, sizes[i].px);
+            return 0;
+        }
+    }
+    if (token_is(token, "smaller")) {
+        set_number(value, CSS_VALUE_PERCENT, 100.0f / 1.2f);
+        return 0;
+    }
+    if (token_is(token, "larger")) {
+        set_number(value, CSS_VALUE_PERCENT, 120.0f);
+        return 0;
+    }
+    return parse_length(token, value, 1, 0);
+}
+
+static int parse_font_weight(const ValueToken* token, CSSValue* value) {
+    if (token_is(token, "normal")) {
+        set_number(value, CSS_VALUE_NUMBER, 400.0f);
+        return 0;
+    }
+    if (token_is(token, "bold")) {
+        set_number(value, CSS_VALUE_NUMBER, 700.0f);
+        return 0;
+    }
+    if (KEYWORDS(font_weight_keywords, token, value) == 0) {
+        return 0;
+    }
+    float number;
+    if (parse_number(token->start, token->length, &number) != token->length || number < 1.0f || number > 1000.0f) {
+        return -1;
+    }
+    set_number(value, CSS_VALUE_NUMBER, number);
+    return 0;
+}
+
+static int parse_line_height(const ValueToken* token, CSSValue* value) {
+    if (token_is(token, "normal")) {
+        set_number(value, CSS_VALUE_NUMBER, 1.2f);
+        return 0;
+    }
+    float number;
+    if (parse_number(token->start, token->length, &number) == token->length) {
+        if (number < 0.0f) {
+            return -1;
+        }
+        set_number(value, CSS_VALUE_NUMBER, number);
+        return 0;
+    }
+    return parse_length(token, value, 1, 0);
+}
+
+static int parse_border_width(const ValueToken* token, CSSValue* value) {
+    if (token_is(token, "thin")) {
+        set_length_px(value, 1.0f);
+        return 0;
+    }
+    if (token_is(token, "medium")) {
+        set_length_px(value, 3.0f);
+        return 0;
+    }
+    if (token_is(token, "thick")) {
+        set_length_px(value, 5.0f);
+        return 0;
+    }
+    return parse_length(token, value, 0, 0);
+}
+
+// width, height: auto or a non-negative length
+static int parse_size(const ValueToken* token, CSSValue* value) {
+    if (token_is(token, "auto")) {
+        memset(value, 0, sizeof(CSSValue));
+        value->type = CSS_VALUE_AUTO;
+        return 0;
+    }
+    return parse_length(token, value, 1, 0);
+}
+
+static int parse_margin(const ValueToken* token, CSSValue* value) {
+    if (token_is(token, "auto")) {
+        memset(value, 0, sizeof(CSSValue));
+        value->type = CSS_VALUE_AUTO;
+        return 0;
+    }
+    return parse_length(token, value, 1, 1);
+}
+
+static int parse_padding(const ValueToken* token, CSSValue* value) {
+    return parse_length(token, value, 1, 0);
+}
+
+static int parse_color_value(const ValueToken* token, CSSValue* value) {
+    return parse_color(token, value);
+}
+
+static int parse_display(const ValueToken* token, CSSValue* value) {
+    return KEYWORDS(display_keywords, token, value);
+}
+
+static int parse_font_style(const ValueToken* token, CSSValue* value) {
+    return KEYWORDS(font_style_keywords, token, value);
+}
+
+static int parse_text_align(const ValueToken* token, CSSValue* value) {
+    return KEYWORDS(text_align_keywords, token, value);
+}
+
+static int parse_white_space(const ValueToken* token, CSSValue* value) {
+    return KEYWORDS(white_space_keywords, token, value);
+}
+
+static int parse_border_style(const ValueToken* token, CSSValue* value) {
+    return KEYWORDS(border_style_keywords, token, value);
+}
+
+typedef int (*ValueParser)(const ValueToken* token, CSSValue* value);
+
+typedef struct {
+    const char* name;
+    CSSProperty property;
+    ValueParser parse;
+} Longhand;
+
+static const Longhand longhands[] = {
+    { "display", CSS_PROP_DISPLAY, parse_display },
+    { "color", CSS_PROP_COLOR, parse_color_value },
+    { "background-color", CSS_PROP_BACKGROUND_COLOR, parse_color_value },
+    { "font-size", CSS_PROP_FONT_SIZE, parse_font_size },
+    { "font-weight", CSS_PROP_FONT_WEIGHT, parse_font_weight },
+    { "font-style", CSS_PROP_FONT_STYLE, parse_font_style },
+    { "line-height", CSS_PROP_LINE_HEIGHT, parse_line_height },
+    { "text-align", CSS_PROP_TEXT_ALIGN, parse_text_align },
+    { "white-space", CSS_PROP_WHITE_SPACE, parse_white_space },
+    { "width", CSS_PROP_WIDTH, parse_size },
+    { "height", CSS_PROP_HEIGHT, parse_size },
+    { "margin-top", CSS_PROP_MARGIN_TOP, parse_margin },
+    { "margin-right", CSS_PROP_MARGIN_RIGHT, parse_margin },
+    { "margin-bottom", CSS_PROP_MARGIN_BOTTOM, parse_margin },
+    { "margin-left", CSS_PROP_MARGIN_LEFT, parse_margin },
+    { "padding-top", CSS_PROP_PADDING_TOP, parse_padding },
+    { "padding-right", CSS_PROP_PADDING_RIGHT, parse_padding },
+    { "padding-bottom", CSS_PROP_PADDING_BOTTOM, parse_padding },
+    { "padding-left", CSS_PROP_PADDING_LEFT, parse_padding },
+    { "border-top-width", CSS_PROP_BORDER_TOP_WIDTH, parse_border_width },
+    { "border-right-width", CSS_PROP_BORDER_RIGHT_WIDTH, parse_border_width },
+    { "border-bottom-width", CSS_PROP_BORDER_BOTTOM_WIDTH, parse_border_width },
+    { "border-left-width", CSS_PROP_BORDER_LEFT_WIDTH, parse_border_width },
+    { "border-top-style", CSS_PROP_BORDER_TOP_STYLE, parse_border_style },
+    { "border-right-style", CSS_PROP_BORDER_RIGHT_STYLE, parse_border_style },
+    { "border-bottom-style", CSS_PROP_BORDER_BOTTOM_STYLE, parse_border_style },
+    { "border-left-style", CSS_PROP_BORDER_LEFT_STYLE, parse_border_style }
+};
+
+// Four-sided shorthands: margin: 1px 2px expands to top/bottom 1px,
+// right/left 2px
+static const struct {
+    const char* name;
+    CSSProperty first;
+    ValueParser parse;
+} box_shorthands[] = {
+    { "margin", CSS_PROP_MARGIN_TOP, parse_margin },
+    { "padding", CSS_PROP_PADDING_TOP, parse_padding },
+    { "border-width", CSS_PROP_BORDER_TOP_WIDTH, parse_border_width },
+    { "border-style", CSS_PROP_BORDER_TOP_STYLE, parse_border_style }
+};
+
+static const char* const border_sides[] = { "border-top", "border-right", "border-bottom", "border-left" };
+
+static int declaration_push(DeclarationList* list, CSSProperty property, const CSSValue* value, int important) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 8;
+        CSSDeclaration* items = (CSSDeclaration*)realloc(list->items, capacity * sizeof(CSSDeclaration));
+        if (!items) {
+            return -1;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    CSSDeclaration* declaration = &list->items[list->count++];
+    declaration->property = property;
+    declaration->value = *value;
+    declaration->important = important;
+    return 0;
+}
+
+static int split_value(const char* start, const char* end, ValueToken* tokens) {
+    int count = 0;
+    const char* p = start;
+    for (;;) {
+        p = skip_space(p, end);
+        if (p >= end) {
+            return count;
+        }
+        if (count == MAX_VALUE_TOKENS) {
+            return -1;
+        }
+        const char* token_end = p;
+        int depth = 0;
+        while (token_end < end && (depth > 0 || !isspace((unsigned char)*token_end))) {
+            if (*token_end == '"' || *token_end == '\'') {
+                token_end = skip_string(token_end, end);
+                continue;
+            }
+            if (*token_end == '(') {
+                depth++;
+            } else if (*token_end == ')' && depth > 0) {
+                depth--;
+            }
+            token_end++;
+        }
+        tokens[count].start = p;
+        tokens[count].length = (size_t)(token_end - p);
+        count++;
+        p = token_end;
+    }
+}
+
+// border, border-top, ...: width, style and color in any order. The
+// computed style has one border color, so a side shorthand only sets it
+// when a color is given.
+static int expand_border(const ValueToken* tokens, int count, int side, int important, DeclarationList* list) {
+    CSSValue width, style, color;
+    int have_width = 0, have_style = 0, have_color = 0;
+    set_length_px(&width, 3.0f);
+    memset(&style, 0, sizeof(style));
+    style.type = CSS_VALUE_KEYWORD;
+    style.keyword = CSS_BORDER_STYLE_NONE;
+    memset(&color, 0, sizeof(color));
+    color.type = CSS_VALUE_CURRENT_COLOR;
+
+    if (count < 1 || count > 3) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!have_width && parse_border_width(&tokens[i], &width) == 0) {
+            have_width = 1;
+        } else if (!have_style && parse_border_style(&tokens[i], &style) == 0) {
+            have_style = 1;
+        } else if (!have_color && parse_color(&tokens[i], &color) == 0) {
+            have_color = 1;
+        } else {
+            return -1;
+        }
+    }
+
+    for (int s = 0; s < 4; s++) {
+        if (side >= 0 && s != side) {
+            continue;
+        }
+        if (declaration_push(list, (CSSProperty)(CSS_PROP_BORDER_TOP_WIDTH + s), &width, important) != 0 ||
+            declaration_push(list, (CSSProperty)(CSS_PROP_BORDER_TOP_STYLE + s), &style, important) != 0) {
+            return -1;
+        }
+    }
+    if (side < 0 || have_color) {
+        return declaration_push(list, CSS_PROP_BORDER_COLOR, &color, important);
+    }
+    return 0;
+}
+
+static int push_global(DeclarationList* list, CSSProperty first, int span, const CSSValue* value, int important) {
+    for (int i = 0; i < span; i++) {
+        if (declaration_push(list, (CSSProperty)(first + i), value, important) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Parse one "name: value" pair into longhand declarations. Returns -1 only
+// on allocation failure; invalid declarations are silently dropped.
+static int parse_declaration(const char* name, size_t name_length, const char* start, const char* end,
+                             int important, DeclarationList* list) {
+    ValueToken property = { name, name_length };
+    ValueToken tokens[MAX_VALUE_TOKENS];
+    int count = split_value(start, end, tokens);
+    if (count <= 0) {
+        return 0;
+    }
+
+    // inherit, initial and unset apply to every longhand of a shorthand
+    CSSValue global;
+    memset(&global, 0, sizeof(global));
+    if (count == 1) {
+        if (token_is(&tokens[0], "inherit")) {
+            global.type = CSS_VALUE_INHERIT;
+        } else if (token_is(&tokens[0], "initial")) {
+            global.type = CSS_VALUE_INITIAL;
+        } else if (token_is(&tokens[0], "unset")) {
+            global.type = CSS_VALUE_UNSET;
+        }
+    }
+    int is_global = count == 1 && (global.type == CSS_VALUE_INHERIT || global.type == CSS_VALUE_INITIAL ||
+                                   global.type == CSS_VALUE_UNSET);
+
+    for (size_t i = 0; i < sizeof(longhands) / sizeof(longhands[0]); i++) {
+        if (!token_is(&property, longhands[i].name)) {
+            continue;
+        }
+        CSSValue value;
+        if (is_global) {
+            return declaration_push(list, longhands[i].property, &global, important);
+        }
+        if (count != 1 || longhands[i].parse(&tokens[0], &value) != 0) {
+            return 0;
+        }
+        return declaration_push(list, longhands[i].property, &value, important);
+    }
+
+    for (size_t i = 0; i < sizeof(box_shorthands) / sizeof(box_shorthands[0]); i++) {
+        if (!token_is(&property, box_shorthands[i].name)) {
+            continue;
+        }
+        if (is_global) {
+            return push_global(list, box_shorthands[i].first, 4, &global, important);
+        }
+        if (count > 4) {
+            return 0;
+        }
+        CSSValue values[4];
+        for (int v = 0; v < count; v++) {
+            if (box_shorthands[i].parse(&tokens[v], &values[v]) != 0) {
+                return 0;
+            }
+        }
+        static const int sources[4][4] = {
+            { 0, 0, 0, 0 }, { 0, 1, 0, 1 }, { 0, 1, 2, 1 }, { 0, 1, 2, 3 }
+        };
+        for (int side = 0; side < 4; side++) {
+            const CSSValue* value = &values[sources[count - 1][side]];
+            if (declaration_push(list, (CSSProperty)(box_shorthands[i].first + side), value, important) != 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    if (token_is(&property, "border")) {
+        if (is_global) {
+            return push_global(list, CSS_PROP_BORDER_TOP_WIDTH, CSS_PROP_BORDER_COLOR - CSS_PROP_BORDER_TOP_WIDTH + 1,
+                               &global, important);
+        }
+        size_t mark = list->count;
+        if (expand_border(tokens, count, -1, important, list) != 0) {
+            list->count = mark;
+        }
+        return 0;
+    }
+    for (int side = 0; side < 4; side++) {
+        if (!token_is(&property, border_sides[side])) {
+            continue;
+        }
+        if (is_global) {
+            return declaration_push(list, (CSSProperty)(CSS_PROP_BORDER_TOP_WIDTH + side), &global, important) == 0 &&
+                   declaration_push(list, (CSSProperty)(CSS_PROP_BORDER_TOP_STYLE + side), &global, important) == 0 ? 0 : -1;
+        }
+        size_t mark = list->count;
+        if (expand_border(tokens, count, side, important, list) != 0) {
+            list->count = mark;
+        }
+        return 0;
+    }
+
+    // One color for all sides; extra per-side colors are ignored
+    if (token_is(&property, "border-color")) {
+        CSSValue value;
+        if (is_global) {
+            return declaration_push(list, CSS_PROP_BORDER_COLOR, &global, important);
+        }
+        if (count > 4 || parse_color(&tokens[0], &value) != 0) {
+            return 0;
+        }
+        return declaration_push(list, CSS_PROP_BORDER_COLOR, &value, important);
+    }
+
+    // Only the color part of a background is used
+    if (token_is(&property, "background")) {
+        CSSValue value;
+        if (is_global) {
+            return declaration_push(list, CSS_PROP_BACKGROUND_COLOR, &global, important);
+        }
+        memset(&value, 0, sizeof(value));
+        value.type = CSS_VALUE_COLOR;
+        for (int i = 0; i < count; i++) {
+            CSSValue color;
+            if (parse_color(&tokens[i], &color) == 0) {
+                value = color;
+                break;
+            }
+        }
+        return declaration_push(list, CSS_PROP_BACKGROUND_COLOR, &value, important);
+    }
+
+    return 0;
+}
+
+CSSDeclaration* css_parse_declarations(const char* text, size_t length, size_t* count) {
+    DeclarationList list;
+    memset(&list, 0, sizeof(list));
+    if (count) {
+        *count = 0;
+    }
+    if (!text) {
+        return NULL;
+    }
+
+    const char* p = text;
+    const char* end = text + length;
+    while (p < end) {
+        const char* stop = scan_until(p, end, ';', ';');
+        const char* name_start = skip_space(p, stop);
+        const char* colon = scan_until(name_start, stop, ':', ':');
+        const char* name_end = trim_end(name_start, colon);
+        const char* value_end = trim_end(colon, stop);
+
+        if (colon < stop && name_end > name_start) {
+            const char* value_start = colon + 1;
+
+            // A trailing !important raises the declaration's priority
+            int important = 0;
+            const char* bang = value_end;
+            while (bang > value_start && bang[-1] != '!') {
+                bang--;
+            }
+            if (bang > value_start) {
+                const char* word = skip_space(bang, value_end);
+                if ((size_t)(value_end - word) == 9 && strncasecmp(word, "important", 9) == 0) {
+                    important = 1;
+                    value_end = trim_end(value_start, bang - 1);
+                }
+            }
+
+            if (parse_declaration(name_start, (size_t)(name_end - name_start), value_start, value_end,
+                                  important, &list) != 0) {
+                free(list.items);
+                return NULL;
+            }
+        }
+        p = stop < end ? stop + 1 : end;
+    }
+
+    if (list.count == 0) {
+        free(list.items);
+        return NULL;
+    }
+    if (count) {
+        *count = list.count;
+    }
+    return list.items;
+}
+
+int css_property_inherited(CSSProperty property) {
+    switch (property) {
+        case CSS_PROP_COLOR:
+        case CSS_PROP_FONT_SIZE:
+        case CSS_PROP_FONT_WEIGHT:
+        case CSS_PROP_FONT_STYLE:
+        case CSS_PROP_LINE_HEIGHT:
+        case CSS_PROP_TEXT_ALIGN:
+        case CSS_PROP_WHITE_SPACE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int sheet_push(CSSStylesheet* sheet, const CSSRule* rule) {
+    if (sheet->count == sheet->capacity) {
+        size_t capacity = sheet->capacity ? sheet->capacity * 2 : 16;
+        CSSRule* rules = (CSSRule*)realloc(sheet->rules, capacity * sizeof(CSSRule));
+        if (!rules) {
+            return -1;
+        }
+        sheet->rules = rules;
+        sheet->capacity = capacity;
+    }
+    sheet->rules[sheet->count++] = *rule;
+    return 0;
+}
+
+CSSStylesheet* css_stylesheet_parse(const char* text, size_t length) {
+    if (!text) {
+        return NULL;
+    }
+
+    CSSStylesheet* sheet = (CSSStylesheet*)calloc(1, sizeof(CSSStylesheet));
+    if (!sheet) {
+        return NULL;
+    }
+
+    const char* p = text;
+    const char* end = text + length;
+    for (;;) {
+        p = skip_space(p, end);
+        // HTML comment markers are allowed around <style> contents
+        if (end - p >= 4 && memcmp(p, "<!--", 4) == 0) {
+            p += 4;
+            continue;
+        }
+        if (end - p >= 3 && memcmp(p, "-->", 3) == 0) {
+            p += 3;
+            continue;
+        }
+        if (p >= end) {
+            break;
+        }
+
+        // At-rules (@media, @font-face, @import, ...) are not supported
+        if (*p == '@') {
+            const char* stop = scan_until(p, end, ';', '{');
+            if (stop < end && *stop == '{') {
+                stop = scan_until(stop + 1, end, '}', '}');
+            }
+            p = stop < end ? stop + 1 : end;
+            continue;
+        }
+
+        const char* open = scan_until(p, end, '{', '{');
+        if (open >= end) {
+            break;
+        }
+        const char* close = scan_until(open + 1, end, '}', '}');
+
+        CSSRule rule;
+        memset(&rule, 0, sizeof(rule));
+        if (parse_selector_list(p, trim_end(p, open), &rule) == 0) {
+            rule.declarations = css_parse_declarations(open + 1, (size_t)(close - open - 1), &rule.declaration_count);
+        }
+        if (rule.declaration_count == 0 || sheet_push(sheet, &rule) != 0) {
+            rule_free(&rule);
+        }
+        p = close < end ? close + 1 : end;
+    }
+
+    return sheet;
+}
+
+void css_stylesheet_destroy(CSSStylesheet* sheet) {
+    if (!sheet) {
+        return;
+    }
+
+    for (size_t i = 0; i < sheet->count; i++) {
+        rule_free(&sheet->rules[i]);
+    }
+    free(sheet->rules);
+    free(sheet);
+}
+
+size_t css_stylesheet_get_rule_count(const CSSStylesheet* sheet) {
+    return sheet ? sheet->count : 0;
+}
@@ -1,6 +1,9 @@
 #include "dom/dom.h"
+#include "html/parser.h"
+#include "html/tape.h"
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 // Event listener structure
 typedef struct EventListener {
@@ -25,23 +28,212 @@ struct DOMNode {
     struct {
         char** attr_names;
         char** attr_values;
+        size_t* attr_name_lengths;  // Names may hold NULs set from script
+        size_t* attr_lengths;       // Value lengths
+        void** attr_scripts;        // Cached script strings for the values
         int attr_count;
         int attr_capacity;
     } attributes;
+
+    // Length of value, and its cached script string (text nodes)
+    size_t value_length;
+    void* script_value;
+
+    // Paint output recorded for this node's subtree, e.g. a display list
+    void* paint_cache;
+
+    // Computed style, owned through the document's style release hook
+    void* style_cache;
+    unsigned int style_dirty;       // DOM_STYLE_DIRTY_* marks
+
+    // Layout results, owned through the document's layout release hook
+    void* layout_cache;
+    int layout_dirty;               // The node or something below it changed
     
     // Event listeners
     EventListener* event_listeners;
+
+    // Weak back-reference to the script wrapper, if one is alive
+    void* binding;
+
+    // Lazy materialization: children still live only on the document's tape
+    DOMDocument* owner_document;
+    uint32_t tape_index;
+    int children_pending;
 };
 
 struct DOMElement {
     DOMNode node;
 };
 
+// Nodes are carved out of per-document chunks and recycled through a free
+// list, so building a subtree costs no malloc per node
+#define DOM_NODE_CHUNK_SIZE 256
+
+typedef struct DOMNodeChunk {
+    struct DOMNodeChunk* next;
+    DOMNode nodes[DOM_NODE_CHUNK_SIZE];
+} DOMNodeChunk;
+
 struct DOMDocument {
     DOMNode node;
     DOMElement* document_element;
+    HTMLTape* tape;
+
+    // Parentless nodes, chained through their sibling links
+    DOMNode* detached;
+
+    // Bumped by every mutation; live collections compare against it
+    uint64_t version;
+
+    // Releases cached script strings; NULL while no script engine is bound
+    DOMScriptCacheRelease script_release;
+    void* script_release_data;
+
+    // Releases cached paint output; NULL while no painter is attached
+    DOMPaintCacheRelease paint_release;
+    void* paint_release_data;
+
+    // Releases stored computed styles; NULL while no style engine is attached
+    DOMStyleCacheRelease style_release;
+    void* style_release_data;
+
+    // Releases stored layout results; NULL while no layout engine is attached
+    DOMLayoutCacheRelease layout_release;
+    void* layout_release_data;
+
+    // Told about every mutation; NULL while nothing observes the document
+    DOMMutationCallback observer;
+    void* observer_data;
+
+    // Node allocator
+    DOMNodeChunk* chunks;
+    size_t chunk_used;          // Slots handed out from the newest chunk
+    DOMNode* free_nodes;        // Recycled slots, chained through next_sibling
 };
 
+struct DOMCollection {
+    DOMNode* root;
+    DOMCollectionKind kind;
+    char* name;                 // Tag name or class list to match
+    uint64_t version;           // Document version the cache was built at
+    DOMNode** items;            // Matches found so far, in tree order
+    size_t count;
+    size_t capacity;
+    int complete;               // All matches found; count is the length
+};
+
+static char* copy_range(const char* str, size_t len);
+static int node_set_attribute(DOMNode* node, const char* name, size_t name_len,
+                              const char* value, size_t value_len);
+static int node_materialize_children(DOMNode* node);
+static int node_insert_before(DOMNode* parent, DOMNode* child, DOMNode* reference);
+
+static DOMDocument* node_document(DOMNode* node) {
+    return node->type == NODE_DOCUMENT ? (DOMDocument*)node : node->owner_document;
+}
+
+// Drop a cached script string, handing it back to the script engine
+static void script_value_drop(DOMDocument* doc, void** slot) {
+    if (*slot) {
+        if (doc && doc->script_release) {
+            doc->script_release(*slot, doc->script_release_data);
+        }
+        *slot = NULL;
+    }
+}
+
+static DOMNode* node_alloc(DOMDocument* doc) {
+    DOMNode* node = doc->free_nodes;
+    if (node) {
+        doc->free_nodes = node->next_sibling;
+    } else {
+        if (!doc->chunks || doc->chunk_used == DOM_NODE_CHUNK_SIZE) {
+            DOMNodeChunk* chunk = (DOMNodeChunk*)malloc(sizeof(DOMNodeChunk));
+            if (!chunk) {
+                return NULL;
+            }
+            chunk->next = doc->chunks;
+            doc->chunks = chunk;
+            doc->chunk_used = 0;
+        }
+        node = &doc->chunks->nodes[doc->chunk_used++];
+    }
+
+    memset(node, 0, sizeof(DOMNode));
+    node->owner_document = doc;
+    return node;
+}
+
+static void node_free(DOMNode* node) {
+    DOMDocument* doc = node->owner_document;
+    node->next_sibling = doc->free_nodes;
+    doc->free_nodes = node;
+}
+
+// Drop cached paint output, handing it back to the painter
+static void paint_cache_drop(DOMDocument* doc, DOMNode* node) {
+    if (node->paint_cache) {
+        if (doc && doc->paint_release) {
+            doc->paint_release(node->paint_cache, doc->paint_release_data);
+        }
+        node->paint_cache = NULL;
+    }
+}
+
+// Drop a stored computed style, handing it back to the style engine
+static void style_cache_drop(DOMDocument* doc, DOMNode* node) {
+    if (node->style_cache) {
+        if (doc && doc->style_release) {
+            doc->style_release(node->style_cache, doc->style_release_data);
+        }
+        node->style_cache = NULL;
+    }
+}
+
+static void notify_child_list(DOMNode* target, DOMNode* added, DOMNode* removed) {
+    DOMDocument* doc = node_document(target);
+    if (doc && doc->observer) {
+        DOMMutation mutation;
+        memset(&mutation, 0, sizeof(mutation));
+        mutation.type = DOM_MUTATION_CHILD_LIST;
+        mutation.target = target;
+        mutation.added = added;
+        mutation.removed = removed;
+        doc->observer(&mutation, doc->observer_data);
+    }
+}
+
+// Drop stored layout results, handing them back to the layout engine
+static void layout_cache_drop(DOMDocument* doc, DOMNode* node) {
+    if (node->layout_cache) {
+        if (doc && doc->layout_release) {
+            doc->layout_release(node->layout_cache, doc->layout_release_data);
+        }
+        node->layout_cache = NULL;
+    }
+}
+
+static void node_mutated(DOMNode* node) {
+    DOMDocument* doc = node_document(node);
+    if (!doc) {
+        return;
+    }
+    doc->version++;
+    dom_node_mark_layout_dirty(node);
+
+    // Caches can only exist while a painter is attached
+    if (!doc->paint_release) {
+        return;
+    }
+
+    // Paint cached for this node or any subtree containing it is stale;
+    // caches on unrelated subtrees stay valid for replay
+    for (DOMNode* ancestor = node; ancestor; ancestor = ancestor->parent) {
+        paint_cache_drop(doc, ancestor);
+    }
+}
+
 DOMDocument* dom_document_create(void) {
     DOMDocument* doc = (DOMDocument*)calloc(1, sizeof(DOMDocument));
     if (!doc) {
@@ -76,9 +268,17 @@ static void dom_node_destroy_recursive(DOMNode* node) {
     for (int i = 0; i < node->attributes.attr_count; i++) {
         free(node->attributes.attr_names[i]);
         free(node->attributes.attr_values[i]);
+        script_value_drop(node->owner_document, &node->attributes.attr_scripts[i]);
     }
     free(node->attributes.attr_names);
     free(node->attributes.attr_values);
+    free(node->attributes.attr_name_lengths);
+    free(node->attributes.attr_lengths);
+    free(node->attributes.attr_scripts);
+    script_value_drop(node->owner_document, &node->script_value);
+    paint_cache_drop(node->owner_document, node);
+    style_cache_drop(node->owner_document, node);
+    layout_cache_drop(node->owner_document, node);
 
     // Free event listeners
     EventListener* listener = node->event_listeners;
@@ -92,7 +292,80 @@ static void dom_node_destroy_recursive(DOMNode* node) {
     // Free node data
     free(node->name);
     free(node->value);
-    free(node);
+    node_free(node);
+}
+
+// Detached roots (nodes without a parent) are kept on the owning document
+// so they are reclaimed when the document or their last binding goes away
+static void detached_push(DOMNode* node) {
+    DOMDocument* doc = node->owner_document;
+    if (!doc) {
+        return;
+    }
+
+    node->prev_sibling = NULL;
+    node->next_sibling = doc->detached;
+    if (doc->detached) {
+        doc->detached->prev_sibling = node;
+    }
+    doc->detached = node;
+}
+
+// Unlink a node from its parent's child list or from the detached list
+static void node_unlink(DOMNode* node) {
+    DOMNode* parent = node->parent;
+
+    if (parent) {
+        if (node->prev_sibling) {
+            node->prev_sibling->next_sibling = node->next_sibling;
+        } else {
+            parent->first_child = node->next_sibling;
+        }
+        if (node->next_sibling) {
+            node->next_sibling->prev_sibling = node->prev_sibling;
+        } else {
+            parent->last_child = node->prev_sibling;
+        }
+        if (parent->type == NODE_DOCUMENT && ((DOMDocument*)parent)->document_element == (DOMElement*)node) {
+            ((DOMDocument*)parent)->document_element = NULL;
+        }
+    } else {
+        if (node->prev_sibling) {
+            node->prev_sibling->next_sibling = node->next_sibling;
+        } else if (node->owner_document && node->owner_document->detached == node) {
+            node->owner_document->detached = node->next_sibling;
+        }
+        if (node->next_sibling) {
+            node->next_sibling->prev_sibling = node->prev_sibling;
+        }
+    }
+
+    node->parent = NULL;
+    node->prev_sibling = NULL;
+    node->next_sibling = NULL;
+}
+
+static int subtree_has_binding(DOMNode* node) {
+    if (node->binding) {
+        return 1;
+    }
+    for (DOMNode* child = node->first_child; child; child = child->next_sibling) {
+        if (subtree_has_binding(child)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Drop a subtree the tree no longer references. Subtrees that a binding
+// still points into stay alive as detached roots.
+static void node_discard(DOMNode* node) {
+    node_unlink(node);
+    if (subtree_has_binding(node)) {
+        detached_push(node);
+    } else {
+        dom_node_destroy_recursive(node);
+    }
 }
 
 void dom_document_destroy(DOMDocument* doc) {
@@ -100,43 +373,49 @@ void dom_document_destroy(DOMDocument* doc) {
         return;
     }
 
-    dom_node_destroy_recursive(doc->node.first_child);
+    DOMNode* child = doc->node.first_child;
+    while (child) {
+        DOMNode* next = child->next_sibling;
+        dom_node_destroy_recursive(child);
+        child = next;
+    }
+    while (doc->detached) {
+        DOMNode* next = doc->detached->next_sibling;
+        dom_node_destroy_recursive(doc->detached);
+        doc->detached = next;
+    }
+    paint_cache_drop(doc, &doc->node);
+    style_cache_drop(doc, &doc->node);
+    layout_cache_drop(doc, &doc->node);
+    html_tape_destroy(doc->tape);
+    while (doc->chunks) {
+        DOMNodeChunk* next = doc->chunks->next;
+        free(doc->chunks);
+        doc->chunks = next;
+    }
     free(doc->node.name);
     free(doc);
 }
 
-DOMElement* dom_document_create_element(DOMDocument* doc, const char* tag_name) {
-    if (!doc || !tag_name) {
-        return NULL;
-    }
-
-    DOMElement* element = (DOMElement*)calloc(1, sizeof(DOMElement));
+static DOMElement* element_create(DOMDocument* doc, const char* tag_name, size_t tag_len) {
+    DOMElement* element = (DOMElement*)node_alloc(doc);
     if (!element) {
         return NULL;
     }
 
     element->node.type = NODE_ELEMENT;
-    element->node.name = strdup(tag_name);
+    element->node.name = (char*)malloc(tag_len + 1);
     if (!element->node.name) {
-        free(element);
-        return NULL;
-    }
-    
-    // Initialize attributes
-    element->node.attributes.attr_capacity = 8;
-    element->node.attributes.attr_names = (char**)calloc(8, sizeof(char*));
-    element->node.attributes.attr_values = (char**)calloc(8, sizeof(char*));
-    
-    if (!element->node.attributes.attr_names || !element->node.attributes.attr_values) {
-        free(element->node.attributes.attr_names);
-        free(element->node.attributes.attr_values);
-        free(element->node.name);
-        free(element);
+        node_free(&element->node);
         return NULL;
     }
+    memcpy(element->node.name, tag_name, tag_len);
+    element->node.name[tag_len] = '\0';
     
-    // Initialize event listeners
+    // No attributes or event listeners yet; the attribute arrays are
+    // allocated by the first attribute set
     element->node.event_listeners = NULL;
+    element->node.owner_document = doc;
 
     // Set as document element if this is the first element
     if (!doc->document_element) {
@@ -144,11 +423,29 @@ DOMElement* dom_document_create_element(DOMDocument* doc, const char* tag_name)
         element->node.parent = &doc->node;
         doc->node.first_child = &element->node;
         doc->node.last_child = &element->node;
+    } else {
+        detached_push(&element->node);
     }
 
     return element;
 }
 
+DOMElement* dom_document_create_element(DOMDocument* doc, const char* tag_name) {
+    if (!tag_name) {
+        return NULL;
+    }
+
+    return dom_document_create_element_len(doc, tag_name, strlen(tag_name));
+}
+
+DOMElement* dom_document_create_element_len(DOMDocument* doc, const char* tag_name, size_t tag_len) {
+    if (!doc || !tag_name) {
+        return NULL;
+    }
+
+    return element_create(doc, tag_name, tag_len);
+}
+
 DOMElement* dom_document_get_element(DOMDocument* doc) {
     if (!doc) {
         return NULL;
@@ -156,209 +453,844 @@ DOMElement* dom_document_get_element(DOMDocument* doc) {
     return doc->document_element;
 }
 
-// Helper function to search for element by ID recursively
-static DOMElement* search_element_by_id(DOMNode* node, const char* id) {
-    if (!node) {
+static DOMNode* text_node_create(DOMDocument* doc, const char* text, size_t len) {
+    DOMNode* text_node = node_alloc(doc);
+    if (!text_node) {
         return NULL;
     }
 
-    // Check if this is an element with matching ID
-    if (node->type == NODE_ELEMENT) {
-        DOMElement* elem = (DOMElement*)node;
-        const char* elem_id = dom_element_get_attribute(elem, "id");
-        if (elem_id && strcmp(elem_id, id) == 0) {
-            return elem;
-        }
+    text_node->type = NODE_TEXT;
+    text_node->owner_document = doc;
+    text_node->value = copy_range(text, len);
+    if (!text_node->value) {
+        node_free(text_node);
+        return NULL;
     }
+    text_node->value_length = len;
+    detached_push(text_node);
+    return text_node;
+}
 
-    // Search children
-    DOMNode* child = node->first_child;
-    while (child) {
-        DOMElement* found = search_element_by_id(child, id);
-        if (found) {
-            return found;
-        }
-        child = child->next_sibling;
+DOMNode* dom_document_create_text_node(DOMDocument* doc, const char* text) {
+    if (!text) {
+        return NULL;
     }
 
-    return NULL;
+    return dom_document_create_text_node_len(doc, text, strlen(text));
 }
 
-DOMElement* dom_document_get_element_by_id(DOMDocument* doc, const char* id) {
-    if (!doc || !id) {
+DOMNode* dom_document_create_text_node_len(DOMDocument* doc, const char* text, size_t len) {
+    if (!doc || !text) {
         return NULL;
     }
 
-    // Start searching from document element
-    return search_element_by_id(&doc->node, id);
+    return text_node_create(doc, text, len);
 }
 
-int dom_node_append_child(DOMNode* parent, DOMNode* child) {
-    if (!parent || !child) {
-        return -1;
+DOMNode* dom_document_create_fragment(DOMDocument* doc) {
+    if (!doc) {
+        return NULL;
     }
 
-    child->parent = parent;
-    child->next_sibling = NULL;
-
-    if (!parent->first_child) {
-        parent->first_child = child;
-        parent->last_child = child;
-        child->prev_sibling = NULL;
-    } else {
-        child->prev_sibling = parent->last_child;
-        parent->last_child->next_sibling = child;
-        parent->last_child = child;
+    DOMNode* fragment = node_alloc(doc);
+    if (!fragment) {
+        return NULL;
     }
 
-    return 0;
-}
-
-DOMNodeType dom_node_get_type(DOMNode* node) {
-    if (!node) {
-        return NODE_DOCUMENT; // Default
-    }
-    return node->type;
+    fragment->type = NODE_DOCUMENT_FRAGMENT;
+    detached_push(fragment);
+    return fragment;
 }
 
-int dom_element_set_attribute(DOMElement* element, const char* name, const char* value) {
-    if (!element || !name || !value) {
-        return -1;
-    }
+// Lazy materialization
+// A node with children_pending set has a subtree that exists only as a
+// range of tape entries. Touching its children materializes one level.
 
-    DOMNode* node = &element->node;
+static DOMNode* node_from_tape(DOMDocument* doc, uint32_t index) {
+    const HTMLTape* tape = doc->tape;
+    const HTMLTapeEntry* entry = &tape->entries[index];
 
-    // Check if attribute already exists
-    for (int i = 0; i < node->attributes.attr_count; i++) {
-        if (strcmp(node->attributes.attr_names[i], name) == 0) {
-            char* new_value = strdup(value);
-            if (!new_value) {
-                return -1;
-            }
-            free(node->attributes.attr_values[i]);
-            node->attributes.attr_values[i] = new_value;
-            return 0;
+    if (entry->kind == HTML_TAPE_TEXT) {
+        DOMNode* text_node = text_node_create(doc, tape->source + entry->offset, entry->length);
+        if (text_node) {
+            text_node->tape_index = index;
         }
+        return text_node;
     }
 
-    // Add new attribute
-    if (node->attributes.attr_count >= node->attributes.attr_capacity) {
-        // Grow arrays
-        int new_capacity = node->attributes.attr_capacity * 2;
-        char** new_names = (char**)realloc(node->attributes.attr_names, new_capacity * sizeof(char*));
-        char** new_values = (char**)realloc(node->attributes.attr_values, new_capacity * sizeof(char*));
-        if (!new_names || !new_values) {
-            return -1;
-        }
-        node->attributes.attr_names = new_names;
-        node->attributes.attr_values = new_values;
-        node->attributes.attr_capacity = new_capacity;
+    DOMElement* element = element_create(doc, tape->source + entry->offset, entry->length);
+    if (!element) {
+        return NULL;
     }
 
-    node->attributes.attr_names[node->attributes.attr_count] = strdup(name);
-    node->attributes.attr_values[node->attributes.attr_count] = strdup(value);
-    
-    if (!node->attributes.attr_names[node->attributes.attr_count] || 
-        !node->attributes.attr_values[node->attributes.attr_count]) {
-        free(node->attributes.attr_names[node->attributes.attr_count]);
-        free(node->attributes.attr_values[node->attributes.attr_count]);
-        return -1;
+    for (uint32_t i = 0; i < entry->attr_count; i++) {
+        const HTMLTapeAttribute* attr = &tape->attrs[entry->attr_first + i];
+        if (node_set_attribute(&element->node,
+                               tape->source + attr->name_offset, attr->name_length,
+                               tape->source + attr->value_offset, attr->value_length) != 0) {
+            node_unlink(&element->node);
+            dom_node_destroy_recursive(&element->node);
+            return NULL;
+        }
     }
-    
-    node->attributes.attr_count++;
 
-    return 0;
+    element->node.tape_index = index;
+    element->node.children_pending = entry->end > index + 1;
+    return &element->node;
 }
 
-const char* dom_element_get_attribute(DOMElement* element, const char* name) {
-    if (!element || !name) {
-        return NULL;
+static int node_materialize_children(DOMNode* node) {
+    if (!node->children_pending) {
+        return 0;
     }
+    node->children_pending = 0;
 
-    DOMNode* node = &element->node;
+    DOMDocument* doc = node->owner_document;
+    const HTMLTape* tape = doc->tape;
+    uint32_t end = tape->entries[node->tape_index].end;
 
-    for (int i = 0; i < node->attributes.attr_count; i++) {
-        if (strcmp(node->attributes.attr_names[i], name) == 0) {
-            return node->attributes.attr_values[i];
+    for (uint32_t i = node->tape_index + 1; i < end; i = tape->entries[i].end) {
+        DOMNode* child = node_from_tape(doc, i);
+        if (!child) {
+            return -1;
         }
+        node_insert_before(node, child, NULL);
     }
 
-    return NULL;
+    return 0;
 }
 
-const char* dom_element_get_tag_name(DOMElement* element) {
-    if (!element) {
-        return NULL;
+// Materialize the chain of ancestors from a pending node down to a tape entry
+static DOMNode* node_materialize_path(DOMNode* node, uint32_t target) {
+    const HTMLTape* tape = node->owner_document->tape;
+
+    while (node && node->tape_index != target) {
+        if (node_materialize_children(node) != 0) {
+            return NULL;
+        }
+
+        DOMNode* child = node->first_child;
+        while (child && !(child->tape_index <= target && target < tape->entries[child->tape_index].end)) {
+            child = child->next_sibling;
+        }
+        node = child;
     }
-    return element->node.name;
+
+    return node;
 }
 
-int dom_element_set_inner_html(DOMElement* element, const char* html) {
-    if (!element || !html) {
+int dom_node_materialize(DOMNode* node) {
+    if (!node) {
         return -1;
     }
-
-    // Destroy existing children
-    DOMNode* child = element->node.first_child;
-    while (child) {
-        DOMNode* next = child->next_sibling;
-        dom_node_destroy_recursive(child);
-        child = next;
+    if (!node_document(node)->tape) {
+        return 0;
     }
-    element->node.first_child = NULL;
-    element->node.last_child = NULL;
 
-    // For basic implementation, just store as a text node
-    // A real implementation would parse the HTML
-    DOMNode* text_node = (DOMNode*)calloc(1, sizeof(DOMNode));
-    if (!text_node) {
+    if (node_materialize_children(node) != 0) {
         return -1;
     }
-
-    text_node->type = NODE_TEXT;
-    text_node->value = strdup(html);
-    if (!text_node->value) {
-        free(text_node);
-        return -1;
+    for (DOMNode* child = node->first_child; child; child = child->next_sibling) {
+        if (dom_node_materialize(child) != 0) {
+            return -1;
+        }
     }
-    
-    return dom_node_append_child(&element->node, text_node);
+    return 0;
 }
 
-int dom_element_add_event_listener(DOMElement* element, const char* event_type,
-                                    DOMEventCallback callback, void* user_data) {
-    if (!element || !event_type || !callback) {
+int dom_document_attach_tape(DOMDocument* doc, HTMLTape* tape) {
+    if (!doc || !tape || doc->tape || doc->document_element) {
         return -1;
     }
 
-    EventListener* listener = (EventListener*)malloc(sizeof(EventListener));
-    if (!listener) {
-        return -1;
+    doc->tape = tape;
+    if (tape->entry_count == 0) {
+        return 0;
     }
 
-    listener->event_type = strdup(event_type);
-    if (!listener->event_type) {
-        free(listener);
+    // The root element registers itself as the document element
+    if (!node_from_tape(doc, 0)) {
+        doc->tape = NULL;
         return -1;
     }
 
-    listener->callback = callback;
-    listener->user_data = user_data;
-    listener->next = element->node.event_listeners;
-    element->node.event_listeners = listener;
-
     return 0;
 }
 
-int dom_element_trigger_event(DOMElement* element, const char* event_type) {
-    if (!element || !event_type) {
-        return -1;
+// Helper function to search for element by ID recursively
+static DOMElement* search_element_by_id(DOMNode* node, const char* id, size_t id_len) {
+    if (!node) {
+        return NULL;
     }
 
-    EventListener* listener = element->node.event_listeners;
-    while (listener) {
-        if (strcmp(listener->event_type, event_type) == 0) {
-            listener->callback(element, listener->user_data);
+    // Check if this is an element with matching ID
+    if (node->type == NODE_ELEMENT) {
+        DOMElement* elem = (DOMElement*)node;
+        size_t elem_id_len;
+        const char* elem_id = dom_element_get_attribute_len(elem, "id", 2, &elem_id_len);
+        if (elem_id && elem_id_len == id_len && memcmp(elem_id, id, id_len) == 0) {
+            return elem;
+        }
+    }
+
+    // Unmaterialized subtree: search the tape, then build only the path
+    if (node->children_pending) {
+        const HTMLTape* tape = node->owner_document->tape;
+        uint32_t found = html_tape_find_attribute_len(tape, node->tape_index + 1,
+                                                      tape->entries[node->tape_index].end,
+                                                      "id", 2, id, id_len);
+        if (found == HTML_TAPE_NONE) {
+            return NULL;
+        }
+        return (DOMElement*)node_materialize_path(node, found);
+    }
+
+    // Search children
+    DOMNode* child = node->first_child;
+    while (child) {
+        DOMElement* found = search_element_by_id(child, id, id_len);
+        if (found) {
+            return found;
+        }
+        child = child->next_sibling;
+    }
+
+    return NULL;
+}
+
+DOMElement* dom_document_get_element_by_id(DOMDocument* doc, const char* id) {
+    if (!id) {
+        return NULL;
+    }
+
+    return dom_document_get_element_by_id_len(doc, id, strlen(id));
+}
+
+DOMElement* dom_document_get_element_by_id_len(DOMDocument* doc, const char* id, size_t id_len) {
+    if (!doc || !id) {
+        return NULL;
+    }
+
+    // Start searching from document element
+    return search_element_by_id(&doc->node, id, id_len);
+}
+
+// Move all children of a fragment in front of reference (NULL appends).
+// The chain is relinked as a whole; only the parent pointers are touched
+// per node.
+static void node_splice_fragment(DOMNode* parent, DOMNode* fragment, DOMNode* reference) {
+    DOMNode* first = fragment->first_child;
+    DOMNode* last = fragment->last_child;
+    if (!first) {
+        return;
+    }
+
+    DOMElement* first_element = NULL;
+    for (DOMNode* node = first; node; node = node->next_sibling) {
+        node->parent = parent;
+        if (!first_element && node->type == NODE_ELEMENT) {
+            first_element = (DOMElement*)node;
+        }
+    }
+
+    DOMNode* prev = reference ? reference->prev_sibling : parent->last_child;
+    first->prev_sibling = prev;
+    last->next_sibling = reference;
+    if (prev) {
+        prev->next_sibling = first;
+    } else {
+        parent->first_child = first;
+    }
+    if (reference) {
+        reference->prev_sibling = last;
+    } else {
+        parent->last_child = last;
+    }
+
+    fragment->first_child = NULL;
+    fragment->last_child = NULL;
+
+    if (parent->type == NODE_DOCUMENT && first_element && !((DOMDocument*)parent)->document_element) {
+        ((DOMDocument*)parent)->document_element = first_element;
+    }
+}
+
+// Link a child into place without touching the mutation version; lazy
+// materialization uses this, as it does not change the logical tree
+static int node_insert_before(DOMNode* parent, DOMNode* child, DOMNode* reference) {
+    if (reference && reference->parent != parent) {
+        return -1;
+    }
+    if (child == reference) {
+        return 0;
+    }
+
+    // Refuse to create a cycle
+    for (DOMNode* ancestor = parent; ancestor; ancestor = ancestor->parent) {
+        if (ancestor == child) {
+            return -1;
+        }
+    }
+
+    // Keep tape-backed children ahead of the inserted node
+    if (node_materialize_children(parent) != 0) {
+        return -1;
+    }
+
+    // Inserting a fragment inserts its children and leaves it empty
+    if (child->type == NODE_DOCUMENT_FRAGMENT) {
+        node_splice_fragment(parent, child, reference);
+        return 0;
+    }
+
+    node_unlink(child);
+    child->parent = parent;
+
+    if (!reference) {
+        child->next_sibling = NULL;
+        child->prev_sibling = parent->last_child;
+        if (parent->last_child) {
+            parent->last_child->next_sibling = child;
+        } else {
+            parent->first_child = child;
+        }
+        parent->last_child = child;
+    } else {
+        child->next_sibling = reference;
+        child->prev_sibling = reference->prev_sibling;
+        if (reference->prev_sibling) {
+            reference->prev_sibling->next_sibling = child;
+        } else {
+            parent->first_child = child;
+        }
+        reference->prev_sibling = child;
+    }
+
+    if (parent->type == NODE_DOCUMENT && child->type == NODE_ELEMENT &&
+        !((DOMDocument*)parent)->document_element) {
+        ((DOMDocument*)parent)->document_element = (DOMElement*)child;
+    }
+
+    return 0;
+}
+
+int dom_node_append_child(DOMNode* parent, DOMNode* child) {
+    return dom_node_insert_before(parent, child, NULL);
+}
+
+int dom_node_insert_before(DOMNode* parent, DOMNode* child, DOMNode* reference) {
+    if (!parent || !child) {
+        return -1;
+    }
+
+    // Documents are never children, and nodes stay in their own document
+    if (child->type == NODE_DOCUMENT || child->owner_document != node_document(parent)) {
+        return -1;
+    }
+
+    // Moving an attached node removes it from its old parent first
+    DOMNode* old_parent = child->parent;
+    if (node_insert_before(parent, child, reference) != 0) {
+        return -1;
+    }
+
+    node_mutated(parent);
+    if (old_parent && old_parent != parent) {
+        notify_child_list(old_parent, NULL, child);
+    }
+    // A fragment's children are inserted in its place
+    notify_child_list(parent, child->type == NODE_DOCUMENT_FRAGMENT ? NULL : child, NULL);
+    return 0;
+}
+
+int dom_node_remove_child(DOMNode* parent, DOMNode* child) {
+    if (!parent || !child || child->parent != parent) {
+        return -1;
+    }
+
+    // The caller (or a binding) still holds the node, so it is kept
+    node_unlink(child);
+    detached_push(child);
+    node_mutated(parent);
+    notify_child_list(parent, NULL, child);
+    return 0;
+}
+
+DOMNode* dom_node_get_parent(DOMNode* node) {
+    if (!node) {
+        return NULL;
+    }
+    return node->parent;
+}
+
+DOMNode* dom_node_get_first_child(DOMNode* node) {
+    if (!node || node_materialize_children(node) != 0) {
+        return NULL;
+    }
+    return node->first_child;
+}
+
+DOMNode* dom_node_get_last_child(DOMNode* node) {
+    if (!node || node_materialize_children(node) != 0) {
+        return NULL;
+    }
+    return node->last_child;
+}
+
+DOMNode* dom_node_get_next_sibling(DOMNode* node) {
+    if (!node || !node->parent) {
+        return NULL;
+    }
+    return node->next_sibling;
+}
+
+DOMNode* dom_node_get_previous_sibling(DOMNode* node) {
+    if (!node || !node->parent) {
+        return NULL;
+    }
+    return node->prev_sibling;
+}
+
+DOMDocument* dom_node_get_owner_document(DOMNode* node) {
+    if (!node) {
+        return NULL;
+    }
+    return node_document(node);
+}
+
+const char* dom_node_get_name(DOMNode* node) {
+    if (!node) {
+        return NULL;
+    }
+    if (node->type == NODE_TEXT) {
+        return "#text";
+    }
+    if (node->type == NODE_DOCUMENT) {
+        return "#document";
+    }
+    if (node->type == NODE_DOCUMENT_FRAGMENT) {
+        return "#document-fragment";
+    }
+    return node->name;
+}
+
+static size_t text_content_length(DOMNode* node) {
+    if (node->type == NODE_TEXT) {
+        return node->value_length;
+    }
+
+    size_t length = 0;
+    for (DOMNode* child = dom_node_get_first_child(node); child; child = child->next_sibling) {
+        length += text_content_length(child);
+    }
+    return length;
+}
+
+static char* text_content_copy(DOMNode* node, char* out) {
+    if (node->type == NODE_TEXT) {
+        memcpy(out, node->value, node->value_length);
+        return out + node->value_length;
+    }
+
+    for (DOMNode* child = node->first_child; child; child = child->next_sibling) {
+        out = text_content_copy(child, out);
+    }
+    return out;
+}
+
+char* dom_node_get_text_content(DOMNode* node) {
+    if (!node) {
+        return NULL;
+    }
+
+    // The first pass materializes the subtree, the second copies
+    size_t length = text_content_length(node);
+    char* text = (char*)malloc(length + 1);
+    if (!text) {
+        return NULL;
+    }
+    *text_content_copy(node, text) = '\0';
+    return text;
+}
+
+int dom_node_set_text_content(DOMNode* node, const char* text) {
+    if (!text) {
+        return -1;
+    }
+
+    return dom_node_set_text_content_len(node, text, strlen(text));
+}
+
+int dom_node_set_text_content_len(DOMNode* node, const char* text, size_t len) {
+    if (!node || !text) {
+        return -1;
+    }
+
+    if (node->type == NODE_TEXT) {
+        char* value = copy_range(text, len);
+        if (!value) {
+            return -1;
+        }
+        free(node->value);
+        node->value = value;
+        node->value_length = len;
+        script_value_drop(node->owner_document, &node->script_value);
+        node_mutated(node);
+
+        DOMDocument* doc = node_document(node);
+        if (doc && doc->observer) {
+            DOMMutation mutation;
+            memset(&mutation, 0, sizeof(mutation));
+            mutation.type = DOM_MUTATION_CHARACTER_DATA;
+            mutation.target = node;
+            doc->observer(&mutation, doc->observer_data);
+        }
+        return 0;
+    }
+
+    while (node->first_child) {
+        node_discard(node->first_child);
+    }
+    node->children_pending = 0;
+
+    if (len > 0) {
+        DOMNode* text_node = text_node_create(node_document(node), text, len);
+        if (!text_node) {
+            return -1;
+        }
+        node_insert_before(node, text_node, NULL);
+    }
+
+    node_mutated(node);
+    notify_child_list(node, NULL, NULL);
+    return 0;
+}
+
+const char* dom_node_get_value(DOMNode* node, size_t* len) {
+    if (!node || node->type != NODE_TEXT) {
+        return NULL;
+    }
+    if (len) {
+        *len = node->value_length;
+    }
+    return node->value;
+}
+
+uint64_t dom_document_get_version(DOMDocument* doc) {
+    if (!doc) {
+        return 0;
+    }
+    return doc->version;
+}
+
+void* dom_node_get_binding(DOMNode* node) {
+    if (!node) {
+        return NULL;
+    }
+    return node->binding;
+}
+
+void dom_node_set_binding(DOMNode* node, void* binding) {
+    if (node) {
+        node->binding = binding;
+    }
+}
+
+int dom_node_release(DOMNode* node) {
+    if (!node) {
+        return 0;
+    }
+
+    DOMNode* root = node;
+    while (root->parent) {
+        root = root->parent;
+    }
+
+    // Still reachable from a document, or another binding points into it
+    if (root->type == NODE_DOCUMENT || subtree_has_binding(root)) {
+        return 0;
+    }
+
+    node_unlink(root);
+    dom_node_destroy_recursive(root);
+    return 1;
+}
+
+DOMNodeType dom_node_get_type(DOMNode* node) {
+    if (!node) {
+        return NODE_DOCUMENT; // Default
+    }
+    return node->type;
+}
+
+static char* copy_range(const char* str, size_t len) {
+    char* copy = (char*)malloc(len + 1);
+    if (copy) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+static int attribute_index(DOMNode* node, const char* name, size_t name_len) {
+    for (int i = 0; i < node->attributes.attr_count; i++) {
+        if (node->attributes.attr_name_lengths[i] == name_len &&
+            memcmp(node->attributes.attr_names[i], name, name_len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int node_set_attribute(DOMNode* node, const char* name, size_t name_len,
+                              const char* value, size_t value_len) {
+    // Check if attribute already exists
+    int index = attribute_index(node, name, name_len);
+    if (index >= 0) {
+        char* new_value = copy_range(value, value_len);
+        if (!new_value) {
+            return -1;
+        }
+        free(node->attributes.attr_values[index]);
+        node->attributes.attr_values[index] = new_value;
+        node->attributes.attr_lengths[index] = value_len;
+        script_value_drop(node->owner_document, &node->attributes.attr_scripts[index]);
+        return 0;
+    }
+
+    // Add new attribute
+    if (node->attributes.attr_count >= node->attributes.attr_capacity) {
+        // Grow arrays; each one is kept as soon as it has moved
+        int new_capacity = node->attributes.attr_capacity ? node->attributes.attr_capacity * 2 : 4;
+        char** new_names = (char**)realloc(node->attributes.attr_names, new_capacity * sizeof(char*));
+        if (!new_names) {
+            return -1;
+        }
+        node->attributes.attr_names = new_names;
+        char** new_values = (char**)realloc(node->attributes.attr_values, new_capacity * sizeof(char*));
+        if (!new_values) {
+            return -1;
+        }
+        node->attributes.attr_values = new_values;
+        size_t* new_name_lengths = (size_t*)realloc(node->attributes.attr_name_lengths,
+                                                    new_capacity * sizeof(size_t));
+        if (!new_name_lengths) {
+            return -1;
+        }
+        node->attributes.attr_name_lengths = new_name_lengths;
+        size_t* new_lengths = (size_t*)realloc(node->attributes.attr_lengths, new_capacity * sizeof(size_t));
+        if (!new_lengths) {
+            return -1;
+        }
+        node->attributes.attr_lengths = new_lengths;
+        void** new_scripts = (void**)realloc(node->attributes.attr_scripts, new_capacity * sizeof(void*));
+        if (!new_scripts) {
+            return -1;
+        }
+        node->attributes.attr_scripts = new_scripts;
+        node->attributes.attr_capacity = new_capacity;
+    }
+
+    node->attributes.attr_names[node->attributes.attr_count] = copy_range(name, name_len);
+    node->attributes.attr_values[node->attributes.attr_count] = copy_range(value, value_len);
+    
+    if (!node->attributes.attr_names[node->attributes.attr_count] || 
+        !node->attributes.attr_values[node->attributes.attr_count]) {
+        free(node->attributes.attr_names[node->attributes.attr_count]);
+        free(node->attributes.attr_values[node->attributes.attr_count]);
+        return -1;
+    }
+    node->attributes.attr_name_lengths[node->attributes.attr_count] = name_len;
+    node->attributes.attr_lengths[node->attributes.attr_count] = value_len;
+    node->attributes.attr_scripts[node->attributes.attr_count] = NULL;
+    
+    node->attributes.attr_count++;
+
+    return 0;
+}
+
+int dom_element_set_attribute(DOMElement* element, const char* name, const char* value) {
+    if (!name || !value) {
+        return -1;
+    }
+
+    return dom_element_set_attribute_len(element, name, strlen(name), value, strlen(value));
+}
+
+int dom_element_set_attribute_len(DOMElement* element, const char* name, size_t name_len,
+                                  const char* value, size_t value_len) {
+    if (!element || !name || !value) {
+        return -1;
+    }
+
+    // Observers see the change before it happens, while the old value is
+    // still readable
+    DOMDocument* doc = node_document(&element->node);
+    if (doc && doc->observer) {
+        DOMMutation mutation;
+        memset(&mutation, 0, sizeof(mutation));
+        mutation.type = DOM_MUTATION_ATTRIBUTE;
+        mutation.target = &element->node;
+        mutation.name = name;
+        mutation.name_length = name_len;
+        mutation.old_value = dom_element_get_attribute_len(element, name, name_len, &mutation.old_value_length);
+        mutation.value = value;
+        mutation.value_length = value_len;
+        doc->observer(&mutation, doc->observer_data);
+    }
+
+    if (node_set_attribute(&element->node, name, name_len, value, value_len) != 0) {
+        return -1;
+    }
+
+    node_mutated(&element->node);
+    return 0;
+}
+
+const char* dom_element_get_attribute(DOMElement* element, const char* name) {
+    if (!name) {
+        return NULL;
+    }
+
+    return dom_element_get_attribute_len(element, name, strlen(name), NULL);
+}
+
+const char* dom_element_get_attribute_len(DOMElement* element, const char* name, size_t name_len,
+                                          size_t* value_len) {
+    if (!element || !name) {
+        return NULL;
+    }
+
+    int index = attribute_index(&element->node, name, name_len);
+    if (index < 0) {
+        return NULL;
+    }
+
+    if (value_len) {
+        *value_len = element->node.attributes.attr_lengths[index];
+    }
+    return element->node.attributes.attr_values[index];
+}
+
+const char* dom_element_get_tag_name(DOMElement* element) {
+    if (!element) {
+        return NULL;
+    }
+    return element->node.name;
+}
+
+int dom_element_set_inner_html(DOMElement* element, const char* html) {
+    if (!html) {
+        return -1;
+    }
+
+    return dom_element_set_inner_html_len(element, html, strlen(html));
+}
+
+int dom_element_set_inner_html_len(DOMElement* element, const char* html, size_t len) {
+    if (!element || !html) {
+        return -1;
+    }
+
+    // Parse first so a failure leaves the element as it was
+    DOMNode* fragment = html_parser_parse_fragment(element->node.owner_document, element->node.name, html, len);
+    if (!fragment) {
+        return -1;
+    }
+
+    // Drop existing children
+    while (element->node.first_child) {
+        node_discard(element->node.first_child);
+    }
+    element->node.children_pending = 0;
+
+    node_splice_fragment(&element->node, fragment, NULL);
+    node_discard(fragment);
+
+    node_mutated(&element->node);
+    notify_child_list(&element->node, NULL, NULL);
+    return 0;
+}
+
+int dom_element_insert_adjacent_html(DOMElement* element, DOMAdjacentPosition position,
+                                     const char* html, size_t len) {
+    if (!element || !html) {
+        return -1;
+    }
+
+    // Outside positions insert into the parent, which must be an element
+    DOMNode* node = &element->node;
+    DOMNode* parent = node;
+    DOMNode* reference = NULL;
+    switch (position) {
+        case DOM_ADJACENT_BEFORE_BEGIN:
+        case DOM_ADJACENT_AFTER_END:
+            parent = node->parent;
+            if (!parent || parent->type != NODE_ELEMENT) {
+                return -1;
+            }
+            reference = position == DOM_ADJACENT_BEFORE_BEGIN ? node : node->next_sibling;
+            break;
+        case DOM_ADJACENT_AFTER_BEGIN:
+            reference = dom_node_get_first_child(node);
+            break;
+        case DOM_ADJACENT_BEFORE_END:
+            break;
+        default:
+            return -1;
+    }
+
+    DOMNode* fragment = html_parser_parse_fragment(node->owner_document, parent->name, html, len);
+    if (!fragment) {
+        return -1;
+    }
+
+    if (node_materialize_children(parent) != 0) {
+        node_discard(fragment);
+        return -1;
+    }
+    node_splice_fragment(parent, fragment, reference);
+    node_discard(fragment);
+
+    node_mutated(parent);
+    notify_child_list(parent, NULL, NULL);
+    return 0;
+}
+
+int dom_element_add_event_listener(DOMElement* element, const char* event_type,
+                                    DOMEventCallback callback, void* user_data) {
+    if (!element || !event_type || !callback) {
+        return -1;
+    }
+
+    EventListener* listener = (EventListener*)malloc(sizeof(EventListener));
+    if (!listener) {
+        return -1;
+    }
+
+    listener->event_type = strdup(event_type);
+    if (!listener->event_type) {
+        free(listener);
+        return -1;
+    }
+
+    listener->callback = callback;
+    listener->user_data = user_data;
+    listener->next = element->node.event_listeners;
+    element->node.event_listeners = listener;
+
+    return 0;
+}
+
+int dom_element_trigger_event(DOMElement* element, const char* event_type) {
+    if (!element || !event_type) {
+        return -1;
+    }
+
+    EventListener* listener = element->node.event_listeners;
+    while (listener) {
+        if (strcmp(listener->event_type, event_type) == 0) {
+            listener->callback(element, listener->user_data);
         }
         listener = listener->next;
     }
@@ -407,6 +1339,17 @@ static DOMElement* search_query_selector(DOMNode* node, const char* selector) {
         }
     }
 
+    // Unmaterialized subtree: search the tape, then build only the path
+    if (node->children_pending) {
+        const HTMLTape* tape = node->owner_document->tape;
+        uint32_t found = html_tape_find_selector(tape, node->tape_index + 1,
+                                                 tape->entries[node->tape_index].end, selector);
+        if (found == HTML_TAPE_NONE) {
+            return NULL;
+        }
+        return (DOMElement*)node_materialize_path(node, found);
+    }
+
     // Search children
     DOMNode* child = node->first_child;
     while (child) {
@@ -427,3 +1370,441 @@ DOMElement* dom_element_query_selector(DOMElement* element, const char* selector
 
     return search_query_selector((DOMNode*)element, selector);
 }
+
+// Live collections
+// Matches are found on demand and cached with the document version they
+// were found at. Asking for item i walks only as far as the i-th match;
+// any mutation of the document makes the next access start over.
+
+static int class_list_contains(const char* list, const char* token, size_t token_len) {
+    const char* p = list;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\f') {
+            p++;
+        }
+        const char* start = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r' && *p != '\f') {
+            p++;
+        }
+        if ((size_t)(p - start) == token_len && token_len > 0 && strncmp(start, token, token_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Every class in the collection's list must be on the element
+static int element_has_classes(DOMNode* node, const char* classes) {
+    const char* list = dom_element_get_attribute((DOMElement*)node, "class");
+    if (!list) {
+        return 0;
+    }
+
+    int any = 0;
+    const char* p = classes;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r' || *p == '\f') {
+            p++;
+        }
+        const char* start = p;
+        while (*p && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r' && *p != '\f') {
+            p++;
+        }
+        if (p > start) {
+            if (!class_list_contains(list, start, (size_t)(p - start))) {
+                return 0;
+            }
+            any = 1;
+        }
+    }
+    return any;
+}
+
+static int collection_matches(const DOMCollection* collection, DOMNode* node) {
+    switch (collection->kind) {
+        case DOM_COLLECTION_CHILD_NODES:
+            return 1;
+        case DOM_COLLECTION_CHILDREN:
+            return node->type == NODE_ELEMENT;
+        case DOM_COLLECTION_BY_TAG_NAME:
+            return node->type == NODE_ELEMENT &&
+                   (strcmp(collection->name, "*") == 0 || strcasecmp(node->name, collection->name) == 0);
+        case DOM_COLLECTION_BY_CLASS_NAME:
+            return node->type == NODE_ELEMENT && element_has_classes(node, collection->name);
+    }
+    return 0;
+}
+
+// Next candidate after node: siblings for child lists, pre-order
+// descendants of the root for the by-name lists
+static DOMNode* collection_step(const DOMCollection* collection, DOMNode* node) {
+    DOMNode* root = collection->root;
+
+    if (collection->kind == DOM_COLLECTION_CHILD_NODES || collection->kind == DOM_COLLECTION_CHILDREN) {
+        return node ? node->next_sibling : dom_node_get_first_child(root);
+    }
+
+    if (!node) {
+        return dom_node_get_first_child(root);
+    }
+    DOMNode* child = dom_node_get_first_child(node);
+    if (child) {
+        return child;
+    }
+    while (node != root) {
+        if (node->next_sibling) {
+            return node->next_sibling;
+        }
+        node = node->parent;
+    }
+    return NULL;
+}
+
+static int collection_push(DOMCollection* collection, DOMNode* node) {
+    if (collection->count >= collection->capacity) {
+        size_t new_capacity = collection->capacity ? collection->capacity * 2 : 16;
+        DOMNode** items = (DOMNode**)realloc(collection->items, new_capacity * sizeof(DOMNode*));
+        if (!items) {
+            return -1;
+        }
+        collection->items = items;
+        collection->capacity = new_capacity;
+    }
+    collection->items[collection->count++] = node;
+    return 0;
+}
+
+// Extend the cache until it holds index, or to the end when index is SIZE_MAX
+static void collection_fill(DOMCollection* collection, size_t index) {
+    DOMDocument* doc = node_document(collection->root);
+    uint64_t version = doc ? doc->version : 0;
+    if (collection->version != version) {
+        collection->count = 0;
+        collection->complete = 0;
+        collection->version = version;
+    }
+
+    DOMNode* node = collection->count ? collection->items[collection->count - 1] : NULL;
+    while (!collection->complete && (index == SIZE_MAX || collection->count <= index)) {
+        node = collection_step(collection, node);
+        if (!node) {
+            collection->complete = 1;
+        } else if (collection_matches(collection, node) && collection_push(collection, node) != 0) {
+            break;
+        }
+    }
+}
+
+DOMCollection* dom_collection_create(DOMNode* root, DOMCollectionKind kind, const char* name) {
+    if (!root) {
+        return NULL;
+    }
+    if ((kind == DOM_COLLECTION_BY_TAG_NAME || kind == DOM_COLLECTION_BY_CLASS_NAME) && !name) {
+        return NULL;
+    }
+
+    DOMCollection* collection = (DOMCollection*)calloc(1, sizeof(DOMCollection));
+    if (!collection) {
+        return NULL;
+    }
+
+    if (name) {
+        collection->name = strdup(name);
+        if (!collection->name) {
+            free(collection);
+            return NULL;
+        }
+    }
+    collection->root = root;
+    collection->kind = kind;
+
+    // Start out of date so the first access builds the cache
+    DOMDocument* doc = node_document(root);
+    collection->version = (doc ? doc->version : 0) - 1;
+
+    return collection;
+}
+
+void dom_collection_destroy(DOMCollection* collection) {
+    if (!collection) {
+        return;
+    }
+
+    free(collection->items);
+    free(collection->name);
+    free(collection);
+}
+
+size_t dom_collection_length(DOMCollection* collection) {
+    if (!collection) {
+        return 0;
+    }
+
+    collection_fill(collection, SIZE_MAX);
+    return collection->count;
+}
+
+DOMNode* dom_collection_item(DOMCollection* collection, size_t index) {
+    if (!collection) {
+        return NULL;
+    }
+
+    collection_fill(collection, index);
+    return index < collection->count ? collection->items[index] : NULL;
+}
+
+DOMNode* dom_collection_get_root(DOMCollection* collection) {
+    if (!collection) {
+        return NULL;
+    }
+    return collection->root;
+}
+
+// Script string cache
+// A script engine may park its string object for an attribute value or a
+// text node's data on the node. The DOM never looks inside; it only hands
+// the string back through the release hook once the value changes or the
+// node is destroyed.
+
+static void script_cache_clear(DOMDocument* doc, DOMNode* node) {
+    for (DOMNode* child = node->first_child; child; child = child->next_sibling) {
+        script_cache_clear(doc, child);
+    }
+    for (int i = 0; i < node->attributes.attr_count; i++) {
+        script_value_drop(doc, &node->attributes.attr_scripts[i]);
+    }
+    script_value_drop(doc, &node->script_value);
+}
+
+void dom_document_set_script_cache(DOMDocument* doc, DOMScriptCacheRelease release, void* user_data) {
+    if (!doc) {
+        return;
+    }
+
+    // Strings cached under the previous hook go back to their owner first
+    script_cache_clear(doc, &doc->node);
+    for (DOMNode* node = doc->detached; node; node = node->next_sibling) {
+        script_cache_clear(doc, node);
+    }
+
+    doc->script_release = release;
+    doc->script_release_data = user_data;
+}
+
+void* dom_element_get_attribute_script_value(DOMElement* element, const char* name, size_t name_len) {
+    if (!element || !name) {
+        return NULL;
+    }
+
+    int index = attribute_index(&element->node, name, name_len);
+    return index >= 0 ? element->node.attributes.attr_scripts[index] : NULL;
+}
+
+int dom_element_set_attribute_script_value(DOMElement* element, const char* name, size_t name_len, void* value) {
+    if (!element || !name || !element->node.owner_document || !element->node.owner_document->script_release) {
+        return -1;
+    }
+
+    int index = attribute_index(&element->node, name, name_len);
+    if (index < 0) {
+        return -1;
+    }
+
+    script_value_drop(element->node.owner_document, &element->node.attributes.attr_scripts[index]);
+    element->node.attributes.attr_scripts[index] = value;
+    return 0;
+}
+
+void* dom_node_get_script_value(DOMNode* node) {
+    if (!node || node->type != NODE_TEXT) {
+        return NULL;
+    }
+    return node->script_value;
+}
+
+int dom_node_set_script_value(DOMNode* node, void* value) {
+    if (!node || node->type != NODE_TEXT || !node->owner_document || !node->owner_document->script_release) {
+        return -1;
+    }
+
+    script_value_drop(node->owner_document, &node->script_value);
+    node->script_value = value;
+    return 0;
+}
+
+// Paint cache
+// A painter may park what it recorded for a subtree (a display list) on the
+// subtree's root. Any mutation drops the cache on the mutated node and on
+// all of its ancestors, so a cache found during paint is always current.
+
+static void paint_cache_clear(DOMDocument* doc, DOMNode* node) {
+    for (DOMNode* child = node->first_child; child; child = child->next_sibling) {
+        paint_cache_clear(doc, child);
+    }
+    paint_cache_drop(doc, node);
+}
+
+void dom_document_set_paint_cache(DOMDocument* doc, DOMPaintCacheRelease release, void* user_data) {
+    if (!doc) {
+        return;
+    }
+
+    paint_cache_clear(doc, &doc->node);
+    for (DOMNode* node = doc->detached; node; node = node->next_sibling) {
+        paint_cache_clear(doc, node);
+    }
+
+    doc->paint_release = release;
+    doc->paint_release_data = user_data;
+}
+
+void* dom_node_get_paint_cache(DOMNode* node) {
+    return node ? node->paint_cache : NULL;
+}
+
+int dom_node_set_paint_cache(DOMNode* node, void* value) {
+    DOMDocument* doc = node ? node_document(node) : NULL;
+    if (!doc || !doc->paint_release) {
+        return -1;
+    }
+
+    paint_cache_drop(doc, node);
+    node->paint_cache = value;
+    return 0;
+}
+
+// Style cache
+// A style engine stores each element's computed style on the element
+// itself, so a lookup is a field read and styles go away with their nodes.
+
+static void style_cache_clear(DOMDocument* doc, DOMNode* node) {
+    for (DOMNode* child = node->first_child; child; child = child->next_sibling) {
+        style_cache_clear(doc, child);
+    }
+    style_cache_drop(doc, node);
+}
+
+void dom_document_set_style_cache(DOMDocument* doc, DOMStyleCacheRelease release, void* user_data) {
+    if (!doc) {
+        return;
+    }
+
+    style_cache_clear(doc, &doc->node);
+    for (DOMNode* node = doc->detached; node; node = node->next_sibling) {
+        style_cache_clear(doc, node);
+    }
+
+    doc->style_release = release;
+    doc->style_release_data = user_data;
+}
+
+void* dom_node_get_style_cache(DOMNode* node) {
+    return node ? node->style_cache : NULL;
+}
+
+int dom_node_set_style_cache(DOMNode* node, void* value) {
+    DOMDocument* doc = node ? node_document(node) : NULL;
+    if (!doc || !doc->style_release) {
+        return -1;
+    }
+
+    style_cache_drop(doc, node);
+    node->style_cache = value;
+    return 0;
+}
+
+// Layout cache
+// Layout results live on the nodes like computed styles do. Mutations do
+// not drop them; they set the layout dirty mark on the node and its
+// ancestors instead, so the layout engine can reuse every clean subtree.
+
+static void layout_cache_clear(DOMDocument* doc, DOMNode* node) {
+    for (DOMNode* child = node->first_child; child; child = child->next_sibling) {
+        layout_cache_clear(doc, child);
+    }
+    layout_cache_drop(doc, node);
+}
+
+void dom_document_set_layout_cache(DOMDocument* doc, DOMLayoutCacheRelease release, void* user_data) {
+    if (!doc) {
+        return;
+    }
+
+    layout_cache_clear(doc, &doc->node);
+    for (DOMNode* node = doc->detached; node; node = node->next_sibling) {
+        layout_cache_clear(doc, node);
+    }
+
+    doc->layout_release = release;
+    doc->layout_release_data = user_data;
+}
+
+void* dom_node_get_layout_cache(DOMNode* node) {
+    return node ? node->layout_cache : NULL;
+}
+
+int dom_node_set_layout_cache(DOMNode* node, void* value) {
+    DOMDocument* doc = node ? node_document(node) : NULL;
+    if (!doc || !doc->layout_release) {
+        return -1;
+    }
+
+    layout_cache_drop(doc, node);
+    node->layout_cache = value;
+    return 0;
+}
+
+void dom_node_mark_layout_dirty(DOMNode* node) {
+    // Always walks to the root: a subtree the layout engine skipped (say,
+    // display: none) may keep stale marks, so a marked ancestor says nothing
+    // about the ones above it
+    for (; node; node = node->parent) {
+        node->layout_dirty = 1;
+    }
+}
+
+int dom_node_get_layout_dirty(DOMNode* node) {
+    return node ? node->layout_dirty : 0;
+}
+
+void dom_node_clear_layout_dirty(DOMNode* node) {
+    if (node) {
+        node->layout_dirty = 0;
+    }
+}
+
+// Mutation observer and style marks
+
+void dom_document_set_mutation_observer(DOMDocument* doc, DOMMutationCallback callback, void* user_data) {
+    if (!doc) {
+        return;
+    }
+
+    doc->observer = callback;
+    doc->observer_data = user_data;
+}
+
+void dom_node_mark_style_dirty(DOMNode* node, unsigned int flags) {
+    if (!node) {
+        return;
+    }
+
+    node->style_dirty |= flags;
+    // An ancestor that is already marked has all of its ancestors marked
+    for (DOMNode* ancestor = node->parent; ancestor; ancestor = ancestor->parent) {
+        if (ancestor->style_dirty & DOM_STYLE_DIRTY_CHILDREN) {
+            break;
+        }
+        ancestor->style_dirty |= DOM_STYLE_DIRTY_CHILDREN;
+    }
+}
+
+unsigned int dom_node_get_style_dirty(DOMNode* node) {
+    return node ? node->style_dirty : 0;
+}
+
+void dom_node_clear_style_dirty(DOMNode* node) {
+    if (node) {
+        node->style_dirty = 0;
+    }
+}
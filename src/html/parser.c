@@ -1,9 +1,11 @@
 #include "html/parser.h"
+#include "html/tape.h"
 #include "dom/dom.h"
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include <stdio.h>
+#include <strings.h>
 
 // Simple HTML parser - handles basic tags and text nodes
 // This is a simplified parser for demonstration purposes
@@ -12,6 +14,8 @@ typedef struct {
     const char* input;
     size_t pos;
     size_t length;
+    HTMLScriptCallback script_callback;
+    void* script_user_data;
 } Parser;
 
 static void skip_whitespace(Parser* p) {
@@ -34,34 +38,15 @@ static char next_char(Parser* p) {
     return '\0';
 }
 
-static char* read_until(Parser* p, char delim) {
-    size_t start = p->pos;
-    while (p->pos < p->length && p->input[p->pos] != delim) {
-        p->pos++;
-    }
-    
-    size_t len = p->pos - start;
-    char* result = (char*)malloc(len + 1);
-    if (result) {
-        memcpy(result, p->input + start, len);
-        result[len] = '\0';
-    }
-    return result;
-}
-
-static char* read_tag_name(Parser* p) {
+// Names are read in place: the span points into the input
+static size_t read_name(Parser* p, const char** name) {
     size_t start = p->pos;
     while (p->pos < p->length && (isalnum(p->input[p->pos]) || p->input[p->pos] == '-')) {
         p->pos++;
     }
-    
-    size_t len = p->pos - start;
-    char* result = (char*)malloc(len + 1);
-    if (result) {
-        memcpy(result, p->input + start, len);
-        result[len] = '\0';
-    }
-    return result;
+
+    *name = p->input + start;
+    return p->pos - start;
 }
 
 static int parse_attributes(Parser* p, DOMElement* element) {
@@ -73,14 +58,19 @@ static int parse_attributes(Parser* p, DOMElement* element) {
         }
         
         // Read attribute name
-        char* attr_name = read_tag_name(p);
-        if (!attr_name) {
-            return -1;
+        const char* attr_name;
+        size_t name_len = read_name(p, &attr_name);
+        if (name_len == 0) {
+            // Not a name character; skip it rather than stall
+            next_char(p);
+            continue;
         }
         
         skip_whitespace(p);
         
-        char* attr_value = NULL;
+        // Values are spans of the input, copied once into the DOM
+        const char* attr_value = "";
+        size_t value_len = 0;
         if (peek_char(p) == '=') {
             next_char(p); // consume '='
             skip_whitespace(p);
@@ -88,41 +78,67 @@ static int parse_attributes(Parser* p, DOMElement* element) {
             char quote = peek_char(p);
             if (quote == '"' || quote == '\'') {
                 next_char(p); // consume quote
-                attr_value = read_until(p, quote);
+                attr_value = p->input + p->pos;
+                while (p->pos < p->length && p->input[p->pos] != quote) {
+                    p->pos++;
+                }
+                value_len = (size_t)(p->input + p->pos - attr_value);
                 next_char(p); // consume closing quote
             } else {
                 // Unquoted attribute value
-                size_t start = p->pos;
+                attr_value = p->input + p->pos;
                 while (p->pos < p->length && !isspace(p->input[p->pos]) && 
                        p->input[p->pos] != '>' && p->input[p->pos] != '/') {
                     p->pos++;
                 }
-                size_t len = p->pos - start;
-                attr_value = (char*)malloc(len + 1);
-                if (attr_value) {
-                    memcpy(attr_value, p->input + start, len);
-                    attr_value[len] = '\0';
-                }
+                value_len = (size_t)(p->input + p->pos - attr_value);
             }
-        } else {
-            // Boolean attribute
-            attr_value = strdup("");
         }
+        // Otherwise a boolean attribute with an empty value
         
-        if (attr_value) {
-            dom_element_set_attribute(element, attr_name, attr_value);
-            free(attr_value);
-        }
-        free(attr_name);
+        dom_element_set_attribute_len(element, attr_name, name_len, attr_value, value_len);
     }
     
     return 0;
 }
 
+// Script and style bodies are raw text: everything up to the matching
+// end tag, with no markup recognized inside
+static int is_raw_text_element(const char* tag) {
+    return strcmp(tag, "script") == 0 || strcmp(tag, "style") == 0;
+}
+
+static void parse_raw_text(Parser* p, DOMDocument* doc, DOMElement* element) {
+    const char* tag = dom_element_get_tag_name(element);
+    size_t tag_len = strlen(tag);
+    size_t start = p->pos;
+
+    while (p->pos < p->length) {
+        if (p->input[p->pos] == '<' && p->pos + 1 + tag_len < p->length &&
+            p->input[p->pos + 1] == '/' &&
+            strncasecmp(p->input + p->pos + 2, tag, tag_len) == 0) {
+            break;
+        }
+        p->pos++;
+    }
+
+    size_t len = p->pos - start;
+    if (len > 0) {
+        DOMNode* text = dom_document_create_text_node_len(doc, p->input + start, len);
+        if (text) {
+            dom_node_append_child((DOMNode*)element, text);
+        }
+    }
+
+    if (p->script_callback && strcmp(tag, "script") == 0) {
+        p->script_callback(element, p->input + start, len, p->script_user_data);
+    }
+}
+
 // Forward declaration
 static DOMElement* parse_element(Parser* p, DOMDocument* doc);
 
-static int parse_children(Parser* p, DOMDocument* doc, DOMElement* parent) {
+static int parse_children(Parser* p, DOMDocument* doc, DOMNode* parent) {
     while (peek_char(p) != '\0') {
         skip_whitespace(p);
         
@@ -143,7 +159,7 @@ static int parse_children(Parser* p, DOMDocument* doc, DOMElement* parent) {
             p->pos--; // put back '<'
             DOMElement* child = parse_element(p, doc);
             if (child) {
-                dom_node_append_child((DOMNode*)parent, (DOMNode*)child);
+                dom_node_append_child(parent, (DOMNode*)child);
             }
         } else {
             // Text content
@@ -165,14 +181,13 @@ static int parse_children(Parser* p, DOMDocument* doc, DOMElement* parent) {
                     text_end--;
                 }
                 
+                // Each run becomes its own text node, so text on either
+                // side of a child element is kept
                 len = text_end - text_start;
                 if (len > 0) {
-                    char* text = (char*)malloc(len + 1);
+                    DOMNode* text = dom_document_create_text_node_len(doc, text_start, len);
                     if (text) {
-                        memcpy(text, text_start, len);
-                        text[len] = '\0';
-                        dom_element_set_inner_html(parent, text);
-                        free(text);
+                        dom_node_append_child(parent, text);
                     }
                 }
             }
@@ -213,14 +228,13 @@ static DOMElement* parse_element(Parser* p, DOMDocument* doc) {
         return NULL;
     }
     
-    char* tag_name = read_tag_name(p);
-    if (!tag_name) {
+    const char* tag_name;
+    size_t tag_len = read_name(p, &tag_name);
+    if (tag_len == 0) {
         return NULL;
     }
     
-    DOMElement* element = dom_document_create_element(doc, tag_name);
-    free(tag_name);
-    
+    DOMElement* element = dom_document_create_element_len(doc, tag_name, tag_len);
     if (!element) {
         return NULL;
     }
@@ -252,7 +266,11 @@ static DOMElement* parse_element(Parser* p, DOMDocument* doc) {
     }
     
     // Parse children
-    parse_children(p, doc, element);
+    if (tag && is_raw_text_element(tag)) {
+        parse_raw_text(p, doc, element);
+    } else {
+        parse_children(p, doc, (DOMNode*)element);
+    }
     
     // Parse closing tag
     skip_whitespace(p);
@@ -260,8 +278,8 @@ static DOMElement* parse_element(Parser* p, DOMDocument* doc) {
         next_char(p); // consume '<'
         if (peek_char(p) == '/') {
             next_char(p); // consume '/'
-            char* closing_tag = read_tag_name(p);
-            free(closing_tag); // We trust it matches for now
+            const char* closing_tag;
+            read_name(p, &closing_tag); // We trust it matches for now
             skip_whitespace(p);
             if (peek_char(p) == '>') {
                 next_char(p); // consume '>'
@@ -273,6 +291,11 @@ static DOMElement* parse_element(Parser* p, DOMDocument* doc) {
 }
 
 int html_parser_parse(DOMDocument* document, const char* html) {
+    return html_parser_parse_with_scripts(document, html, NULL, NULL);
+}
+
+int html_parser_parse_with_scripts(DOMDocument* document, const char* html,
+                                   HTMLScriptCallback callback, void* user_data) {
     if (!document || !html) {
         return -1;
     }
@@ -281,6 +304,8 @@ int html_parser_parse(DOMDocument* document, const char* html) {
     parser.input = html;
     parser.pos = 0;
     parser.length = strlen(html);
+    parser.script_callback = callback;
+    parser.script_user_data = user_data;
     
     // Parse all top-level elements
     while (parser.pos < parser.length) {
@@ -306,3 +331,66 @@ int html_parser_parse(DOMDocument* document, const char* html) {
     
     return 0;
 }
+
+DOMNode* html_parser_parse_fragment(DOMDocument* document, const char* context,
+                                    const char* html, size_t length) {
+    if (!document || !html) {
+        return NULL;
+    }
+
+    DOMNode* fragment = dom_document_create_fragment(document);
+    if (!fragment) {
+        return NULL;
+    }
+
+    // Inside script or style the markup is just text
+    if (context && is_raw_text_element(context)) {
+        if (length > 0) {
+            DOMNode* text = dom_document_create_text_node_len(document, html, length);
+            if (text) {
+                dom_node_append_child(fragment, text);
+            }
+        }
+        return fragment;
+    }
+
+    Parser parser;
+    parser.input = html;
+    parser.pos = 0;
+    parser.length = length;
+    parser.script_callback = NULL;
+    parser.script_user_data = NULL;
+
+    while (parser.pos < parser.length) {
+        parse_children(&parser, document, fragment);
+
+        // parse_children stops at an end tag; one with no open element
+        // here is dropped
+        while (parser.pos < parser.length && parser.input[parser.pos] != '>') {
+            parser.pos++;
+        }
+        if (parser.pos < parser.length) {
+            parser.pos++;
+        }
+    }
+
+    return fragment;
+}
+
+int html_parser_parse_lazy(DOMDocument* document, const char* html) {
+    if (!document || !html) {
+        return -1;
+    }
+
+    HTMLTape* tape = html_tape_build(html, strlen(html));
+    if (!tape) {
+        return -1;
+    }
+
+    if (dom_document_attach_tape(document, tape) != 0) {
+        html_tape_destroy(tape);
+        return -1;
+    }
+
+    return 0;
+}
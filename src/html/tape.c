@@ -0,0 +1,489 @@
+#include "html/tape.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <strings.h>
+
+// Structural tape builder
+// Records tag open/close structure and attribute byte ranges in one pass,
+// following the same tokenization rules as parser.c but without creating
+// any DOM nodes. The DOM materializes nodes from the tape on demand.
+
+typedef struct {
+    HTMLTape* tape;
+    const char* input;
+    size_t pos;
+    size_t length;
+    uint32_t* open;        // Stack of open element entry indices
+    size_t open_count;
+    size_t open_capacity;
+} TapeBuilder;
+
+static void skip_whitespace(TapeBuilder* b) {
+    while (b->pos < b->length && isspace((unsigned char)b->input[b->pos])) {
+        b->pos++;
+    }
+}
+
+static char peek_char(TapeBuilder* b) {
+    if (b->pos < b->length) {
+        return b->input[b->pos];
+    }
+    return '\0';
+}
+
+static int is_name_char(char c) {
+    return isalnum((unsigned char)c) || c == '-';
+}
+
+static int is_void_element(const char* name, size_t len) {
+    static const char* const void_elements[] = { "br", "hr", "img", "input", "meta", "link" };
+    for (size_t i = 0; i < sizeof(void_elements) / sizeof(void_elements[0]); i++) {
+        if (strlen(void_elements[i]) == len && memcmp(void_elements[i], name, len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int is_raw_text_element(const char* name, size_t len) {
+    return (len == 6 && memcmp(name, "script", 6) == 0) ||
+           (len == 5 && memcmp(name, "style", 5) == 0);
+}
+
+static int push_entry(HTMLTape* tape, uint8_t kind, size_t offset, size_t length) {
+    if (tape->entry_count >= tape->entry_capacity) {
+        uint32_t new_capacity = tape->entry_capacity ? tape->entry_capacity * 2 : 64;
+        HTMLTapeEntry* entries = (HTMLTapeEntry*)realloc(tape->entries, new_capacity * sizeof(HTMLTapeEntry));
+        if (!entries) {
+            return -1;
+        }
+        tape->entries = entries;
+        tape->entry_capacity = new_capacity;
+    }
+
+    HTMLTapeEntry* entry = &tape->entries[tape->entry_count];
+    entry->offset = (uint32_t)offset;
+    entry->length = (uint32_t)length;
+    entry->end = tape->entry_count + 1;
+    entry->attr_first = tape->attr_count;
+    entry->attr_count = 0;
+    entry->kind = kind;
+    entry->reserved = 0;
+    tape->entry_count++;
+    return 0;
+}
+
+static int push_attribute(HTMLTape* tape, size_t name_offset, size_t name_length,
+                          size_t value_offset, size_t value_length) {
+    if (tape->attr_count >= tape->attr_capacity) {
+        uint32_t new_capacity = tape->attr_capacity ? tape->attr_capacity * 2 : 64;
+        HTMLTapeAttribute* attrs = (HTMLTapeAttribute*)realloc(tape->attrs, new_capacity * sizeof(HTMLTapeAttribute));
+        if (!attrs) {
+            return -1;
+        }
+        tape->attrs = attrs;
+        tape->attr_capacity = new_capacity;
+    }
+
+    HTMLTapeAttribute* attr = &tape->attrs[tape->attr_count++];
+    attr->name_offset = (uint32_t)name_offset;
+    attr->name_length = (uint32_t)name_length;
+    attr->value_offset = (uint32_t)value_offset;
+    attr->value_length = (uint32_t)value_length;
+    return 0;
+}
+
+static int push_open(TapeBuilder* b, uint32_t index) {
+    if (b->open_count >= b->open_capacity) {
+        size_t new_capacity = b->open_capacity ? b->open_capacity * 2 : 32;
+        uint32_t* open = (uint32_t*)realloc(b->open, new_capacity * sizeof(uint32_t));
+        if (!open) {
+            return -1;
+        }
+        b->open = open;
+        b->open_capacity = new_capacity;
+    }
+    b->open[b->open_count++] = index;
+    return 0;
+}
+
+static void close_top(TapeBuilder* b) {
+    if (b->open_count > 0) {
+        uint32_t index = b->open[--b->open_count];
+        b->tape->entries[index].end = b->tape->entry_count;
+    }
+}
+
+static int scan_attributes(TapeBuilder* b, uint32_t entry_index) {
+    HTMLTape* tape = b->tape;
+
+    while (peek_char(b) != '>' && peek_char(b) != '/' && peek_char(b) != '\0') {
+        skip_whitespace(b);
+
+        if (peek_char(b) == '>' || peek_char(b) == '/' || peek_char(b) == '\0') {
+            break;
+        }
+
+        size_t name_start = b->pos;
+        while (b->pos < b->length && is_name_char(b->input[b->pos])) {
+            b->pos++;
+        }
+        size_t name_length = b->pos - name_start;
+        if (name_length == 0) {
+            // Not an attribute name; skip the stray character
+            b->pos++;
+            continue;
+        }
+
+        skip_whitespace(b);
+
+        size_t value_start = b->pos;
+        size_t value_length = 0;
+        if (peek_char(b) == '=') {
+            b->pos++; // consume '='
+            skip_whitespace(b);
+
+            char quote = peek_char(b);
+            if (quote == '"' || quote == '\'') {
+                b->pos++; // consume quote
+                value_start = b->pos;
+                while (b->pos < b->length && b->input[b->pos] != quote) {
+                    b->pos++;
+                }
+                value_length = b->pos - value_start;
+                if (b->pos < b->length) {
+                    b->pos++; // consume closing quote
+                }
+            } else {
+                // Unquoted attribute value
+                value_start = b->pos;
+                while (b->pos < b->length && !isspace((unsigned char)b->input[b->pos]) &&
+                       b->input[b->pos] != '>' && b->input[b->pos] != '/') {
+                    b->pos++;
+                }
+                value_length = b->pos - value_start;
+            }
+        }
+
+        if (push_attribute(tape, name_start, name_length, value_start, value_length) != 0) {
+            return -1;
+        }
+        tape->entries[entry_index].attr_count++;
+    }
+
+    return 0;
+}
+
+// Script and style bodies become a single untrimmed text entry
+static int scan_raw_text(TapeBuilder* b, uint32_t index, size_t name_start, size_t name_length) {
+    size_t start = b->pos;
+    while (b->pos < b->length) {
+        if (b->input[b->pos] == '<' && b->pos + 1 + name_length < b->length &&
+            b->input[b->pos + 1] == '/' &&
+            strncasecmp(b->input + b->pos + 2, b->input + name_start, name_length) == 0) {
+            break;
+        }
+        b->pos++;
+    }
+
+    if (b->pos > start && push_entry(b->tape, HTML_TAPE_TEXT, start, b->pos - start) != 0) {
+        return -1;
+    }
+
+    // Skip the end tag
+    while (b->pos < b->length && b->input[b->pos] != '>') {
+        b->pos++;
+    }
+    if (b->pos < b->length) {
+        b->pos++;
+    }
+
+    b->tape->entries[index].end = b->tape->entry_count;
+    return 0;
+}
+
+// Scan markup starting at '<'. Comments and DOCTYPE are skipped; closing
+// tags pop the open element stack; start tags push a new entry.
+static int scan_tag(TapeBuilder* b) {
+    b->pos++; // consume '<'
+
+    if (b->pos + 2 < b->length && b->input[b->pos] == '!' &&
+        b->input[b->pos + 1] == '-' && b->input[b->pos + 2] == '-') {
+        b->pos += 3;
+        while (b->pos + 2 < b->length) {
+            if (b->input[b->pos] == '-' && b->input[b->pos + 1] == '-' && b->input[b->pos + 2] == '>') {
+                b->pos += 3;
+                return 0;
+            }
+            b->pos++;
+        }
+        b->pos = b->length;
+        return 0;
+    }
+
+    if (peek_char(b) == '!' || peek_char(b) == '/') {
+        int closing = peek_char(b) == '/';
+        while (peek_char(b) != '>' && peek_char(b) != '\0') {
+            b->pos++;
+        }
+        if (peek_char(b) == '>') {
+            b->pos++;
+        }
+        if (closing) {
+            // We trust it matches, as the tree parser does
+            close_top(b);
+        }
+        return 0;
+    }
+
+    size_t name_start = b->pos;
+    while (b->pos < b->length && is_name_char(b->input[b->pos])) {
+        b->pos++;
+    }
+    size_t name_length = b->pos - name_start;
+
+    // A '<' that starts no tag is dropped and text resumes after it, as in
+    // the tree parser
+    if (name_length == 0) {
+        return 0;
+    }
+
+    uint32_t index = b->tape->entry_count;
+    if (push_entry(b->tape, HTML_TAPE_ELEMENT, name_start, name_length) != 0) {
+        return -1;
+    }
+    if (scan_attributes(b, index) != 0) {
+        return -1;
+    }
+
+    skip_whitespace(b);
+
+    // Self-closing tag
+    if (peek_char(b) == '/') {
+        b->pos++;
+        if (peek_char(b) == '>') {
+            b->pos++;
+        }
+        return 0;
+    }
+
+    if (peek_char(b) == '>') {
+        b->pos++;
+    }
+
+    if (is_void_element(b->input + name_start, name_length)) {
+        return 0;
+    }
+
+    if (is_raw_text_element(b->input + name_start, name_length)) {
+        return scan_raw_text(b, index, name_start, name_length);
+    }
+
+    return push_open(b, index);
+}
+
+static int scan_text(TapeBuilder* b) {
+    size_t start = b->pos;
+    while (b->pos < b->length && b->input[b->pos] != '<') {
+        b->pos++;
+    }
+
+    size_t end = b->pos;
+    while (start < end && isspace((unsigned char)b->input[start])) {
+        start++;
+    }
+    while (end > start && isspace((unsigned char)b->input[end - 1])) {
+        end--;
+    }
+
+    if (end > start) {
+        return push_entry(b->tape, HTML_TAPE_TEXT, start, end - start);
+    }
+    return 0;
+}
+
+HTMLTape* html_tape_build(const char* html, size_t length) {
+    if (!html || length >= UINT32_MAX) {
+        return NULL;
+    }
+
+    HTMLTape* tape = (HTMLTape*)calloc(1, sizeof(HTMLTape));
+    if (!tape) {
+        return NULL;
+    }
+
+    tape->source = (char*)malloc(length + 1);
+    if (!tape->source) {
+        free(tape);
+        return NULL;
+    }
+    memcpy(tape->source, html, length);
+    tape->source[length] = '\0';
+    tape->source_length = length;
+
+    TapeBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.tape = tape;
+    builder.input = tape->source;
+    builder.length = length;
+
+    int result = 0;
+    while (result == 0 && builder.pos < builder.length) {
+        skip_whitespace(&builder);
+        if (peek_char(&builder) == '\0') {
+            break;
+        }
+
+        if (builder.open_count == 0) {
+            // Only the first top-level element becomes part of the document
+            if (tape->entry_count > 0) {
+                break;
+            }
+            if (peek_char(&builder) == '<') {
+                result = scan_tag(&builder);
+            } else {
+                // Skip unexpected text at top level
+                builder.pos++;
+            }
+        } else if (peek_char(&builder) == '<') {
+            result = scan_tag(&builder);
+        } else {
+            result = scan_text(&builder);
+        }
+    }
+
+    // Close anything left open at end of input
+    while (builder.open_count > 0) {
+        close_top(&builder);
+    }
+    free(builder.open);
+
+    if (result != 0) {
+        html_tape_destroy(tape);
+        return NULL;
+    }
+
+    return tape;
+}
+
+void html_tape_destroy(HTMLTape* tape) {
+    if (!tape) {
+        return;
+    }
+
+    free(tape->source);
+    free(tape->entries);
+    free(tape->attrs);
+    free(tape);
+}
+
+static int slice_equals(const HTMLTape* tape, uint32_t offset, uint32_t length, const char* str, size_t str_len) {
+    return length == str_len && memcmp(tape->source + offset, str, str_len) == 0;
+}
+
+// Last matching attribute wins, mirroring dom_element_set_attribute replacement
+static const HTMLTapeAttribute* entry_attribute(const HTMLTape* tape, const HTMLTapeEntry* entry,
+                                                const char* name, size_t name_len) {
+    const HTMLTapeAttribute* found = NULL;
+    for (uint32_t i = 0; i < entry->attr_count; i++) {
+        const HTMLTapeAttribute* attr = &tape->attrs[entry->attr_first + i];
+        if (slice_equals(tape, attr->name_offset, attr->name_length, name, name_len)) {
+            found = attr;
+        }
+    }
+    return found;
+}
+
+uint32_t html_tape_find_attribute(const HTMLTape* tape, uint32_t first, uint32_t end,
+                                  const char* name, const char* value) {
+    if (!name || !value) {
+        return HTML_TAPE_NONE;
+    }
+
+    return html_tape_find_attribute_len(tape, first, end, name, strlen(name), value, strlen(value));
+}
+
+uint32_t html_tape_find_attribute_len(const HTMLTape* tape, uint32_t first, uint32_t end,
+                                      const char* name, size_t name_len,
+                                      const char* value, size_t value_len) {
+    if (!tape || !name || !value) {
+        return HTML_TAPE_NONE;
+    }
+
+    if (end > tape->entry_count) {
+        end = tape->entry_count;
+    }
+
+    for (uint32_t i = first; i < end; i++) {
+        const HTMLTapeEntry* entry = &tape->entries[i];
+        if (entry->kind != HTML_TAPE_ELEMENT || entry->attr_count == 0) {
+            continue;
+        }
+        const HTMLTapeAttribute* attr = entry_attribute(tape, entry, name, name_len);
+        if (attr && slice_equals(tape, attr->value_offset, attr->value_length, value, value_len)) {
+            return i;
+        }
+    }
+
+    return HTML_TAPE_NONE;
+}
+
+// Substring search within a source slice (class matching mirrors strstr)
+static int slice_contains(const HTMLTape* tape, uint32_t offset, uint32_t length, const char* needle, size_t needle_len) {
+    if (needle_len == 0) {
+        return 1;
+    }
+    if (needle_len > length) {
+        return 0;
+    }
+    const char* haystack = tape->source + offset;
+    for (uint32_t i = 0; i + needle_len <= length; i++) {
+        if (haystack[i] == needle[0] && memcmp(haystack + i, needle, needle_len) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t html_tape_find_selector(const HTMLTape* tape, uint32_t first, uint32_t end,
+                                 const char* selector) {
+    if (!tape || !selector) {
+        return HTML_TAPE_NONE;
+    }
+
+    if (selector[0] == '#') {
+        return html_tape_find_attribute(tape, first, end, "id", selector + 1);
+    }
+
+    if (end > tape->entry_count) {
+        end = tape->entry_count;
+    }
+
+    if (selector[0] == '.') {
+        const char* class_name = selector + 1;
+        size_t class_len = strlen(class_name);
+        for (uint32_t i = first; i < end; i++) {
+            const HTMLTapeEntry* entry = &tape->entries[i];
+            if (entry->kind != HTML_TAPE_ELEMENT || entry->attr_count == 0) {
+                continue;
+            }
+            const HTMLTapeAttribute* attr = entry_attribute(tape, entry, "class", 5);
+            if (attr && slice_contains(tape, attr->value_offset, attr->value_length, class_name, class_len)) {
+                return i;
+            }
+        }
+        return HTML_TAPE_NONE;
+    }
+
+    size_t tag_len = strlen(selector);
+    for (uint32_t i = first; i < end; i++) {
+        const HTMLTapeEntry* entry = &tape->entries[i];
+        if (entry->kind == HTML_TAPE_ELEMENT &&
+            slice_equals(tape, entry->offset, entry->length, selector, tag_len)) {
+            return i;
+        }
+    }
+
+    return HTML_TAPE_NONE;
+}
@@ -0,0 +1,585 @@
+#include "js/bytecode_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Two-tier bytecode cache
+// The memory tier is a hash table with an LRU list; the disk tier is one
+// file per script, laid out so the payload can be used straight from mmap.
+
+#ifndef JUST_BROWSE_QUICKJS_VERSION
+#define JUST_BROWSE_QUICKJS_VERSION "unknown"
+#endif
+
+#define DEFAULT_MEMORY_BUDGET (32u * 1024 * 1024)
+#define DEFAULT_DISK_BUDGET (256u * 1024 * 1024)
+#define BUCKET_COUNT 1024
+#define FILE_FORMAT_VERSION 1
+#define FILE_SUFFIX ".jbc"
+
+// On-disk header; the payload follows immediately
+typedef struct {
+    char magic[4];
+    uint32_t format;
+    char engine_version[32];
+    uint32_t pointer_size;
+    uint32_t reserved;
+    uint64_t key_hi;
+    uint64_t key_lo;
+    uint64_t payload_size;
+} CacheFileHeader;
+
+struct JSBytecodeEntry {
+    JSBytecodeKey key;
+    const uint8_t* data;
+    size_t size;
+    void* mapping;          // Non-NULL when backed by an mmap'ed cache file
+    size_t mapping_size;
+    int refcount;
+    int evicted;
+    struct JSBytecodeEntry* hash_next;
+    struct JSBytecodeEntry* lru_prev;
+    struct JSBytecodeEntry* lru_next;
+};
+
+struct JSBytecodeCache {
+    pthread_mutex_t lock;
+    JSBytecodeEntry* buckets[BUCKET_COUNT];
+    JSBytecodeEntry* lru_head;   // Most recently used
+    JSBytecodeEntry* lru_tail;   // Least recently used
+    size_t memory_budget;
+    char* disk_path;
+    size_t disk_budget;
+    JSBytecodeCacheStats stats;
+};
+
+// Hashing
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint64_t hash_bytes(const void* data, size_t length, uint64_t seed) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t h = seed ^ (length * 0x9E3779B97F4A7C15ULL);
+
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ mix64(word)) * 0x9E3779B97F4A7C15ULL;
+        h = (h << 27) | (h >> 37);
+        p += 8;
+        length -= 8;
+    }
+
+    uint64_t tail = 0;
+    for (size_t i = 0; i < length; i++) {
+        tail |= (uint64_t)p[i] << (8 * i);
+    }
+    h ^= mix64(tail ^ length);
+
+    return mix64(h);
+}
+
+JSBytecodeKey js_bytecode_cache_key(const char* source, size_t length, const char* filename) {
+    JSBytecodeKey key;
+    uint64_t name_hash = filename ? hash_bytes(filename, strlen(filename), 0) : 0;
+    key.hi = hash_bytes(source, length, 0x243F6A8885A308D3ULL ^ name_hash);
+    key.lo = hash_bytes(source, length, 0x13198A2E03707344ULL + name_hash);
+    return key;
+}
+
+static int key_equals(JSBytecodeKey a, JSBytecodeKey b) {
+    return a.hi == b.hi && a.lo == b.lo;
+}
+
+// Memory tier (caller holds the lock)
+
+static void entry_free(JSBytecodeEntry* entry) {
+    if (entry->mapping) {
+        munmap(entry->mapping, entry->mapping_size);
+    } else {
+        free((void*)entry->data);
+    }
+    free(entry);
+}
+
+static void lru_unlink(JSBytecodeCache* cache, JSBytecodeEntry* entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void lru_push_front(JSBytecodeCache* cache, JSBytecodeEntry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    }
+    cache->lru_head = entry;
+    if (!cache->lru_tail) {
+        cache->lru_tail = entry;
+    }
+}
+
+static JSBytecodeEntry* memory_find(JSBytecodeCache* cache, JSBytecodeKey key) {
+    JSBytecodeEntry* entry = cache->buckets[key.lo % BUCKET_COUNT];
+    while (entry && !key_equals(entry->key, key)) {
+        entry = entry->hash_next;
+    }
+    return entry;
+}
+
+static void memory_remove(JSBytecodeCache* cache, JSBytecodeEntry* entry) {
+    JSBytecodeEntry** link = &cache->buckets[entry->key.lo % BUCKET_COUNT];
+    while (*link && *link != entry) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = entry->hash_next;
+    }
+    lru_unlink(cache, entry);
+    cache->stats.memory_bytes -= entry->size;
+
+    // Entries still in use are freed by the last release
+    if (entry->refcount > 0) {
+        entry->evicted = 1;
+    } else {
+        entry_free(entry);
+    }
+}
+
+static void memory_insert(JSBytecodeCache* cache, JSBytecodeEntry* entry) {
+    size_t bucket = entry->key.lo % BUCKET_COUNT;
+    entry->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = entry;
+    lru_push_front(cache, entry);
+    cache->stats.memory_bytes += entry->size;
+
+    while (cache->stats.memory_bytes > cache->memory_budget && cache->lru_tail && cache->lru_tail != entry) {
+        memory_remove(cache, cache->lru_tail);
+        cache->stats.evictions++;
+    }
+}
+
+// Disk tier
+// Nothing here takes the lock: disk_path and disk_budget never change after
+// create, and callers fold the counters these return into the stats under
+// the lock afterwards, so one thread's file I/O never stalls the others.
+
+static char* cache_file_path(const JSBytecodeCache* cache, JSBytecodeKey key, const char* suffix) {
+    size_t len = strlen(cache->disk_path) + 1 + 32 + strlen(suffix) + 1;
+    char* path = (char*)malloc(len);
+    if (path) {
+        snprintf(path, len, "%s/%016llx%016llx%s", cache->disk_path,
+                 (unsigned long long)key.hi, (unsigned long long)key.lo, suffix);
+    }
+    return path;
+}
+
+static void header_init(CacheFileHeader* header, JSBytecodeKey key, size_t payload_size) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, "JBBC", 4);
+    header->format = FILE_FORMAT_VERSION;
+    strncpy(header->engine_version, JUST_BROWSE_QUICKJS_VERSION, sizeof(header->engine_version) - 1);
+    header->pointer_size = (uint32_t)sizeof(void*);
+    header->key_hi = key.hi;
+    header->key_lo = key.lo;
+    header->payload_size = payload_size;
+}
+
+static int header_valid(const CacheFileHeader* header, JSBytecodeKey key, size_t file_size) {
+    CacheFileHeader expected;
+    header_init(&expected, key, header->payload_size);
+    return memcmp(header, &expected, sizeof(expected)) == 0 &&
+           header->payload_size == file_size - sizeof(CacheFileHeader);
+}
+
+// Map a cache file; stale files are deleted and their size added to *removed
+static JSBytecodeEntry* disk_load(const JSBytecodeCache* cache, JSBytecodeKey key, size_t* removed) {
+    char* path = cache_file_path(cache, key, FILE_SUFFIX);
+    if (!path) {
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        free(path);
+        return NULL;
+    }
+
+    struct stat st;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size > sizeof(CacheFileHeader)) {
+        mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        free(path);
+        return NULL;
+    }
+
+    // Files written by another QuickJS version or build are stale
+    if (!header_valid((const CacheFileHeader*)mapping, key, (size_t)st.st_size)) {
+        munmap(mapping, (size_t)st.st_size);
+        close(fd);
+        if (unlink(path) == 0) {
+            *removed += (size_t)st.st_size;
+        }
+        free(path);
+        return NULL;
+    }
+
+    // Touch the file so disk eviction approximates LRU
+    futimens(fd, NULL);
+    close(fd);
+    free(path);
+
+    JSBytecodeEntry* entry = (JSBytecodeEntry*)calloc(1, sizeof(JSBytecodeEntry));
+    if (!entry) {
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+
+    entry->key = key;
+    entry->mapping = mapping;
+    entry->mapping_size = (size_t)st.st_size;
+    entry->data = (const uint8_t*)mapping + sizeof(CacheFileHeader);
+    entry->size = (size_t)st.st_size - sizeof(CacheFileHeader);
+    return entry;
+}
+
+typedef struct {
+    char* path;
+    time_t mtime;
+    size_t size;
+} DiskFile;
+
+static int compare_disk_files(const void* a, const void* b) {
+    const DiskFile* fa = (const DiskFile*)a;
+    const DiskFile* fb = (const DiskFile*)b;
+    return (fa->mtime > fb->mtime) - (fa->mtime < fb->mtime);
+}
+
+// Scan the cache directory; optionally delete oldest files until under
+// budget, counting them in *evicted
+static size_t disk_scan(const JSBytecodeCache* cache, int enforce_budget, size_t* evicted) {
+    DIR* dir = opendir(cache->disk_path);
+    if (!dir) {
+        return 0;
+    }
+
+    DiskFile* files = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t total = 0;
+    size_t suffix_len = strlen(FILE_SUFFIX);
+
+    struct dirent* ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t name_len = strlen(ent->d_name);
+        if (name_len <= suffix_len || strcmp(ent->d_name + name_len - suffix_len, FILE_SUFFIX) != 0) {
+            continue;
+        }
+
+        size_t path_len = strlen(cache->disk_path) + 1 + name_len + 1;
+        char* path = (char*)malloc(path_len);
+        if (!path) {
+            continue;
+        }
+        snprintf(path, path_len, "%s/%s", cache->disk_path, ent->d_name);
+
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            free(path);
+            continue;
+        }
+        total += (size_t)st.st_size;
+
+        if (count >= capacity) {
+            size_t new_capacity = capacity ? capacity * 2 : 64;
+            DiskFile* grown = (DiskFile*)realloc(files, new_capacity * sizeof(DiskFile));
+            if (!grown) {
+                free(path);
+                continue;
+            }
+            files = grown;
+            capacity = new_capacity;
+        }
+        files[count].path = path;
+        files[count].mtime = st.st_mtime;
+        files[count].size = (size_t)st.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    if (enforce_budget && total > cache->disk_budget) {
+        qsort(files, count, sizeof(DiskFile), compare_disk_files);
+        for (size_t i = 0; i < count && total > cache->disk_budget; i++) {
+            if (unlink(files[i].path) == 0) {
+                total -= files[i].size;
+                (*evicted)++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        free(files[i].path);
+    }
+    free(files);
+
+    return total;
+}
+
+// Write a cache file; returns its size, or 0 if nothing was written
+static size_t disk_store(const JSBytecodeCache* cache, JSBytecodeKey key, const uint8_t* data, size_t size) {
+    char* path = cache_file_path(cache, key, FILE_SUFFIX);
+    char* tmp_path = cache_file_path(cache, key, FILE_SUFFIX ".XXXXXX");
+    if (!path || !tmp_path) {
+        free(path);
+        free(tmp_path);
+        return 0;
+    }
+
+    CacheFileHeader header;
+    header_init(&header, key, size);
+
+    // Write to a temporary file and rename so readers never see partial
+    // files; the name is unique so writers of the same script never share it
+    int fd = mkstemp(tmp_path);
+    FILE* file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    int ok = file != NULL;
+    if (file) {
+        ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+             fwrite(data, 1, size, file) == size;
+        ok = fclose(file) == 0 && ok;
+    } else if (fd >= 0) {
+        close(fd);
+    }
+
+    size_t written = 0;
+    if (ok && rename(tmp_path, path) == 0) {
+        written = sizeof(header) + size;
+    } else if (fd >= 0) {
+        unlink(tmp_path);
+    }
+
+    free(path);
+    free(tmp_path);
+    return written;
+}
+
+// Public API
+
+JSBytecodeCache* js_bytecode_cache_create(const JSBytecodeCacheConfig* config) {
+    JSBytecodeCache* cache = (JSBytecodeCache*)calloc(1, sizeof(JSBytecodeCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->memory_budget = DEFAULT_MEMORY_BUDGET;
+    cache->disk_budget = DEFAULT_DISK_BUDGET;
+
+    if (config) {
+        if (config->memory_budget) {
+            cache->memory_budget = config->memory_budget;
+        }
+        if (config->disk_budget) {
+            cache->disk_budget = config->disk_budget;
+        }
+        if (config->disk_path) {
+            cache->disk_path = strdup(config->disk_path);
+            if (!cache->disk_path) {
+                pthread_mutex_destroy(&cache->lock);
+                free(cache);
+                return NULL;
+            }
+            mkdir(cache->disk_path, 0755);
+            cache->stats.disk_bytes = disk_scan(cache, 1, &cache->stats.evictions);
+        }
+    }
+
+    return cache;
+}
+
+void js_bytecode_cache_destroy(JSBytecodeCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    JSBytecodeEntry* entry = cache->lru_head;
+    while (entry) {
+        JSBytecodeEntry* next = entry->lru_next;
+        entry_free(entry);
+        entry = next;
+    }
+
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->disk_path);
+    free(cache);
+}
+
+JSBytecodeEntry* js_bytecode_cache_acquire(JSBytecodeCache* cache, JSBytecodeKey key) {
+    if (!cache) {
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    JSBytecodeEntry* entry = memory_find(cache, key);
+    if (entry || !cache->disk_path) {
+        if (entry) {
+            lru_unlink(cache, entry);
+            lru_push_front(cache, entry);
+            entry->refcount++;
+            cache->stats.memory_hits++;
+        } else {
+            cache->stats.misses++;
+        }
+        pthread_mutex_unlock(&cache->lock);
+        return entry;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    size_t removed = 0;
+    JSBytecodeEntry* loaded = disk_load(cache, key, &removed);
+
+    pthread_mutex_lock(&cache->lock);
+    if (cache->stats.disk_bytes >= removed) {
+        cache->stats.disk_bytes -= removed;
+    }
+    entry = memory_find(cache, key);
+    if (entry) {
+        // Loaded or stored by another thread meanwhile
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+        cache->stats.memory_hits++;
+    } else if (loaded) {
+        entry = loaded;
+        loaded = NULL;
+        memory_insert(cache, entry);
+        cache->stats.disk_hits++;
+    } else {
+        cache->stats.misses++;
+    }
+    if (entry) {
+        entry->refcount++;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    if (loaded) {
+        entry_free(loaded);
+    }
+    return entry;
+}
+
+const uint8_t* js_bytecode_entry_data(const JSBytecodeEntry* entry, size_t* size) {
+    if (!entry) {
+        return NULL;
+    }
+    if (size) {
+        *size = entry->size;
+    }
+    return entry->data;
+}
+
+void js_bytecode_cache_release(JSBytecodeCache* cache, JSBytecodeEntry* entry) {
+    if (!cache || !entry) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    entry->refcount--;
+    if (entry->refcount == 0 && entry->evicted) {
+        entry_free(entry);
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+int js_bytecode_cache_store(JSBytecodeCache* cache, JSBytecodeKey key, const uint8_t* data, size_t size) {
+    if (!cache || !data || size == 0) {
+        return -1;
+    }
+
+    JSBytecodeEntry* entry = (JSBytecodeEntry*)calloc(1, sizeof(JSBytecodeEntry));
+    uint8_t* copy = (uint8_t*)malloc(size);
+    if (!entry || !copy) {
+        free(entry);
+        free(copy);
+        return -1;
+    }
+    memcpy(copy, data, size);
+
+    entry->key = key;
+    entry->data = copy;
+    entry->size = size;
+
+    pthread_mutex_lock(&cache->lock);
+
+    JSBytecodeEntry* existing = memory_find(cache, key);
+    if (existing) {
+        memory_remove(cache, existing);
+    }
+    memory_insert(cache, entry);
+    cache->stats.stores++;
+    pthread_mutex_unlock(&cache->lock);
+
+    if (!cache->disk_path) {
+        return 0;
+    }
+
+    size_t written = disk_store(cache, key, data, size);
+    if (written == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    cache->stats.disk_bytes += written;
+    int over_budget = cache->stats.disk_bytes > cache->disk_budget;
+    pthread_mutex_unlock(&cache->lock);
+
+    if (over_budget) {
+        size_t evicted = 0;
+        size_t total = disk_scan(cache, 1, &evicted);
+        pthread_mutex_lock(&cache->lock);
+        cache->stats.disk_bytes = total;
+        cache->stats.evictions += evicted;
+        pthread_mutex_unlock(&cache->lock);
+    }
+    return 0;
+}
+
+void js_bytecode_cache_get_stats(JSBytecodeCache* cache, JSBytecodeCacheStats* stats) {
+    if (!cache || !stats) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
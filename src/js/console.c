@@ -0,0 +1,181 @@
+#include "js_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// Console
+// Messages are formatted straight into a bounded per-engine buffer and
+// handed to the sink in one batch when the script or task finishes, so a
+// chatty page costs one sink call (one stdio write by default) per batch
+// instead of several per console call. A message that does not fit is
+// dropped and counted.
+
+#define JS_CONSOLE_DEFAULT_CAPACITY (64 * 1024)
+
+static int console_reserve_records(JSConsole* console) {
+    if (console->record_count < console->record_capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = console->record_capacity ? console->record_capacity * 2 : 64;
+    JSConsoleRecord* records = (JSConsoleRecord*)realloc(console->records, new_capacity * sizeof(JSConsoleRecord));
+    if (!records) {
+        return -1;
+    }
+    console->records = records;
+    console->record_capacity = new_capacity;
+    return 0;
+}
+
+static JSValue js_console_write(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic) {
+    JSEngine* engine = (JSEngine*)JS_GetContextOpaque(ctx);
+    JSConsole* console = &engine->console;
+
+    if (!console->text || console_reserve_records(console) != 0) {
+        console->dropped++;
+        return JS_UNDEFINED;
+    }
+
+    // Arguments are joined with spaces and the message ends with a newline
+    size_t start = console->text_used;
+    size_t pos = start;
+    int fits = 1;
+    for (int i = 0; i < argc && fits; i++) {
+        size_t len;
+        const char* str = JS_ToCStringLen(ctx, &len, argv[i]);
+        if (!str) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+            continue;
+        }
+        size_t needed = len + (pos > start ? 1 : 0);
+        if (pos + needed + 1 > console->capacity) {
+            fits = 0;
+        } else {
+            if (pos > start) {
+                console->text[pos++] = ' ';
+            }
+            memcpy(console->text + pos, str, len);
+            pos += len;
+        }
+        JS_FreeCString(ctx, str);
+    }
+
+    if (!fits || pos + 1 > console->capacity) {
+        console->dropped++;
+        return JS_UNDEFINED;
+    }
+
+    console->text[pos++] = '\n';
+    JSConsoleRecord* record = &console->records[console->record_count++];
+    record->level = (JSConsoleLevel)magic;
+    record->offset = start;
+    record->length = pos - start - 1;
+    console->text_used = pos;
+
+    return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry js_console_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("debug", 1, js_console_write, JS_CONSOLE_DEBUG),
+    JS_CFUNC_MAGIC_DEF("log", 1, js_console_write, JS_CONSOLE_LOG),
+    JS_CFUNC_MAGIC_DEF("info", 1, js_console_write, JS_CONSOLE_LOG),
+    JS_CFUNC_MAGIC_DEF("warn", 1, js_console_write, JS_CONSOLE_WARN),
+    JS_CFUNC_MAGIC_DEF("error", 1, js_console_write, JS_CONSOLE_ERROR),
+};
+
+int js_console_init(JSEngine* engine) {
+    JSContext* ctx = engine->context;
+    JSConsole* console = &engine->console;
+
+    // The buffer outlives context resets
+    if (!console->text) {
+        if (console->capacity == 0) {
+            console->capacity = JS_CONSOLE_DEFAULT_CAPACITY;
+        }
+        console->text = (char*)malloc(console->capacity);
+        if (!console->text) {
+            return -1;
+        }
+    }
+
+    JSValue console_obj = JS_NewObject(ctx);
+    if (JS_IsException(console_obj)) {
+        return -1;
+    }
+    JS_SetPropertyFunctionList(ctx, console_obj, js_console_funcs,
+                               sizeof(js_console_funcs) / sizeof(js_console_funcs[0]));
+
+    JSValue global = JS_GetGlobalObject(ctx);
+    JS_SetPropertyStr(ctx, global, "console", console_obj);
+    JS_FreeValue(ctx, global);
+
+    return 0;
+}
+
+void js_console_free(JSEngine* engine) {
+    JSConsole* console = &engine->console;
+
+    js_engine_flush_console(engine);
+    free(console->text);
+    free(console->records);
+    memset(console, 0, sizeof(*console));
+}
+
+int js_engine_flush_console(JSEngine* engine) {
+    if (!engine) {
+        return -1;
+    }
+
+    JSConsole* console = &engine->console;
+    if (console->record_count == 0) {
+        return 0;
+    }
+
+    if (console->sink) {
+        for (size_t i = 0; i < console->record_count; i++) {
+            const JSConsoleRecord* record = &console->records[i];
+            console->sink(record->level, console->text + record->offset, record->length, console->user_data);
+        }
+    } else {
+        // Every message already ends in a newline: one write for the batch
+        fwrite(console->text, 1, console->text_used, stdout);
+    }
+
+    console->text_used = 0;
+    console->record_count = 0;
+    return 0;
+}
+
+int js_engine_set_console_sink(JSEngine* engine, JSConsoleSink sink, void* user_data, size_t capacity) {
+    if (!engine) {
+        return -1;
+    }
+
+    JSConsole* console = &engine->console;
+
+    // Pending messages go to the sink they were written under
+    js_engine_flush_console(engine);
+
+    if (capacity == 0) {
+        capacity = JS_CONSOLE_DEFAULT_CAPACITY;
+    }
+    if (capacity != console->capacity) {
+        char* text = (char*)realloc(console->text, capacity);
+        if (!text) {
+            return -1;
+        }
+        console->text = text;
+        console->capacity = capacity;
+    }
+
+    console->sink = sink;
+    console->user_data = user_data;
+    return 0;
+}
+
+uint64_t js_engine_console_dropped(JSEngine* engine) {
+    if (!engine) {
+        return 0;
+    }
+    return engine->console.dropped;
+}
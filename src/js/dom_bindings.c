@@ -0,0 +1,999 @@
+#include "js_internal.h"
+#include "dom/dom.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+
+#define countof(x) (sizeof(x) / sizeof((x)[0]))
+
+// DOM bindings
+// Node wrappers share one prototype chain: Element, Text and Document
+// prototypes inherit from a common Node prototype. Collections are live
+// views backed by DOMCollection; indexed access goes through an exotic
+// get_own_property hook so nothing is materialized until it is read.
+
+// Class IDs are process-wide; classes and prototypes are registered per
+// runtime and per context. Wrappers keep the native pointer as opaque.
+static JSClassID js_document_class_id;
+static JSClassID js_element_class_id;
+static JSClassID js_text_class_id;
+static JSClassID js_collection_class_id;
+static pthread_once_t js_class_ids_once = PTHREAD_ONCE_INIT;
+
+// A collection wrapper holds the root's wrapper so the root node stays
+// alive (and bound) for as long as the collection can be read
+typedef struct {
+    DOMCollection* collection;
+    JSValue root;
+} JSDOMCollection;
+
+// Magic values for the tree navigation getters
+enum {
+    JS_NODE_PARENT,
+    JS_NODE_FIRST_CHILD,
+    JS_NODE_LAST_CHILD,
+    JS_NODE_PREVIOUS_SIBLING,
+    JS_NODE_NEXT_SIBLING,
+};
+
+static void js_document_finalizer(JSRuntime* rt, JSValue val);
+static void js_element_finalizer(JSRuntime* rt, JSValue val);
+static void js_text_finalizer(JSRuntime* rt, JSValue val);
+static void js_collection_finalizer(JSRuntime* rt, JSValue val);
+static void js_collection_mark(JSRuntime* rt, JSValueConst val, JS_MarkFunc* mark_func);
+static int js_collection_get_own_property(JSContext* ctx, JSPropertyDescriptor* desc, JSValueConst obj, JSAtom prop);
+static int js_collection_get_own_property_names(JSContext* ctx, JSPropertyEnum** ptab, uint32_t* plen, JSValueConst obj);
+
+static JSClassDef js_document_class = {
+    .class_name = "Document",
+    .finalizer = js_document_finalizer,
+};
+
+static JSClassDef js_element_class = {
+    .class_name = "Element",
+    .finalizer = js_element_finalizer,
+};
+
+static JSClassDef js_text_class = {
+    .class_name = "Text",
+    .finalizer = js_text_finalizer,
+};
+
+static JSClassExoticMethods js_collection_exotic = {
+    .get_own_property = js_collection_get_own_property,
+    .get_own_property_names = js_collection_get_own_property_names,
+};
+
+static JSClassDef js_collection_class = {
+    .class_name = "HTMLCollection",
+    .finalizer = js_collection_finalizer,
+    .gc_mark = js_collection_mark,
+    .exotic = &js_collection_exotic,
+};
+
+// Forward declarations for DOM bindings
+static JSValue js_document_create_element(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_document_get_element_by_id(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_document_query_selector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_document_get_document_element(JSContext *ctx, JSValueConst this_val);
+static JSValue js_document_create_text_node(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_set_attribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_get_attribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_set_inner_html(JSContext *ctx, JSValueConst this_val, JSValueConst val);
+static JSValue js_element_query_selector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_insert_adjacent_html(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_element_get_tag_name(JSContext *ctx, JSValueConst this_val);
+static JSValue js_node_get_relative(JSContext *ctx, JSValueConst this_val, int magic);
+static JSValue js_node_get_collection(JSContext *ctx, JSValueConst this_val, int magic);
+static JSValue js_node_get_elements_by(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic);
+static JSValue js_node_get_node_type(JSContext *ctx, JSValueConst this_val);
+static JSValue js_node_get_node_name(JSContext *ctx, JSValueConst this_val);
+static JSValue js_node_get_text_content(JSContext *ctx, JSValueConst this_val);
+static JSValue js_node_set_text_content(JSContext *ctx, JSValueConst this_val, JSValueConst val);
+static JSValue js_node_append_child(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_node_insert_before(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_node_remove_child(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+static JSValue js_collection_get_length(JSContext *ctx, JSValueConst this_val);
+static JSValue js_collection_item(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+
+static const JSCFunctionListEntry js_node_proto_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("parentNode", js_node_get_relative, NULL, JS_NODE_PARENT),
+    JS_CGETSET_MAGIC_DEF("firstChild", js_node_get_relative, NULL, JS_NODE_FIRST_CHILD),
+    JS_CGETSET_MAGIC_DEF("lastChild", js_node_get_relative, NULL, JS_NODE_LAST_CHILD),
+    JS_CGETSET_MAGIC_DEF("previousSibling", js_node_get_relative, NULL, JS_NODE_PREVIOUS_SIBLING),
+    JS_CGETSET_MAGIC_DEF("nextSibling", js_node_get_relative, NULL, JS_NODE_NEXT_SIBLING),
+    JS_CGETSET_MAGIC_DEF("childNodes", js_node_get_collection, NULL, DOM_COLLECTION_CHILD_NODES),
+    JS_CGETSET_DEF("nodeType", js_node_get_node_type, NULL),
+    JS_CGETSET_DEF("nodeName", js_node_get_node_name, NULL),
+    JS_CGETSET_DEF("textContent", js_node_get_text_content, js_node_set_text_content),
+    JS_CFUNC_DEF("appendChild", 1, js_node_append_child),
+    JS_CFUNC_DEF("insertBefore", 2, js_node_insert_before),
+    JS_CFUNC_DEF("removeChild", 1, js_node_remove_child),
+};
+
+static const JSCFunctionListEntry js_document_proto_funcs[] = {
+    JS_CFUNC_DEF("createElement", 1, js_document_create_element),
+    JS_CFUNC_DEF("createTextNode", 1, js_document_create_text_node),
+    JS_CFUNC_DEF("getElementById", 1, js_document_get_element_by_id),
+    JS_CFUNC_DEF("querySelector", 1, js_document_query_selector),
+    JS_CFUNC_MAGIC_DEF("getElementsByTagName", 1, js_node_get_elements_by, DOM_COLLECTION_BY_TAG_NAME),
+    JS_CFUNC_MAGIC_DEF("getElementsByClassName", 1, js_node_get_elements_by, DOM_COLLECTION_BY_CLASS_NAME),
+    JS_CGETSET_MAGIC_DEF("children", js_node_get_collection, NULL, DOM_COLLECTION_CHILDREN),
+    JS_CGETSET_DEF("documentElement", js_document_get_document_element, NULL),
+};
+
+static const JSCFunctionListEntry js_element_proto_funcs[] = {
+    JS_CFUNC_DEF("setAttribute", 2, js_element_set_attribute),
+    JS_CFUNC_DEF("getAttribute", 1, js_element_get_attribute),
+    JS_CFUNC_DEF("querySelector", 1, js_element_query_selector),
+    JS_CFUNC_DEF("insertAdjacentHTML", 2, js_element_insert_adjacent_html),
+    JS_CFUNC_MAGIC_DEF("getElementsByTagName", 1, js_node_get_elements_by, DOM_COLLECTION_BY_TAG_NAME),
+    JS_CFUNC_MAGIC_DEF("getElementsByClassName", 1, js_node_get_elements_by, DOM_COLLECTION_BY_CLASS_NAME),
+    JS_CGETSET_MAGIC_DEF("children", js_node_get_collection, NULL, DOM_COLLECTION_CHILDREN),
+    JS_CGETSET_DEF("tagName", js_element_get_tag_name, NULL),
+    JS_CGETSET_DEF("innerHTML", NULL, js_element_set_inner_html),
+};
+
+static const JSCFunctionListEntry js_collection_proto_funcs[] = {
+    JS_CGETSET_DEF("length", js_collection_get_length, NULL),
+    JS_CFUNC_DEF("item", 1, js_collection_item),
+};
+
+static void js_class_ids_init(void) {
+    JS_NewClassID(&js_document_class_id);
+    JS_NewClassID(&js_element_class_id);
+    JS_NewClassID(&js_text_class_id);
+    JS_NewClassID(&js_collection_class_id);
+}
+
+static int js_class_register(JSRuntime* rt, JSClassID class_id, const JSClassDef* class_def) {
+    if (JS_IsRegisteredClass(rt, class_id)) {
+        return 0;
+    }
+    return JS_NewClass(rt, class_id, class_def);
+}
+
+// Make collections iterable with the generic array-like methods
+static int js_collection_proto_init(JSContext* ctx, JSValueConst proto) {
+    JSValue global = JS_GetGlobalObject(ctx);
+    JSValue array = JS_GetPropertyStr(ctx, global, "Array");
+    JSValue array_proto = JS_GetPropertyStr(ctx, array, "prototype");
+    JSValue symbol = JS_GetPropertyStr(ctx, global, "Symbol");
+    JSValue iterator = JS_GetPropertyStr(ctx, symbol, "iterator");
+    JSAtom iterator_atom = JS_ValueToAtom(ctx, iterator);
+    int result = -1;
+
+    if (iterator_atom != JS_ATOM_NULL &&
+        JS_DefinePropertyValue(ctx, proto, iterator_atom, JS_GetPropertyStr(ctx, array_proto, "values"),
+                               JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE) >= 0 &&
+        JS_DefinePropertyValueStr(ctx, proto, "forEach", JS_GetPropertyStr(ctx, array_proto, "forEach"),
+                                  JS_PROP_WRITABLE | JS_PROP_CONFIGURABLE) >= 0) {
+        result = 0;
+    }
+
+    JS_FreeAtom(ctx, iterator_atom);
+    JS_FreeValue(ctx, iterator);
+    JS_FreeValue(ctx, symbol);
+    JS_FreeValue(ctx, array_proto);
+    JS_FreeValue(ctx, array);
+    JS_FreeValue(ctx, global);
+    return result;
+}
+
+// Register DOM classes on the runtime and install shared prototypes once
+int js_dom_classes_init(JSContext* ctx) {
+    JSRuntime* rt = JS_GetRuntime(ctx);
+
+    pthread_once(&js_class_ids_once, js_class_ids_init);
+
+    if (js_class_register(rt, js_document_class_id, &js_document_class) != 0 ||
+        js_class_register(rt, js_element_class_id, &js_element_class) != 0 ||
+        js_class_register(rt, js_text_class_id, &js_text_class) != 0 ||
+        js_class_register(rt, js_collection_class_id, &js_collection_class) != 0) {
+        return -1;
+    }
+
+    JSValue node_proto = JS_NewObject(ctx);
+    if (JS_IsException(node_proto)) {
+        return -1;
+    }
+    JS_SetPropertyFunctionList(ctx, node_proto, js_node_proto_funcs, countof(js_node_proto_funcs));
+
+    JSValue document_proto = JS_NewObjectProto(ctx, node_proto);
+    JSValue element_proto = JS_NewObjectProto(ctx, node_proto);
+    JSValue text_proto = JS_NewObjectProto(ctx, node_proto);
+    JSValue collection_proto = JS_NewObject(ctx);
+    JS_FreeValue(ctx, node_proto);
+
+    if (JS_IsException(document_proto) || JS_IsException(element_proto) ||
+        JS_IsException(text_proto) || JS_IsException(collection_proto)) {
+        JS_FreeValue(ctx, document_proto);
+        JS_FreeValue(ctx, element_proto);
+        JS_FreeValue(ctx, text_proto);
+        JS_FreeValue(ctx, collection_proto);
+        return -1;
+    }
+
+    JS_SetPropertyFunctionList(ctx, document_proto, js_document_proto_funcs, countof(js_document_proto_funcs));
+    JS_SetPropertyFunctionList(ctx, element_proto, js_element_proto_funcs, countof(js_element_proto_funcs));
+    JS_SetPropertyFunctionList(ctx, collection_proto, js_collection_proto_funcs, countof(js_collection_proto_funcs));
+    if (js_collection_proto_init(ctx, collection_proto) != 0) {
+        JS_FreeValue(ctx, document_proto);
+        JS_FreeValue(ctx, element_proto);
+        JS_FreeValue(ctx, text_proto);
+        JS_FreeValue(ctx, collection_proto);
+        return -1;
+    }
+
+    JS_SetClassProto(ctx, js_document_class_id, document_proto);
+    JS_SetClassProto(ctx, js_element_class_id, element_proto);
+    JS_SetClassProto(ctx, js_text_class_id, text_proto);
+    JS_SetClassProto(ctx, js_collection_class_id, collection_proto);
+
+    return 0;
+}
+
+// Return the node's wrapper, creating it on first use. The node keeps a
+// weak back-reference so the same object is returned while it lives.
+static JSValue js_node_wrap(JSContext* ctx, DOMNode* node) {
+    if (!node) {
+        return JS_NULL;
+    }
+
+    void* binding = dom_node_get_binding(node);
+    if (binding) {
+        return JS_DupValue(ctx, JS_MKPTR(JS_TAG_OBJECT, binding));
+    }
+
+    JSClassID class_id;
+    switch (dom_node_get_type(node)) {
+        case NODE_ELEMENT:
+            class_id = js_element_class_id;
+            break;
+        case NODE_DOCUMENT:
+            class_id = js_document_class_id;
+            break;
+        default:
+            class_id = js_text_class_id;
+            break;
+    }
+
+    JSValue obj = JS_NewObjectClass(ctx, class_id);
+    if (JS_IsException(obj)) {
+        return obj;
+    }
+    JS_SetOpaque(obj, node);
+    dom_node_set_binding(node, JS_VALUE_GET_PTR(obj));
+    return obj;
+}
+
+// Get the node behind any node wrapper
+static DOMNode* js_node_unwrap(JSContext* ctx, JSValueConst val) {
+    DOMNode* node = JS_GetOpaque(val, js_element_class_id);
+    if (!node) {
+        node = JS_GetOpaque(val, js_text_class_id);
+    }
+    if (!node) {
+        node = JS_GetOpaque(val, js_document_class_id);
+    }
+    if (!node) {
+        JS_ThrowTypeError(ctx, "not a Node");
+    }
+    return node;
+}
+
+// Last reference to the wrapper is gone: detached trees nobody can reach
+// any more are reclaimed here
+static void js_node_finalize(JSValue val, JSClassID class_id) {
+    DOMNode* node = JS_GetOpaque(val, class_id);
+    if (node) {
+        dom_node_set_binding(node, NULL);
+        dom_node_release(node);
+    }
+}
+
+static void js_element_finalizer(JSRuntime* rt, JSValue val) {
+    js_node_finalize(val, js_element_class_id);
+}
+
+static void js_text_finalizer(JSRuntime* rt, JSValue val) {
+    js_node_finalize(val, js_text_class_id);
+}
+
+// The document is owned by the browser engine; only the binding goes
+static void js_document_finalizer(JSRuntime* rt, JSValue val) {
+    DOMNode* node = JS_GetOpaque(val, js_document_class_id);
+    if (node && dom_node_get_binding(node) == JS_VALUE_GET_PTR(val)) {
+        dom_node_set_binding(node, NULL);
+    }
+}
+
+// Cached attribute and text strings hold a reference on the runtime
+static void js_dom_release_string(void* value, void* user_data) {
+    JS_FreeValueRT((JSRuntime*)user_data, JS_MKPTR(JS_TAG_STRING, value));
+}
+
+void js_dom_unbind(JSEngine* engine) {
+    if (engine->bound_document) {
+        dom_document_set_script_cache(engine->bound_document, NULL, NULL);
+        engine->bound_document = NULL;
+    }
+}
+
+int js_engine_bind_dom(JSEngine* engine, DOMDocument* document) {
+    if (!engine || !document) {
+        return -1;
+    }
+
+    if (engine->bound_document != document) {
+        js_dom_unbind(engine);
+    }
+    engine->bound_document = document;
+    dom_document_set_script_cache(document, js_dom_release_string, engine->runtime);
+
+    // Create document object
+    JSValue global = JS_GetGlobalObject(engine->context);
+    JSValue doc_obj = js_node_wrap(engine->context, (DOMNode*)document);
+    if (JS_IsException(doc_obj)) {
+        JS_FreeValue(engine->context, global);
+        return -1;
+    }
+
+    // Set as global document
+    JS_SetPropertyStr(engine->context, global, "document", doc_obj);
+    JS_FreeValue(engine->context, global);
+
+    return 0;
+}
+
+// Live collections
+
+static JSValue js_collection_new(JSContext* ctx, JSValueConst root_obj, DOMNode* root,
+                                 DOMCollectionKind kind, const char* name) {
+    JSDOMCollection* wrapper = (JSDOMCollection*)malloc(sizeof(JSDOMCollection));
+    if (!wrapper) {
+        return JS_ThrowOutOfMemory(ctx);
+    }
+
+    wrapper->collection = dom_collection_create(root, kind, name);
+    if (!wrapper->collection) {
+        free(wrapper);
+        return JS_ThrowOutOfMemory(ctx);
+    }
+
+    JSValue obj = JS_NewObjectClass(ctx, js_collection_class_id);
+    if (JS_IsException(obj)) {
+        dom_collection_destroy(wrapper->collection);
+        free(wrapper);
+        return obj;
+    }
+
+    wrapper->root = JS_DupValue(ctx, root_obj);
+    JS_SetOpaque(obj, wrapper);
+    return obj;
+}
+
+static void js_collection_finalizer(JSRuntime* rt, JSValue val) {
+    JSDOMCollection* wrapper = JS_GetOpaque(val, js_collection_class_id);
+    if (wrapper) {
+        dom_collection_destroy(wrapper->collection);
+        JS_FreeValueRT(rt, wrapper->root);
+        free(wrapper);
+    }
+}
+
+static void js_collection_mark(JSRuntime* rt, JSValueConst val, JS_MarkFunc* mark_func) {
+    JSDOMCollection* wrapper = JS_GetOpaque(val, js_collection_class_id);
+    if (wrapper) {
+        JS_MarkValue(rt, wrapper->root, mark_func);
+    }
+}
+
+// Indexed reads resolve against the live collection; every other property
+// falls through to the prototype
+static int js_collection_get_own_property(JSContext* ctx, JSPropertyDescriptor* desc, JSValueConst obj, JSAtom prop) {
+    JSDOMCollection* wrapper = JS_GetOpaque(obj, js_collection_class_id);
+    if (!wrapper) {
+        return 0;
+    }
+
+    // Array index atoms come back as integers
+    JSValue key = JS_AtomToValue(ctx, prop);
+    if (JS_VALUE_GET_TAG(key) != JS_TAG_INT) {
+        JS_FreeValue(ctx, key);
+        return 0;
+    }
+    int32_t index = JS_VALUE_GET_INT(key);
+    if (index < 0) {
+        return 0;
+    }
+
+    DOMNode* node = dom_collection_item(wrapper->collection, (size_t)index);
+    if (!node) {
+        return 0;
+    }
+
+    if (desc) {
+        JSValue value = js_node_wrap(ctx, node);
+        if (JS_IsException(value)) {
+            return -1;
+        }
+        desc->flags = JS_PROP_ENUMERABLE;
+        desc->value = value;
+        desc->getter = JS_UNDEFINED;
+        desc->setter = JS_UNDEFINED;
+    }
+    return 1;
+}
+
+static int js_collection_get_own_property_names(JSContext* ctx, JSPropertyEnum** ptab, uint32_t* plen, JSValueConst obj) {
+    JSDOMCollection* wrapper = JS_GetOpaque(obj, js_collection_class_id);
+    size_t length = wrapper ? dom_collection_length(wrapper->collection) : 0;
+
+    JSPropertyEnum* tab = js_malloc(ctx, sizeof(JSPropertyEnum) * (length ? length : 1));
+    if (!tab) {
+        return -1;
+    }
+    for (size_t i = 0; i < length; i++) {
+        tab[i].is_enumerable = 1;
+        tab[i].atom = JS_NewAtomUInt32(ctx, (uint32_t)i);
+    }
+
+    *ptab = tab;
+    *plen = (uint32_t)length;
+    return 0;
+}
+
+static JSValue js_collection_get_length(JSContext *ctx, JSValueConst this_val) {
+    JSDOMCollection* wrapper = JS_GetOpaque2(ctx, this_val, js_collection_class_id);
+    if (!wrapper) {
+        return JS_EXCEPTION;
+    }
+
+    return JS_NewInt64(ctx, (int64_t)dom_collection_length(wrapper->collection));
+}
+
+static JSValue js_collection_item(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    JSDOMCollection* wrapper = JS_GetOpaque2(ctx, this_val, js_collection_class_id);
+    if (!wrapper) {
+        return JS_EXCEPTION;
+    }
+
+    int64_t index = 0;
+    if (argc > 0 && JS_ToInt64(ctx, &index, argv[0]) != 0) {
+        return JS_EXCEPTION;
+    }
+    if (index < 0) {
+        return JS_NULL;
+    }
+
+    return js_node_wrap(ctx, dom_collection_item(wrapper->collection, (size_t)index));
+}
+
+// DOM binding implementations
+// Strings cross the boundary with explicit lengths. Attribute values and
+// text node data are cached as JS strings on the DOM, so repeated reads of
+// an unchanged value return the same string without copying.
+
+// Hand the DOM a reference to a string it is about to cache
+static void* js_string_retain(JSContext* ctx, JSValueConst str) {
+    return JS_VALUE_GET_PTR(JS_DupValue(ctx, str));
+}
+
+static JSValue js_text_node_data(JSContext *ctx, DOMNode* node) {
+    void* cached = dom_node_get_script_value(node);
+    if (cached) {
+        return JS_DupValue(ctx, JS_MKPTR(JS_TAG_STRING, cached));
+    }
+
+    size_t length;
+    const char* data = dom_node_get_value(node, &length);
+    JSValue result = JS_NewStringLen(ctx, data, length);
+    if (JS_VALUE_GET_TAG(result) == JS_TAG_STRING) {
+        void* retained = js_string_retain(ctx, result);
+        if (dom_node_set_script_value(node, retained) != 0) {
+            JS_FreeValue(ctx, result);
+        }
+    }
+    return result;
+}
+
+static JSValue js_node_get_relative(JSContext *ctx, JSValueConst this_val, int magic) {
+    DOMNode* node = js_node_unwrap(ctx, this_val);
+    if (!node) {
+        return JS_EXCEPTION;
+    }
+
+    switch (magic) {
+        case JS_NODE_PARENT:
+            return js_node_wrap(ctx, dom_node_get_parent(node));
+        case JS_NODE_FIRST_CHILD:
+            return js_node_wrap(ctx, dom_node_get_first_child(node));
+        case JS_NODE_LAST_CHILD:
+            return js_node_wrap(ctx, dom_node_get_last_child(node));
+        case JS_NODE_PREVIOUS_SIBLING:
+            return js_node_wrap(ctx, dom_node_get_previous_sibling(node));
+        case JS_NODE_NEXT_SIBLING:
+            return js_node_wrap(ctx, dom_node_get_next_sibling(node));
+    }
+    return JS_NULL;
+}
+
+static JSValue js_node_get_collection(JSContext *ctx, JSValueConst this_val, int magic) {
+    DOMNode* node = js_node_unwrap(ctx, this_val);
+    if (!node) {
+        return JS_EXCEPTION;
+    }
+
+    return js_collection_new(ctx, this_val, node, (DOMCollectionKind)magic, NULL);
+}
+
+static JSValue js_node_get_elements_by(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv, int magic) {
+    DOMNode* node = js_node_unwrap(ctx, this_val);
+    if (!node) {
+        return JS_EXCEPTION;
+    }
+    if (argc < 1) {
+        return JS_ThrowTypeError(ctx, "missing argument");
+    }
+
+    const char* name = JS_ToCString(ctx, argv[0]);
+    if (!name) {
+        return JS_EXCEPTION;
+    }
+
+    JSValue collection = js_collection_new(ctx, this_val, node, (DOMCollectionKind)magic, name);
+    JS_FreeCString(ctx, name);
+    return collection;
+}
+
+static JSValue js_node_get_node_type(JSContext *ctx, JSValueConst this_val) {
+    DOMNode* node = js_node_unwrap(ctx, this_val);
+    if (!node) {
+        return JS_EXCEPTION;
+    }
+
+    return JS_NewInt32(ctx, (int32_t)dom_node_get_type(node));
+}
+
+// HTML element names are reported in upper case
+static JSValue js_new_upper_case_string(JSContext *ctx, const char* str) {
+    size_t length = strlen(str);
+    char* upper = (char*)malloc(length + 1);
+    if (!upper) {
+        return JS_ThrowOutOfMemory(ctx);
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        char c = str[i];
+        upper[i] = (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+    }
+    upper[length] = '\0';
+
+    JSValue result = JS_NewStringLen(ctx, upper, length);
+    free(upper);
+    return result;
+}
+
+static JSValue js_node_get_node_name(JSContext *ctx, JSValueConst this_val) {
+    DOMNode* node = js_node_unwrap(ctx, this_val);
+    if (!node) {
+        return JS_EXCEPTION;
+    }
+
+    const char* name = dom_node_get_name(node);
+    if (dom_node_get_type(node) == NODE_ELEMENT) {
+        return js_new_upper_case_string(ctx, name);
+    }
+    return JS_NewString(ctx, name);
+}
+
+static JSValue js_node_get_text_content(JSContext *ctx, JSValueConst this_val) {
+    DOMNode* node = js_node_unwrap(ctx, this_val);
+    if (!node) {
+        return JS_EXCEPTION;
+    }
+
+    // Documents have no text content of their own
+    DOMNodeType type = dom_node_get_type(node);
+    if (type == NODE_DOCUMENT) {
+        return JS_NULL;
+    }
+
+    // An element holding a single text node reads as that node's data
+    if (type == NODE_ELEMENT) {
+        DOMNode* child = dom_node_get_first_child(node);
+        if (child && child == dom_node_get_last_child(node) && dom_node_get_type(child) == NODE_TEXT) {
+            node = child;
+            type = NODE_TEXT;
+        }
+    }
+    if (type == NODE_TEXT) {
+        return js_text_node_data(ctx, node);
+    }
+
+    char* text = dom_node_get_text_content(node);
+    if (!text) {
+        return JS_ThrowOutOfMemory(ctx);
+    }
+
+    JSValue result = JS_NewString(ctx, text);
+    free(text);
+    return result;
+}
+
+static JSValue js_node_set_text_content(JSContext *ctx, JSValueConst this_val, JSValueConst val) {
+    DOMNode* node = js_node_unwrap(ctx, this_val);
+    if (!node) {
+        return JS_EXCEPTION;
+    }
+
+    if (dom_node_get_type(node) == NODE_DOCUMENT) {
+        return JS_UNDEFINED;
+    }
+
+    // null clears the node like the empty string
+    size_t length = 0;
+    const char* text = JS_IsNull(val) ? "" : JS_ToCStringLen(ctx, &length, val);
+    if (!text) {
+        return JS_EXCEPTION;
+    }
+
+    int result = dom_node_set_text_content_len(node, text, length);
+    if (!JS_IsNull(val)) {
+        JS_FreeCString(ctx, text);
+    }
+
+    return result == 0 ? JS_UNDEFINED : JS_ThrowOutOfMemory(ctx);
+}
+
+static JSValue js_node_append_child(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DOMNode* parent = js_node_unwrap(ctx, this_val);
+    if (!parent) {
+        return JS_EXCEPTION;
+    }
+    if (argc < 1) {
+        return JS_ThrowTypeError(ctx, "missing argument");
+    }
+
+    DOMNode* child = js_node_unwrap(ctx, argv[0]);
+    if (!child) {
+        return JS_EXCEPTION;
+    }
+
+    if (dom_node_append_child(parent, child) != 0) {
+        return JS_ThrowTypeError(ctx, "HierarchyRequestError: cannot append node here");
+    }
+
+    return JS_DupValue(ctx, argv[0]);
+}
+
+static JSValue js_node_insert_before(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DOMNode* parent = js_node_unwrap(ctx, this_val);
+    if (!parent) {
+        return JS_EXCEPTION;
+    }
+    if (argc < 1) {
+        return JS_ThrowTypeError(ctx, "missing argument");
+    }
+
+    DOMNode* child = js_node_unwrap(ctx, argv[0]);
+    if (!child) {
+        return JS_EXCEPTION;
+    }
+
+    DOMNode* reference = NULL;
+    if (argc > 1 && !JS_IsNull(argv[1]) && !JS_IsUndefined(argv[1])) {
+        reference = js_node_unwrap(ctx, argv[1]);
+        if (!reference) {
+            return JS_EXCEPTION;
+        }
+    }
+
+    if (dom_node_insert_before(parent, child, reference) != 0) {
+        return JS_ThrowTypeError(ctx, "HierarchyRequestError: cannot insert node here");
+    }
+
+    return JS_DupValue(ctx, argv[0]);
+}
+
+static JSValue js_node_remove_child(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DOMNode* parent = js_node_unwrap(ctx, this_val);
+    if (!parent) {
+        return JS_EXCEPTION;
+    }
+    if (argc < 1) {
+        return JS_ThrowTypeError(ctx, "missing argument");
+    }
+
+    DOMNode* child = js_node_unwrap(ctx, argv[0]);
+    if (!child) {
+        return JS_EXCEPTION;
+    }
+
+    if (dom_node_remove_child(parent, child) != 0) {
+        return JS_ThrowTypeError(ctx, "NotFoundError: node is not a child");
+    }
+
+    return JS_DupValue(ctx, argv[0]);
+}
+
+static JSValue js_document_get_document_element(JSContext *ctx, JSValueConst this_val) {
+    DOMDocument* doc = JS_GetOpaque2(ctx, this_val, js_document_class_id);
+    if (!doc) {
+        return JS_EXCEPTION;
+    }
+
+    return js_node_wrap(ctx, (DOMNode*)dom_document_get_element(doc));
+}
+
+static JSValue js_document_create_text_node(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DOMDocument* doc = JS_GetOpaque2(ctx, this_val, js_document_class_id);
+    if (!doc) {
+        return JS_EXCEPTION;
+    }
+    if (argc < 1) {
+        return JS_ThrowTypeError(ctx, "missing argument");
+    }
+
+    size_t length;
+    const char* text = JS_ToCStringLen(ctx, &length, argv[0]);
+    if (!text) {
+        return JS_EXCEPTION;
+    }
+
+    DOMNode* node = dom_document_create_text_node_len(doc, text, length);
+    JS_FreeCString(ctx, text);
+
+    if (!node) {
+        return JS_ThrowOutOfMemory(ctx);
+    }
+    return js_node_wrap(ctx, node);
+}
+
+static JSValue js_element_insert_adjacent_html(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    DOMElement* elem = JS_GetOpaque2(ctx, this_val, js_element_class_id);
+    if (!elem) {
+        return JS_EXCEPTION;
+    }
+    if (argc < 2) {
+        return JS_ThrowTypeError(ctx, "missing argument");
+    }
+
+    static const char* const positions[] = { "beforebegin", "afterbegin", "beforeend", "afterend" };
+    const char* where = JS_ToCString(ctx, argv[0]);
+    if (!where) {
+        return JS_EXCEPTION;
+    }
+    int position = -1;
+    for (int i = 0; i < (int)countof(positions); i++) {
+        if (strcasecmp(where, positions[i]) == 0) {
+            position = i;
+            break;
+        }
+    }
+    JS_FreeCString(ctx, where);
+    if (position < 0) {
+        return JS_ThrowSyntaxError(ctx, "insertAdjacentHTML: invalid position");
+    }
+
+    size_t html_len;
+    const char* html = JS_ToCStringLen(ctx, &html_len, argv[1]);
+    if (!html) {
+        return JS_EXCEPTION;
+    }
+
+    int result = dom_element_insert_adjacent_html(elem, (DOMAdjacentPosition)position, html, html_len);
+    JS_FreeCString(ctx, html);
+
+    if (result != 0) {
+        return JS_ThrowTypeError(ctx, "NoModificationAllowedError: no parent element");
+    }
+    return JS_UNDEFINED;
+}
+
+static JSValue js_element_get_tag_name(JSContext *ctx, JSValueConst this_val) {
+    DOMElement* elem = JS_GetOpaque2(ctx, this_val, js_element_class_id);
+    if (!elem) {
+        return JS_EXCEPTION;
+    }
+
+    return js_new_upper_case_string(ctx, dom_element_get_tag_name(elem));
+}
+
+static JSValue js_document_create_element(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    if (argc < 1) {
+        return JS_EXCEPTION;
+    }
+
+    DOMDocument* doc = JS_GetOpaque2(ctx, this_val, js_document_class_id);
+    if (!doc) {
+        return JS_EXCEPTION;
+    }
+
+    size_t tag_len;
+    const char* tag_name = JS_ToCStringLen(ctx, &tag_len, argv[0]);
+    if (!tag_name) {
+        return JS_EXCEPTION;
+    }
+
+    DOMElement* elem = dom_document_create_element_len(doc, tag_name, tag_len);
+    JS_FreeCString(ctx, tag_name);
+
+    if (!elem) {
+        return JS_NULL;
+    }
+
+    return js_node_wrap(ctx, (DOMNode*)elem);
+}
+
+static JSValue js_document_get_element_by_id(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    if (argc < 1) {
+        return JS_EXCEPTION;
+    }
+
+    DOMDocument* doc = JS_GetOpaque2(ctx, this_val, js_document_class_id);
+    if (!doc) {
+        return JS_EXCEPTION;
+    }
+
+    size_t id_len;
+    const char* id = JS_ToCStringLen(ctx, &id_len, argv[0]);
+    if (!id) {
+        return JS_EXCEPTION;
+    }
+
+    DOMElement* elem = dom_document_get_element_by_id_len(doc, id, id_len);
+    JS_FreeCString(ctx, id);
+
+    if (!elem) {
+        return JS_NULL;
+    }
+
+    return js_node_wrap(ctx, (DOMNode*)elem);
+}
+
+static JSValue js_element_set_attribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    if (argc < 2) {
+        return JS_EXCEPTION;
+    }
+
+    DOMElement* elem = JS_GetOpaque2(ctx, this_val, js_element_class_id);
+    if (!elem) {
+        return JS_EXCEPTION;
+    }
+
+    size_t name_len;
+    size_t value_len;
+    const char* name = JS_ToCStringLen(ctx, &name_len, argv[0]);
+    const char* value = JS_ToCStringLen(ctx, &value_len, argv[1]);
+
+    if (!name || !value) {
+        JS_FreeCString(ctx, name);
+        JS_FreeCString(ctx, value);
+        return JS_EXCEPTION;
+    }
+
+    int result = dom_element_set_attribute_len(elem, name, name_len, value, value_len);
+
+    JS_FreeCString(ctx, name);
+    JS_FreeCString(ctx, value);
+
+    return result == 0 ? JS_UNDEFINED : JS_EXCEPTION;
+}
+
+static JSValue js_element_get_attribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    if (argc < 1) {
+        return JS_EXCEPTION;
+    }
+
+    DOMElement* elem = JS_GetOpaque2(ctx, this_val, js_element_class_id);
+    if (!elem) {
+        return JS_EXCEPTION;
+    }
+
+    size_t name_len;
+    const char* name = JS_ToCStringLen(ctx, &name_len, argv[0]);
+    if (!name) {
+        return JS_EXCEPTION;
+    }
+
+    JSValue result;
+    void* cached = dom_element_get_attribute_script_value(elem, name, name_len);
+    if (cached) {
+        result = JS_DupValue(ctx, JS_MKPTR(JS_TAG_STRING, cached));
+    } else {
+        size_t value_len;
+        const char* value = dom_element_get_attribute_len(elem, name, name_len, &value_len);
+        if (!value) {
+            result = JS_NULL;
+        } else {
+            result = JS_NewStringLen(ctx, value, value_len);
+            if (JS_VALUE_GET_TAG(result) == JS_TAG_STRING) {
+                void* retained = js_string_retain(ctx, result);
+                if (dom_element_set_attribute_script_value(elem, name, name_len, retained) != 0) {
+                    JS_FreeValue(ctx, result);
+                }
+            }
+        }
+    }
+    JS_FreeCString(ctx, name);
+
+    return result;
+}
+
+static JSValue js_element_set_inner_html(JSContext *ctx, JSValueConst this_val, JSValueConst val) {
+    DOMElement* elem = JS_GetOpaque2(ctx, this_val, js_element_class_id);
+    if (!elem) {
+        return JS_EXCEPTION;
+    }
+
+    size_t html_len;
+    const char* html = JS_ToCStringLen(ctx, &html_len, val);
+    if (!html) {
+        return JS_EXCEPTION;
+    }
+
+    int result = dom_element_set_inner_html_len(elem, html, html_len);
+    JS_FreeCString(ctx, html);
+
+    return result == 0 ? JS_UNDEFINED : JS_EXCEPTION;
+}
+
+static JSValue js_document_query_selector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    if (argc < 1) {
+        return JS_EXCEPTION;
+    }
+
+    DOMDocument* doc = JS_GetOpaque2(ctx, this_val, js_document_class_id);
+    if (!doc) {
+        return JS_EXCEPTION;
+    }
+
+    const char* selector = JS_ToCString(ctx, argv[0]);
+    if (!selector) {
+        return JS_EXCEPTION;
+    }
+
+    // Start search from document element
+    DOMElement* doc_elem = dom_document_get_element(doc);
+    DOMElement* found = NULL;
+    
+    if (doc_elem) {
+        found = dom_element_query_selector(doc_elem, selector);
+    }
+    
+    JS_FreeCString(ctx, selector);
+
+    if (!found) {
+        return JS_NULL;
+    }
+
+    return js_node_wrap(ctx, (DOMNode*)found);
+}
+
+static JSValue js_element_query_selector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    if (argc < 1) {
+        return JS_EXCEPTION;
+    }
+
+    DOMElement* elem = JS_GetOpaque2(ctx, this_val, js_element_class_id);
+    if (!elem) {
+        return JS_EXCEPTION;
+    }
+
+    const char* selector = JS_ToCString(ctx, argv[0]);
+    if (!selector) {
+        return JS_EXCEPTION;
+    }
+
+    DOMElement* found = dom_element_query_selector(elem, selector);
+    JS_FreeCString(ctx, selector);
+
+    if (!found) {
+        return JS_NULL;
+    }
+
+    return js_node_wrap(ctx, (DOMNode*)found);
+}
@@ -0,0 +1,139 @@
+#include "js/engine_pool.h"
+#include "js/js_engine.h"
+#include <stdlib.h>
+#include <pthread.h>
+
+// Pool of ready-to-use engines
+// Engines are reset when they come back rather than when they go out, so
+// acquire is a pop off the idle stack. Each engine keeps its runtime for
+// life; only the context is rebuilt.
+
+struct JSEnginePool {
+    JSEngine** idle;
+    size_t idle_count;
+    size_t capacity;
+    size_t hits;
+    size_t misses;
+    size_t discarded;
+    JSEngineConfig config;
+    int has_config;
+    pthread_mutex_t lock;
+};
+
+static JSEngine* pool_new_engine(JSEnginePool* pool) {
+    return js_engine_init_with_config(pool->has_config ? &pool->config : NULL);
+}
+
+JSEnginePool* js_engine_pool_create(size_t capacity, size_t prewarm, const JSEngineConfig* config) {
+    if (capacity == 0) {
+        return NULL;
+    }
+
+    JSEnginePool* pool = (JSEnginePool*)calloc(1, sizeof(JSEnginePool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->idle = (JSEngine**)calloc(capacity, sizeof(JSEngine*));
+    if (!pool->idle) {
+        free(pool);
+        return NULL;
+    }
+    pool->capacity = capacity;
+    if (config) {
+        pool->config = *config;
+        pool->has_config = 1;
+    }
+    pthread_mutex_init(&pool->lock, NULL);
+
+    if (prewarm > capacity) {
+        prewarm = capacity;
+    }
+    for (size_t i = 0; i < prewarm; i++) {
+        JSEngine* engine = pool_new_engine(pool);
+        if (!engine) {
+            break;
+        }
+        pool->idle[pool->idle_count++] = engine;
+    }
+
+    return pool;
+}
+
+void js_engine_pool_destroy(JSEnginePool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    for (size_t i = 0; i < pool->idle_count; i++) {
+        js_engine_destroy(pool->idle[i]);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->idle);
+    free(pool);
+}
+
+JSEngine* js_engine_pool_acquire(JSEnginePool* pool) {
+    if (!pool) {
+        return NULL;
+    }
+
+    JSEngine* engine = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle_count > 0) {
+        engine = pool->idle[--pool->idle_count];
+        pool->hits++;
+    } else {
+        pool->misses++;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    if (!engine) {
+        engine = pool_new_engine(pool);
+    }
+    return engine;
+}
+
+void js_engine_pool_release(JSEnginePool* pool, JSEngine* engine) {
+    if (!engine) {
+        return;
+    }
+    if (!pool) {
+        js_engine_destroy(engine);
+        return;
+    }
+
+    // Reset outside the lock; it finalizes wrappers and rebuilds the context
+    if (js_engine_reset(engine) == 0) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->idle_count < pool->capacity) {
+            pool->idle[pool->idle_count++] = engine;
+            engine = NULL;
+        }
+        if (engine) {
+            pool->discarded++;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    } else {
+        pthread_mutex_lock(&pool->lock);
+        pool->discarded++;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    if (engine) {
+        js_engine_destroy(engine);
+    }
+}
+
+void js_engine_pool_get_stats(JSEnginePool* pool, JSEnginePoolStats* stats) {
+    if (!pool || !stats) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    stats->idle = pool->idle_count;
+    stats->hits = pool->hits;
+    stats->misses = pool->misses;
+    stats->discarded = pool->discarded;
+    pthread_mutex_unlock(&pool->lock);
+}
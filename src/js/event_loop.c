@@ -0,0 +1,458 @@
+#include "js_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Event loop
+// Timers sit in a binary min-heap keyed on (due time, insertion order) and
+// run against a virtual clock that only moves when the embedder advances
+// it, so headless runs fast-forward instead of sleeping. Promise jobs and
+// queueMicrotask callbacks are drained after every script and task.
+
+#define JS_ENGINE_FRAME_INTERVAL_MS 16
+#define JS_ENGINE_TIMER_NESTING_LIMIT 5
+#define JS_ENGINE_TIMER_MIN_NESTED_MS 4
+
+static int timer_before(const JSTimer* a, const JSTimer* b) {
+    return a->due_ms < b->due_ms || (a->due_ms == b->due_ms && a->seq < b->seq);
+}
+
+static void timer_sift_up(JSTimer* heap, size_t i) {
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!timer_before(&heap[i], &heap[parent])) {
+            break;
+        }
+        JSTimer tmp = heap[i];
+        heap[i] = heap[parent];
+        heap[parent] = tmp;
+        i = parent;
+    }
+}
+
+static void timer_sift_down(JSTimer* heap, size_t count, size_t i) {
+    for (;;) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1;
+        size_t right = left + 1;
+        if (left < count && timer_before(&heap[left], &heap[smallest])) {
+            smallest = left;
+        }
+        if (right < count && timer_before(&heap[right], &heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        JSTimer tmp = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+static int timer_push(JSEngine* engine, const JSTimer* timer) {
+    if (engine->timer_count >= engine->timer_capacity) {
+        size_t new_capacity = engine->timer_capacity ? engine->timer_capacity * 2 : 16;
+        JSTimer* timers = (JSTimer*)realloc(engine->timers, new_capacity * sizeof(JSTimer));
+        if (!timers) {
+            return -1;
+        }
+        engine->timers = timers;
+        engine->timer_capacity = new_capacity;
+    }
+
+    engine->timers[engine->timer_count] = *timer;
+    timer_sift_up(engine->timers, engine->timer_count);
+    engine->timer_count++;
+    return 0;
+}
+
+// Remove the timer at heap index i and hand it back to the caller
+static JSTimer timer_remove_at(JSEngine* engine, size_t i) {
+    JSTimer timer = engine->timers[i];
+    engine->timer_count--;
+    if (i < engine->timer_count) {
+        engine->timers[i] = engine->timers[engine->timer_count];
+        timer_sift_down(engine->timers, engine->timer_count, i);
+        timer_sift_up(engine->timers, i);
+    }
+    return timer;
+}
+
+static void timer_free(JSContext* ctx, JSTimer* timer) {
+    JS_FreeValue(ctx, timer->callback);
+    for (int i = 0; i < timer->argc; i++) {
+        JS_FreeValue(ctx, timer->argv[i]);
+    }
+    free(timer->argv);
+}
+
+static JSValue js_set_timer(JSContext* ctx, int argc, JSValueConst* argv, int repeat) {
+    JSEngine* engine = (JSEngine*)JS_GetContextOpaque(ctx);
+
+    if (argc < 1 || !JS_IsFunction(ctx, argv[0])) {
+        return JS_ThrowTypeError(ctx, "callback is not a function");
+    }
+
+    int64_t delay = 0;
+    if (argc > 1 && JS_ToInt64(ctx, &delay, argv[1]) != 0) {
+        return JS_EXCEPTION;
+    }
+    if (delay < 0) {
+        delay = 0;
+    }
+    if (delay > UINT32_MAX) {
+        delay = UINT32_MAX;
+    }
+
+    JSTimer timer;
+    memset(&timer, 0, sizeof(timer));
+    timer.nesting = engine->timer_nesting + 1;
+
+    // Deeply nested timers are clamped as in HTML, so a page that keeps
+    // rescheduling itself with a zero delay still lets virtual time move
+    if (timer.nesting > JS_ENGINE_TIMER_NESTING_LIMIT && delay < JS_ENGINE_TIMER_MIN_NESTED_MS) {
+        delay = JS_ENGINE_TIMER_MIN_NESTED_MS;
+    }
+    if (repeat && delay == 0) {
+        delay = 1;
+    }
+
+    if (argc > 2) {
+        timer.argv = (JSValue*)malloc((size_t)(argc - 2) * sizeof(JSValue));
+        if (!timer.argv) {
+            return JS_ThrowOutOfMemory(ctx);
+        }
+        for (int i = 2; i < argc; i++) {
+            timer.argv[i - 2] = JS_DupValue(ctx, argv[i]);
+        }
+        timer.argc = argc - 2;
+    }
+
+    timer.id = ++engine->next_timer_id;
+    timer.seq = engine->timer_seq++;
+    timer.due_ms = engine->now_ms + (uint64_t)delay;
+    timer.interval_ms = (uint32_t)delay;
+    timer.repeat = repeat;
+    timer.callback = JS_DupValue(ctx, argv[0]);
+
+    if (timer_push(engine, &timer) != 0) {
+        timer_free(ctx, &timer);
+        return JS_ThrowOutOfMemory(ctx);
+    }
+
+    return JS_NewInt64(ctx, timer.id);
+}
+
+static JSValue js_set_timeout(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    return js_set_timer(ctx, argc, argv, 0);
+}
+
+static JSValue js_set_interval(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    return js_set_timer(ctx, argc, argv, 1);
+}
+
+// Shared by clearTimeout and clearInterval, which are interchangeable
+static JSValue js_clear_timer(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    JSEngine* engine = (JSEngine*)JS_GetContextOpaque(ctx);
+
+    int64_t id;
+    if (argc < 1 || JS_ToInt64(ctx, &id, argv[0]) != 0) {
+        return JS_UNDEFINED;
+    }
+
+    // The running timer is out of the heap until its callback returns
+    if (engine->running_timer_id != 0 && engine->running_timer_id == id) {
+        engine->running_timer_cleared = 1;
+        return JS_UNDEFINED;
+    }
+
+    for (size_t i = 0; i < engine->timer_count; i++) {
+        if (engine->timers[i].id == id) {
+            JSTimer timer = timer_remove_at(engine, i);
+            timer_free(ctx, &timer);
+            break;
+        }
+    }
+
+    return JS_UNDEFINED;
+}
+
+static JSValue js_microtask_job(JSContext *ctx, int argc, JSValueConst *argv) {
+    return JS_Call(ctx, argv[0], JS_UNDEFINED, 0, NULL);
+}
+
+static JSValue js_queue_microtask(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    if (argc < 1 || !JS_IsFunction(ctx, argv[0])) {
+        return JS_ThrowTypeError(ctx, "callback is not a function");
+    }
+
+    if (JS_EnqueueJob(ctx, js_microtask_job, 1, argv) != 0) {
+        return JS_EXCEPTION;
+    }
+    return JS_UNDEFINED;
+}
+
+static JSValue js_request_animation_frame(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    JSEngine* engine = (JSEngine*)JS_GetContextOpaque(ctx);
+
+    if (argc < 1 || !JS_IsFunction(ctx, argv[0])) {
+        return JS_ThrowTypeError(ctx, "callback is not a function");
+    }
+
+    if (engine->frame_count >= engine->frame_capacity) {
+        size_t new_capacity = engine->frame_capacity ? engine->frame_capacity * 2 : 8;
+        JSAnimationFrame* frames = (JSAnimationFrame*)realloc(engine->frames, new_capacity * sizeof(JSAnimationFrame));
+        if (!frames) {
+            return JS_ThrowOutOfMemory(ctx);
+        }
+        engine->frames = frames;
+        engine->frame_capacity = new_capacity;
+    }
+
+    JSAnimationFrame* frame = &engine->frames[engine->frame_count++];
+    frame->id = ++engine->next_frame_id;
+    frame->callback = JS_DupValue(ctx, argv[0]);
+
+    return JS_NewInt64(ctx, frame->id);
+}
+
+static JSValue js_cancel_animation_frame(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
+    JSEngine* engine = (JSEngine*)JS_GetContextOpaque(ctx);
+
+    int64_t id;
+    if (argc < 1 || JS_ToInt64(ctx, &id, argv[0]) != 0) {
+        return JS_UNDEFINED;
+    }
+
+    for (size_t i = 0; i < engine->frame_count; i++) {
+        if (engine->frames[i].id == id) {
+            JS_FreeValue(ctx, engine->frames[i].callback);
+            memmove(&engine->frames[i], &engine->frames[i + 1],
+                    (engine->frame_count - i - 1) * sizeof(JSAnimationFrame));
+            engine->frame_count--;
+            break;
+        }
+    }
+
+    return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry js_event_loop_funcs[] = {
+    JS_CFUNC_DEF("setTimeout", 2, js_set_timeout),
+    JS_CFUNC_DEF("setInterval", 2, js_set_interval),
+    JS_CFUNC_DEF("clearTimeout", 1, js_clear_timer),
+    JS_CFUNC_DEF("clearInterval", 1, js_clear_timer),
+    JS_CFUNC_DEF("queueMicrotask", 1, js_queue_microtask),
+    JS_CFUNC_DEF("requestAnimationFrame", 1, js_request_animation_frame),
+    JS_CFUNC_DEF("cancelAnimationFrame", 1, js_cancel_animation_frame),
+};
+
+int js_event_loop_init(JSEngine* engine) {
+    JSContext* ctx = engine->context;
+
+    JSValue global = JS_GetGlobalObject(ctx);
+    if (JS_IsException(global)) {
+        return -1;
+    }
+    JS_SetPropertyFunctionList(ctx, global, js_event_loop_funcs,
+                               sizeof(js_event_loop_funcs) / sizeof(js_event_loop_funcs[0]));
+    JS_FreeValue(ctx, global);
+
+    return 0;
+}
+
+void js_event_loop_clear(JSEngine* engine) {
+    JSContext* ctx = engine->context;
+
+    for (size_t i = 0; i < engine->timer_count; i++) {
+        timer_free(ctx, &engine->timers[i]);
+    }
+    free(engine->timers);
+    engine->timers = NULL;
+    engine->timer_count = 0;
+    engine->timer_capacity = 0;
+
+    for (size_t i = 0; i < engine->frame_count; i++) {
+        JS_FreeValue(ctx, engine->frames[i].callback);
+    }
+    free(engine->frames);
+    engine->frames = NULL;
+    engine->frame_count = 0;
+    engine->frame_capacity = 0;
+
+    // QuickJS offers no way to drop queued jobs, and they point at the
+    // context being freed. Run them with every interrupt check failing so
+    // each is consumed while doing as little work as possible.
+    engine->discarding = 1;
+    JSContext* job_ctx;
+    while (JS_ExecutePendingJob(engine->runtime, &job_ctx) != 0) {
+        JS_FreeValue(job_ctx, JS_GetException(job_ctx));
+    }
+    engine->discarding = 0;
+
+    engine->now_ms = 0;
+    engine->timer_seq = 0;
+    engine->next_timer_id = 0;
+    engine->next_frame_id = 0;
+    engine->timer_nesting = 0;
+}
+
+void js_event_loop_run_microtasks(JSEngine* engine) {
+    JSContext* job_ctx;
+    while (!engine->budget_exceeded) {
+        int ret = JS_ExecutePendingJob(engine->runtime, &job_ctx);
+        if (ret == 0) {
+            break;
+        }
+        if (ret < 0 && !engine->budget_exceeded && !engine->last_error) {
+            js_engine_report_exception(engine);
+        } else if (ret < 0) {
+            JS_FreeValue(job_ctx, JS_GetException(job_ctx));
+        }
+    }
+}
+
+// Run the callback of a due timer as a task, then rearm it if it repeats
+static void run_timer(JSEngine* engine) {
+    JSContext* ctx = engine->context;
+    JSTimer timer = timer_remove_at(engine, 0);
+
+    engine->timer_nesting = timer.nesting;
+    engine->running_timer_id = timer.id;
+    engine->running_timer_cleared = 0;
+    JSValue result = JS_Call(ctx, timer.callback, JS_UNDEFINED, timer.argc, (JSValueConst*)timer.argv);
+    engine->timer_nesting = 0;
+    engine->running_timer_id = 0;
+
+    if (JS_IsException(result)) {
+        if (engine->budget_exceeded) {
+            JS_FreeValue(ctx, JS_GetException(ctx));
+        } else {
+            js_engine_report_exception(engine);
+        }
+    }
+    JS_FreeValue(ctx, result);
+
+    // An interval comes back unless its callback cleared it
+    if (timer.repeat && !engine->running_timer_cleared && !engine->budget_exceeded) {
+        timer.seq = engine->timer_seq++;
+        timer.due_ms = engine->now_ms + timer.interval_ms;
+        timer.nesting = timer.nesting + 1;
+        if (timer_push(engine, &timer) == 0) {
+            return;
+        }
+    }
+    timer_free(ctx, &timer);
+}
+
+// Run every animation frame callback registered before this frame began
+static void run_frame(JSEngine* engine) {
+    JSContext* ctx = engine->context;
+
+    size_t count = engine->frame_count;
+    JSAnimationFrame* frames = engine->frames;
+    engine->frames = NULL;
+    engine->frame_count = 0;
+    engine->frame_capacity = 0;
+
+    JSValue timestamp = JS_NewFloat64(ctx, (double)engine->now_ms);
+    for (size_t i = 0; i < count; i++) {
+        if (!engine->budget_exceeded) {
+            JSValue result = JS_Call(ctx, frames[i].callback, JS_UNDEFINED, 1, &timestamp);
+            if (JS_IsException(result)) {
+                if (engine->budget_exceeded) {
+                    JS_FreeValue(ctx, JS_GetException(ctx));
+                } else {
+                    js_engine_report_exception(engine);
+                }
+            }
+            JS_FreeValue(ctx, result);
+            js_event_loop_run_microtasks(engine);
+        }
+        JS_FreeValue(ctx, frames[i].callback);
+    }
+    free(frames);
+}
+
+static uint64_t next_frame_due(const JSEngine* engine) {
+    return (engine->now_ms / JS_ENGINE_FRAME_INTERVAL_MS + 1) * JS_ENGINE_FRAME_INTERVAL_MS;
+}
+
+// Run tasks due at or before the deadline in time order. Returns 0 when
+// nothing is left before the deadline, or JS_ENGINE_BUDGET_EXCEEDED.
+static int run_tasks_until(JSEngine* engine, uint64_t deadline) {
+    for (;;) {
+        if (js_engine_page_budget_spent(engine)) {
+            return JS_ENGINE_BUDGET_EXCEEDED;
+        }
+
+        int have_timer = engine->timer_count > 0;
+        int have_frame = engine->frame_count > 0;
+        if (!have_timer && !have_frame) {
+            return 0;
+        }
+
+        uint64_t frame_due = have_frame ? next_frame_due(engine) : UINT64_MAX;
+        uint64_t timer_due = have_timer ? engine->timers[0].due_ms : UINT64_MAX;
+        uint64_t due = timer_due < frame_due ? timer_due : frame_due;
+        if (due > deadline) {
+            return 0;
+        }
+        if (due > engine->now_ms) {
+            engine->now_ms = due;
+        }
+
+        js_engine_budget_begin(engine);
+        if (timer_due <= frame_due) {
+            run_timer(engine);
+            js_event_loop_run_microtasks(engine);
+        } else {
+            run_frame(engine);
+        }
+        js_engine_budget_end(engine);
+        js_engine_flush_console(engine);
+
+        if (engine->budget_exceeded) {
+            return JS_ENGINE_BUDGET_EXCEEDED;
+        }
+    }
+}
+
+uint64_t js_engine_now(JSEngine* engine) {
+    if (!engine) {
+        return 0;
+    }
+    return engine->now_ms;
+}
+
+int js_engine_advance_time(JSEngine* engine, uint64_t ms) {
+    if (!engine) {
+        return -1;
+    }
+
+    uint64_t deadline = engine->now_ms + ms;
+    int ret = run_tasks_until(engine, deadline);
+    if (ret == 0) {
+        engine->now_ms = deadline;
+    }
+    return ret;
+}
+
+int js_engine_run_until_idle(JSEngine* engine, uint64_t timeout_ms) {
+    if (!engine) {
+        return -1;
+    }
+
+    uint64_t deadline = engine->now_ms + timeout_ms;
+    int ret = run_tasks_until(engine, deadline);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (engine->timer_count > 0 || engine->frame_count > 0) {
+        engine->now_ms = deadline;
+        return 1;
+    }
+    return 0;
+}
@@ -1,28 +1,110 @@
-#include "js/js_engine.h"
-#include "dom/dom.h"
-#include "quickjs.h"
+#include "js_internal.h"
+#include "js/bytecode_cache.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <time.h>
 
-struct JSEngine {
-    JSRuntime* runtime;
-    JSContext* context;
-    DOMDocument* bound_document;
-    char* last_error;
-};
-
-// Forward declarations for DOM bindings
-static JSValue js_document_create_element(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
-static JSValue js_document_get_element_by_id(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
-static JSValue js_document_query_selector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
-static JSValue js_element_set_attribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
-static JSValue js_element_get_attribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
-static JSValue js_element_set_inner_html(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
-static JSValue js_element_query_selector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
-static JSValue js_console_log(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv);
+// QuickJS calls the interrupt handler roughly once per this many
+// operations (JS_INTERRUPT_COUNTER_INIT), so one handler call stands for
+// that many ticks and a clock read per call is already amortized
+#define JS_ENGINE_INTERRUPT_TICKS 10000
+
+uint64_t js_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Stop the running script once any budget is spent. Returning nonzero makes
+// QuickJS throw an uncatchable "interrupted" error.
+static int js_engine_interrupt_handler(JSRuntime* rt, void* opaque) {
+    JSEngine* engine = (JSEngine*)opaque;
+    if (engine->discarding) {
+        return 1;
+    }
+    if (!engine->running) {
+        return 0;
+    }
+
+    if (engine->profiler.active) {
+        js_profiler_maybe_sample(engine);
+    }
+
+    const JSEngineBudget* budget = &engine->budget;
+    engine->eval_ticks += JS_ENGINE_INTERRUPT_TICKS;
+    if ((budget->eval_instructions && engine->eval_ticks > budget->eval_instructions) ||
+        (budget->page_instructions && engine->page_ticks + engine->eval_ticks > budget->page_instructions)) {
+        engine->budget_exceeded = 1;
+        return 1;
+    }
+
+    if (budget->eval_time_ns || budget->page_time_ns) {
+        uint64_t elapsed = js_monotonic_ns() - engine->eval_start_ns;
+        if ((budget->eval_time_ns && elapsed > budget->eval_time_ns) ||
+            (budget->page_time_ns && engine->page_time_ns + elapsed > budget->page_time_ns)) {
+            engine->budget_exceeded = 1;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int js_engine_page_budget_spent(JSEngine* engine) {
+    const JSEngineBudget* budget = &engine->budget;
+    return (budget->page_instructions && engine->page_ticks >= budget->page_instructions) ||
+           (budget->page_time_ns && engine->page_time_ns >= budget->page_time_ns);
+}
+
+void js_engine_budget_begin(JSEngine* engine) {
+    engine->running = 1;
+    engine->budget_exceeded = 0;
+    engine->eval_ticks = 0;
+    engine->eval_start_ns = js_monotonic_ns();
+}
+
+void js_engine_budget_end(JSEngine* engine) {
+    engine->running = 0;
+    engine->page_ticks += engine->eval_ticks;
+    engine->page_time_ns += js_monotonic_ns() - engine->eval_start_ns;
+}
+
+// Build a pristine context on the engine's runtime: DOM classes and their
+// prototypes, plus the console global
+static int js_engine_context_init(JSEngine* engine) {
+    engine->context = JS_NewContext(engine->runtime);
+    if (!engine->context) {
+        return -1;
+    }
+
+    JS_SetContextOpaque(engine->context, engine);
+
+    // The profiler builds its backtraces with this; a page may replace the
+    // global Error, and its code must not run inside the interrupt handler
+    JSValue global = JS_GetGlobalObject(engine->context);
+    engine->profiler.error_constructor = JS_GetPropertyStr(engine->context, global, "Error");
+    JS_FreeValue(engine->context, global);
+
+    if (!JS_IsFunction(engine->context, engine->profiler.error_constructor) ||
+        js_dom_classes_init(engine->context) != 0 ||
+        js_event_loop_init(engine) != 0 ||
+        js_console_init(engine) != 0) {
+        JS_FreeValue(engine->context, engine->profiler.error_constructor);
+        engine->profiler.error_constructor = JS_UNDEFINED;
+        JS_FreeContext(engine->context);
+        engine->context = NULL;
+        return -1;
+    }
+
+    return 0;
+}
 
 JSEngine* js_engine_init(void) {
+    return js_engine_init_with_config(NULL);
+}
+
+JSEngine* js_engine_init_with_config(const JSEngineConfig* config) {
     JSEngine* engine = (JSEngine*)calloc(1, sizeof(JSEngine));
     if (!engine) {
         return NULL;
@@ -35,26 +117,73 @@ JSEngine* js_engine_init(void) {
         return NULL;
     }
 
+    JS_SetInterruptHandler(engine->runtime, js_engine_interrupt_handler, engine);
+    JS_SetModuleLoaderFunc(engine->runtime, NULL, js_module_loader, engine);
+
+    // Limits live on the runtime and so survive js_engine_reset
+    if (config) {
+        if (config->memory_limit) {
+            JS_SetMemoryLimit(engine->runtime, config->memory_limit);
+        }
+        if (config->gc_threshold) {
+            JS_SetGCThreshold(engine->runtime, config->gc_threshold);
+        }
+        if (config->max_stack_size) {
+            JS_SetMaxStackSize(engine->runtime, config->max_stack_size);
+        }
+    }
+
+    engine->bound_document = NULL;
+    engine->last_error = NULL;
+
     // Create QuickJS context
-    engine->context = JS_NewContext(engine->runtime);
-    if (!engine->context) {
+    if (js_engine_context_init(engine) != 0) {
         JS_FreeRuntime(engine->runtime);
+        js_console_free(engine);
         free(engine);
         return NULL;
     }
 
-    engine->bound_document = NULL;
-    engine->last_error = NULL;
+    return engine;
+}
 
-    // Add console.log support
-    JSValue global = JS_GetGlobalObject(engine->context);
-    JSValue console = JS_NewObject(engine->context);
-    JS_SetPropertyStr(engine->context, console, "log",
-                     JS_NewCFunction(engine->context, js_console_log, "log", 1));
-    JS_SetPropertyStr(engine->context, global, "console", console);
-    JS_FreeValue(engine->context, global);
+int js_engine_reset(JSEngine* engine) {
+    if (!engine) {
+        return -1;
+    }
 
-    return engine;
+    // Dropping the context releases every wrapper it created; the GC pass
+    // collects cycles so wrapper finalizers run before the bound document
+    // can go away. The runtime, with its registered classes, atoms and
+    // shapes, is kept.
+    if (engine->profiler.active) {
+        js_engine_profiler_stop(engine);
+    }
+    js_engine_profiler_clear(engine);
+
+    if (engine->context) {
+        js_event_loop_clear(engine);
+        JS_FreeValue(engine->context, engine->profiler.error_constructor);
+        engine->profiler.error_constructor = JS_UNDEFINED;
+        JS_FreeContext(engine->context);
+        engine->context = NULL;
+    }
+    js_engine_flush_console(engine);
+    js_engine_run_gc(engine);
+
+    js_dom_unbind(engine);
+    engine->bytecode_cache = NULL;
+    engine->module_provider = NULL;
+    engine->module_user_data = NULL;
+    // Later pages write to stdout until they install a sink of their own
+    engine->console.sink = NULL;
+    engine->console.user_data = NULL;
+    engine->console.dropped = 0;
+    free(engine->last_error);
+    engine->last_error = NULL;
+    js_engine_reset_page_budget(engine);
+
+    return js_engine_context_init(engine);
 }
 
 void js_engine_destroy(JSEngine* engine) {
@@ -62,358 +191,305 @@ void js_engine_destroy(JSEngine* engine) {
         return;
     }
 
+    if (engine->profiler.active) {
+        js_engine_profiler_stop(engine);
+    }
+    js_engine_profiler_clear(engine);
+
     if (engine->context) {
+        js_event_loop_clear(engine);
+        JS_FreeValue(engine->context, engine->profiler.error_constructor);
         JS_FreeContext(engine->context);
     }
     if (engine->runtime) {
+        js_dom_unbind(engine);
         JS_FreeRuntime(engine->runtime);
     }
+    js_console_free(engine);
+    js_bytecode_cache_destroy(engine->module_cache);
     free(engine->last_error);
     free(engine);
 }
 
-int js_engine_bind_dom(JSEngine* engine, DOMDocument* document) {
-    if (!engine || !document) {
+int js_engine_set_bytecode_cache(JSEngine* engine, JSBytecodeCache* cache) {
+    if (!engine) {
         return -1;
     }
 
-    engine->bound_document = document;
-
-    // Create document object
-    JSValue global = JS_GetGlobalObject(engine->context);
-    JSValue doc_obj = JS_NewObject(engine->context);
-
-    // Store document pointer directly as a property (simpler approach)
-    JS_SetPropertyStr(engine->context, doc_obj, "_internal_doc_ptr",
-                     JS_NewBigInt64(engine->context, (int64_t)(uintptr_t)document));
-
-    // Bind document methods
-    JS_SetPropertyStr(engine->context, doc_obj, "createElement",
-                     JS_NewCFunction(engine->context, js_document_create_element, "createElement", 1));
-    JS_SetPropertyStr(engine->context, doc_obj, "getElementById",
-                     JS_NewCFunction(engine->context, js_document_get_element_by_id, "getElementById", 1));
-    JS_SetPropertyStr(engine->context, doc_obj, "querySelector",
-                     JS_NewCFunction(engine->context, js_document_query_selector, "querySelector", 1));
-
-    // Set as global document
-    JS_SetPropertyStr(engine->context, global, "document", doc_obj);
-    JS_FreeValue(engine->context, global);
-
+    engine->bytecode_cache = cache;
     return 0;
 }
 
-int js_engine_eval(JSEngine* engine, const char* script) {
-    if (!engine || !script) {
+// Give a compiled module its import.meta, the same on both cache paths
+static int js_module_set_import_meta(JSContext* ctx, JSValueConst module, const char* filename) {
+    JSValue meta = JS_GetImportMeta(ctx, (JSModuleDef*)JS_VALUE_GET_PTR(module));
+    if (JS_IsException(meta)) {
         return -1;
     }
+    int ret = JS_DefinePropertyValueStr(ctx, meta, "url", JS_NewString(ctx, filename), JS_PROP_C_W_E);
+    JS_FreeValue(ctx, meta);
+    return ret < 0 ? -1 : 0;
+}
 
-    free(engine->last_error);
-    engine->last_error = NULL;
-
-    JSValue result = JS_Eval(engine->context, script, strlen(script), 
-                            "<eval>", JS_EVAL_TYPE_GLOBAL);
-
-    if (JS_IsException(result)) {
-        JSValue exception = JS_GetException(engine->context);
-        const char* error_str = JS_ToCString(engine->context, exception);
-        if (error_str) {
-            engine->last_error = strdup(error_str);
-            JS_FreeCString(engine->context, error_str);
+// Compile through a bytecode cache: a hit skips parsing entirely, a miss
+// compiles once and publishes the serialized function for later evals
+JSValue js_engine_compile_cached(JSEngine* engine, JSBytecodeCache* cache, const char* script,
+                                 size_t length, const char* filename, int eval_type) {
+    JSContext* ctx = engine->context;
+    JSBytecodeKey key = js_bytecode_cache_key(script, length, filename);
+
+    JSBytecodeEntry* entry = js_bytecode_cache_acquire(cache, key);
+    if (entry) {
+        size_t size;
+        const uint8_t* data = js_bytecode_entry_data(entry, &size);
+        JSValue func = JS_ReadObject(ctx, data, size, JS_READ_OBJ_BYTECODE);
+        js_bytecode_cache_release(cache, entry);
+
+        if (!JS_IsException(func)) {
+            if (JS_VALUE_GET_TAG(func) != JS_TAG_MODULE) {
+                return func;
+            }
+            // A module read back from bytecode has its imports unresolved;
+            // compiling from source resolves them, so do the same here
+            if (JS_ResolveModule(ctx, func) < 0 || js_module_set_import_meta(ctx, func, filename) < 0) {
+                JS_FreeValue(ctx, func);
+                return JS_EXCEPTION;
+            }
+            return func;
         }
-        JS_FreeValue(engine->context, exception);
-        JS_FreeValue(engine->context, result);
-        return -1;
-    }
 
-    JS_FreeValue(engine->context, result);
-    return 0;
-}
-
-const char* js_engine_get_error(JSEngine* engine) {
-    if (!engine) {
-        return NULL;
+        // Unreadable bytecode: drop the error and recompile from source
+        JS_FreeValue(ctx, JS_GetException(ctx));
     }
-    return engine->last_error;
-}
 
-// DOM binding implementations
-
-static JSValue js_console_log(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    for (int i = 0; i < argc; i++) {
-        const char* str = JS_ToCString(ctx, argv[i]);
-        if (str) {
-            printf("%s%s", i > 0 ? " " : "", str);
-            JS_FreeCString(ctx, str);
-        }
+    JSValue func = JS_Eval(ctx, script, length, filename,
+                           eval_type | JS_EVAL_FLAG_COMPILE_ONLY);
+    if (JS_IsException(func)) {
+        return func;
     }
-    printf("\n");
-    return JS_UNDEFINED;
-}
 
-static JSValue js_document_create_element(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    if (argc < 1) {
-        return JS_EXCEPTION;
+    size_t size;
+    uint8_t* data = JS_WriteObject(ctx, &size, func, JS_WRITE_OBJ_BYTECODE);
+    if (data) {
+        js_bytecode_cache_store(cache, key, data, size);
+        js_free(ctx, data);
     }
 
-    // Get document pointer from _internal_doc_ptr property
-    JSValue ptr_val = JS_GetPropertyStr(ctx, this_val, "_internal_doc_ptr");
-    int64_t ptr_int;
-    JS_ToBigInt64(ctx, &ptr_int, ptr_val);
-    JS_FreeValue(ctx, ptr_val);
-    
-    DOMDocument* doc = (DOMDocument*)(uintptr_t)ptr_int;
-    if (!doc) {
+    if (JS_VALUE_GET_TAG(func) == JS_TAG_MODULE && js_module_set_import_meta(ctx, func, filename) < 0) {
+        JS_FreeValue(ctx, func);
         return JS_EXCEPTION;
     }
+    return func;
+}
 
-    const char* tag_name = JS_ToCString(ctx, argv[0]);
-    if (!tag_name) {
-        return JS_EXCEPTION;
+void js_engine_report_exception(JSEngine* engine) {
+    JSValue exception = JS_GetException(engine->context);
+    const char* error_str = JS_ToCString(engine->context, exception);
+    if (error_str) {
+        free(engine->last_error);
+        engine->last_error = strdup(error_str);
+        JS_FreeCString(engine->context, error_str);
     }
+    JS_FreeValue(engine->context, exception);
+}
 
-    DOMElement* elem = dom_document_create_element(doc, tag_name);
-    JS_FreeCString(ctx, tag_name);
+// Record the script's outcome, then run the microtask checkpoint that
+// follows every script
+static int js_engine_finish_eval(JSEngine* engine, JSValue result) {
+    int ret = 0;
 
-    if (!elem) {
-        return JS_NULL;
+    if (JS_IsException(result)) {
+        if (engine->budget_exceeded) {
+            JS_FreeValue(engine->context, JS_GetException(engine->context));
+        } else {
+            js_engine_report_exception(engine);
+            ret = -1;
+        }
     }
+    JS_FreeValue(engine->context, result);
 
-    // Create JavaScript wrapper for element
-    JSValue elem_obj = JS_NewObject(ctx);
-    JS_SetPropertyStr(ctx, elem_obj, "_internal_elem_ptr",
-                     JS_NewBigInt64(ctx, (int64_t)(uintptr_t)elem));
-
-    // Bind element methods
-    JS_SetPropertyStr(ctx, elem_obj, "setAttribute",
-                     JS_NewCFunction(ctx, js_element_set_attribute, "setAttribute", 2));
-    JS_SetPropertyStr(ctx, elem_obj, "getAttribute",
-                     JS_NewCFunction(ctx, js_element_get_attribute, "getAttribute", 1));
-    JS_SetPropertyStr(ctx, elem_obj, "querySelector",
-                     JS_NewCFunction(ctx, js_element_query_selector, "querySelector", 1));
-    
-    // Add innerHTML property setter/getter
-    JSValue set_inner_html = JS_NewCFunction(ctx, js_element_set_inner_html, "set innerHTML", 1);
-    JS_DefinePropertyGetSet(ctx, elem_obj, JS_NewAtom(ctx, "innerHTML"),
-                           JS_UNDEFINED, set_inner_html, JS_PROP_CONFIGURABLE);
+    js_event_loop_run_microtasks(engine);
+    js_engine_budget_end(engine);
+    js_engine_flush_console(engine);
 
-    return elem_obj;
+    if (engine->budget_exceeded) {
+        free(engine->last_error);
+        engine->last_error = strdup("script exceeded its execution budget");
+        return JS_ENGINE_BUDGET_EXCEEDED;
+    }
+    return ret;
 }
 
-static JSValue js_document_get_element_by_id(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    if (argc < 1) {
-        return JS_EXCEPTION;
+int js_engine_eval(JSEngine* engine, const char* script) {
+    if (!engine || !script) {
+        return -1;
     }
 
-    JSValue ptr_val = JS_GetPropertyStr(ctx, this_val, "_internal_doc_ptr");
-    int64_t ptr_int;
-    JS_ToBigInt64(ctx, &ptr_int, ptr_val);
-    JS_FreeValue(ctx, ptr_val);
-    
-    DOMDocument* doc = (DOMDocument*)(uintptr_t)ptr_int;
-    if (!doc) {
-        return JS_EXCEPTION;
-    }
+    free(engine->last_error);
+    engine->last_error = NULL;
 
-    const char* id = JS_ToCString(ctx, argv[0]);
-    if (!id) {
-        return JS_EXCEPTION;
+    if (js_engine_page_budget_spent(engine)) {
+        engine->last_error = strdup("page exceeded its execution budget");
+        return JS_ENGINE_BUDGET_EXCEEDED;
     }
 
-    DOMElement* elem = dom_document_get_element_by_id(doc, id);
-    JS_FreeCString(ctx, id);
-
-    if (!elem) {
-        return JS_NULL;
+    js_engine_budget_begin(engine);
+    JSValue result;
+    if (engine->bytecode_cache) {
+        result = js_engine_compile_cached(engine, engine->bytecode_cache, script, strlen(script),
+                                          "<eval>", JS_EVAL_TYPE_GLOBAL);
+        if (!JS_IsException(result)) {
+            result = JS_EvalFunction(engine->context, result);
+        }
+    } else {
+        result = JS_Eval(engine->context, script, strlen(script), 
+                         "<eval>", JS_EVAL_TYPE_GLOBAL);
     }
 
-    // Create JavaScript wrapper
-    JSValue elem_obj = JS_NewObject(ctx);
-    JS_SetPropertyStr(ctx, elem_obj, "_internal_elem_ptr",
-                     JS_NewBigInt64(ctx, (int64_t)(uintptr_t)elem));
-
-    JS_SetPropertyStr(ctx, elem_obj, "setAttribute",
-                     JS_NewCFunction(ctx, js_element_set_attribute, "setAttribute", 2));
-    JS_SetPropertyStr(ctx, elem_obj, "getAttribute",
-                     JS_NewCFunction(ctx, js_element_get_attribute, "getAttribute", 1));
-
-    return elem_obj;
+    return js_engine_finish_eval(engine, result);
 }
 
-static JSValue js_element_set_attribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    if (argc < 2) {
-        return JS_EXCEPTION;
-    }
-
-    JSValue ptr_val = JS_GetPropertyStr(ctx, this_val, "_internal_elem_ptr");
-    int64_t ptr_int;
-    JS_ToBigInt64(ctx, &ptr_int, ptr_val);
-    JS_FreeValue(ctx, ptr_val);
-    
-    DOMElement* elem = (DOMElement*)(uintptr_t)ptr_int;
-    if (!elem) {
-        return JS_EXCEPTION;
+int js_engine_eval_module(JSEngine* engine, const char* source, const char* filename) {
+    if (!engine || !source || !filename) {
+        return -1;
     }
 
-    const char* name = JS_ToCString(ctx, argv[0]);
-    const char* value = JS_ToCString(ctx, argv[1]);
+    free(engine->last_error);
+    engine->last_error = NULL;
 
-    if (!name || !value) {
-        JS_FreeCString(ctx, name);
-        JS_FreeCString(ctx, value);
-        return JS_EXCEPTION;
+    if (js_engine_page_budget_spent(engine)) {
+        engine->last_error = strdup("page exceeded its execution budget");
+        return JS_ENGINE_BUDGET_EXCEEDED;
     }
 
-    int result = dom_element_set_attribute(elem, name, value);
+    JSBytecodeCache* cache = js_module_cache(engine);
+    if (!cache) {
+        return -1;
+    }
 
-    JS_FreeCString(ctx, name);
-    JS_FreeCString(ctx, value);
+    // Compiling (or reading back and resolving) the module loads its
+    // imports through the module loader; evaluating it runs them first
+    js_engine_budget_begin(engine);
+    JSValue module = js_engine_compile_cached(engine, cache, source, strlen(source),
+                                              filename, JS_EVAL_TYPE_MODULE);
+    if (!JS_IsException(module)) {
+        module = JS_EvalFunction(engine->context, module);
+    }
 
-    return result == 0 ? JS_UNDEFINED : JS_EXCEPTION;
+    return js_engine_finish_eval(engine, module);
 }
 
-static JSValue js_element_get_attribute(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    if (argc < 1) {
-        return JS_EXCEPTION;
+int js_engine_eval_bytecode(JSEngine* engine, const uint8_t* bytecode, size_t size) {
+    if (!engine || !bytecode) {
+        return -1;
     }
 
-    JSValue ptr_val = JS_GetPropertyStr(ctx, this_val, "_internal_elem_ptr");
-    int64_t ptr_int;
-    JS_ToBigInt64(ctx, &ptr_int, ptr_val);
-    JS_FreeValue(ctx, ptr_val);
-    
-    DOMElement* elem = (DOMElement*)(uintptr_t)ptr_int;
-    if (!elem) {
-        return JS_EXCEPTION;
-    }
+    free(engine->last_error);
+    engine->last_error = NULL;
 
-    const char* name = JS_ToCString(ctx, argv[0]);
-    if (!name) {
-        return JS_EXCEPTION;
+    if (js_engine_page_budget_spent(engine)) {
+        engine->last_error = strdup("page exceeded its execution budget");
+        return JS_ENGINE_BUDGET_EXCEEDED;
     }
 
-    const char* value = dom_element_get_attribute(elem, name);
-    JS_FreeCString(ctx, name);
-
-    if (!value) {
-        return JS_NULL;
+    js_engine_budget_begin(engine);
+    JSValue func = JS_ReadObject(engine->context, bytecode, size, JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(func)) {
+        return js_engine_finish_eval(engine, func);
     }
 
-    return JS_NewString(ctx, value);
+    return js_engine_finish_eval(engine, JS_EvalFunction(engine->context, func));
 }
 
-static JSValue js_element_set_inner_html(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    if (argc < 1) {
-        return JS_EXCEPTION;
+int js_engine_set_budget(JSEngine* engine, const JSEngineBudget* budget) {
+    if (!engine) {
+        return -1;
     }
 
-    JSValue ptr_val = JS_GetPropertyStr(ctx, this_val, "_internal_elem_ptr");
-    int64_t ptr_int;
-    JS_ToBigInt64(ctx, &ptr_int, ptr_val);
-    JS_FreeValue(ctx, ptr_val);
-    
-    DOMElement* elem = (DOMElement*)(uintptr_t)ptr_int;
-    if (!elem) {
-        return JS_EXCEPTION;
+    if (budget) {
+        engine->budget = *budget;
+    } else {
+        memset(&engine->budget, 0, sizeof(engine->budget));
     }
+    return 0;
+}
 
-    const char* html = JS_ToCString(ctx, argv[0]);
-    if (!html) {
-        return JS_EXCEPTION;
+void js_engine_reset_page_budget(JSEngine* engine) {
+    if (!engine) {
+        return;
     }
 
-    int result = dom_element_set_inner_html(elem, html);
-    JS_FreeCString(ctx, html);
-
-    return result == 0 ? JS_UNDEFINED : JS_EXCEPTION;
+    engine->page_ticks = 0;
+    engine->page_time_ns = 0;
 }
 
-static JSValue js_document_query_selector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    if (argc < 1) {
-        return JS_EXCEPTION;
-    }
-
-    JSValue ptr_val = JS_GetPropertyStr(ctx, this_val, "_internal_doc_ptr");
-    int64_t ptr_int;
-    JS_ToBigInt64(ctx, &ptr_int, ptr_val);
-    JS_FreeValue(ctx, ptr_val);
-    
-    DOMDocument* doc = (DOMDocument*)(uintptr_t)ptr_int;
-    if (!doc) {
-        return JS_EXCEPTION;
+int js_engine_run_gc(JSEngine* engine) {
+    if (!engine) {
+        return -1;
     }
 
-    const char* selector = JS_ToCString(ctx, argv[0]);
-    if (!selector) {
-        return JS_EXCEPTION;
-    }
+    uint64_t start = js_monotonic_ns();
+    JS_RunGC(engine->runtime);
+    engine->explicit_gc_time_ns += js_monotonic_ns() - start;
+    engine->explicit_gc_count++;
 
-    // Start search from document element
-    DOMElement* doc_elem = dom_document_get_element(doc);
-    DOMElement* found = NULL;
-    
-    if (doc_elem) {
-        found = dom_element_query_selector(doc_elem, selector);
-    }
-    
-    JS_FreeCString(ctx, selector);
+    return 0;
+}
 
-    if (!found) {
-        return JS_NULL;
+int js_engine_get_heap_stats(JSEngine* engine, JSEngineHeapStats* stats) {
+    if (!engine || !stats) {
+        return -1;
     }
 
-    // Create JavaScript wrapper
-    JSValue elem_obj = JS_NewObject(ctx);
-    JS_SetPropertyStr(ctx, elem_obj, "_internal_elem_ptr",
-                     JS_NewBigInt64(ctx, (int64_t)(uintptr_t)found));
-
-    JS_SetPropertyStr(ctx, elem_obj, "setAttribute",
-                     JS_NewCFunction(ctx, js_element_set_attribute, "setAttribute", 2));
-    JS_SetPropertyStr(ctx, elem_obj, "getAttribute",
-                     JS_NewCFunction(ctx, js_element_get_attribute, "getAttribute", 1));
-    JS_SetPropertyStr(ctx, elem_obj, "querySelector",
-                     JS_NewCFunction(ctx, js_element_query_selector, "querySelector", 1));
+    JSMemoryUsage usage;
+    JS_ComputeMemoryUsage(engine->runtime, &usage);
+
+    stats->malloc_size = usage.malloc_size;
+    stats->malloc_limit = usage.malloc_limit;
+    stats->memory_used_size = usage.memory_used_size;
+    stats->malloc_count = usage.malloc_count;
+    stats->atom_count = usage.atom_count;
+    stats->atom_size = usage.atom_size;
+    stats->str_count = usage.str_count;
+    stats->str_size = usage.str_size;
+    stats->obj_count = usage.obj_count;
+    stats->obj_size = usage.obj_size;
+    stats->prop_count = usage.prop_count;
+    stats->prop_size = usage.prop_size;
+    stats->shape_count = usage.shape_count;
+    stats->shape_size = usage.shape_size;
+    stats->js_func_count = usage.js_func_count;
+    stats->js_func_size = usage.js_func_size;
+    stats->js_func_code_size = usage.js_func_code_size;
+    stats->c_func_count = usage.c_func_count;
+    stats->array_count = usage.array_count;
+    stats->fast_array_count = usage.fast_array_count;
+    stats->fast_array_elements = usage.fast_array_elements;
+    stats->binary_object_count = usage.binary_object_count;
+    stats->binary_object_size = usage.binary_object_size;
+    stats->explicit_gc_count = engine->explicit_gc_count;
+    stats->explicit_gc_time_ns = engine->explicit_gc_time_ns;
 
-    return elem_obj;
+    return 0;
 }
 
-static JSValue js_element_query_selector(JSContext *ctx, JSValueConst this_val, int argc, JSValueConst *argv) {
-    if (argc < 1) {
-        return JS_EXCEPTION;
-    }
-
-    JSValue ptr_val = JS_GetPropertyStr(ctx, this_val, "_internal_elem_ptr");
-    int64_t ptr_int;
-    JS_ToBigInt64(ctx, &ptr_int, ptr_val);
-    JS_FreeValue(ctx, ptr_val);
-    
-    DOMElement* elem = (DOMElement*)(uintptr_t)ptr_int;
-    if (!elem) {
-        return JS_EXCEPTION;
+const char* js_engine_get_error(JSEngine* engine) {
+    if (!engine) {
+        return NULL;
     }
+    return engine->last_error;
+}
 
-    const char* selector = JS_ToCString(ctx, argv[0]);
-    if (!selector) {
-        return JS_EXCEPTION;
+int js_engine_set_error(JSEngine* engine, const char* message) {
+    if (!engine || !message) {
+        return -1;
     }
 
-    DOMElement* found = dom_element_query_selector(elem, selector);
-    JS_FreeCString(ctx, selector);
-
-    if (!found) {
-        return JS_NULL;
+    char* copy = strdup(message);
+    if (!copy) {
+        return -1;
     }
-
-    // Create JavaScript wrapper
-    JSValue elem_obj = JS_NewObject(ctx);
-    JS_SetPropertyStr(ctx, elem_obj, "_internal_elem_ptr",
-                     JS_NewBigInt64(ctx, (int64_t)(uintptr_t)found));
-
-    JS_SetPropertyStr(ctx, elem_obj, "setAttribute",
-                     JS_NewCFunction(ctx, js_element_set_attribute, "setAttribute", 2));
-    JS_SetPropertyStr(ctx, elem_obj, "getAttribute",
-                     JS_NewCFunction(ctx, js_element_get_attribute, "getAttribute", 1));
-    JS_SetPropertyStr(ctx, elem_obj, "querySelector",
-                     JS_NewCFunction(ctx, js_element_query_selector, "querySelector", 1));
-
-    return elem_obj;
+    free(engine->last_error);
+    engine->last_error = copy;
+    return 0;
 }
@@ -0,0 +1,213 @@
+#ifndef JUST_BROWSE_JS_INTERNAL_H
+#define JUST_BROWSE_JS_INTERNAL_H
+
+// Engine state shared by the js/ translation units; not installed
+
+#include "js/js_engine.h"
+#include "quickjs.h"
+#include <stdint.h>
+
+// A pending setTimeout/setInterval callback
+typedef struct {
+    uint64_t due_ms;
+    uint64_t seq;               // Orders timers that fall due together
+    uint32_t id;
+    uint32_t interval_ms;
+    int repeat;
+    int nesting;                // Timer nesting level for the 4ms clamp
+    JSValue callback;
+    int argc;
+    JSValue* argv;
+} JSTimer;
+
+// A pending requestAnimationFrame callback
+typedef struct {
+    uint32_t id;
+    JSValue callback;
+} JSAnimationFrame;
+
+// Profile aggregate keyed by function name or collapsed stack
+typedef struct {
+    char* key;
+    uint64_t self;              // Samples with this function (or stack) as the leaf
+    uint64_t total;             // Samples with this function anywhere on the stack
+    uint64_t mark;              // Last sample that counted towards total
+} JSProfileEntry;
+
+typedef struct {
+    JSProfileEntry* entries;    // Open addressing, capacity a power of two
+    size_t count;
+    size_t capacity;
+} JSProfileTable;
+
+typedef struct {
+    int active;
+    uint32_t interval_us;
+    unsigned last_tick;         // Last SIGPROF tick seen
+    uint64_t next_sample_ns;
+    uint64_t samples;
+    uint64_t sample_serial;
+    JSProfileTable stacks;
+    JSProfileTable functions;
+    JSValue error_constructor;  // The intrinsic Error, taken before page scripts run
+} JSProfiler;
+
+// A buffered console message; its text lives in the console buffer
+typedef struct {
+    JSConsoleLevel level;
+    size_t offset;
+    size_t length;              // Excluding the trailing newline
+} JSConsoleRecord;
+
+typedef struct {
+    JSConsoleSink sink;         // NULL writes batches to stdout
+    void* user_data;
+    char* text;                 // Formatted messages, each ending in a newline
+    size_t text_used;
+    size_t capacity;
+    JSConsoleRecord* records;
+    size_t record_count;
+    size_t record_capacity;
+    uint64_t dropped;
+} JSConsole;
+
+struct JSEngine {
+    JSRuntime* runtime;
+    JSContext* context;
+    DOMDocument* bound_document;
+    char* last_error;
+    JSBytecodeCache* bytecode_cache;
+    uint64_t explicit_gc_count;
+    uint64_t explicit_gc_time_ns;
+    JSEngineBudget budget;
+    int running;                // Inside an eval; budgets are charged
+    int budget_exceeded;        // Set by the interrupt handler
+    int discarding;             // Abort whatever runs; used to flush jobs on reset
+    uint64_t eval_start_ns;
+    uint64_t eval_ticks;
+    uint64_t page_time_ns;      // Charged by finished evals since the page began
+    uint64_t page_ticks;
+
+    // Event loop (event_loop.c)
+    uint64_t now_ms;            // Virtual clock
+    JSTimer* timers;            // Min-heap on (due_ms, seq)
+    size_t timer_count;
+    size_t timer_capacity;
+    uint64_t timer_seq;
+    uint32_t next_timer_id;
+    int timer_nesting;          // Nesting level of the running timer, 0 outside
+    uint32_t running_timer_id;  // Timer whose callback is running, 0 outside
+    int running_timer_cleared;  // The running timer cleared itself
+    JSAnimationFrame* frames;
+    size_t frame_count;
+    size_t frame_capacity;
+    uint32_t next_frame_id;
+
+    // Sampling profiler (profiler.c)
+    JSProfiler profiler;
+
+    // Console (console.c)
+    JSConsole console;
+
+    // Module loader (module_loader.c)
+    JSModuleProvider module_provider;
+    void* module_user_data;
+    JSBytecodeCache* module_cache;  // Private module cache when none is shared
+};
+
+/**
+ * Read the monotonic clock
+ * @return Nanoseconds from an arbitrary origin
+ */
+uint64_t js_monotonic_ns(void);
+
+/**
+ * Open and close a budgeted region; script run in between is charged to
+ * the eval and page budgets
+ */
+void js_engine_budget_begin(JSEngine* engine);
+void js_engine_budget_end(JSEngine* engine);
+
+/**
+ * Check whether the page budget is used up
+ * @return Nonzero if no further script may run on this page
+ */
+int js_engine_page_budget_spent(JSEngine* engine);
+
+/**
+ * Move the pending exception into last_error
+ */
+void js_engine_report_exception(JSEngine* engine);
+
+/**
+ * Register the DOM wrapper classes and install their prototypes on a
+ * fresh context
+ * @return 0 on success, -1 on failure
+ */
+int js_dom_classes_init(JSContext* ctx);
+
+/**
+ * Detach from the bound document, releasing every string the bindings
+ * cached on it. Must run while the runtime is still alive.
+ */
+void js_dom_unbind(JSEngine* engine);
+
+/**
+ * Install timer and microtask globals on a fresh context
+ * @return 0 on success, -1 on failure
+ */
+int js_event_loop_init(JSEngine* engine);
+
+/**
+ * Drop every timer, animation frame and pending job. Must run before the
+ * context is freed.
+ */
+void js_event_loop_clear(JSEngine* engine);
+
+/**
+ * Run pending promise jobs until none are left or a budget runs out
+ */
+void js_event_loop_run_microtasks(JSEngine* engine);
+
+/**
+ * Compile a script or module without running it, going through a bytecode
+ * cache
+ * @param cache The cache, or NULL to compile directly
+ * @param eval_type JS_EVAL_TYPE_GLOBAL or JS_EVAL_TYPE_MODULE
+ * @return The compiled function or module, or JS_EXCEPTION
+ */
+JSValue js_engine_compile_cached(JSEngine* engine, JSBytecodeCache* cache, const char* script,
+                                 size_t length, const char* filename, int eval_type);
+
+/**
+ * QuickJS module loader: fetch a module from the provider and compile it
+ * through the module cache
+ */
+JSModuleDef* js_module_loader(JSContext* ctx, const char* module_name, void* opaque);
+
+/**
+ * Get the cache holding module bytecode: the shared bytecode cache when
+ * set, else a private one created on first use
+ * @return The cache, or NULL on allocation failure
+ */
+JSBytecodeCache* js_module_cache(JSEngine* engine);
+
+/**
+ * Install the console global on a fresh context, allocating the buffer on
+ * first use
+ * @return 0 on success, -1 on failure
+ */
+int js_console_init(JSEngine* engine);
+
+/**
+ * Flush pending messages and release the console buffer
+ */
+void js_console_free(JSEngine* engine);
+
+/**
+ * Called from the interrupt handler while profiling: record the running
+ * stack if a sample is due
+ */
+void js_profiler_maybe_sample(JSEngine* engine);
+
+#endif // JUST_BROWSE_JS_INTERNAL_H
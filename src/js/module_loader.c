@@ -0,0 +1,58 @@
+#include "js_internal.h"
+#include "js/bytecode_cache.h"
+#include <stdlib.h>
+
+// Module loader
+// QuickJS resolves "./" and "../" specifiers against the importing module
+// and keeps each loaded module in the context, so the loader runs once per
+// module per page. Module bytecode goes through a bytecode cache that lives
+// as long as the runtime (or the process, when a shared cache is set), so
+// a dependency graph is parsed once and every later page reads it back.
+
+JSBytecodeCache* js_module_cache(JSEngine* engine) {
+    if (engine->bytecode_cache) {
+        return engine->bytecode_cache;
+    }
+    if (!engine->module_cache) {
+        engine->module_cache = js_bytecode_cache_create(NULL);
+    }
+    return engine->module_cache;
+}
+
+JSModuleDef* js_module_loader(JSContext* ctx, const char* module_name, void* opaque) {
+    JSEngine* engine = (JSEngine*)opaque;
+
+    if (!engine->module_provider) {
+        JS_ThrowReferenceError(ctx, "could not load module '%s': no module provider", module_name);
+        return NULL;
+    }
+
+    size_t length = 0;
+    char* source = engine->module_provider(module_name, &length, engine->module_user_data);
+    if (!source) {
+        JS_ThrowReferenceError(ctx, "could not load module '%s'", module_name);
+        return NULL;
+    }
+
+    JSBytecodeCache* cache = js_module_cache(engine);
+    JSValue module = js_engine_compile_cached(engine, cache, source, length, module_name, JS_EVAL_TYPE_MODULE);
+    free(source);
+    if (JS_IsException(module)) {
+        return NULL;
+    }
+
+    // The context keeps the module record; only our reference goes
+    JSModuleDef* m = (JSModuleDef*)JS_VALUE_GET_PTR(module);
+    JS_FreeValue(ctx, module);
+    return m;
+}
+
+int js_engine_set_module_provider(JSEngine* engine, JSModuleProvider provider, void* user_data) {
+    if (!engine) {
+        return -1;
+    }
+
+    engine->module_provider = provider;
+    engine->module_user_data = user_data;
+    return 0;
+}
@@ -0,0 +1,460 @@
+#include "js_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#ifndef BUILD_WASM
+#include <signal.h>
+#include <sys/time.h>
+#endif
+
+// Sampling profiler
+// A process-wide SIGPROF timer bumps a tick counter; the interrupt handler,
+// which QuickJS already calls every few thousand operations, notices the
+// new tick and records the current JS stack. The signal handler itself
+// only does an atomic increment. Without signals (WASM) the interrupt
+// handler reads the clock instead.
+
+#define JS_PROFILER_DEFAULT_INTERVAL_US 1000
+#define JS_PROFILER_MAX_FRAMES 64
+
+static atomic_uint profiler_ticks;
+
+#ifndef BUILD_WASM
+static pthread_mutex_t profiler_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static int profiler_timer_users;
+static struct sigaction profiler_saved_action;
+
+static void profiler_signal_handler(int signo) {
+    (void)signo;
+    atomic_fetch_add_explicit(&profiler_ticks, 1, memory_order_relaxed);
+}
+
+// The timer is shared by every profiling engine; the first one to start
+// sets its rate
+static int profiler_timer_acquire(uint32_t interval_us) {
+    int ret = 0;
+
+    pthread_mutex_lock(&profiler_timer_lock);
+    if (profiler_timer_users == 0) {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = profiler_signal_handler;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+
+        struct itimerval timer;
+        timer.it_interval.tv_sec = interval_us / 1000000;
+        timer.it_interval.tv_usec = interval_us % 1000000;
+        timer.it_value = timer.it_interval;
+
+        if (sigaction(SIGPROF, &action, &profiler_saved_action) != 0) {
+            ret = -1;
+        } else if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+            sigaction(SIGPROF, &profiler_saved_action, NULL);
+            ret = -1;
+        }
+    }
+    if (ret == 0) {
+        profiler_timer_users++;
+    }
+    pthread_mutex_unlock(&profiler_timer_lock);
+
+    return ret;
+}
+
+static void profiler_timer_release(void) {
+    pthread_mutex_lock(&profiler_timer_lock);
+    if (--profiler_timer_users == 0) {
+        struct itimerval timer;
+        memset(&timer, 0, sizeof(timer));
+        setitimer(ITIMER_PROF, &timer, NULL);
+        sigaction(SIGPROF, &profiler_saved_action, NULL);
+    }
+    pthread_mutex_unlock(&profiler_timer_lock);
+}
+#endif
+
+static uint64_t hash_string(const char* str, size_t len) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Find or insert a key in an open-addressing table
+static JSProfileEntry* profile_table_get(JSProfileTable* table, const char* key, size_t len) {
+    if ((table->count + 1) * 4 > table->capacity * 3) {
+        size_t new_capacity = table->capacity ? table->capacity * 2 : 64;
+        JSProfileEntry* entries = (JSProfileEntry*)calloc(new_capacity, sizeof(JSProfileEntry));
+        if (!entries) {
+            return NULL;
+        }
+        for (size_t i = 0; i < table->capacity; i++) {
+            JSProfileEntry* old = &table->entries[i];
+            if (!old->key) {
+                continue;
+            }
+            size_t slot = hash_string(old->key, strlen(old->key)) & (new_capacity - 1);
+            while (entries[slot].key) {
+                slot = (slot + 1) & (new_capacity - 1);
+            }
+            entries[slot] = *old;
+        }
+        free(table->entries);
+        table->entries = entries;
+        table->capacity = new_capacity;
+    }
+
+    size_t slot = hash_string(key, len) & (table->capacity - 1);
+    while (table->entries[slot].key) {
+        JSProfileEntry* entry = &table->entries[slot];
+        if (strncmp(entry->key, key, len) == 0 && entry->key[len] == '\0') {
+            return entry;
+        }
+        slot = (slot + 1) & (table->capacity - 1);
+    }
+
+    JSProfileEntry* entry = &table->entries[slot];
+    entry->key = (char*)malloc(len + 1);
+    if (!entry->key) {
+        return NULL;
+    }
+    memcpy(entry->key, key, len);
+    entry->key[len] = '\0';
+    entry->self = 0;
+    entry->total = 0;
+    entry->mark = 0;
+    table->count++;
+    return entry;
+}
+
+static void profile_table_clear(JSProfileTable* table) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        free(table->entries[i].key);
+    }
+    free(table->entries);
+    memset(table, 0, sizeof(*table));
+}
+
+// Split a QuickJS backtrace ("    at name (file:line)\n" per frame,
+// innermost first) into function names
+static int parse_backtrace(const char* stack, const char** names, size_t* lengths, int max) {
+    int count = 0;
+    const char* line = stack;
+
+    while (*line && count < max) {
+        const char* end = strchr(line, '\n');
+        if (!end) {
+            end = line + strlen(line);
+        }
+
+        const char* at = strstr(line, "at ");
+        if (at && at < end) {
+            const char* name = at + 3;
+            const char* paren = name;
+            while (paren < end && !(paren[0] == ' ' && paren[1] == '(')) {
+                paren++;
+            }
+            if (paren > name) {
+                names[count] = name;
+                lengths[count] = (size_t)(paren - name);
+                count++;
+            }
+        }
+
+        line = *end ? end + 1 : end;
+    }
+
+    return count;
+}
+
+static void profiler_record(JSEngine* engine, const char* stack) {
+    JSProfiler* profiler = &engine->profiler;
+    const char* names[JS_PROFILER_MAX_FRAMES];
+    size_t lengths[JS_PROFILER_MAX_FRAMES];
+
+    int depth = parse_backtrace(stack, names, lengths, JS_PROFILER_MAX_FRAMES);
+    if (depth == 0) {
+        return;
+    }
+
+    // Collapsed stack, root first: "outer;inner;leaf"
+    size_t collapsed_len = 0;
+    for (int i = 0; i < depth; i++) {
+        collapsed_len += lengths[i] + 1;
+    }
+    char* collapsed = (char*)malloc(collapsed_len);
+    if (!collapsed) {
+        return;
+    }
+    size_t pos = 0;
+    for (int i = depth - 1; i >= 0; i--) {
+        memcpy(collapsed + pos, names[i], lengths[i]);
+        pos += lengths[i];
+        collapsed[pos++] = i > 0 ? ';' : '\0';
+    }
+
+    JSProfileEntry* entry = profile_table_get(&profiler->stacks, collapsed, pos - 1);
+    free(collapsed);
+    if (!entry) {
+        return;
+    }
+    entry->self++;
+
+    // Recursive functions count once towards total per sample
+    profiler->sample_serial++;
+    for (int i = 0; i < depth; i++) {
+        JSProfileEntry* function = profile_table_get(&profiler->functions, names[i], lengths[i]);
+        if (!function) {
+            continue;
+        }
+        if (i == 0) {
+            function->self++;
+        }
+        if (function->mark != profiler->sample_serial) {
+            function->mark = profiler->sample_serial;
+            function->total++;
+        }
+    }
+
+    profiler->samples++;
+}
+
+void js_profiler_maybe_sample(JSEngine* engine) {
+    JSProfiler* profiler = &engine->profiler;
+
+#ifndef BUILD_WASM
+    unsigned ticks = atomic_load_explicit(&profiler_ticks, memory_order_relaxed);
+    if (ticks == profiler->last_tick) {
+        return;
+    }
+    profiler->last_tick = ticks;
+#endif
+
+    // Rate-limit per engine: the shared timer may run faster than this
+    // engine asked for
+    uint64_t now = js_monotonic_ns();
+    if (now < profiler->next_sample_ns) {
+        return;
+    }
+    profiler->next_sample_ns = now + (uint64_t)profiler->interval_us * 1000;
+
+    // Constructing an Error captures the backtrace of the running script.
+    // JS_NewError and the JS_Throw* helpers leave the stack out when called
+    // from inside bytecode, so go through the intrinsic constructor, which
+    // runs no page code and sets "stack" as an own data property.
+    JSContext* ctx = engine->context;
+    JSValue error = JS_CallConstructor(ctx, profiler->error_constructor, 0, NULL);
+    if (JS_IsException(error)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        return;
+    }
+    JSValue stack = JS_GetPropertyStr(ctx, error, "stack");
+    const char* stack_str = JS_ToCString(ctx, stack);
+    if (stack_str) {
+        profiler_record(engine, stack_str);
+        JS_FreeCString(ctx, stack_str);
+    } else {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+    }
+    JS_FreeValue(ctx, stack);
+    JS_FreeValue(ctx, error);
+}
+
+int js_engine_profiler_start(JSEngine* engine, uint32_t interval_us) {
+    if (!engine || engine->profiler.active) {
+        return -1;
+    }
+
+    if (interval_us == 0) {
+        interval_us = JS_PROFILER_DEFAULT_INTERVAL_US;
+    }
+
+#ifndef BUILD_WASM
+    if (profiler_timer_acquire(interval_us) != 0) {
+        return -1;
+    }
+    engine->profiler.last_tick = atomic_load_explicit(&profiler_ticks, memory_order_relaxed);
+#endif
+
+    engine->profiler.interval_us = interval_us;
+    engine->profiler.next_sample_ns = js_monotonic_ns() + (uint64_t)interval_us * 1000;
+    engine->profiler.active = 1;
+    return 0;
+}
+
+int js_engine_profiler_stop(JSEngine* engine) {
+    if (!engine || !engine->profiler.active) {
+        return -1;
+    }
+
+#ifndef BUILD_WASM
+    profiler_timer_release();
+#endif
+    engine->profiler.active = 0;
+    return 0;
+}
+
+void js_engine_profiler_clear(JSEngine* engine) {
+    if (!engine) {
+        return;
+    }
+
+    profile_table_clear(&engine->profiler.stacks);
+    profile_table_clear(&engine->profiler.functions);
+    engine->profiler.samples = 0;
+}
+
+uint64_t js_engine_profiler_sample_count(JSEngine* engine) {
+    if (!engine) {
+        return 0;
+    }
+    return engine->profiler.samples;
+}
+
+// Growable output buffer for the exporters
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int failed;
+} ProfileBuffer;
+
+static void buffer_append(ProfileBuffer* buffer, const char* str, size_t len) {
+    if (buffer->failed) {
+        return;
+    }
+    if (buffer->length + len + 1 > buffer->capacity) {
+        size_t new_capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        while (new_capacity < buffer->length + len + 1) {
+            new_capacity *= 2;
+        }
+        char* data = (char*)realloc(buffer->data, new_capacity);
+        if (!data) {
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = data;
+        buffer->capacity = new_capacity;
+    }
+    memcpy(buffer->data + buffer->length, str, len);
+    buffer->length += len;
+    buffer->data[buffer->length] = '\0';
+}
+
+static void buffer_append_str(ProfileBuffer* buffer, const char* str) {
+    buffer_append(buffer, str, strlen(str));
+}
+
+static void buffer_append_u64(ProfileBuffer* buffer, uint64_t value) {
+    char number[24];
+    int len = snprintf(number, sizeof(number), "%llu", (unsigned long long)value);
+    buffer_append(buffer, number, (size_t)len);
+}
+
+static void buffer_append_json_string(ProfileBuffer* buffer, const char* str) {
+    buffer_append(buffer, "\"", 1);
+    for (const char* p = str; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c == '"' || c == '\\') {
+            char escaped[2] = { '\\', (char)c };
+            buffer_append(buffer, escaped, 2);
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            buffer_append(buffer, escaped, 6);
+        } else {
+            buffer_append(buffer, (const char*)p, 1);
+        }
+    }
+    buffer_append(buffer, "\"", 1);
+}
+
+static char* buffer_finish(ProfileBuffer* buffer) {
+    if (buffer->failed) {
+        free(buffer->data);
+        return NULL;
+    }
+    if (!buffer->data) {
+        return strdup("");
+    }
+    return buffer->data;
+}
+
+char* js_engine_profiler_export_collapsed(JSEngine* engine) {
+    if (!engine) {
+        return NULL;
+    }
+
+    ProfileBuffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+
+    const JSProfileTable* stacks = &engine->profiler.stacks;
+    for (size_t i = 0; i < stacks->capacity; i++) {
+        const JSProfileEntry* entry = &stacks->entries[i];
+        if (!entry->key) {
+            continue;
+        }
+        buffer_append_str(&buffer, entry->key);
+        buffer_append(&buffer, " ", 1);
+        buffer_append_u64(&buffer, entry->self);
+        buffer_append(&buffer, "\n", 1);
+    }
+
+    return buffer_finish(&buffer);
+}
+
+char* js_engine_profiler_export_json(JSEngine* engine) {
+    if (!engine) {
+        return NULL;
+    }
+
+    const JSProfiler* profiler = &engine->profiler;
+    ProfileBuffer buffer;
+    memset(&buffer, 0, sizeof(buffer));
+
+    buffer_append_str(&buffer, "{\"interval_us\":");
+    buffer_append_u64(&buffer, profiler->interval_us);
+    buffer_append_str(&buffer, ",\"samples\":");
+    buffer_append_u64(&buffer, profiler->samples);
+
+    buffer_append_str(&buffer, ",\"functions\":[");
+    int first = 1;
+    for (size_t i = 0; i < profiler->functions.capacity; i++) {
+        const JSProfileEntry* entry = &profiler->functions.entries[i];
+        if (!entry->key) {
+            continue;
+        }
+        buffer_append_str(&buffer, first ? "{\"name\":" : ",{\"name\":");
+        buffer_append_json_string(&buffer, entry->key);
+        buffer_append_str(&buffer, ",\"self\":");
+        buffer_append_u64(&buffer, entry->self);
+        buffer_append_str(&buffer, ",\"total\":");
+        buffer_append_u64(&buffer, entry->total);
+        buffer_append(&buffer, "}", 1);
+        first = 0;
+    }
+
+    buffer_append_str(&buffer, "],\"stacks\":[");
+    first = 1;
+    for (size_t i = 0; i < profiler->stacks.capacity; i++) {
+        const JSProfileEntry* entry = &profiler->stacks.entries[i];
+        if (!entry->key) {
+            continue;
+        }
+        buffer_append_str(&buffer, first ? "{\"stack\":" : ",{\"stack\":");
+        buffer_append_json_string(&buffer, entry->key);
+        buffer_append_str(&buffer, ",\"count\":");
+        buffer_append_u64(&buffer, entry->self);
+        buffer_append(&buffer, "}", 1);
+        first = 0;
+    }
+    buffer_append_str(&buffer, "]}");
+
+    return buffer_finish(&buffer);
+}
@@ -0,0 +1,289 @@
+#include "js/script_compiler.h"
+#include "js/bytecode_cache.h"
+#include "quickjs.h"
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+// Off-thread script compilation
+// Workers compile with JS_EVAL_FLAG_COMPILE_ONLY in their own runtime and
+// serialize with JS_WriteObject; the main context reads the bytecode back
+// with JS_ReadObject, so no QuickJS object ever crosses threads.
+
+#define MAX_COMPILE_THREADS 64
+
+struct JSCompileJob {
+    char* source;
+    size_t length;
+    char* filename;
+    uint8_t* bytecode;
+    size_t bytecode_size;
+    char* error;
+    int done;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+    struct JSCompileJob* next;
+};
+
+struct JSCompilePool {
+    pthread_t threads[MAX_COMPILE_THREADS];
+    int thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t available;
+    JSCompileJob* queue_head;
+    JSCompileJob* queue_tail;
+    JSBytecodeCache* bytecode_cache;
+    int shutting_down;
+};
+
+static void job_finish(JSCompileJob* job) {
+    pthread_mutex_lock(&job->lock);
+    job->done = 1;
+    pthread_cond_broadcast(&job->finished);
+    pthread_mutex_unlock(&job->lock);
+}
+
+static void job_compile(JSBytecodeCache* cache, JSContext* ctx, JSCompileJob* job) {
+    JSBytecodeKey key = js_bytecode_cache_key(job->source, job->length, job->filename);
+
+    if (cache) {
+        JSBytecodeEntry* entry = js_bytecode_cache_acquire(cache, key);
+        if (entry) {
+            size_t size;
+            const uint8_t* data = js_bytecode_entry_data(entry, &size);
+            job->bytecode = (uint8_t*)malloc(size);
+            if (job->bytecode) {
+                memcpy(job->bytecode, data, size);
+                job->bytecode_size = size;
+            }
+            js_bytecode_cache_release(cache, entry);
+            if (job->bytecode) {
+                return;
+            }
+        }
+    }
+
+    JSValue func = JS_Eval(ctx, job->source, job->length, job->filename,
+                           JS_EVAL_TYPE_GLOBAL | JS_EVAL_FLAG_COMPILE_ONLY);
+    if (JS_IsException(func)) {
+        JSValue exception = JS_GetException(ctx);
+        const char* error_str = JS_ToCString(ctx, exception);
+        job->error = strdup(error_str ? error_str : "compile error");
+        JS_FreeCString(ctx, error_str);
+        JS_FreeValue(ctx, exception);
+        return;
+    }
+
+    size_t size;
+    uint8_t* data = JS_WriteObject(ctx, &size, func, JS_WRITE_OBJ_BYTECODE);
+    JS_FreeValue(ctx, func);
+    if (!data) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        job->error = strdup("failed to serialize bytecode");
+        return;
+    }
+
+    // Copy out of the worker runtime's allocator
+    job->bytecode = (uint8_t*)malloc(size);
+    if (job->bytecode) {
+        memcpy(job->bytecode, data, size);
+        job->bytecode_size = size;
+        if (cache) {
+            js_bytecode_cache_store(cache, key, data, size);
+        }
+    } else {
+        job->error = strdup("out of memory");
+    }
+    js_free(ctx, data);
+}
+
+static void* worker_main(void* arg) {
+    JSCompilePool* pool = (JSCompilePool*)arg;
+
+    // The runtime is created on this thread so its stack limit is correct
+    JSRuntime* rt = JS_NewRuntime();
+    JSContext* ctx = rt ? JS_NewContext(rt) : NULL;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->queue_head && !pool->shutting_down) {
+            pthread_cond_wait(&pool->available, &pool->lock);
+        }
+        JSCompileJob* job = pool->queue_head;
+        if (!job) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pool->queue_head = job->next;
+        if (!pool->queue_head) {
+            pool->queue_tail = NULL;
+        }
+        JSBytecodeCache* cache = pool->bytecode_cache;
+        pthread_mutex_unlock(&pool->lock);
+
+        if (ctx) {
+            job_compile(cache, ctx, job);
+        } else {
+            job->error = strdup("compiler runtime unavailable");
+        }
+        job_finish(job);
+    }
+
+    if (ctx) {
+        JS_FreeContext(ctx);
+    }
+    if (rt) {
+        JS_FreeRuntime(rt);
+    }
+    return NULL;
+}
+
+JSCompilePool* js_compile_pool_create(int thread_count) {
+    if (thread_count <= 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cpus > 0 ? (int)cpus : 1;
+    }
+    if (thread_count > MAX_COMPILE_THREADS) {
+        thread_count = MAX_COMPILE_THREADS;
+    }
+
+    JSCompilePool* pool = (JSCompilePool*)calloc(1, sizeof(JSCompilePool));
+    if (!pool) {
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->available, NULL);
+
+    for (int i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker_main, pool) != 0) {
+            break;
+        }
+        pool->thread_count++;
+    }
+
+    if (pool->thread_count == 0) {
+        pthread_cond_destroy(&pool->available);
+        pthread_mutex_destroy(&pool->lock);
+        free(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+void js_compile_pool_destroy(JSCompilePool* pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = 1;
+    pthread_cond_broadcast(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->available);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+void js_compile_pool_set_bytecode_cache(JSCompilePool* pool, JSBytecodeCache* cache) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->bytecode_cache = cache;
+    pthread_mutex_unlock(&pool->lock);
+}
+
+JSCompileJob* js_compile_pool_submit(JSCompilePool* pool, const char* source, size_t length, const char* filename) {
+    if (!pool || !source || !filename) {
+        return NULL;
+    }
+
+    JSCompileJob* job = (JSCompileJob*)calloc(1, sizeof(JSCompileJob));
+    if (!job) {
+        return NULL;
+    }
+
+    // QuickJS expects NUL-terminated input
+    job->source = (char*)malloc(length + 1);
+    job->filename = strdup(filename);
+    if (!job->source || !job->filename) {
+        free(job->source);
+        free(job->filename);
+        free(job);
+        return NULL;
+    }
+    memcpy(job->source, source, length);
+    job->source[length] = '\0';
+    job->length = length;
+
+    pthread_mutex_init(&job->lock, NULL);
+    pthread_cond_init(&job->finished, NULL);
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->queue_tail) {
+        pool->queue_tail->next = job;
+    } else {
+        pool->queue_head = job;
+    }
+    pool->queue_tail = job;
+    pthread_cond_signal(&pool->available);
+    pthread_mutex_unlock(&pool->lock);
+
+    return job;
+}
+
+int js_compile_job_wait(JSCompileJob* job) {
+    if (!job) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&job->lock);
+    while (!job->done) {
+        pthread_cond_wait(&job->finished, &job->lock);
+    }
+    pthread_mutex_unlock(&job->lock);
+
+    return job->bytecode ? 0 : -1;
+}
+
+const uint8_t* js_compile_job_bytecode(JSCompileJob* job, size_t* size) {
+    if (!job || js_compile_job_wait(job) != 0) {
+        return NULL;
+    }
+    if (size) {
+        *size = job->bytecode_size;
+    }
+    return job->bytecode;
+}
+
+const char* js_compile_job_error(JSCompileJob* job) {
+    if (!job) {
+        return NULL;
+    }
+    js_compile_job_wait(job);
+    return job->error;
+}
+
+void js_compile_job_free(JSCompileJob* job) {
+    if (!job) {
+        return;
+    }
+
+    js_compile_job_wait(job);
+    pthread_cond_destroy(&job->finished);
+    pthread_mutex_destroy(&job->lock);
+    free(job->source);
+    free(job->filename);
+    free(job->bytecode);
+    free(job->error);
+    free(job);
+}
@@ -0,0 +1,1196 @@
+#include "layout/layout.h"
+#include "core/thread_pool.h"
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// Layout engine
+// Boxes are kept on the elements themselves (see the DOM layout cache) and
+// positioned relative to the content box of their container, the block that
+// laid them out. A subtree that is not marked layout dirty and keeps its
+// containing block width is therefore reused as is, wherever its container
+// moves it; a mutation only costs layout along the path from the mutated
+// node to the root plus the inline formatting contexts on that path.
+//
+// Block-level children are stacked with adjacent sibling margins collapsed.
+// Inline content (text, inline elements, inline-blocks and <br>) is broken
+// into line boxes; runs of inline content between block-level children are
+// laid out in place, as anonymous blocks would be.
+//
+// With a thread pool, the block children of a container are independent:
+// their width is known before they are laid out and their position is only
+// set afterwards. A layout first walks down the boxes that need layout
+// until it has enough such subtrees, lays those out on the workers, and
+// then runs the regular pass, which finds them done and only places them.
+
+#define ASCENT 0.8f                 // Share of the font size above the baseline
+#define FIT_EPSILON 0.01f
+#define TASKS_PER_WORKER 4          // Subtrees to gather per worker before going parallel
+
+typedef struct {
+    DOMNode* node;
+    const ComputedStyle* style;
+    float x;                        // Relative to the container's content box
+    float y;
+    float width;
+    float height;
+    size_t text_offset;             // In the container's text buffer
+    size_t length;
+    size_t line;
+} Fragment;
+
+typedef struct {
+    DOMNode* container;             // Content box x and y are relative to
+    const ComputedStyle* style;     // Style the box was laid out with
+    unsigned int generation;        // Engine generation the box was laid out in
+    int inline_level;               // Inline element: the union of its fragments
+    int prepared;                   // Laid out by a worker in the current layout
+    float containing_width;
+    float x;                        // Border box
+    float y;
+    float width;
+    float height;
+    float margin[4];
+    float border[4];
+    float padding[4];
+
+    // Line boxes, for block containers
+    Fragment* fragments;
+    size_t fragment_count;
+    size_t fragment_capacity;
+    char* text;                     // Whitespace-processed text of all fragments
+    size_t text_length;
+    size_t text_capacity;
+} LayoutBox;
+
+typedef enum {
+    ITEM_TEXT,
+    ITEM_BOX,
+    ITEM_BREAK
+} ItemKind;
+
+typedef struct {
+    ItemKind kind;
+    DOMNode* node;
+    const ComputedStyle* style;
+    size_t offset;                  // ITEM_TEXT: range in the container's text
+    size_t length;
+} InlineItem;
+
+// Per-thread state of a layout
+typedef struct {
+    // Inline items of the contexts being laid out, used as a stack since
+    // inline-blocks nest contexts
+    InlineItem* items;
+    size_t item_count;
+    size_t item_capacity;
+    LayoutStats stats;
+} LayoutWorker;
+
+// A block-level subtree laid out on a worker
+typedef struct {
+    DOMNode* node;
+    const ComputedStyle* style;
+    float containing_width;
+    int failed;
+} LayoutTask;
+
+typedef struct {
+    LayoutTask* tasks;
+    size_t count;
+    size_t capacity;
+} LayoutTaskList;
+
+struct LayoutEngine {
+    DOMDocument* doc;
+    StyleEngine* styles;
+    LayoutMeasureText measure;
+    void* measure_data;
+    unsigned int generation;        // Bumped to invalidate every box
+    int valid;                      // The last layout succeeded
+    float viewport_width;
+    float document_height;
+    LayoutWorker main;              // The calling thread's
+
+    ThreadPool* pool;
+    LayoutWorker* workers;          // One per pool worker
+    int worker_count;
+    LayoutTaskList levels[2];       // Subtrees of the current and the next level
+};
+
+// One inline formatting context being laid out
+typedef struct {
+    LayoutEngine* engine;
+    LayoutWorker* worker;
+    DOMNode* container;
+    LayoutBox* box;
+    const ComputedStyle* style;     // The container's
+    float width;
+    size_t first_item;
+    int after_space;                // Collapsible whitespace is swallowed next
+
+    // Current line
+    size_t line_start;              // First fragment of the line
+    size_t line;
+    float x;
+    float y;                        // Top of the line
+    float trailing;                 // Width of collapsible spaces ending the line
+    size_t trailing_length;
+    int has_content;
+    int break_after;                // A line may break after the last item
+    float extent;                   // Widest line
+} InlineContext;
+
+static LayoutBox* layout_box(LayoutEngine* engine, LayoutWorker* worker, DOMNode* node,
+                             const ComputedStyle* style, float containing_width, int shrink);
+
+// DOM release hook: the element went away
+static void box_release(void* value, void* user_data) {
+    LayoutBox* box = (LayoutBox*)value;
+    free(box->fragments);
+    free(box->text);
+    free(box);
+}
+
+static LayoutBox* box_for(DOMNode* node) {
+    LayoutBox* box = (LayoutBox*)dom_node_get_layout_cache(node);
+    if (box) {
+        return box;
+    }
+
+    box = (LayoutBox*)calloc(1, sizeof(LayoutBox));
+    if (!box) {
+        return NULL;
+    }
+    if (dom_node_set_layout_cache(node, box) != 0) {
+        free(box);
+        return NULL;
+    }
+    return box;
+}
+
+static const ComputedStyle* style_of(LayoutEngine* engine, DOMNode* node) {
+    const ComputedStyle* style = style_engine_get_style(engine->styles, (DOMElement*)node);
+    return style && style->display != CSS_DISPLAY_NONE ? style : NULL;
+}
+
+static float resolve_length(CSSLength length, float base) {
+    switch (length.type) {
+        case CSS_LENGTH_PX:
+            return length.value;
+        case CSS_LENGTH_PERCENT:
+            return length.value * base / 100.0f;
+        default:
+            return 0.0f;
+    }
+}
+
+static float line_height_of(const ComputedStyle* style) {
+    if (style->line_height.type == CSS_LENGTH_NUMBER) {
+        return style->line_height.value * style->font_size;
+    }
+    return style->line_height.value;
+}
+
+static float collapse_margins(float a, float b) {
+    if (a >= 0.0f && b >= 0.0f) {
+        return a > b ? a : b;
+    }
+    if (a < 0.0f && b < 0.0f) {
+        return a < b ? a : b;
+    }
+    return a + b;
+}
+
+static int is_tag(DOMNode* node, const char* tag) {
+    return strcasecmp(dom_element_get_tag_name((DOMElement*)node), tag) == 0;
+}
+
+// Built-in metrics: every character advances half an em
+static float default_measure(const char* text, size_t length, const ComputedStyle* style, void* user_data) {
+    size_t characters = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (((unsigned char)text[i] & 0xC0) != 0x80) {
+            characters++;
+        }
+    }
+    return (float)characters * style->font_size * 0.5f;
+}
+
+static float measure(LayoutEngine* engine, const char* text, size_t length, const ComputedStyle* style) {
+    return length > 0 ? engine->measure(text, length, style, engine->measure_data) : 0.0f;
+}
+
+// Inline content collection
+
+static int push_item(LayoutWorker* worker, const InlineItem* item) {
+    if (worker->item_count == worker->item_capacity) {
+        size_t capacity = worker->item_capacity ? worker->item_capacity * 2 : 64;
+        InlineItem* items = (InlineItem*)realloc(worker->items, capacity * sizeof(InlineItem));
+        if (!items) {
+            return -1;
+        }
+        worker->items = items;
+        worker->item_capacity = capacity;
+    }
+    worker->items[worker->item_count++] = *item;
+    return 0;
+}
+
+static int append_char(LayoutBox* box, char c) {
+    if (box->text_length == box->text_capacity) {
+        size_t capacity = box->text_capacity ? box->text_capacity * 2 : 64;
+        char* text = (char*)realloc(box->text, capacity);
+        if (!text) {
+            return -1;
+        }
+        box->text = text;
+        box->text_capacity = capacity;
+    }
+    box->text[box->text_length++] = c;
+    return 0;
+}
+
+static int flush_text(InlineContext* ctx, DOMNode* node, const ComputedStyle* style, size_t start) {
+    if (ctx->box->text_length == start) {
+        return 0;
+    }
+    InlineItem item = { ITEM_TEXT, node, style, start, ctx->box->text_length - start };
+    return push_item(ctx->worker, &item);
+}
+
+static int push_break(InlineContext* ctx, DOMNode* node, const ComputedStyle* style) {
+    InlineItem item = { ITEM_BREAK, node, style, 0, 0 };
+    return push_item(ctx->worker, &item);
+}
+
+// Apply white-space processing to a text node and queue the result
+static int collect_text(InlineContext* ctx, DOMNode* node, const ComputedStyle* style) {
+    size_t length;
+    const char* value = dom_node_get_value(node, &length);
+    if (!value) {
+        return 0;
+    }
+
+    CSSWhiteSpace mode = style->white_space;
+    int collapse = mode == CSS_WHITE_SPACE_NORMAL || mode == CSS_WHITE_SPACE_NOWRAP ||
+                   mode == CSS_WHITE_SPACE_PRE_LINE;
+    int keep_newlines = mode == CSS_WHITE_SPACE_PRE || mode == CSS_WHITE_SPACE_PRE_WRAP ||
+                        mode == CSS_WHITE_SPACE_PRE_LINE;
+
+    size_t start = ctx->box->text_length;
+    for (size_t i = 0; i < length; i++) {
+        char c = value[i];
+        if (c == '\r') {
+            continue;
+        }
+        if (c == '\n' && keep_newlines) {
+            if (flush_text(ctx, node, style, start) != 0 || push_break(ctx, node, style) != 0) {
+                return -1;
+            }
+            start = ctx->box->text_length;
+            ctx->after_space = collapse;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\f') {
+            if (collapse && ctx->after_space) {
+                continue;
+            }
+            if (append_char(ctx->box, ' ') != 0) {
+                return -1;
+            }
+            ctx->after_space = 1;
+            continue;
+        }
+        if (append_char(ctx->box, c) != 0) {
+            return -1;
+        }
+        ctx->after_space = 0;
+    }
+    return flush_text(ctx, node, style, start);
+}
+
+// Queue the inline content of the siblings from first up to stop
+static int collect_inline(InlineContext* ctx, DOMNode* first, DOMNode* stop, const ComputedStyle* style) {
+    for (DOMNode* node = first; node && node != stop; node = dom_node_get_next_sibling(node)) {
+        DOMNodeType type = dom_node_get_type(node);
+        if (type == NODE_TEXT) {
+            dom_node_clear_layout_dirty(node);
+            if (collect_text(ctx, node, style) != 0) {
+                return -1;
+            }
+            continue;
+        }
+        if (type != NODE_ELEMENT) {
+            continue;
+        }
+
+        const ComputedStyle* child_style = style_of(ctx->engine, node);
+        if (!child_style) {
+            continue;
+        }
+        if (is_tag(node, "br")) {
+            dom_node_clear_layout_dirty(node);
+            if (push_break(ctx, node, child_style) != 0) {
+                return -1;
+            }
+            ctx->after_space = 1;
+        } else if (child_style->display == CSS_DISPLAY_INLINE) {
+            LayoutBox* box = box_for(node);
+            if (!box) {
+                return -1;
+            }
+            dom_node_clear_layout_dirty(node);
+            memset(box->margin, 0, sizeof(box->margin));
+            memset(box->border, 0, sizeof(box->border));
+            memset(box->padding, 0, sizeof(box->padding));
+            box->inline_level = 1;
+            box->style = child_style;
+            box->generation = ctx->engine->generation;
+            box->container = ctx->container;
+            // No fragment yet; an element that ends up with none sits at
+            // the container's origin, as on a first layout
+            box->x = 0.0f;
+            box->y = 0.0f;
+            box->width = -1.0f;
+            box->height = 0.0f;
+            if (collect_inline(ctx, dom_node_get_first_child(node), NULL, child_style) != 0) {
+                return -1;
+            }
+        } else {
+            // Inline-blocks shrink to fit; a block inside an inline element
+            // is laid out as an atomic box at full width
+            LayoutBox* box = layout_box(ctx->engine, ctx->worker, node, child_style, ctx->width,
+                                        child_style->display == CSS_DISPLAY_INLINE_BLOCK);
+            if (!box) {
+                return -1;
+            }
+            InlineItem item = { ITEM_BOX, node, child_style, 0, 0 };
+            if (push_item(ctx->worker, &item) != 0) {
+                return -1;
+            }
+            ctx->after_space = 0;
+        }
+    }
+    return 0;
+}
+
+// Line breaking
+
+static Fragment* push_fragment(LayoutBox* box) {
+    if (box->fragment_count == box->fragment_capacity) {
+        size_t capacity = box->fragment_capacity ? box->fragment_capacity * 2 : 16;
+        Fragment* fragments = (Fragment*)realloc(box->fragments, capacity * sizeof(Fragment));
+        if (!fragments) {
+            return NULL;
+        }
+        box->fragments = fragments;
+        box->fragment_capacity = capacity;
+    }
+    Fragment* fragment = &box->fragments[box->fragment_count++];
+    memset(fragment, 0, sizeof(Fragment));
+    return fragment;
+}
+
+static void finish_line(InlineContext* ctx, int forced) {
+    LayoutBox* box = ctx->box;
+    if (!ctx->has_content && !forced) {
+        return;
+    }
+
+    // Collapsible spaces at the end of a line hang and are dropped
+    if (ctx->trailing_length > 0 && box->fragment_count > ctx->line_start) {
+        Fragment* last = &box->fragments[box->fragment_count - 1];
+        last->width -= ctx->trailing;
+        last->length -= ctx->trailing_length;
+        if (last->length == 0) {
+            box->fragment_count--;
+        }
+    }
+
+    // Baselines line up; the container's own metrics act as a strut
+    float strut = line_height_of(ctx->style);
+    float ascent = (strut - ctx->style->font_size) / 2.0f + ASCENT * ctx->style->font_size;
+    float descent = strut - ascent;
+    for (size_t i = ctx->line_start; i < box->fragment_count; i++) {
+        Fragment* fragment = &box->fragments[i];
+        float a, d;
+        if (fragment->length > 0 || dom_node_get_type(fragment->node) == NODE_TEXT) {
+            float line_height = line_height_of(fragment->style);
+            a = (line_height - fragment->style->font_size) / 2.0f + ASCENT * fragment->style->font_size;
+            d = line_height - a;
+        } else {
+            a = fragment->height;
+            d = 0.0f;
+        }
+        ascent = a > ascent ? a : ascent;
+        descent = d > descent ? d : descent;
+    }
+
+    float used = 0.0f;
+    if (box->fragment_count > ctx->line_start) {
+        Fragment* last = &box->fragments[box->fragment_count - 1];
+        used = last->x + last->width;
+    }
+    float shift = 0.0f;
+    if (used < ctx->width) {
+        if (ctx->style->text_align == CSS_TEXT_ALIGN_RIGHT) {
+            shift = ctx->width - used;
+        } else if (ctx->style->text_align == CSS_TEXT_ALIGN_CENTER) {
+            shift = (ctx->width - used) / 2.0f;
+        }
+    }
+
+    for (size_t i = ctx->line_start; i < box->fragment_count; i++) {
+        Fragment* fragment = &box->fragments[i];
+        fragment->x += shift;
+        if (dom_node_get_type(fragment->node) == NODE_TEXT) {
+            fragment->y = ctx->y + ascent - ASCENT * fragment->style->font_size;
+            fragment->height = fragment->style->font_size;
+        } else {
+            // Atomic boxes sit on the baseline with their bottom margin edge
+            fragment->y = ctx->y + ascent - fragment->height;
+            LayoutBox* child = (LayoutBox*)dom_node_get_layout_cache(fragment->node);
+            child->container = ctx->container;
+            child->x = fragment->x + child->margin[3];
+            child->y = fragment->y + child->margin[0];
+        }
+        fragment->line = ctx->line;
+    }
+
+    if (used > ctx->extent) {
+        ctx->extent = used;
+    }
+    ctx->y += ascent + descent;
+    ctx->line++;
+    ctx->worker->stats.lines++;
+    ctx->line_start = box->fragment_count;
+    ctx->x = 0.0f;
+    ctx->trailing = 0.0f;
+    ctx->trailing_length = 0;
+    ctx->has_content = 0;
+    ctx->break_after = 0;
+}
+
+// Add text[start, end) to the current line, extending the previous
+// fragment when it continues the same text
+static int place_run(InlineContext* ctx, const InlineItem* item, size_t start, size_t end, float width) {
+    LayoutBox* box = ctx->box;
+    Fragment* fragment = NULL;
+    if (box->fragment_count > ctx->line_start) {
+        fragment = &box->fragments[box->fragment_count - 1];
+        if (fragment->node != item->node || fragment->text_offset + fragment->length != start) {
+            fragment = NULL;
+        }
+    }
+    if (!fragment) {
+        fragment = push_fragment(box);
+        if (!fragment) {
+            return -1;
+        }
+        fragment->node = item->node;
+        fragment->style = item->style;
+        fragment->x = ctx->x;
+        fragment->text_offset = start;
+    }
+    fragment->length += end - start;
+    fragment->width += width;
+    ctx->x += width;
+    ctx->has_content = 1;
+    return 0;
+}
+
+static int place_text(InlineContext* ctx, const InlineItem* item) {
+    const char* text = ctx->box->text;
+    CSSWhiteSpace mode = item->style->white_space;
+    int wrap = mode == CSS_WHITE_SPACE_NORMAL || mode == CSS_WHITE_SPACE_PRE_WRAP || mode == CSS_WHITE_SPACE_PRE_LINE;
+    int collapse = mode == CSS_WHITE_SPACE_NORMAL || mode == CSS_WHITE_SPACE_NOWRAP ||
+                   mode == CSS_WHITE_SPACE_PRE_LINE;
+
+    size_t p = item->offset;
+    size_t end = item->offset + item->length;
+    while (p < end) {
+        // Collapsible spaces never start a line
+        if (collapse && !ctx->has_content && text[p] == ' ') {
+            p++;
+            continue;
+        }
+
+        // A unit is a word and the spaces after it; without wrapping, the
+        // rest of the item
+        size_t word_end = p;
+        while (word_end < end && (text[word_end] != ' ' || !wrap)) {
+            word_end++;
+        }
+        if (!wrap) {
+            while (word_end > p && text[word_end - 1] == ' ') {
+                word_end--;
+            }
+        }
+        size_t unit_end = word_end;
+        while (unit_end < end && text[unit_end] == ' ') {
+            unit_end++;
+        }
+
+        float word_width = measure(ctx->engine, text + p, word_end - p, item->style);
+        if (ctx->has_content && ctx->break_after &&
+            ctx->x - ctx->trailing + word_width > ctx->width + FIT_EPSILON) {
+            finish_line(ctx, 0);
+            continue;
+        }
+
+        float space_width = measure(ctx->engine, text + word_end, unit_end - word_end, item->style);
+        if (place_run(ctx, item, p, unit_end, word_width + space_width) != 0) {
+            return -1;
+        }
+        if (collapse) {
+            ctx->trailing = unit_end > word_end ? space_width : 0.0f;
+            ctx->trailing_length = unit_end - word_end;
+        } else {
+            ctx->trailing = 0.0f;
+            ctx->trailing_length = 0;
+        }
+        ctx->break_after = wrap && unit_end > word_end;
+        p = unit_end;
+    }
+    return 0;
+}
+
+static int place_box(InlineContext* ctx, const InlineItem* item) {
+    LayoutBox* child = (LayoutBox*)dom_node_get_layout_cache(item->node);
+    float width = child->margin[3] + child->width + child->margin[1];
+    float height = child->margin[0] + child->height + child->margin[2];
+    if (ctx->has_content && ctx->break_after && ctx->x - ctx->trailing + width > ctx->width + FIT_EPSILON) {
+        finish_line(ctx, 0);
+    }
+
+    Fragment* fragment = push_fragment(ctx->box);
+    if (!fragment) {
+        return -1;
+    }
+    fragment->node = item->node;
+    fragment->style = item->style;
+    fragment->x = ctx->x;
+    fragment->width = width;
+    fragment->height = height;
+    ctx->x += width;
+    ctx->trailing = 0.0f;
+    ctx->trailing_length = 0;
+    ctx->has_content = 1;
+    ctx->break_after = 1;
+    return 0;
+}
+
+// Grow the geometry of the inline elements a fragment sits in
+static void extend_inline_boxes(InlineContext* ctx, const Fragment* fragment) {
+    for (DOMNode* node = dom_node_get_parent(fragment->node); node && node != ctx->container;
+         node = dom_node_get_parent(node)) {
+        LayoutBox* box = (LayoutBox*)dom_node_get_layout_cache(node);
+        if (!box || !box->inline_level) {
+            continue;
+        }
+        if (box->width < 0.0f) {
+            box->x = fragment->x;
+            box->y = fragment->y;
+            box->width = fragment->width;
+            box->height = fragment->height;
+            continue;
+        }
+        float right = box->x + box->width;
+        float bottom = box->y + box->height;
+        if (fragment->x < box->x) {
+            box->x = fragment->x;
+        }
+        if (fragment->y < box->y) {
+            box->y = fragment->y;
+        }
+        if (fragment->x + fragment->width > right) {
+            right = fragment->x + fragment->width;
+        }
+        if (fragment->y + fragment->height > bottom) {
+            bottom = fragment->y + fragment->height;
+        }
+        box->width = right - box->x;
+        box->height = bottom - box->y;
+    }
+}
+
+// Lay out the siblings from first up to stop as lines starting at y,
+// appending to the container's fragments; returns the height used
+static int layout_inline(LayoutEngine* engine, LayoutWorker* worker, DOMNode* container, LayoutBox* box,
+                         const ComputedStyle* style, DOMNode* first, DOMNode* stop, float width, float y,
+                         float* height, float* extent) {
+    InlineContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.engine = engine;
+    ctx.worker = worker;
+    ctx.container = container;
+    ctx.box = box;
+    ctx.style = style;
+    ctx.width = width;
+    ctx.first_item = worker->item_count;
+    ctx.after_space = 1;
+    ctx.y = y;
+    ctx.line_start = box->fragment_count;
+    if (box->fragment_count > 0) {
+        ctx.line = box->fragments[box->fragment_count - 1].line + 1;
+    }
+
+    size_t first_fragment = box->fragment_count;
+    int result = collect_inline(&ctx, first, stop, style);
+    for (size_t i = ctx.first_item; result == 0 && i < worker->item_count; i++) {
+        InlineItem item = worker->items[i];
+        switch (item.kind) {
+            case ITEM_TEXT:
+                result = place_text(&ctx, &item);
+                break;
+            case ITEM_BOX:
+                result = place_box(&ctx, &item);
+                break;
+            case ITEM_BREAK:
+                finish_line(&ctx, 1);
+                break;
+        }
+    }
+    worker->item_count = ctx.first_item;
+    if (result != 0) {
+        return -1;
+    }
+    finish_line(&ctx, 0);
+
+    for (size_t i = first_fragment; i < box->fragment_count; i++) {
+        extend_inline_boxes(&ctx, &box->fragments[i]);
+    }
+    *height = ctx.y - y;
+    if (ctx.extent > *extent) {
+        *extent = ctx.extent;
+    }
+    return 0;
+}
+
+// Block layout
+
+static int is_block_level(LayoutEngine* engine, DOMNode* node) {
+    if (dom_node_get_type(node) != NODE_ELEMENT) {
+        return 0;
+    }
+    const ComputedStyle* style = style_of(engine, node);
+    return style && style->display == CSS_DISPLAY_BLOCK;
+}
+
+// Lay out an element's children in a content box of the given width;
+// returns the content height
+static int layout_children(LayoutEngine* engine, LayoutWorker* worker, DOMNode* node, LayoutBox* box,
+                           float width, float* height, float* extent) {
+    box->fragment_count = 0;
+    box->text_length = 0;
+
+    int has_block = 0;
+    for (DOMNode* child = dom_node_get_first_child(node); child && !has_block; child = dom_node_get_next_sibling(child)) {
+        has_block = is_block_level(engine, child);
+    }
+    if (!has_block) {
+        return layout_inline(engine, worker, node, box, box->style, dom_node_get_first_child(node), NULL, width,
+                             0.0f, height, extent);
+    }
+
+    float cursor = 0.0f;
+    float pending_margin = 0.0f;
+    DOMNode* run = NULL;            // First node of the current inline run
+    for (DOMNode* child = dom_node_get_first_child(node);; child = dom_node_get_next_sibling(child)) {
+        if (child && !is_block_level(engine, child)) {
+            if (!run) {
+                run = child;
+            }
+            continue;
+        }
+
+        if (run) {
+            float run_height = 0.0f;
+            if (layout_inline(engine, worker, node, box, box->style, run, child, width, cursor + pending_margin,
+                              &run_height, extent) != 0) {
+                return -1;
+            }
+            if (run_height > 0.0f) {
+                cursor += pending_margin + run_height;
+                pending_margin = 0.0f;
+            }
+            run = NULL;
+        }
+        if (!child) {
+            break;
+        }
+
+        LayoutBox* child_box = layout_box(engine, worker, child, style_of(engine, child), width, 0);
+        if (!child_box) {
+            return -1;
+        }
+        child_box->container = node;
+        child_box->x = child_box->margin[3];
+        child_box->y = cursor + collapse_margins(pending_margin, child_box->margin[0]);
+        cursor = child_box->y + child_box->height;
+        pending_margin = child_box->margin[2];
+
+        float right = child_box->margin[3] + child_box->width + child_box->margin[1];
+        if (right > *extent) {
+            *extent = right;
+        }
+    }
+
+    *height = cursor + pending_margin;
+    return 0;
+}
+
+// Whether a box can be kept as it was last laid out
+static int box_reusable(LayoutEngine* engine, DOMNode* node, const LayoutBox* box, const ComputedStyle* style,
+                        float containing_width) {
+    return !dom_node_get_layout_dirty(node) && box->generation == engine->generation && !box->inline_level &&
+           box->style == style && box->containing_width == containing_width;
+}
+
+// Resolve a box's margins, borders and padding against its containing block
+// and return its content width. Auto heights are left to the caller.
+static float resolve_edges(LayoutBox* box, DOMNode* node, const ComputedStyle* style, float containing_width,
+                           int shrink, int* auto_width, float* intrinsic_height) {
+    for (int side = 0; side < 4; side++) {
+        box->margin[side] = resolve_length(style->margin[side], containing_width);
+        box->border[side] = style->border_width[side];
+        box->padding[side] = resolve_length(style->padding[side], containing_width);
+    }
+    float horizontal = box->border[1] + box->border[3] + box->padding[1] + box->padding[3];
+
+    float width;
+    float attribute_width = 0.0f;
+    *auto_width = style->width.type == CSS_LENGTH_AUTO;
+    *intrinsic_height = 0.0f;
+    if (is_tag(node, "img")) {
+        // Images have no content to size them; use their size attributes
+        const char* value = dom_element_get_attribute((DOMElement*)node, "width");
+        attribute_width = value ? strtof(value, NULL) : 0.0f;
+        value = dom_element_get_attribute((DOMElement*)node, "height");
+        *intrinsic_height = value ? strtof(value, NULL) : 0.0f;
+    }
+    if (!*auto_width) {
+        width = resolve_length(style->width, containing_width);
+    } else if (attribute_width > 0.0f) {
+        width = attribute_width;
+        *auto_width = 0;
+    } else {
+        width = containing_width - box->margin[1] - box->margin[3] - horizontal;
+    }
+    if (width < 0.0f) {
+        width = 0.0f;
+    }
+
+    // Auto margins take up the space a block of definite width leaves
+    int left_auto = style->margin[3].type == CSS_LENGTH_AUTO;
+    int right_auto = style->margin[1].type == CSS_LENGTH_AUTO;
+    if (!shrink && !*auto_width && (left_auto || right_auto)) {
+        float remaining = containing_width - width - horizontal - box->margin[1] - box->margin[3];
+        if (remaining < 0.0f) {
+            remaining = 0.0f;
+        }
+        if (left_auto && right_auto) {
+            box->margin[1] = box->margin[3] = remaining / 2.0f;
+        } else if (left_auto) {
+            box->margin[3] = remaining;
+        } else {
+            box->margin[1] = remaining;
+        }
+    }
+    return width;
+}
+
+// Lay out an element, or keep its cached layout when nothing it depends on
+// changed. The caller positions the box.
+static LayoutBox* layout_box(LayoutEngine* engine, LayoutWorker* worker, DOMNode* node,
+                             const ComputedStyle* style, float containing_width, int shrink) {
+    LayoutBox* box = box_for(node);
+    if (!box) {
+        return NULL;
+    }
+    if (box_reusable(engine, node, box, style, containing_width)) {
+        // A subtree a worker just laid out is new, not reused
+        if (box->prepared) {
+            box->prepared = 0;
+        } else {
+            worker->stats.boxes_reused++;
+        }
+        return box;
+    }
+    dom_node_clear_layout_dirty(node);
+    worker->stats.boxes_laid_out++;
+
+    box->style = style;
+    box->generation = engine->generation;
+    box->inline_level = 0;
+    box->prepared = 0;
+    box->containing_width = containing_width;
+    int auto_width;
+    float intrinsic_height;
+    float width = resolve_edges(box, node, style, containing_width, shrink, &auto_width, &intrinsic_height);
+
+    float height = 0.0f;
+    float extent = 0.0f;
+    if (layout_children(engine, worker, node, box, width, &height, &extent) != 0) {
+        return NULL;
+    }
+    // Shrink to fit: lay out again at the width the content actually used
+    if (shrink && auto_width && extent < width) {
+        width = extent;
+        extent = 0.0f;
+        if (layout_children(engine, worker, node, box, width, &height, &extent) != 0) {
+            return NULL;
+        }
+    }
+
+    if (style->height.type == CSS_LENGTH_PX) {
+        height = style->height.value;
+    } else if (intrinsic_height > 0.0f && style->height.type == CSS_LENGTH_AUTO) {
+        height = intrinsic_height;
+    }
+    box->width = width + box->border[1] + box->border[3] + box->padding[1] + box->padding[3];
+    box->height = height + box->border[0] + box->border[2] + box->padding[0] + box->padding[2];
+    return box;
+}
+
+// Parallel layout
+
+static int task_list_push(LayoutTaskList* list, DOMNode* node, const ComputedStyle* style,
+                          float containing_width) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        LayoutTask* tasks = (LayoutTask*)realloc(list->tasks, capacity * sizeof(LayoutTask));
+        if (!tasks) {
+            return -1;
+        }
+        list->tasks = tasks;
+        list->capacity = capacity;
+    }
+    LayoutTask* task = &list->tasks[list->count++];
+    task->node = node;
+    task->style = style;
+    task->containing_width = containing_width;
+    task->failed = 0;
+    return 0;
+}
+
+// Queue a block-level element unless its cached layout can be kept
+static int queue_box(LayoutEngine* engine, LayoutTaskList* list, DOMNode* node, const ComputedStyle* style,
+                     float containing_width) {
+    LayoutBox* box = (LayoutBox*)dom_node_get_layout_cache(node);
+    if (box && box_reusable(engine, node, box, style, containing_width)) {
+        return 0;
+    }
+    return task_list_push(list, node, style, containing_width);
+}
+
+// Queue the block-level children of a box that needs layout; the box
+// itself is laid out by the regular pass
+static int queue_children(LayoutEngine* engine, LayoutTaskList* list, const LayoutTask* task) {
+    LayoutBox* box = box_for(task->node);
+    if (!box) {
+        return -1;
+    }
+    int auto_width;
+    float intrinsic_height;
+    float width = resolve_edges(box, task->node, task->style, task->containing_width, 0, &auto_width,
+                                &intrinsic_height);
+    for (DOMNode* child = dom_node_get_first_child(task->node); child; child = dom_node_get_next_sibling(child)) {
+        if (is_block_level(engine, child) && queue_box(engine, list, child, style_of(engine, child), width) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void layout_task(void* user_data, size_t index, int worker) {
+    LayoutEngine* engine = (LayoutEngine*)user_data;
+    LayoutTask* task = &engine->levels[0].tasks[index];
+    LayoutBox* box = layout_box(engine, &engine->workers[worker], task->node, task->style,
+                                task->containing_width, 0);
+    if (box) {
+        box->prepared = 1;
+    }
+    task->failed = !box;
+}
+
+// Lay out independent block subtrees on the pool ahead of the regular pass
+static int layout_parallel(LayoutEngine* engine, float viewport_width) {
+    LayoutTaskList* current = &engine->levels[0];
+    LayoutTaskList* next = &engine->levels[1];
+    size_t target = (size_t)engine->worker_count * TASKS_PER_WORKER;
+
+    current->count = 0;
+    DOMNode* root = (DOMNode*)engine->doc;
+    for (DOMNode* child = dom_node_get_first_child(root); child; child = dom_node_get_next_sibling(child)) {
+        const ComputedStyle* style = dom_node_get_type(child) == NODE_ELEMENT ? style_of(engine, child) : NULL;
+        if (style && queue_box(engine, current, child, style, viewport_width) != 0) {
+            return -1;
+        }
+    }
+    while (current->count > 0 && current->count < target) {
+        next->count = 0;
+        for (size_t i = 0; i < current->count; i++) {
+            if (queue_children(engine, next, &current->tasks[i]) != 0) {
+                return -1;
+            }
+        }
+        if (next->count == 0) {
+            break;
+        }
+        LayoutTaskList swap = *current;
+        *current = *next;
+        *next = swap;
+    }
+    if (current->count < 2) {
+        return 0;
+    }
+
+    // Workers must not materialize lazily parsed nodes
+    for (size_t i = 0; i < current->count; i++) {
+        if (dom_node_materialize(current->tasks[i].node) != 0) {
+            return -1;
+        }
+    }
+    if (thread_pool_parallel_for(engine->pool, current->count, layout_task, engine) != 0) {
+        return -1;
+    }
+
+    int failed = 0;
+    for (size_t i = 0; i < current->count; i++) {
+        failed |= current->tasks[i].failed;
+    }
+    for (int w = 0; w < engine->worker_count; w++) {
+        LayoutStats* stats = &engine->workers[w].stats;
+        engine->main.stats.boxes_laid_out += stats->boxes_laid_out;
+        engine->main.stats.boxes_reused += stats->boxes_reused;
+        engine->main.stats.lines += stats->lines;
+        memset(stats, 0, sizeof(LayoutStats));
+    }
+    return failed ? -1 : 0;
+}
+
+LayoutEngine* layout_engine_create(DOMDocument* doc, StyleEngine* styles) {
+    if (!doc || !styles) {
+        return NULL;
+    }
+
+    LayoutEngine* engine = (LayoutEngine*)calloc(1, sizeof(LayoutEngine));
+    if (!engine) {
+        return NULL;
+    }
+    engine->doc = doc;
+    engine->styles = styles;
+    engine->measure = default_measure;
+    engine->generation = 1;
+
+    dom_document_set_layout_cache(doc, box_release, engine);
+    return engine;
+}
+
+void layout_engine_destroy(LayoutEngine* engine) {
+    if (!engine) {
+        return;
+    }
+
+    // Hands every box back through box_release
+    dom_document_set_layout_cache(engine->doc, NULL, NULL);
+    layout_engine_set_thread_pool(engine, NULL);
+    free(engine->levels[0].tasks);
+    free(engine->levels[1].tasks);
+    free(engine->main.items);
+    free(engine);
+}
+
+int layout_engine_set_text_measure(LayoutEngine* engine, LayoutMeasureText measure, void* user_data) {
+    if (!engine) {
+        return -1;
+    }
+
+    engine->measure = measure ? measure : default_measure;
+    engine->measure_data = user_data;
+    engine->generation++;
+    engine->valid = 0;
+    return 0;
+}
+
+int layout_engine_set_thread_pool(LayoutEngine* engine, ThreadPool* pool) {
+    if (!engine) {
+        return -1;
+    }
+
+    int worker_count = pool ? thread_pool_get_worker_count(pool) : 0;
+    LayoutWorker* workers = NULL;
+    if (worker_count > 1) {
+        workers = (LayoutWorker*)calloc((size_t)worker_count, sizeof(LayoutWorker));
+        if (!workers) {
+            return -1;
+        }
+    }
+
+    for (int w = 0; w < engine->worker_count; w++) {
+        free(engine->workers[w].items);
+    }
+    free(engine->workers);
+    engine->pool = workers ? pool : NULL;
+    engine->workers = workers;
+    engine->worker_count = workers ? worker_count : 0;
+    return 0;
+}
+
+int layout_engine_layout(LayoutEngine* engine, float viewport_width) {
+    if (!engine) {
+        return -1;
+    }
+
+    memset(&engine->main.stats, 0, sizeof(LayoutStats));
+    if (style_engine_resolve(engine->styles) != 0) {
+        return -1;
+    }
+
+    DOMNode* root = (DOMNode*)engine->doc;
+    if (engine->valid && engine->viewport_width == viewport_width && !dom_node_get_layout_dirty(root)) {
+        return 0;
+    }
+    dom_node_clear_layout_dirty(root);
+    engine->valid = 0;
+    engine->viewport_width = viewport_width;
+    if (engine->worker_count > 1 && layout_parallel(engine, viewport_width) != 0) {
+        engine->generation++;
+        return -1;
+    }
+
+    // The root element is laid out in the initial containing block
+    float cursor = 0.0f;
+    float pending_margin = 0.0f;
+    for (DOMNode* child = dom_node_get_first_child(root); child; child = dom_node_get_next_sibling(child)) {
+        if (dom_node_get_type(child) != NODE_ELEMENT) {
+            continue;
+        }
+        const ComputedStyle* style = style_of(engine, child);
+        if (!style) {
+            continue;
+        }
+
+        LayoutBox* box = layout_box(engine, &engine->main, child, style, viewport_width, 0);
+        if (!box) {
+            // Boxes laid out so far may be half done
+            engine->generation++;
+            return -1;
+        }
+        box->container = root;
+        box->x = box->margin[3];
+        box->y = cursor + collapse_margins(pending_margin, box->margin[0]);
+        cursor = box->y + box->height;
+        pending_margin = box->margin[2];
+    }
+
+    engine->document_height = cursor + pending_margin;
+    engine->valid = 1;
+    return 0;
+}
+
+float layout_engine_get_document_height(LayoutEngine* engine) {
+    return engine ? engine->document_height : 0.0f;
+}
+
+// The box of a node laid out by the last layout, if that is still current
+static LayoutBox* current_box(LayoutEngine* engine, DOMNode* node) {
+    if (!engine->valid || dom_node_get_layout_dirty((DOMNode*)engine->doc)) {
+        return NULL;
+    }
+
+    // Detached nodes and nodes below display: none keep stale boxes
+    for (DOMNode* ancestor = node; ancestor != (DOMNode*)engine->doc; ancestor = dom_node_get_parent(ancestor)) {
+        if (!ancestor || (dom_node_get_type(ancestor) == NODE_ELEMENT && !style_of(engine, ancestor))) {
+            return NULL;
+        }
+    }
+
+    LayoutBox* box = (LayoutBox*)dom_node_get_layout_cache(node);
+    return box && box->generation == engine->generation ? box : NULL;
+}
+
+// Document position of a box's border box
+static void box_origin(LayoutEngine* engine, const LayoutBox* box, float* x, float* y) {
+    *x = box->x;
+    *y = box->y;
+    for (DOMNode* container = box->container; container && container != (DOMNode*)engine->doc;) {
+        const LayoutBox* outer = (const LayoutBox*)dom_node_get_layout_cache(container);
+        *x += outer->x + outer->border[3] + outer->padding[3];
+        *y += outer->y + outer->border[0] + outer->padding[0];
+        container = outer->container;
+    }
+}
+
+int layout_engine_get_geometry(LayoutEngine* engine, DOMElement* element, LayoutGeometry* geometry) {
+    if (!engine || !element || !geometry) {
+        return -1;
+    }
+
+    LayoutBox* box = current_box(engine, (DOMNode*)element);
+    if (!box) {
+        return -1;
+    }
+
+    float x, y;
+    box_origin(engine, box, &x, &y);
+    geometry->border_box.x = x;
+    geometry->border_box.y = y;
+    geometry->border_box.width = box->width > 0.0f ? box->width : 0.0f;
+    geometry->border_box.height = box->height > 0.0f ? box->height : 0.0f;
+    geometry->content_box.x = x + box->border[3] + box->padding[3];
+    geometry->content_box.y = y + box->border[0] + box->padding[0];
+    geometry->content_box.width = geometry->border_box.width - box->border[1] - box->border[3] -
+                                  box->padding[1] - box->padding[3];
+    geometry->content_box.height = geometry->border_box.height - box->border[0] - box->border[2] -
+                                   box->padding[0] - box->padding[2];
+    memcpy(geometry->margin, box->margin, sizeof(box->margin));
+    memcpy(geometry->border, box->border, sizeof(box->border));
+    memcpy(geometry->padding, box->padding, sizeof(box->padding));
+    return 0;
+}
+
+size_t layout_engine_get_fragment_count(LayoutEngine* engine, DOMElement* element) {
+    if (!engine || !element) {
+        return 0;
+    }
+
+    LayoutBox* box = current_box(engine, (DOMNode*)element);
+    return box && !box->inline_level ? box->fragment_count : 0;
+}
+
+int layout_engine_get_fragment(LayoutEngine* engine, DOMElement* element, size_t index, LayoutFragment* fragment) {
+    if (!engine || !element || !fragment) {
+        return -1;
+    }
+
+    LayoutBox* box = current_box(engine, (DOMNode*)element);
+    if (!box || box->inline_level || index >= box->fragment_count) {
+        return -1;
+    }
+
+    const Fragment* source = &box->fragments[index];
+    float x, y;
+    box_origin(engine, box, &x, &y);
+    fragment->node = source->node;
+    fragment->style = source->style;
+    fragment->rect.x = x + box->border[3] + box->padding[3] + source->x;
+    fragment->rect.y = y + box->border[0] + box->padding[0] + source->y;
+    fragment->rect.width = source->width;
+    fragment->rect.height = source->height;
+    fragment->text = source->length > 0 ? box->text + source->text_offset : NULL;
+    fragment->length = source->length;
+    fragment->line = source->line;
+    return 0;
+}
+
+int layout_engine_get_stats(LayoutEngine* engine, LayoutStats* stats) {
+    if (!engine || !stats) {
+        return -1;
+    }
+
+    *stats = engine->main.stats;
+    return 0;
+}
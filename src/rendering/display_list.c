@@ -0,0 +1,495 @@
+#include "display_list_internal.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+// Retained display lists
+// Paint records ops here instead of straight into the frame, so a subtree
+// that did not change can be replayed from its cached list. Replaying is a
+// copy with an offset, and the renderer's frame diff then finds nothing to
+// repaint for it.
+
+#define FORMAT_VERSION 1
+
+// Geometry further out than this is dropped on replay rather than risking
+// int overflow in the rasterizer
+#define COORD_LIMIT (1LL << 30)
+
+// Serialized header; op records follow, each trailed by its pixel payload
+typedef struct {
+    char magic[4];
+    uint32_t format;
+    uint32_t op_count;
+    uint32_t reserved;
+} ListHeader;
+
+typedef struct {
+    uint32_t type;
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+    uint8_t color[4];
+    uint8_t color_to[4];
+    uint32_t direction;
+    int32_t widths[4];
+    int32_t source_width;
+    int32_t source_height;
+} OpRecord;
+
+DisplayList* display_list_create(void) {
+    return (DisplayList*)calloc(1, sizeof(DisplayList));
+}
+
+void display_list_destroy(DisplayList* list) {
+    if (!list) {
+        return;
+    }
+
+    free(list->ops);
+    free(list->pixel_data);
+    free(list);
+}
+
+void display_list_clear(DisplayList* list) {
+    if (list) {
+        list->count = 0;
+    }
+}
+
+size_t display_list_get_count(const DisplayList* list) {
+    return list ? list->count : 0;
+}
+
+DisplayOp* display_list_push(DisplayList* list, DisplayOpType type, int x, int y, int width, int height) {
+    if (!list || width <= 0 || height <= 0) {
+        return NULL;
+    }
+
+    // The renderer bins ops by 32-bit index
+    if (list->count >= 0xFFFFFFFFu) {
+        return NULL;
+    }
+
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        DisplayOp* ops = (DisplayOp*)realloc(list->ops, capacity * sizeof(DisplayOp));
+        if (!ops) {
+            return NULL;
+        }
+        list->ops = ops;
+        list->capacity = capacity;
+    }
+
+    DisplayOp* op = &list->ops[list->count++];
+    memset(op, 0, sizeof(DisplayOp));
+    op->type = type;
+    op->x = x;
+    op->y = y;
+    op->width = width;
+    op->height = height;
+    return op;
+}
+
+int display_list_copy(DisplayList* list, const DisplayList* source) {
+    if (!list || !source) {
+        return -1;
+    }
+
+    if (source->count > list->capacity) {
+        DisplayOp* ops = (DisplayOp*)realloc(list->ops, source->capacity * sizeof(DisplayOp));
+        if (!ops) {
+            return -1;
+        }
+        list->ops = ops;
+        list->capacity = source->capacity;
+    }
+    if (source->count > 0) {
+        memcpy(list->ops, source->ops, source->count * sizeof(DisplayOp));
+    }
+    list->count = source->count;
+    return 0;
+}
+
+int display_op_areas(const DisplayOp* op, long long rects[4][4]) {
+    long long x = op->x;
+    long long y = op->y;
+    long long width = op->width;
+    long long height = op->height;
+
+    if (op->type != DISPLAY_OP_BORDER) {
+        rects[0][0] = x;
+        rects[0][1] = y;
+        rects[0][2] = width;
+        rects[0][3] = height;
+        return 1;
+    }
+
+    // The top and bottom edges span the full width so corners are drawn
+    // exactly once; widths are clamped so opposite edges never overlap
+    long long top = op->widths[RENDER_SIDE_TOP];
+    long long right = op->widths[RENDER_SIDE_RIGHT];
+    long long bottom = op->widths[RENDER_SIDE_BOTTOM];
+    long long left = op->widths[RENDER_SIDE_LEFT];
+    if (top > height) {
+        top = height;
+    }
+    if (bottom > height - top) {
+        bottom = height - top;
+    }
+    if (left > width) {
+        left = width;
+    }
+    if (right > width - left) {
+        right = width - left;
+    }
+    long long middle = height - top - bottom;
+
+    long long edges[4][4] = {
+        { x, y, width, top },
+        { x + width - right, y + top, right, middle },
+        { x, y + height - bottom, width, bottom },
+        { x, y + top, left, middle }
+    };
+    memcpy(rects, edges, sizeof(edges));
+    return 4;
+}
+
+int display_list_get_bounds(const DisplayList* list, RenderRect* bounds) {
+    if (!list || !bounds || list->count == 0) {
+        return -1;
+    }
+
+    long long x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    for (size_t i = 0; i < list->count; i++) {
+        const DisplayOp* op = &list->ops[i];
+        if (i == 0 || op->x < x0) {
+            x0 = op->x;
+        }
+        if (i == 0 || op->y < y0) {
+            y0 = op->y;
+        }
+        if (i == 0 || (long long)op->x + op->width > x1) {
+            x1 = (long long)op->x + op->width;
+        }
+        if (i == 0 || (long long)op->y + op->height > y1) {
+            y1 = (long long)op->y + op->height;
+        }
+    }
+
+    if (x1 - x0 > INT32_MAX || y1 - y0 > INT32_MAX) {
+        return -1;
+    }
+    bounds->x = (int)x0;
+    bounds->y = (int)y0;
+    bounds->width = (int)(x1 - x0);
+    bounds->height = (int)(y1 - y0);
+    return 0;
+}
+
+int display_list_fill_rect(DisplayList* list, int x, int y, int width, int height, RenderColor color) {
+    DisplayOp* op = display_list_push(list, DISPLAY_OP_FILL, x, y, width, height);
+    if (!op) {
+        return -1;
+    }
+    op->color = color;
+    return 0;
+}
+
+int display_list_fill_gradient(DisplayList* list, int x, int y, int width, int height,
+                               RenderColor from, RenderColor to, RenderGradientDirection direction) {
+    if (direction != RENDER_GRADIENT_HORIZONTAL && direction != RENDER_GRADIENT_VERTICAL) {
+        return -1;
+    }
+
+    DisplayOp* op = display_list_push(list, DISPLAY_OP_GRADIENT, x, y, width, height);
+    if (!op) {
+        return -1;
+    }
+    op->color = from;
+    op->color_to = to;
+    op->direction = direction;
+    return 0;
+}
+
+int display_list_stroke_border(DisplayList* list, int x, int y, int width, int height,
+                               const int widths[4], RenderColor color) {
+    if (!widths) {
+        return -1;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (widths[i] < 0) {
+            return -1;
+        }
+    }
+
+    DisplayOp* op = display_list_push(list, DISPLAY_OP_BORDER, x, y, width, height);
+    if (!op) {
+        return -1;
+    }
+    op->color = color;
+    memcpy(op->widths, widths, sizeof(op->widths));
+    return 0;
+}
+
+int display_list_draw_glyph(DisplayList* list, int x, int y, const unsigned char* mask,
+                            int width, int height, int stride, RenderColor color) {
+    if (!mask || stride < width) {
+        return -1;
+    }
+
+    DisplayOp* op = display_list_push(list, DISPLAY_OP_GLYPH, x, y, width, height);
+    if (!op) {
+        return -1;
+    }
+    op->color = color;
+    op->pixels = mask;
+    op->source_width = width;
+    op->source_height = height;
+    op->stride = stride;
+    return 0;
+}
+
+int display_list_draw_image(DisplayList* list, int x, int y, int width, int height,
+                            const unsigned char* pixels, int image_width, int image_height, int stride) {
+    if (!pixels || image_width <= 0 || image_height <= 0 || stride / 4 < image_width) {
+        return -1;
+    }
+
+    DisplayOp* op = display_list_push(list, DISPLAY_OP_IMAGE, x, y, width, height);
+    if (!op) {
+        return -1;
+    }
+    op->pixels = pixels;
+    op->source_width = image_width;
+    op->source_height = image_height;
+    op->stride = stride;
+    return 0;
+}
+
+static long long scale_coord(long long value, float scale) {
+    return (long long)floor((double)value * (double)scale);
+}
+
+int display_list_append(DisplayList* list, const DisplayList* source, int dx, int dy, float scale) {
+    if (!list || !source || list == source || !(scale > 0.0f) || isinf(scale)) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < source->count; i++) {
+        const DisplayOp* from = &source->ops[i];
+        long long x0 = from->x;
+        long long y0 = from->y;
+        long long x1 = x0 + from->width;
+        long long y1 = y0 + from->height;
+        if (scale != 1.0f) {
+            x0 = scale_coord(x0, scale);
+            y0 = scale_coord(y0, scale);
+            x1 = scale_coord(x1, scale);
+            y1 = scale_coord(y1, scale);
+        }
+        x0 += dx;
+        y0 += dy;
+        x1 += dx;
+        y1 += dy;
+
+        // Ops that shrink to nothing or land out of range paint nothing
+        if (x1 <= x0 || y1 <= y0 || x0 < -COORD_LIMIT || y0 < -COORD_LIMIT ||
+            x1 > COORD_LIMIT || y1 > COORD_LIMIT) {
+            continue;
+        }
+
+        DisplayOp* op = display_list_push(list, from->type, (int)x0, (int)y0, (int)(x1 - x0), (int)(y1 - y0));
+        if (!op) {
+            return -1;
+        }
+        op->color = from->color;
+        op->color_to = from->color_to;
+        op->direction = from->direction;
+        op->pixels = from->pixels;
+        op->source_width = from->source_width;
+        op->source_height = from->source_height;
+        op->stride = from->stride;
+        for (int side = 0; side < 4; side++) {
+            long long width = from->widths[side];
+            if (scale != 1.0f && width > 0) {
+                width = (long long)floor((double)width * (double)scale + 0.5);
+                // Keep hairlines visible when scaling down
+                if (width < 1) {
+                    width = 1;
+                }
+                if (width > COORD_LIMIT) {
+                    width = COORD_LIMIT;
+                }
+            }
+            op->widths[side] = (int)width;
+        }
+    }
+
+    return 0;
+}
+
+static size_t op_payload_size(const DisplayOp* op) {
+    if (op->type == DISPLAY_OP_GLYPH) {
+        return (size_t)op->source_width * (size_t)op->source_height;
+    }
+    if (op->type == DISPLAY_OP_IMAGE) {
+        return (size_t)op->source_width * (size_t)op->source_height * 4;
+    }
+    return 0;
+}
+
+unsigned char* display_list_serialize(const DisplayList* list, size_t* size) {
+    if (!list || !size || list->count > UINT32_MAX) {
+        return NULL;
+    }
+
+    size_t total = sizeof(ListHeader);
+    for (size_t i = 0; i < list->count; i++) {
+        total += sizeof(OpRecord) + op_payload_size(&list->ops[i]);
+    }
+
+    unsigned char* data = (unsigned char*)malloc(total);
+    if (!data) {
+        return NULL;
+    }
+
+    ListHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "JBDL", 4);
+    header.format = FORMAT_VERSION;
+    header.op_count = (uint32_t)list->count;
+    memcpy(data, &header, sizeof(header));
+    unsigned char* p = data + sizeof(header);
+
+    for (size_t i = 0; i < list->count; i++) {
+        const DisplayOp* op = &list->ops[i];
+        OpRecord record;
+        memset(&record, 0, sizeof(record));
+        record.type = (uint32_t)op->type;
+        record.x = op->x;
+        record.y = op->y;
+        record.width = op->width;
+        record.height = op->height;
+        memcpy(record.color, &op->color, 4);
+        memcpy(record.color_to, &op->color_to, 4);
+        record.direction = (uint32_t)op->direction;
+        for (int side = 0; side < 4; side++) {
+            record.widths[side] = op->widths[side];
+        }
+        record.source_width = op->source_width;
+        record.source_height = op->source_height;
+        memcpy(p, &record, sizeof(record));
+        p += sizeof(record);
+
+        // Pixel rows are packed, dropping any stride padding
+        size_t bytes_per_pixel = op->type == DISPLAY_OP_IMAGE ? 4 : 1;
+        size_t row_bytes = (size_t)op->source_width * bytes_per_pixel;
+        if (op_payload_size(op) > 0) {
+            for (int row = 0; row < op->source_height; row++) {
+                memcpy(p, op->pixels + (size_t)row * (size_t)op->stride, row_bytes);
+                p += row_bytes;
+            }
+        }
+    }
+
+    *size = total;
+    return data;
+}
+
+DisplayList* display_list_deserialize(const unsigned char* data, size_t size) {
+    if (!data || size < sizeof(ListHeader)) {
+        return NULL;
+    }
+
+    ListHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, "JBDL", 4) != 0 || header.format != FORMAT_VERSION) {
+        return NULL;
+    }
+
+    DisplayList* list = display_list_create();
+    if (!list) {
+        return NULL;
+    }
+
+    // Payloads are a subset of the input, so its size bounds the copy and
+    // the buffer never has to grow under the ops pointing into it
+    size_t payload_used = 0;
+    if (size > sizeof(header)) {
+        list->pixel_data = (unsigned char*)malloc(size - sizeof(header));
+        if (!list->pixel_data) {
+            display_list_destroy(list);
+            return NULL;
+        }
+    }
+
+    const unsigned char* p = data + sizeof(header);
+    size_t remaining = size - sizeof(header);
+
+    for (uint32_t i = 0; i < header.op_count; i++) {
+        OpRecord record;
+        if (remaining < sizeof(record)) {
+            goto malformed;
+        }
+        memcpy(&record, p, sizeof(record));
+        p += sizeof(record);
+        remaining -= sizeof(record);
+
+        if (record.type > DISPLAY_OP_IMAGE || record.direction > RENDER_GRADIENT_VERTICAL) {
+            goto malformed;
+        }
+        for (int side = 0; side < 4; side++) {
+            if (record.widths[side] < 0) {
+                goto malformed;
+            }
+        }
+
+        DisplayOp* op = display_list_push(list, (DisplayOpType)record.type,
+                                          record.x, record.y, record.width, record.height);
+        if (!op) {
+            goto malformed;
+        }
+        memcpy(&op->color, record.color, 4);
+        memcpy(&op->color_to, record.color_to, 4);
+        op->direction = (RenderGradientDirection)record.direction;
+        for (int side = 0; side < 4; side++) {
+            op->widths[side] = record.widths[side];
+        }
+
+        if (op->type == DISPLAY_OP_GLYPH || op->type == DISPLAY_OP_IMAGE) {
+            if (record.source_width <= 0 || record.source_height <= 0) {
+                goto malformed;
+            }
+            size_t bytes_per_pixel = op->type == DISPLAY_OP_IMAGE ? 4 : 1;
+            size_t row_bytes = (size_t)record.source_width * bytes_per_pixel;
+            if ((size_t)record.source_height > remaining / row_bytes) {
+                goto malformed;
+            }
+            size_t payload = row_bytes * (size_t)record.source_height;
+            if (row_bytes > INT32_MAX) {
+                goto malformed;
+            }
+
+            memcpy(list->pixel_data + payload_used, p, payload);
+            op->source_width = record.source_width;
+            op->source_height = record.source_height;
+            op->stride = (int)row_bytes;
+            op->pixels = list->pixel_data + payload_used;
+            payload_used += payload;
+            p += payload;
+            remaining -= payload;
+        }
+    }
+
+    if (remaining != 0) {
+        goto malformed;
+    }
+
+    return list;
+
+malformed:
+    display_list_destroy(list);
+    return NULL;
+}
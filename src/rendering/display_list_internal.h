@@ -0,0 +1,70 @@
+#ifndef JUST_BROWSE_DISPLAY_LIST_INTERNAL_H
+#define JUST_BROWSE_DISPLAY_LIST_INTERNAL_H
+
+// Display list layout shared by the rendering/ translation units; not installed
+
+#include "rendering/display_list.h"
+
+typedef enum {
+    DISPLAY_OP_FILL,
+    DISPLAY_OP_GRADIENT,
+    DISPLAY_OP_BORDER,
+    DISPLAY_OP_GLYPH,
+    DISPLAY_OP_IMAGE
+} DisplayOpType;
+
+// One drawing op. Ops are memset before being filled in so two ops can be
+// compared with memcmp.
+typedef struct {
+    DisplayOpType type;
+    int x;
+    int y;
+    int width;
+    int height;
+    RenderColor color;
+    RenderColor color_to;
+    RenderGradientDirection direction;
+    int widths[4];
+    const unsigned char* pixels;    // Glyph mask or RGBA image
+    int source_width;
+    int source_height;
+    int stride;
+} DisplayOp;
+
+struct DisplayList {
+    DisplayOp* ops;
+    size_t count;
+    size_t capacity;
+    unsigned char* pixel_data;      // Owned copies of pixels, for deserialized lists
+};
+
+/**
+ * Append a zeroed op
+ * @param list The list
+ * @param type Op type
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param width Width in pixels
+ * @param height Height in pixels
+ * @return Pointer to the op (valid until the next append), or NULL on failure
+ */
+DisplayOp* display_list_push(DisplayList* list, DisplayOpType type, int x, int y, int width, int height);
+
+/**
+ * Replace one list's ops with a copy of another's
+ * @param list The destination list
+ * @param source The list to copy
+ * @return 0 on success, -1 on failure
+ */
+int display_list_copy(DisplayList* list, const DisplayList* source);
+
+/**
+ * Compute the rectangles an op paints: four edges for a border, otherwise
+ * the op's own rectangle
+ * @param op The op
+ * @param rects Output rectangles as x, y, width, height
+ * @return Number of rectangles written
+ */
+int display_op_areas(const DisplayOp* op, long long rects[4][4]);
+
+#endif // JUST_BROWSE_DISPLAY_LIST_INTERNAL_H
@@ -0,0 +1,387 @@
+#include "rendering/font.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Built-in font
+// Glyphs are 8x8 bitmaps (bit 0 is the leftmost column) treated as
+// outlines made of square cells, so they scale to any size: each mask pixel
+// gets the exact area of the cells it overlaps. The em is ten cells; rows
+// 0-6 sit above the baseline and row 7 holds descenders. Advances are
+// proportional, taken from the columns a glyph actually inks plus one cell
+// of spacing.
+
+#define CELLS_PER_EM 10.0f
+#define BASELINE_ROW 7
+#define SPACE_CELLS 3.0f
+#define BOLD_WEIGHT 600
+#define BOLD_CELLS 0.5f             // Extra stroke width for bold
+#define ITALIC_SLANT 0.2f           // Shear for italic, as x per y
+#define MAX_CELLS (8 * 4)           // Eight rows of at most four runs
+
+#define FIRST_GLYPH 0x20
+#define LAST_GLYPH 0x7E
+
+static const unsigned char glyphs[LAST_GLYPH - FIRST_GLYPH + 1][8] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },    // space
+    { 0x18, 0x3C, 0x3C, 0x18, 0x18, 0x00, 0x18, 0x00 },    // !
+    { 0x36, 0x36, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },    // "
+    { 0x36, 0x36, 0x7F, 0x36, 0x7F, 0x36, 0x36, 0x00 },    // #
+    { 0x0C, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x0C, 0x00 },    // $
+    { 0x00, 0x63, 0x33, 0x18, 0x0C, 0x66, 0x63, 0x00 },    // %
+    { 0x1C, 0x36, 0x1C, 0x6E, 0x3B, 0x33, 0x6E, 0x00 },    // &
+    { 0x06, 0x06, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00 },    // '
+    { 0x18, 0x0C, 0x06, 0x06, 0x06, 0x0C, 0x18, 0x00 },    // (
+    { 0x06, 0x0C, 0x18, 0x18, 0x18, 0x0C, 0x06, 0x00 },    // )
+    { 0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00 },    // *
+    { 0x00, 0x0C, 0x0C, 0x3F, 0x0C, 0x0C, 0x00, 0x00 },    // +
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x06 },    // ,
+    { 0x00, 0x00, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00 },    // -
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00 },    // .
+    { 0x60, 0x30, 0x18, 0x0C, 0x06, 0x03, 0x01, 0x00 },    // /
+    { 0x3E, 0x63, 0x73, 0x7B, 0x6F, 0x67, 0x3E, 0x00 },    // 0
+    { 0x0C, 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x3F, 0x00 },    // 1
+    { 0x1E, 0x33, 0x30, 0x1C, 0x06, 0x33, 0x3F, 0x00 },    // 2
+    { 0x1E, 0x33, 0x30, 0x1C, 0x30, 0x33, 0x1E, 0x00 },    // 3
+    { 0x38, 0x3C, 0x36, 0x33, 0x7F, 0x30, 0x78, 0x00 },    // 4
+    { 0x3F, 0x03, 0x1F, 0x30, 0x30, 0x33, 0x1E, 0x00 },    // 5
+    { 0x1C, 0x06, 0x03, 0x1F, 0x33, 0x33, 0x1E, 0x00 },    // 6
+    { 0x3F, 0x33, 0x30, 0x18, 0x0C, 0x0C, 0x0C, 0x00 },    // 7
+    { 0x1E, 0x33, 0x33, 0x1E, 0x33, 0x33, 0x1E, 0x00 },    // 8
+    { 0x1E, 0x33, 0x33, 0x3E, 0x30, 0x18, 0x0E, 0x00 },    // 9
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00 },    // :
+    { 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x06 },    // ;
+    { 0x18, 0x0C, 0x06, 0x03, 0x06, 0x0C, 0x18, 0x00 },    // <
+    { 0x00, 0x00, 0x3F, 0x00, 0x00, 0x3F, 0x00, 0x00 },    // =
+    { 0x06, 0x0C, 0x18, 0x30, 0x18, 0x0C, 0x06, 0x00 },    // >
+    { 0x1E, 0x33, 0x30, 0x18, 0x0C, 0x00, 0x0C, 0x00 },    // ?
+    { 0x3E, 0x63, 0x7B, 0x7B, 0x7B, 0x03, 0x1E, 0x00 },    // @
+    { 0x0C, 0x1E, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x00 },    // A
+    { 0x3F, 0x66, 0x66, 0x3E, 0x66, 0x66, 0x3F, 0x00 },    // B
+    { 0x3C, 0x66, 0x03, 0x03, 0x03, 0x66, 0x3C, 0x00 },    // C
+    { 0x1F, 0x36, 0x66, 0x66, 0x66, 0x36, 0x1F, 0x00 },    // D
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x46, 0x7F, 0x00 },    // E
+    { 0x7F, 0x46, 0x16, 0x1E, 0x16, 0x06, 0x0F, 0x00 },    // F
+    { 0x3C, 0x66, 0x03, 0x03, 0x73, 0x66, 0x7C, 0x00 },    // G
+    { 0x33, 0x33, 0x33, 0x3F, 0x33, 0x33, 0x33, 0x00 },    // H
+    { 0x1E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },    // I
+    { 0x78, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E, 0x00 },    // J
+    { 0x67, 0x66, 0x36, 0x1E, 0x36, 0x66, 0x67, 0x00 },    // K
+    { 0x0F, 0x06, 0x06, 0x06, 0x46, 0x66, 0x7F, 0x00 },    // L
+    { 0x63, 0x77, 0x7F, 0x7F, 0x6B, 0x63, 0x63, 0x00 },    // M
+    { 0x63, 0x67, 0x6F, 0x7B, 0x73, 0x63, 0x63, 0x00 },    // N
+    { 0x1C, 0x36, 0x63, 0x63, 0x63, 0x36, 0x1C, 0x00 },    // O
+    { 0x3F, 0x66, 0x66, 0x3E, 0x06, 0x06, 0x0F, 0x00 },    // P
+    { 0x1E, 0x33, 0x33, 0x33, 0x3B, 0x1E, 0x38, 0x00 },    // Q
+    { 0x3F, 0x66, 0x66, 0x3E, 0x36, 0x66, 0x67, 0x00 },    // R
+    { 0x1E, 0x33, 0x07, 0x0E, 0x38, 0x33, 0x1E, 0x00 },    // S
+    { 0x3F, 0x2D, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },    // T
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x3F, 0x00 },    // U
+    { 0x33, 0x33, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },    // V
+    { 0x63, 0x63, 0x63, 0x6B, 0x7F, 0x77, 0x63, 0x00 },    // W
+    { 0x63, 0x63, 0x36, 0x1C, 0x1C, 0x36, 0x63, 0x00 },    // X
+    { 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x0C, 0x1E, 0x00 },    // Y
+    { 0x7F, 0x63, 0x31, 0x18, 0x4C, 0x66, 0x7F, 0x00 },    // Z
+    { 0x1E, 0x06, 0x06, 0x06, 0x06, 0x06, 0x1E, 0x00 },    // [
+    { 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x40, 0x00 },    // backslash
+    { 0x1E, 0x18, 0x18, 0x18, 0x18, 0x18, 0x1E, 0x00 },    // ]
+    { 0x08, 0x1C, 0x36, 0x63, 0x00, 0x00, 0x00, 0x00 },    // ^
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF },    // _
+    { 0x0C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00 },    // `
+    { 0x00, 0x00, 0x1E, 0x30, 0x3E, 0x33, 0x6E, 0x00 },    // a
+    { 0x07, 0x06, 0x06, 0x3E, 0x66, 0x66, 0x3B, 0x00 },    // b
+    { 0x00, 0x00, 0x1E, 0x33, 0x03, 0x33, 0x1E, 0x00 },    // c
+    { 0x38, 0x30, 0x30, 0x3E, 0x33, 0x33, 0x6E, 0x00 },    // d
+    { 0x00, 0x00, 0x1E, 0x33, 0x3F, 0x03, 0x1E, 0x00 },    // e
+    { 0x1C, 0x36, 0x06, 0x0F, 0x06, 0x06, 0x0F, 0x00 },    // f
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x1F },    // g
+    { 0x07, 0x06, 0x36, 0x6E, 0x66, 0x66, 0x67, 0x00 },    // h
+    { 0x0C, 0x00, 0x0E, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },    // i
+    { 0x30, 0x00, 0x30, 0x30, 0x30, 0x33, 0x33, 0x1E },    // j
+    { 0x07, 0x06, 0x66, 0x36, 0x1E, 0x36, 0x67, 0x00 },    // k
+    { 0x0E, 0x0C, 0x0C, 0x0C, 0x0C, 0x0C, 0x1E, 0x00 },    // l
+    { 0x00, 0x00, 0x33, 0x7F, 0x7F, 0x6B, 0x63, 0x00 },    // m
+    { 0x00, 0x00, 0x1F, 0x33, 0x33, 0x33, 0x33, 0x00 },    // n
+    { 0x00, 0x00, 0x1E, 0x33, 0x33, 0x33, 0x1E, 0x00 },    // o
+    { 0x00, 0x00, 0x3B, 0x66, 0x66, 0x3E, 0x06, 0x0F },    // p
+    { 0x00, 0x00, 0x6E, 0x33, 0x33, 0x3E, 0x30, 0x78 },    // q
+    { 0x00, 0x00, 0x3B, 0x6E, 0x66, 0x06, 0x0F, 0x00 },    // r
+    { 0x00, 0x00, 0x3E, 0x03, 0x1E, 0x30, 0x1F, 0x00 },    // s
+    { 0x08, 0x0C, 0x3E, 0x0C, 0x0C, 0x2C, 0x18, 0x00 },    // t
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x33, 0x6E, 0x00 },    // u
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x1E, 0x0C, 0x00 },    // v
+    { 0x00, 0x00, 0x63, 0x6B, 0x7F, 0x7F, 0x36, 0x00 },    // w
+    { 0x00, 0x00, 0x63, 0x36, 0x1C, 0x36, 0x63, 0x00 },    // x
+    { 0x00, 0x00, 0x33, 0x33, 0x33, 0x3E, 0x30, 0x1F },    // y
+    { 0x00, 0x00, 0x3F, 0x19, 0x0C, 0x26, 0x3F, 0x00 },    // z
+    { 0x38, 0x0C, 0x0C, 0x07, 0x0C, 0x0C, 0x38, 0x00 },    // {
+    { 0x18, 0x18, 0x18, 0x00, 0x18, 0x18, 0x18, 0x00 },    // |
+    { 0x07, 0x0C, 0x0C, 0x38, 0x0C, 0x0C, 0x07, 0x00 },    // }
+    { 0x6E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },    // ~
+};
+
+// Drawn for characters the font has no glyph for
+static const unsigned char missing_glyph[8] = { 0x7F, 0x41, 0x41, 0x41, 0x41, 0x41, 0x7F, 0x00 };
+
+// A filled rectangle of the outline, in px relative to the pen on the
+// baseline (y grows downwards)
+typedef struct {
+    float x0;
+    float y0;
+    float x1;
+    float y1;
+} GlyphCell;
+
+static int font_valid(const FontSpec* font) {
+    return font && font->size > 0.0f && isfinite(font->size);
+}
+
+static int is_space(uint32_t codepoint) {
+    return codepoint == ' ' || codepoint == '\t' || codepoint == '\n' || codepoint == '\r' ||
+           codepoint == '\f' || codepoint == 0xA0;
+}
+
+// Bitmap of a character; NULL for whitespace and control characters
+static const unsigned char* glyph_bitmap(uint32_t codepoint) {
+    if (is_space(codepoint) || codepoint < FIRST_GLYPH || codepoint == 0x7F ||
+        (codepoint >= 0x80 && codepoint < 0xA0)) {
+        return NULL;
+    }
+    if (codepoint <= LAST_GLYPH) {
+        return glyphs[codepoint - FIRST_GLYPH];
+    }
+    return missing_glyph;
+}
+
+// First and last inked column
+static void ink_columns(const unsigned char* bitmap, int* first, int* last) {
+    unsigned columns = 0;
+    for (int row = 0; row < 8; row++) {
+        columns |= bitmap[row];
+    }
+    *first = 0;
+    *last = 7;
+    while (*first < 7 && !(columns & (1u << *first))) {
+        (*first)++;
+    }
+    while (*last > *first && !(columns & (1u << *last))) {
+        (*last)--;
+    }
+}
+
+static int is_bold(const FontSpec* font) {
+    return font->weight >= BOLD_WEIGHT;
+}
+
+float font_get_ascent(const FontSpec* font) {
+    return font_valid(font) ? 0.8f * font->size : 0.0f;
+}
+
+float font_get_descent(const FontSpec* font) {
+    return font_valid(font) ? 0.2f * font->size : 0.0f;
+}
+
+float font_get_advance(const FontSpec* font, uint32_t codepoint) {
+    if (!font_valid(font)) {
+        return 0.0f;
+    }
+
+    float unit = font->size / CELLS_PER_EM;
+    if (is_space(codepoint)) {
+        return SPACE_CELLS * unit;
+    }
+
+    const unsigned char* bitmap = glyph_bitmap(codepoint);
+    if (!bitmap) {
+        return 0.0f;
+    }
+
+    int first;
+    int last;
+    ink_columns(bitmap, &first, &last);
+    float cells = (float)(last - first + 2) + (is_bold(font) ? BOLD_CELLS : 0.0f);
+    return cells * unit;
+}
+
+// Break a glyph into one cell per horizontal run of set bits. Runs in a
+// row are at least a cell apart and bold widens them by less than that, so
+// cells never overlap and their coverage can simply be summed.
+static int glyph_cells(const FontSpec* font, const unsigned char* bitmap, int subpixel, GlyphCell* cells) {
+    float unit = font->size / CELLS_PER_EM;
+    float pen = (float)subpixel / FONT_SUBPIXEL_STEPS;
+    float bold = is_bold(font) ? BOLD_CELLS * unit : 0.0f;
+    int first;
+    int last;
+    ink_columns(bitmap, &first, &last);
+
+    int count = 0;
+    for (int row = 0; row < 8; row++) {
+        float y0 = (float)(row - BASELINE_ROW) * unit;
+        // Shear about the baseline, sampled at the middle of the row
+        float slant = font->italic ? -(y0 + unit / 2.0f) * ITALIC_SLANT : 0.0f;
+
+        int column = first;
+        while (column <= last) {
+            if (!(bitmap[row] & (1u << column))) {
+                column++;
+                continue;
+            }
+            int end = column;
+            while (end + 1 <= last && (bitmap[row] & (1u << (end + 1)))) {
+                end++;
+            }
+            GlyphCell* cell = &cells[count++];
+            cell->x0 = pen + slant + ((float)(column - first) + 0.5f) * unit;
+            cell->x1 = pen + slant + ((float)(end - first) + 1.5f) * unit + bold;
+            cell->y0 = y0;
+            cell->y1 = y0 + unit;
+            column = end + 1;
+        }
+    }
+    return count;
+}
+
+static void cell_bounds(const GlyphCell* cells, int count, int* left, int* top, int* right, int* bottom) {
+    float x0 = cells[0].x0, y0 = cells[0].y0, x1 = cells[0].x1, y1 = cells[0].y1;
+    for (int i = 1; i < count; i++) {
+        x0 = fminf(x0, cells[i].x0);
+        y0 = fminf(y0, cells[i].y0);
+        x1 = fmaxf(x1, cells[i].x1);
+        y1 = fmaxf(y1, cells[i].y1);
+    }
+    *left = (int)floorf(x0);
+    *top = (int)floorf(y0);
+    *right = (int)ceilf(x1);
+    *bottom = (int)ceilf(y1);
+}
+
+int font_get_glyph_metrics(const FontSpec* font, uint32_t codepoint, int subpixel, FontGlyphMetrics* metrics) {
+    if (!font_valid(font) || !metrics || subpixel < 0 || subpixel >= FONT_SUBPIXEL_STEPS) {
+        return -1;
+    }
+
+    memset(metrics, 0, sizeof(FontGlyphMetrics));
+    metrics->advance = font_get_advance(font, codepoint);
+
+    const unsigned char* bitmap = glyph_bitmap(codepoint);
+    GlyphCell cells[MAX_CELLS];
+    int count = bitmap ? glyph_cells(font, bitmap, subpixel, cells) : 0;
+    if (count == 0) {
+        return 0;
+    }
+
+    int left, top, right, bottom;
+    cell_bounds(cells, count, &left, &top, &right, &bottom);
+    metrics->width = right - left;
+    metrics->height = bottom - top;
+    metrics->left = left;
+    metrics->top = -top;
+    return 0;
+}
+
+int font_rasterize_glyph(const FontSpec* font, uint32_t codepoint, int subpixel, unsigned char* mask, int stride) {
+    FontGlyphMetrics metrics;
+    if (font_get_glyph_metrics(font, codepoint, subpixel, &metrics) != 0 || (!mask && metrics.width > 0) ||
+        stride < metrics.width) {
+        return -1;
+    }
+    if (metrics.width == 0) {
+        return 0;
+    }
+
+    float* coverage = (float*)calloc((size_t)metrics.width * (size_t)metrics.height, sizeof(float));
+    if (!coverage) {
+        return -1;
+    }
+
+    GlyphCell cells[MAX_CELLS];
+    int count = glyph_cells(font, glyph_bitmap(codepoint), subpixel, cells);
+    float origin_x = (float)metrics.left;
+    float origin_y = (float)-metrics.top;
+
+    for (int i = 0; i < count; i++) {
+        float x0 = cells[i].x0 - origin_x, x1 = cells[i].x1 - origin_x;
+        float y0 = cells[i].y0 - origin_y, y1 = cells[i].y1 - origin_y;
+        int py_end = (int)ceilf(y1) < metrics.height ? (int)ceilf(y1) : metrics.height;
+        int px_end = (int)ceilf(x1) < metrics.width ? (int)ceilf(x1) : metrics.width;
+
+        for (int py = (int)floorf(y0); py < py_end; py++) {
+            float cover_y = fminf(y1, (float)(py + 1)) - fmaxf(y0, (float)py);
+            if (py < 0 || cover_y <= 0.0f) {
+                continue;
+            }
+            float* row = coverage + (size_t)py * (size_t)metrics.width;
+            for (int px = (int)floorf(x0); px < px_end; px++) {
+                float cover_x = fminf(x1, (float)(px + 1)) - fmaxf(x0, (float)px);
+                if (px >= 0 && cover_x > 0.0f) {
+                    row[px] += cover_x * cover_y;
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < metrics.height; y++) {
+        const float* row = coverage + (size_t)y * (size_t)metrics.width;
+        unsigned char* out = mask + (size_t)y * (size_t)stride;
+        for (int x = 0; x < metrics.width; x++) {
+            float value = row[x] * 255.0f + 0.5f;
+            out[x] = value >= 255.0f ? 255 : (unsigned char)value;
+        }
+    }
+
+    free(coverage);
+    return 0;
+}
+
+uint32_t font_decode_utf8(const char* text, size_t length, size_t* offset) {
+    const unsigned char* s = (const unsigned char*)text;
+    size_t i = *offset;
+    if (i >= length) {
+        return 0xFFFD;
+    }
+
+    unsigned char lead = s[i];
+    if (lead < 0x80) {
+        *offset = i + 1;
+        return lead;
+    }
+
+    int extra;
+    uint32_t codepoint;
+    uint32_t minimum;
+    if ((lead & 0xE0) == 0xC0) {
+        extra = 1;
+        codepoint = lead & 0x1F;
+        minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        extra = 2;
+        codepoint = lead & 0x0F;
+        minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        extra = 3;
+        codepoint = lead & 0x07;
+        minimum = 0x10000;
+    } else {
+        *offset = i + 1;
+        return 0xFFFD;
+    }
+
+    if ((size_t)extra >= length - i) {
+        *offset = i + 1;
+        return 0xFFFD;
+    }
+    for (int k = 1; k <= extra; k++) {
+        if ((s[i + k] & 0xC0) != 0x80) {
+            *offset = i + 1;
+            return 0xFFFD;
+        }
+        codepoint = (codepoint << 6) | (s[i + k] & 0x3F);
+    }
+    if (codepoint < minimum || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        *offset = i + 1;
+        return 0xFFFD;
+    }
+
+    *offset = i + extra + 1;
+    return codepoint;
+}
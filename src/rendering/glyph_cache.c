@@ -0,0 +1,427 @@
+#include "rendering/glyph_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Glyph atlas cache
+// Rasterized glyphs are packed into 8-bit atlas pages on shelves: rows of
+// glyphs of similar height, opened top to bottom as needed. A page is the
+// unit of eviction: when nothing fits, the least recently used page is
+// cleared and packed again from the top. The renderer keeps pointers into
+// the atlas for the frame being recorded and compares them against the
+// previous frame's commands, so pages touched in either frame are never
+// evicted; reusing one could put different pixels behind an unchanged
+// pointer.
+
+#define DEFAULT_PAGE_SIZE 256
+#define DEFAULT_MAX_PAGES 8
+#define INITIAL_BUCKETS 256
+#define SIZE_STEPS 64.0f            // Font sizes are keyed in 1/64 px
+
+typedef struct {
+    uint32_t size;                  // 1/64 px
+    uint32_t codepoint;
+    uint8_t bold;
+    uint8_t italic;
+    uint8_t subpixel;
+} GlyphKey;
+
+typedef struct GlyphEntry {
+    GlyphKey key;
+    int page;                       // -1 for blank glyphs, which take no atlas space
+    int x;
+    int y;
+    FontGlyphMetrics metrics;
+    struct GlyphEntry* hash_next;
+    struct GlyphEntry* page_next;   // Glyphs on the same page
+} GlyphEntry;
+
+typedef struct {
+    int y;
+    int height;
+    int used;                       // Width taken from the left
+} Shelf;
+
+typedef struct {
+    unsigned char* pixels;
+    Shelf* shelves;
+    size_t shelf_count;
+    size_t shelf_capacity;
+    int free_y;                     // Top of the space below the last shelf
+    uint64_t last_used;             // Frame the page was last drawn from
+    GlyphEntry* glyphs;
+} AtlasPage;
+
+struct GlyphCache {
+    int page_size;
+    size_t max_pages;
+    AtlasPage* pages;
+    size_t page_count;
+    GlyphEntry** buckets;
+    size_t bucket_count;
+    size_t count;
+    uint64_t frame;
+    GlyphCacheStats stats;
+};
+
+// Keys
+
+static GlyphKey make_key(const FontSpec* font, uint32_t codepoint, int subpixel) {
+    GlyphKey key;
+    memset(&key, 0, sizeof(GlyphKey));
+    key.size = (uint32_t)lroundf(font->size * SIZE_STEPS);
+    key.codepoint = codepoint;
+    key.bold = font->weight >= 600;
+    key.italic = font->italic != 0;
+    key.subpixel = (uint8_t)subpixel;
+    return key;
+}
+
+// The font a key stands for, so a glyph is rasterized at the size it is
+// keyed by
+static FontSpec key_font(GlyphKey key) {
+    FontSpec font;
+    font.size = (float)key.size / SIZE_STEPS;
+    font.weight = key.bold ? 700 : 400;
+    font.italic = key.italic;
+    return font;
+}
+
+static int key_equals(GlyphKey a, GlyphKey b) {
+    return a.size == b.size && a.codepoint == b.codepoint && a.bold == b.bold &&
+           a.italic == b.italic && a.subpixel == b.subpixel;
+}
+
+static size_t key_hash(GlyphKey key) {
+    uint64_t h = ((uint64_t)key.codepoint << 32) ^ key.size;
+    h ^= (uint64_t)(key.bold | (key.italic << 1) | (key.subpixel << 2)) << 56;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h;
+}
+
+// Hash table
+
+static GlyphEntry** bucket_for(GlyphCache* cache, GlyphKey key) {
+    return &cache->buckets[key_hash(key) & (cache->bucket_count - 1)];
+}
+
+static GlyphEntry* table_find(GlyphCache* cache, GlyphKey key) {
+    for (GlyphEntry* entry = *bucket_for(cache, key); entry; entry = entry->hash_next) {
+        if (key_equals(entry->key, key)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void table_grow(GlyphCache* cache) {
+    size_t bucket_count = cache->bucket_count * 2;
+    GlyphEntry** buckets = (GlyphEntry**)calloc(bucket_count, sizeof(GlyphEntry*));
+    if (!buckets) {
+        return;     // Keep the longer chains
+    }
+
+    for (size_t i = 0; i < cache->bucket_count; i++) {
+        GlyphEntry* entry = cache->buckets[i];
+        while (entry) {
+            GlyphEntry* next = entry->hash_next;
+            size_t index = key_hash(entry->key) & (bucket_count - 1);
+            entry->hash_next = buckets[index];
+            buckets[index] = entry;
+            entry = next;
+        }
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_count = bucket_count;
+}
+
+static void table_insert(GlyphCache* cache, GlyphEntry* entry) {
+    if (cache->count >= cache->bucket_count) {
+        table_grow(cache);
+    }
+    GlyphEntry** bucket = bucket_for(cache, entry->key);
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    cache->count++;
+}
+
+static void table_remove(GlyphCache* cache, GlyphEntry* entry) {
+    GlyphEntry** link = bucket_for(cache, entry->key);
+    while (*link != entry) {
+        link = &(*link)->hash_next;
+    }
+    *link = entry->hash_next;
+    cache->count--;
+}
+
+// Atlas pages
+
+static int page_add(GlyphCache* cache) {
+    AtlasPage* pages = (AtlasPage*)realloc(cache->pages, (cache->page_count + 1) * sizeof(AtlasPage));
+    if (!pages) {
+        return -1;
+    }
+    cache->pages = pages;
+
+    AtlasPage* page = &pages[cache->page_count];
+    memset(page, 0, sizeof(AtlasPage));
+    page->pixels = (unsigned char*)calloc((size_t)cache->page_size * (size_t)cache->page_size, 1);
+    if (!page->pixels) {
+        return -1;
+    }
+    page->last_used = cache->frame;
+    return (int)cache->page_count++;
+}
+
+// Find room for a width x height glyph: the tightest shelf it fits on, or
+// a new shelf below the others
+static int page_place(GlyphCache* cache, AtlasPage* page, int width, int height, int* x, int* y) {
+    Shelf* best = NULL;
+    for (size_t i = 0; i < page->shelf_count; i++) {
+        Shelf* shelf = &page->shelves[i];
+        if (shelf->height >= height && shelf->height <= height + height / 4 + 1 &&
+            cache->page_size - shelf->used >= width && (!best || shelf->height < best->height)) {
+            best = shelf;
+        }
+    }
+
+    if (!best) {
+        if (cache->page_size - page->free_y < height) {
+            return -1;
+        }
+        if (page->shelf_count == page->shelf_capacity) {
+            size_t capacity = page->shelf_capacity ? page->shelf_capacity * 2 : 16;
+            Shelf* shelves = (Shelf*)realloc(page->shelves, capacity * sizeof(Shelf));
+            if (!shelves) {
+                return -1;
+            }
+            page->shelves = shelves;
+            page->shelf_capacity = capacity;
+        }
+        best = &page->shelves[page->shelf_count++];
+        best->y = page->free_y;
+        best->height = height;
+        best->used = 0;
+        page->free_y += height;
+    }
+
+    *x = best->used;
+    *y = best->y;
+    best->used += width;
+    return 0;
+}
+
+static void page_evict(GlyphCache* cache, AtlasPage* page) {
+    GlyphEntry* entry = page->glyphs;
+    while (entry) {
+        GlyphEntry* next = entry->page_next;
+        table_remove(cache, entry);
+        free(entry);
+        entry = next;
+    }
+    page->glyphs = NULL;
+    page->shelf_count = 0;
+    page->free_y = 0;
+    cache->stats.evictions++;
+}
+
+// Pages the current and previous frames may be drawing from are pinned
+static int page_evictable(const GlyphCache* cache, const AtlasPage* page) {
+    return page->last_used + 1 < cache->frame;
+}
+
+// Allocate atlas space, evicting the least recently used page if every
+// page allowed is full
+static int atlas_allocate(GlyphCache* cache, int width, int height, int* page_index, int* x, int* y) {
+    for (size_t i = 0; i < cache->page_count; i++) {
+        if (page_place(cache, &cache->pages[i], width, height, x, y) == 0) {
+            *page_index = (int)i;
+            return 0;
+        }
+    }
+
+    int index = -1;
+    if (cache->page_count >= cache->max_pages) {
+        for (size_t i = 0; i < cache->page_count; i++) {
+            if (page_evictable(cache, &cache->pages[i]) &&
+                (index < 0 || cache->pages[i].last_used < cache->pages[index].last_used)) {
+                index = (int)i;
+            }
+        }
+        if (index >= 0) {
+            page_evict(cache, &cache->pages[index]);
+        }
+    }
+    if (index < 0) {
+        index = page_add(cache);
+        if (index < 0) {
+            return -1;
+        }
+    }
+
+    *page_index = index;
+    return page_place(cache, &cache->pages[index], width, height, x, y);
+}
+
+GlyphCache* glyph_cache_create(int page_size, size_t max_pages) {
+    if (page_size < 0) {
+        return NULL;
+    }
+
+    GlyphCache* cache = (GlyphCache*)calloc(1, sizeof(GlyphCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->page_size = page_size > 0 ? page_size : DEFAULT_PAGE_SIZE;
+    cache->max_pages = max_pages > 0 ? max_pages : DEFAULT_MAX_PAGES;
+    cache->bucket_count = INITIAL_BUCKETS;
+    cache->buckets = (GlyphEntry**)calloc(cache->bucket_count, sizeof(GlyphEntry*));
+    if (!cache->buckets) {
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void glyph_cache_destroy(GlyphCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    for (size_t i = 0; i < cache->bucket_count; i++) {
+        GlyphEntry* entry = cache->buckets[i];
+        while (entry) {
+            GlyphEntry* next = entry->hash_next;
+            free(entry);
+            entry = next;
+        }
+    }
+    for (size_t i = 0; i < cache->page_count; i++) {
+        free(cache->pages[i].pixels);
+        free(cache->pages[i].shelves);
+    }
+    free(cache->pages);
+    free(cache->buckets);
+    free(cache);
+}
+
+void glyph_cache_begin_frame(GlyphCache* cache) {
+    if (cache) {
+        cache->frame++;
+    }
+}
+
+static void fill_glyph(const GlyphCache* cache, const GlyphEntry* entry, CachedGlyph* glyph) {
+    glyph->width = entry->metrics.width;
+    glyph->height = entry->metrics.height;
+    glyph->left = entry->metrics.left;
+    glyph->top = entry->metrics.top;
+    glyph->advance = entry->metrics.advance;
+    if (entry->page < 0) {
+        glyph->mask = NULL;
+        glyph->stride = 0;
+        return;
+    }
+    glyph->stride = cache->page_size;
+    glyph->mask = cache->pages[entry->page].pixels + (size_t)entry->y * (size_t)cache->page_size + (size_t)entry->x;
+}
+
+int glyph_cache_get(GlyphCache* cache, const FontSpec* font, uint32_t codepoint, int subpixel, CachedGlyph* glyph) {
+    if (!cache || !font || !glyph || !(font->size > 0.0f) || subpixel < 0 || subpixel >= FONT_SUBPIXEL_STEPS) {
+        return -1;
+    }
+
+    GlyphKey key = make_key(font, codepoint, subpixel);
+    GlyphEntry* entry = table_find(cache, key);
+    if (entry) {
+        if (entry->page >= 0) {
+            cache->pages[entry->page].last_used = cache->frame;
+        }
+        cache->stats.hits++;
+        fill_glyph(cache, entry, glyph);
+        return 0;
+    }
+
+    FontSpec keyed = key_font(key);
+    FontGlyphMetrics metrics;
+    if (font_get_glyph_metrics(&keyed, codepoint, subpixel, &metrics) != 0 ||
+        metrics.width > cache->page_size || metrics.height > cache->page_size) {
+        return -1;
+    }
+
+    entry = (GlyphEntry*)calloc(1, sizeof(GlyphEntry));
+    if (!entry) {
+        return -1;
+    }
+    entry->key = key;
+    entry->metrics = metrics;
+    entry->page = -1;
+
+    if (metrics.width > 0) {
+        if (atlas_allocate(cache, metrics.width, metrics.height, &entry->page, &entry->x, &entry->y) != 0) {
+            free(entry);
+            return -1;
+        }
+        AtlasPage* page = &cache->pages[entry->page];
+        unsigned char* pixels = page->pixels + (size_t)entry->y * (size_t)cache->page_size + (size_t)entry->x;
+        font_rasterize_glyph(&keyed, codepoint, subpixel, pixels, cache->page_size);
+        page->last_used = cache->frame;
+        entry->page_next = page->glyphs;
+        page->glyphs = entry;
+    }
+
+    table_insert(cache, entry);
+    cache->stats.misses++;
+    fill_glyph(cache, entry, glyph);
+    return 0;
+}
+
+int glyph_cache_draw_text(GlyphCache* cache, Renderer* renderer, float x, int baseline, const char* text,
+                          size_t length, const FontSpec* font, RenderColor color, float* advance) {
+    if (!cache || !renderer || (!text && length > 0) || !font) {
+        return -1;
+    }
+
+    float pen = x;
+    size_t offset = 0;
+    while (offset < length) {
+        uint32_t codepoint = font_decode_utf8(text, length, &offset);
+
+        float whole = floorf(pen);
+        int origin = (int)whole;
+        int subpixel = (int)((pen - whole) * FONT_SUBPIXEL_STEPS + 0.5f);
+        if (subpixel == FONT_SUBPIXEL_STEPS) {
+            origin++;
+            subpixel = 0;
+        }
+
+        CachedGlyph glyph;
+        if (glyph_cache_get(cache, font, codepoint, subpixel, &glyph) != 0) {
+            return -1;
+        }
+        if (glyph.mask && renderer_draw_glyph(renderer, origin + glyph.left, baseline - glyph.top, glyph.mask,
+                                              glyph.width, glyph.height, glyph.stride, color) != 0) {
+            return -1;
+        }
+        pen += glyph.advance;
+    }
+
+    if (advance) {
+        *advance = pen - x;
+    }
+    return 0;
+}
+
+void glyph_cache_get_stats(GlyphCache* cache, GlyphCacheStats* stats) {
+    if (!cache || !stats) {
+        return;
+    }
+
+    *stats = cache->stats;
+    stats->glyphs = cache->count;
+    stats->pages = cache->page_count;
+}
@@ -0,0 +1,166 @@
+#include "rendering/painter.h"
+#include "rendering/font.h"
+#include <stdlib.h>
+#include <math.h>
+
+// Painter
+// Walks the element tree in document order and records each box from the
+// layout engine's geometry: backgrounds and borders of block-level boxes,
+// then the text fragments of their line boxes through the glyph cache.
+// Nothing is retained between frames except the glyph atlas; the renderer
+// diffs consecutive command lists to find what to repaint.
+
+struct Painter {
+    GlyphCache* glyphs;
+};
+
+typedef struct {
+    Painter* painter;
+    Renderer* renderer;
+    StyleEngine* styles;
+    LayoutEngine* layout;
+} PaintContext;
+
+Painter* painter_create(void) {
+    Painter* painter = (Painter*)calloc(1, sizeof(Painter));
+    if (!painter) {
+        return NULL;
+    }
+
+    painter->glyphs = glyph_cache_create(0, 0);
+    if (!painter->glyphs) {
+        free(painter);
+        return NULL;
+    }
+    return painter;
+}
+
+void painter_destroy(Painter* painter) {
+    if (!painter) {
+        return;
+    }
+
+    glyph_cache_destroy(painter->glyphs);
+    free(painter);
+}
+
+static RenderColor render_color(CSSColor color) {
+    RenderColor result = { color.r, color.g, color.b, color.a };
+    return result;
+}
+
+// Snap a document rectangle to whole pixels by its edges, so adjacent boxes
+// neither overlap nor leave gaps
+static RenderRect snap_rect(LayoutRect rect) {
+    RenderRect result;
+    result.x = (int)lroundf(rect.x);
+    result.y = (int)lroundf(rect.y);
+    result.width = (int)lroundf(rect.x + rect.width) - result.x;
+    result.height = (int)lroundf(rect.y + rect.height) - result.y;
+    return result;
+}
+
+static int paint_box(PaintContext* ctx, const ComputedStyle* style, const LayoutGeometry* geometry) {
+    RenderRect box = snap_rect(geometry->border_box);
+    if (box.width <= 0 || box.height <= 0) {
+        return 0;
+    }
+
+    if (style->background_color.a > 0 &&
+        renderer_fill_rect(ctx->renderer, box.x, box.y, box.width, box.height,
+                           render_color(style->background_color)) != 0) {
+        return -1;
+    }
+
+    int widths[4];
+    int any = 0;
+    for (int side = 0; side < 4; side++) {
+        widths[side] = (int)lroundf(geometry->border[side]);
+        any |= widths[side] > 0;
+    }
+    if (any && style->border_color.a > 0 &&
+        renderer_stroke_border(ctx->renderer, box.x, box.y, box.width, box.height, widths,
+                               render_color(style->border_color)) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Draw the text on a block container's lines
+static int paint_lines(PaintContext* ctx, DOMElement* element) {
+    size_t count = layout_engine_get_fragment_count(ctx->layout, element);
+    for (size_t i = 0; i < count; i++) {
+        LayoutFragment fragment;
+        if (layout_engine_get_fragment(ctx->layout, element, i, &fragment) != 0) {
+            return -1;
+        }
+        if (!fragment.text || fragment.style->color.a == 0) {
+            continue;
+        }
+
+        FontSpec font;
+        font.size = fragment.style->font_size;
+        font.weight = fragment.style->font_weight;
+        font.italic = fragment.style->font_style == CSS_FONT_STYLE_ITALIC;
+
+        // Text fragments span the em box, so the baseline sits one ascent down
+        int baseline = (int)lroundf(fragment.rect.y + font_get_ascent(&font));
+
+        // A glyph too large for an atlas page ends its run early rather
+        // than failing the frame
+        glyph_cache_draw_text(ctx->painter->glyphs, ctx->renderer, fragment.rect.x, baseline,
+                              fragment.text, fragment.length, &font, render_color(fragment.style->color), NULL);
+    }
+    return 0;
+}
+
+static int paint_element(PaintContext* ctx, DOMElement* element) {
+    const ComputedStyle* style = style_engine_get_style(ctx->styles, element);
+    if (!style || style->display == CSS_DISPLAY_NONE) {
+        return 0;
+    }
+
+    if (style->display != CSS_DISPLAY_INLINE) {
+        LayoutGeometry geometry;
+        if (layout_engine_get_geometry(ctx->layout, element, &geometry) != 0) {
+            return 0;
+        }
+        if (paint_box(ctx, style, &geometry) != 0 || paint_lines(ctx, element) != 0) {
+            return -1;
+        }
+    }
+
+    // Inline elements hold no lines of their own, but may hold
+    // inline-blocks and blocks that do
+    for (DOMNode* child = dom_node_get_first_child((DOMNode*)element); child;
+         child = dom_node_get_next_sibling(child)) {
+        if (dom_node_get_type(child) == NODE_ELEMENT && paint_element(ctx, (DOMElement*)child) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int painter_paint(Painter* painter, Renderer* renderer, DOMDocument* doc, StyleEngine* styles,
+                  LayoutEngine* layout) {
+    if (!painter || !renderer || !doc || !styles || !layout) {
+        return -1;
+    }
+
+    // Masks recorded last frame stay valid through this one, which is what
+    // the renderer needs to diff against them
+    glyph_cache_begin_frame(painter->glyphs);
+    renderer_clear_commands(renderer);
+
+    PaintContext ctx = { painter, renderer, styles, layout };
+    DOMElement* root = dom_document_get_element(doc);
+    return root ? paint_element(&ctx, root) : 0;
+}
+
+void painter_get_glyph_stats(Painter* painter, GlyphCacheStats* stats) {
+    if (!painter || !stats) {
+        return;
+    }
+
+    glyph_cache_get_stats(painter->glyphs, stats);
+}
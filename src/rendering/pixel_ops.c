@@ -0,0 +1,299 @@
+#include "pixel_ops_internal.h"
+#include <string.h>
+#include <pthread.h>
+
+// Pixel kernels: portable versions and runtime dispatch
+// Every version uses the same integer arithmetic (exact division by 255,
+// 8-bit bilinear weights), so switching instruction sets never changes a
+// single output byte.
+
+// Exact x / 255 for x <= 255 * 255
+static inline unsigned int div255(unsigned int x) {
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+static inline uint8_t saturate(unsigned int x) {
+    return (uint8_t)(x > 255 ? 255 : x);
+}
+
+static void scalar_fill(uint8_t* dst, size_t count, const uint8_t pixel[4]) {
+    for (size_t i = 0; i < count; i++) {
+        memcpy(dst + i * 4, pixel, 4);
+    }
+}
+
+static void scalar_blend_solid(uint8_t* dst, size_t count, const uint8_t color[4]) {
+    unsigned int inverse = 255 - color[3];
+    for (size_t i = 0; i < count; i++) {
+        uint8_t* d = dst + i * 4;
+        for (int c = 0; c < 4; c++) {
+            d[c] = saturate(color[c] + div255(d[c] * inverse));
+        }
+    }
+}
+
+static void scalar_blend_over(uint8_t* dst, const uint8_t* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint8_t* d = dst + i * 4;
+        const uint8_t* s = src + i * 4;
+        unsigned int inverse = 255 - s[3];
+        for (int c = 0; c < 4; c++) {
+            d[c] = saturate(s[c] + div255(d[c] * inverse));
+        }
+    }
+}
+
+static void scalar_blend_mask(uint8_t* dst, const uint8_t* mask, size_t count, const uint8_t color[4]) {
+    for (size_t i = 0; i < count; i++) {
+        unsigned int coverage = mask[i];
+        if (coverage == 0) {
+            continue;
+        }
+        uint8_t* d = dst + i * 4;
+        unsigned int s[4];
+        for (int c = 0; c < 4; c++) {
+            s[c] = div255(color[c] * coverage);
+        }
+        unsigned int inverse = 255 - s[3];
+        for (int c = 0; c < 4; c++) {
+            d[c] = saturate(s[c] + div255(d[c] * inverse));
+        }
+    }
+}
+
+static void scalar_premultiply(uint8_t* dst, const uint8_t* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* s = src + i * 4;
+        uint8_t* d = dst + i * 4;
+        unsigned int alpha = s[3];
+        d[0] = (uint8_t)div255(s[0] * alpha);
+        d[1] = (uint8_t)div255(s[1] * alpha);
+        d[2] = (uint8_t)div255(s[2] * alpha);
+        d[3] = (uint8_t)alpha;
+    }
+}
+
+static void scalar_swap_rb(uint8_t* dst, const uint8_t* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* s = src + i * 4;
+        uint8_t* d = dst + i * 4;
+        uint8_t r = s[0];
+        uint8_t b = s[2];
+        d[0] = b;
+        d[1] = s[1];
+        d[2] = r;
+        d[3] = s[3];
+    }
+}
+
+static void scalar_rgba_to_rgb(uint8_t* dst, const uint8_t* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i * 3] = src[i * 4];
+        dst[i * 3 + 1] = src[i * 4 + 1];
+        dst[i * 3 + 2] = src[i * 4 + 2];
+    }
+}
+
+static void scalar_rgb_to_rgba(uint8_t* dst, const uint8_t* src, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        dst[i * 4] = src[i * 3];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = 255;
+    }
+}
+
+static void scalar_bilinear_row(uint8_t* dst, const uint8_t* row0, const uint8_t* row1,
+                                const BilinearTap* taps, size_t count, unsigned int weight) {
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* p00 = row0 + (size_t)taps[i].x0 * 4;
+        const uint8_t* p01 = row0 + (size_t)taps[i].x1 * 4;
+        const uint8_t* p10 = row1 + (size_t)taps[i].x0 * 4;
+        const uint8_t* p11 = row1 + (size_t)taps[i].x1 * 4;
+        unsigned int wx = taps[i].weight;
+        for (int c = 0; c < 4; c++) {
+            unsigned int top = (p00[c] * (256 - wx) + p01[c] * wx + 128) >> 8;
+            unsigned int bottom = (p10[c] * (256 - wx) + p11[c] * wx + 128) >> 8;
+            dst[i * 4 + c] = (uint8_t)((top * (256 - weight) + bottom * weight + 128) >> 8);
+        }
+    }
+}
+
+const PixelKernels pixel_kernels_scalar = {
+    scalar_fill,
+    scalar_blend_solid,
+    scalar_blend_over,
+    scalar_blend_mask,
+    scalar_premultiply,
+    scalar_swap_rb,
+    scalar_rgba_to_rgb,
+    scalar_rgb_to_rgba,
+    scalar_bilinear_row
+};
+
+static const PixelKernels* kernels = &pixel_kernels_scalar;
+static PixelISA kernels_isa = PIXEL_ISA_SCALAR;
+static pthread_once_t kernels_once = PTHREAD_ONCE_INIT;
+
+static int isa_supported(PixelISA isa) {
+    switch (isa) {
+        case PIXEL_ISA_SCALAR:
+            return 1;
+#ifdef PIXEL_OPS_X86
+        case PIXEL_ISA_SSE2:
+            return __builtin_cpu_supports("sse2");
+        case PIXEL_ISA_AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return 0;
+    }
+}
+
+static void select_isa(PixelISA isa) {
+    kernels_isa = isa;
+#ifdef PIXEL_OPS_X86
+    if (isa == PIXEL_ISA_AVX2) {
+        kernels = &pixel_kernels_avx2;
+        return;
+    }
+    if (isa == PIXEL_ISA_SSE2) {
+        kernels = &pixel_kernels_sse2;
+        return;
+    }
+#endif
+    kernels = &pixel_kernels_scalar;
+}
+
+static void detect_isa(void) {
+#ifdef PIXEL_OPS_X86
+    __builtin_cpu_init();
+#endif
+    if (isa_supported(PIXEL_ISA_AVX2)) {
+        select_isa(PIXEL_ISA_AVX2);
+    } else if (isa_supported(PIXEL_ISA_SSE2)) {
+        select_isa(PIXEL_ISA_SSE2);
+    } else {
+        select_isa(PIXEL_ISA_SCALAR);
+    }
+}
+
+static const PixelKernels* active_kernels(void) {
+    pthread_once(&kernels_once, detect_isa);
+    return kernels;
+}
+
+PixelISA pixel_ops_get_isa(void) {
+    active_kernels();
+    return kernels_isa;
+}
+
+int pixel_ops_set_isa(PixelISA isa) {
+    active_kernels();
+    if (!isa_supported(isa)) {
+        return -1;
+    }
+    select_isa(isa);
+    return 0;
+}
+
+const char* pixel_ops_isa_name(PixelISA isa) {
+    switch (isa) {
+        case PIXEL_ISA_SCALAR:
+            return "scalar";
+        case PIXEL_ISA_SSE2:
+            return "sse2";
+        case PIXEL_ISA_AVX2:
+            return "avx2";
+        default:
+            return "unknown";
+    }
+}
+
+void pixel_fill(uint8_t* dst, size_t count, const uint8_t pixel[4]) {
+    active_kernels()->fill(dst, count, pixel);
+}
+
+void pixel_blend_solid(uint8_t* dst, size_t count, const uint8_t color[4]) {
+    active_kernels()->blend_solid(dst, count, color);
+}
+
+void pixel_blend_over(uint8_t* dst, const uint8_t* src, size_t count) {
+    active_kernels()->blend_over(dst, src, count);
+}
+
+void pixel_blend_mask(uint8_t* dst, const uint8_t* mask, size_t count, const uint8_t color[4]) {
+    active_kernels()->blend_mask(dst, mask, count, color);
+}
+
+void pixel_premultiply(uint8_t* dst, const uint8_t* src, size_t count) {
+    active_kernels()->premultiply(dst, src, count);
+}
+
+void pixel_swap_rb(uint8_t* dst, const uint8_t* src, size_t count) {
+    active_kernels()->swap_rb(dst, src, count);
+}
+
+void pixel_rgba_to_rgb(uint8_t* dst, const uint8_t* src, size_t count) {
+    active_kernels()->rgba_to_rgb(dst, src, count);
+}
+
+void pixel_rgb_to_rgba(uint8_t* dst, const uint8_t* src, size_t count) {
+    active_kernels()->rgb_to_rgba(dst, src, count);
+}
+
+// Map output column or row i of a scaled image back onto the source, in
+// 1/256 pixel units, sampling at pixel centers
+static BilinearTap bilinear_tap(long long i, int scaled, int source) {
+    BilinearTap tap;
+    long long position = ((2 * i + 1) * source * 128) / scaled - 128;
+    if (position < 0) {
+        position = 0;
+    }
+    tap.x0 = (int)(position >> 8);
+    tap.weight = (unsigned int)(position & 255);
+    if (tap.x0 >= source - 1) {
+        tap.x0 = source - 1;
+        tap.weight = 0;
+    }
+    tap.x1 = tap.weight ? tap.x0 + 1 : tap.x0;
+    return tap;
+}
+
+#define BILINEAR_CHUNK 256
+
+// Keeps bilinear_tap's 64-bit arithmetic from overflowing
+#define BILINEAR_MAX_SIZE (1 << 24)
+
+void pixel_scale_bilinear(uint8_t* dst, size_t dst_stride, int x, int y, int width, int height,
+                          int scaled_width, int scaled_height,
+                          const uint8_t* src, int src_width, int src_height, size_t src_stride) {
+    if (!dst || !src || x < 0 || y < 0 || width <= 0 || height <= 0 ||
+        scaled_width <= 0 || scaled_height <= 0 || src_width <= 0 || src_height <= 0) {
+        return;
+    }
+    if (scaled_width > BILINEAR_MAX_SIZE || scaled_height > BILINEAR_MAX_SIZE ||
+        src_width > BILINEAR_MAX_SIZE || src_height > BILINEAR_MAX_SIZE ||
+        x > BILINEAR_MAX_SIZE - width || y > BILINEAR_MAX_SIZE - height) {
+        return;
+    }
+
+    const PixelKernels* k = active_kernels();
+    BilinearTap taps[BILINEAR_CHUNK];
+
+    // Columns in chunks so the taps fit on the stack
+    for (int column = 0; column < width; column += BILINEAR_CHUNK) {
+        int columns = width - column < BILINEAR_CHUNK ? width - column : BILINEAR_CHUNK;
+        for (int i = 0; i < columns; i++) {
+            taps[i] = bilinear_tap((long long)x + column + i, scaled_width, src_width);
+        }
+
+        for (int row = 0; row < height; row++) {
+            BilinearTap vertical = bilinear_tap((long long)y + row, scaled_height, src_height);
+            k->bilinear_row(dst + (size_t)row * dst_stride + (size_t)column * 4,
+                            src + (size_t)vertical.x0 * src_stride,
+                            src + (size_t)vertical.x1 * src_stride,
+                            taps, (size_t)columns, vertical.weight);
+        }
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef JUST_BROWSE_PIXEL_OPS_INTERNAL_H
+#define JUST_BROWSE_PIXEL_OPS_INTERNAL_H
+
+// Kernel tables shared by the pixel_ops translation units; not installed
+
+#include "rendering/pixel_ops.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PIXEL_OPS_X86 1
+#endif
+
+// Source column pair and weight for one bilinear output column
+typedef struct {
+    int x0;
+    int x1;
+    unsigned int weight;        // Weight of x1, out of 256
+} BilinearTap;
+
+typedef struct {
+    void (*fill)(uint8_t* dst, size_t count, const uint8_t pixel[4]);
+    void (*blend_solid)(uint8_t* dst, size_t count, const uint8_t color[4]);
+    void (*blend_over)(uint8_t* dst, const uint8_t* src, size_t count);
+    void (*blend_mask)(uint8_t* dst, const uint8_t* mask, size_t count, const uint8_t color[4]);
+    void (*premultiply)(uint8_t* dst, const uint8_t* src, size_t count);
+    void (*swap_rb)(uint8_t* dst, const uint8_t* src, size_t count);
+    void (*rgba_to_rgb)(uint8_t* dst, const uint8_t* src, size_t count);
+    void (*rgb_to_rgba)(uint8_t* dst, const uint8_t* src, size_t count);
+    // One output row from two source rows; weight is that of row1, out of 256
+    void (*bilinear_row)(uint8_t* dst, const uint8_t* row0, const uint8_t* row1,
+                         const BilinearTap* taps, size_t count, unsigned int weight);
+} PixelKernels;
+
+// Portable kernels; the SIMD versions use them for leftover pixels
+extern const PixelKernels pixel_kernels_scalar;
+
+#ifdef PIXEL_OPS_X86
+extern const PixelKernels pixel_kernels_sse2;
+extern const PixelKernels pixel_kernels_avx2;
+#endif
+
+#endif // JUST_BROWSE_PIXEL_OPS_INTERNAL_H
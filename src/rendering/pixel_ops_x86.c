@@ -0,0 +1,338 @@
+#include "pixel_ops_internal.h"
+
+// SSE2 and AVX2 pixel kernels
+// Compiled with per-function target attributes, so the rest of the build
+// needs no extra flags and dispatch picks a version at runtime. Channels
+// are widened to 16 bits and divided by 255 exactly as the scalar
+// kernels do, which keeps the output bit-identical. SSE2 has no byte
+// shuffle, so the RGB conversions only get AVX2 versions (which may use
+// the SSSE3 shuffle AVX2 implies).
+
+#ifdef PIXEL_OPS_X86
+
+#include <immintrin.h>
+#include <string.h>
+
+#define SSE2 __attribute__((target("sse2")))
+#define AVX2 __attribute__((target("avx2")))
+
+// 16-bit lanes: exact x / 255 for x <= 255 * 255
+static inline SSE2 __m128i div255_sse2(__m128i x) {
+    __m128i t = _mm_add_epi16(x, _mm_set1_epi16(1));
+    t = _mm_add_epi16(t, _mm_srli_epi16(x, 8));
+    return _mm_srli_epi16(t, 8);
+}
+
+// Broadcast each pixel's alpha to its four 16-bit lanes
+static inline SSE2 __m128i alpha_sse2(__m128i pixels) {
+    pixels = _mm_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_shufflehi_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+// src + dst * (255 - src alpha) / 255 for two widened pixels
+static inline SSE2 __m128i over_sse2(__m128i dst, __m128i src) {
+    __m128i inverse = _mm_sub_epi16(_mm_set1_epi16(255), alpha_sse2(src));
+    return _mm_add_epi16(src, div255_sse2(_mm_mullo_epi16(dst, inverse)));
+}
+
+static SSE2 void sse2_fill(uint8_t* dst, size_t count, const uint8_t pixel[4]) {
+    uint32_t value;
+    memcpy(&value, pixel, 4);
+    __m128i v = _mm_set1_epi32((int)value);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_si128((__m128i*)(dst + i * 4), v);
+    }
+    pixel_kernels_scalar.fill(dst + i * 4, count - i, pixel);
+}
+
+static SSE2 void sse2_blend_solid(uint8_t* dst, size_t count, const uint8_t color[4]) {
+    uint32_t value;
+    memcpy(&value, color, 4);
+    __m128i zero = _mm_setzero_si128();
+    __m128i src = _mm_unpacklo_epi8(_mm_set1_epi32((int)value), zero);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+        __m128i lo = over_sse2(_mm_unpacklo_epi8(d, zero), src);
+        __m128i hi = over_sse2(_mm_unpackhi_epi8(d, zero), src);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    pixel_kernels_scalar.blend_solid(dst + i * 4, count - i, color);
+}
+
+static SSE2 void sse2_blend_over(uint8_t* dst, const uint8_t* src, size_t count) {
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+        __m128i lo = over_sse2(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero));
+        __m128i hi = over_sse2(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    pixel_kernels_scalar.blend_over(dst + i * 4, src + i * 4, count - i);
+}
+
+static SSE2 void sse2_blend_mask(uint8_t* dst, const uint8_t* mask, size_t count, const uint8_t color[4]) {
+    uint32_t value;
+    memcpy(&value, color, 4);
+    __m128i zero = _mm_setzero_si128();
+    __m128i c = _mm_unpacklo_epi8(_mm_set1_epi32((int)value), zero);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        uint32_t coverage;
+        memcpy(&coverage, mask + i, 4);
+        if (coverage == 0) {
+            continue;
+        }
+        // Spread each coverage byte over its pixel's four channels
+        __m128i m = _mm_cvtsi32_si128((int)coverage);
+        m = _mm_unpacklo_epi8(m, m);
+        m = _mm_unpacklo_epi16(m, m);
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i * 4));
+        __m128i s_lo = div255_sse2(_mm_mullo_epi16(c, _mm_unpacklo_epi8(m, zero)));
+        __m128i s_hi = div255_sse2(_mm_mullo_epi16(c, _mm_unpackhi_epi8(m, zero)));
+        __m128i lo = over_sse2(_mm_unpacklo_epi8(d, zero), s_lo);
+        __m128i hi = over_sse2(_mm_unpackhi_epi8(d, zero), s_hi);
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    pixel_kernels_scalar.blend_mask(dst + i * 4, mask + i, count - i, color);
+}
+
+// Alpha in the color lanes, 255 in the alpha lane, so alpha survives
+static inline SSE2 __m128i premultiply_factor_sse2(__m128i pixels) {
+    __m128i color_lanes = _mm_set_epi16(0, -1, -1, -1, 0, -1, -1, -1);
+    __m128i alpha_lane = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    return _mm_or_si128(_mm_and_si128(alpha_sse2(pixels), color_lanes), alpha_lane);
+}
+
+static SSE2 void sse2_premultiply(uint8_t* dst, const uint8_t* src, size_t count) {
+    __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i lo = _mm_unpacklo_epi8(s, zero);
+        __m128i hi = _mm_unpackhi_epi8(s, zero);
+        lo = div255_sse2(_mm_mullo_epi16(lo, premultiply_factor_sse2(lo)));
+        hi = div255_sse2(_mm_mullo_epi16(hi, premultiply_factor_sse2(hi)));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+    pixel_kernels_scalar.premultiply(dst + i * 4, src + i * 4, count - i);
+}
+
+static SSE2 void sse2_swap_rb(uint8_t* dst, const uint8_t* src, size_t count) {
+    __m128i ga = _mm_set1_epi32((int)0xFF00FF00u);
+    __m128i rb = _mm_set1_epi32(0x00FF00FF);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 4));
+        __m128i swapped = _mm_or_si128(_mm_slli_epi32(s, 16), _mm_srli_epi32(s, 16));
+        __m128i out = _mm_or_si128(_mm_and_si128(s, ga), _mm_and_si128(swapped, rb));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), out);
+    }
+    pixel_kernels_scalar.swap_rb(dst + i * 4, src + i * 4, count - i);
+}
+
+static SSE2 void sse2_bilinear_row(uint8_t* dst, const uint8_t* row0, const uint8_t* row1,
+                                   const BilinearTap* taps, size_t count, unsigned int weight) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i round = _mm_set1_epi16(128);
+    __m128i vertical = _mm_set_epi16((short)weight, (short)weight, (short)weight, (short)weight,
+                                     (short)(256 - weight), (short)(256 - weight),
+                                     (short)(256 - weight), (short)(256 - weight));
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t p[4];
+        memcpy(&p[0], row0 + (size_t)taps[i].x0 * 4, 4);
+        memcpy(&p[1], row0 + (size_t)taps[i].x1 * 4, 4);
+        memcpy(&p[2], row1 + (size_t)taps[i].x0 * 4, 4);
+        memcpy(&p[3], row1 + (size_t)taps[i].x1 * 4, 4);
+        __m128i texels = _mm_loadu_si128((const __m128i*)p);
+
+        short wx = (short)taps[i].weight;
+        short wx0 = (short)(256 - taps[i].weight);
+        __m128i horizontal = _mm_set_epi16(wx, wx, wx, wx, wx0, wx0, wx0, wx0);
+
+        // Lanes 0-3 hold the left texel, 4-7 the right; fold them together
+        __m128i top = _mm_mullo_epi16(_mm_unpacklo_epi8(texels, zero), horizontal);
+        __m128i bottom = _mm_mullo_epi16(_mm_unpackhi_epi8(texels, zero), horizontal);
+        top = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(top, _mm_srli_si128(top, 8)), round), 8);
+        bottom = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(bottom, _mm_srli_si128(bottom, 8)), round), 8);
+
+        __m128i both = _mm_mullo_epi16(_mm_unpacklo_epi64(top, bottom), vertical);
+        both = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(both, _mm_srli_si128(both, 8)), round), 8);
+        uint32_t out = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(both, zero));
+        memcpy(dst + i * 4, &out, 4);
+    }
+}
+
+// No byte shuffle before SSSE3, so the RGB conversions stay scalar
+static void sse2_rgba_to_rgb(uint8_t* dst, const uint8_t* src, size_t count) {
+    pixel_kernels_scalar.rgba_to_rgb(dst, src, count);
+}
+
+static void sse2_rgb_to_rgba(uint8_t* dst, const uint8_t* src, size_t count) {
+    pixel_kernels_scalar.rgb_to_rgba(dst, src, count);
+}
+
+const PixelKernels pixel_kernels_sse2 = {
+    sse2_fill,
+    sse2_blend_solid,
+    sse2_blend_over,
+    sse2_blend_mask,
+    sse2_premultiply,
+    sse2_swap_rb,
+    sse2_rgba_to_rgb,
+    sse2_rgb_to_rgba,
+    sse2_bilinear_row
+};
+
+static inline AVX2 __m256i div255_avx2(__m256i x) {
+    __m256i t = _mm256_add_epi16(x, _mm256_set1_epi16(1));
+    t = _mm256_add_epi16(t, _mm256_srli_epi16(x, 8));
+    return _mm256_srli_epi16(t, 8);
+}
+
+static inline AVX2 __m256i alpha_avx2(__m256i pixels) {
+    pixels = _mm256_shufflelo_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm256_shufflehi_epi16(pixels, _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static inline AVX2 __m256i over_avx2(__m256i dst, __m256i src) {
+    __m256i inverse = _mm256_sub_epi16(_mm256_set1_epi16(255), alpha_avx2(src));
+    return _mm256_add_epi16(src, div255_avx2(_mm256_mullo_epi16(dst, inverse)));
+}
+
+static AVX2 void avx2_fill(uint8_t* dst, size_t count, const uint8_t pixel[4]) {
+    uint32_t value;
+    memcpy(&value, pixel, 4);
+    __m256i v = _mm256_set1_epi32((int)value);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), v);
+    }
+    pixel_kernels_scalar.fill(dst + i * 4, count - i, pixel);
+}
+
+static AVX2 void avx2_blend_solid(uint8_t* dst, size_t count, const uint8_t color[4]) {
+    uint32_t value;
+    memcpy(&value, color, 4);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i src = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)value), zero);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i * 4));
+        __m256i lo = over_avx2(_mm256_unpacklo_epi8(d, zero), src);
+        __m256i hi = over_avx2(_mm256_unpackhi_epi8(d, zero), src);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    pixel_kernels_scalar.blend_solid(dst + i * 4, count - i, color);
+}
+
+static AVX2 void avx2_blend_over(uint8_t* dst, const uint8_t* src, size_t count) {
+    __m256i zero = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i * 4));
+        __m256i lo = over_avx2(_mm256_unpacklo_epi8(d, zero), _mm256_unpacklo_epi8(s, zero));
+        __m256i hi = over_avx2(_mm256_unpackhi_epi8(d, zero), _mm256_unpackhi_epi8(s, zero));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    pixel_kernels_scalar.blend_over(dst + i * 4, src + i * 4, count - i);
+}
+
+static AVX2 void avx2_blend_mask(uint8_t* dst, const uint8_t* mask, size_t count, const uint8_t color[4]) {
+    uint32_t value;
+    memcpy(&value, color, 4);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i c = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)value), zero);
+    // Byte i of the result takes mask byte i / 4 within each 128-bit lane
+    __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                      4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        uint64_t coverage;
+        memcpy(&coverage, mask + i, 8);
+        if (coverage == 0) {
+            continue;
+        }
+        __m256i m = _mm256_shuffle_epi8(_mm256_set1_epi64x((long long)coverage), spread);
+        __m256i d = _mm256_loadu_si256((const __m256i*)(dst + i * 4));
+        __m256i s_lo = div255_avx2(_mm256_mullo_epi16(c, _mm256_unpacklo_epi8(m, zero)));
+        __m256i s_hi = div255_avx2(_mm256_mullo_epi16(c, _mm256_unpackhi_epi8(m, zero)));
+        __m256i lo = over_avx2(_mm256_unpacklo_epi8(d, zero), s_lo);
+        __m256i hi = over_avx2(_mm256_unpackhi_epi8(d, zero), s_hi);
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    pixel_kernels_scalar.blend_mask(dst + i * 4, mask + i, count - i, color);
+}
+
+static AVX2 void avx2_premultiply(uint8_t* dst, const uint8_t* src, size_t count) {
+    __m256i zero = _mm256_setzero_si256();
+    __m256i color_lanes = _mm256_set_epi16(0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1, 0, -1, -1, -1);
+    __m256i alpha_lane = _mm256_set_epi16(255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        __m256i lo = _mm256_unpacklo_epi8(s, zero);
+        __m256i hi = _mm256_unpackhi_epi8(s, zero);
+        __m256i lo_factor = _mm256_or_si256(_mm256_and_si256(alpha_avx2(lo), color_lanes), alpha_lane);
+        __m256i hi_factor = _mm256_or_si256(_mm256_and_si256(alpha_avx2(hi), color_lanes), alpha_lane);
+        lo = div255_avx2(_mm256_mullo_epi16(lo, lo_factor));
+        hi = div255_avx2(_mm256_mullo_epi16(hi, hi_factor));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_packus_epi16(lo, hi));
+    }
+    pixel_kernels_scalar.premultiply(dst + i * 4, src + i * 4, count - i);
+}
+
+static AVX2 void avx2_swap_rb(uint8_t* dst, const uint8_t* src, size_t count) {
+    __m256i order = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                     2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i s = _mm256_loadu_si256((const __m256i*)(src + i * 4));
+        _mm256_storeu_si256((__m256i*)(dst + i * 4), _mm256_shuffle_epi8(s, order));
+    }
+    pixel_kernels_scalar.swap_rb(dst + i * 4, src + i * 4, count - i);
+}
+
+static AVX2 void avx2_rgba_to_rgb(uint8_t* dst, const uint8_t* src, size_t count) {
+    // Four pixels in, twelve bytes out; the top four shuffled bytes are zero
+    __m128i order = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i packed = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i * 4)), order);
+        _mm_storel_epi64((__m128i*)(dst + i * 3), packed);
+        uint32_t tail = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        memcpy(dst + i * 3 + 8, &tail, 4);
+    }
+    pixel_kernels_scalar.rgba_to_rgb(dst + i * 3, src + i * 4, count - i);
+}
+
+static AVX2 void avx2_rgb_to_rgba(uint8_t* dst, const uint8_t* src, size_t count) {
+    __m128i order = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i opaque = _mm_set1_epi32((int)0xFF000000u);
+    size_t i = 0;
+    // Each step reads 16 bytes but consumes 12, so stop while 4 spare remain
+    for (; i + 6 <= count; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i*)(src + i * 3));
+        _mm_storeu_si128((__m128i*)(dst + i * 4), _mm_or_si128(_mm_shuffle_epi8(s, order), opaque));
+    }
+    pixel_kernels_scalar.rgb_to_rgba(dst + i * 4, src + i * 3, count - i);
+}
+
+const PixelKernels pixel_kernels_avx2 = {
+    avx2_fill,
+    avx2_blend_solid,
+    avx2_blend_over,
+    avx2_blend_mask,
+    avx2_premultiply,
+    avx2_swap_rb,
+    avx2_rgba_to_rgb,
+    avx2_rgb_to_rgba,
+    sse2_bilinear_row
+};
+
+#endif
@@ -1,20 +1,120 @@
 #include "rendering/renderer.h"
+#include "rendering/pixel_ops.h"
+#include "display_list_internal.h"
 #include "dom/dom.h"
+#include "core/thread_pool.h"
 #include <stdlib.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <string.h>
+#include <stdatomic.h>
 
-// RmlUi integration stub
-// In a real implementation, this would use actual RmlUi
-// For now, we'll create a minimal stub
+// Tile-based software rasterizer
+// Draw commands are recorded into the frame's display list, either directly
+// or by replaying cached lists. renderer_render bins each command
+// into the fixed-size tiles it touches, then rasterizes the tiles in
+// parallel: a tile only ever writes its own pixels, so workers never share
+// memory and the output is identical for any thread count.
+//
+// Only damaged pixels are repainted. Damage comes from diffing the command
+// list against the previous frame, plus anything reported through
+// renderer_add_damage, and is kept as a short list of merged rectangles.
+//
+// Pixels are written through the pixel_ops kernels and stored premultiplied.
+// Draw helpers only ever see areas clipped to one tile, so their per-row
+// scratch buffers are TILE_SIZE pixels wide.
+//
+// With triple buffering, finished frames are handed to a consumer thread
+// through one atomic slot: the renderer swaps its back buffer into the slot,
+// the consumer swaps its front buffer out of it, and neither ever waits. A
+// recycled back buffer holds an older frame than the last one, so besides
+// this frame's damage it is repainted wherever the frames it missed changed,
+// taken from a short per-frame damage history.
+
+#define TILE_SIZE 64
+#define MAX_DAMAGE_RECTS 16
+#define MAX_BUFFERS 3
+#define DAMAGE_HISTORY 4            // Frames a buffer may fall behind before a full repaint
+
+// Handoff slot: buffer index, plus a flag for a frame the consumer has not taken
+#define SLOT_INDEX 3u
+#define SLOT_FRESH 4u
+
+typedef struct {
+    unsigned int* commands;
+    size_t count;
+    size_t capacity;
+} TileBin;
+
+typedef struct {
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+} ClipRect;
+
+// Non-overlapping rectangles; merged further once the list is full
+typedef struct {
+    ClipRect rects[MAX_DAMAGE_RECTS];
+    size_t count;
+} DamageList;
+
+typedef struct {
+    unsigned char* pixels;
+    int width;
+    int height;
+    uint64_t sequence;                // Frame the pixels hold; 0 when stale
+} FrameBuffer;
 
 struct Renderer {
     int width;
     int height;
-    unsigned char* buffer;
+    unsigned char* buffer;            // Pixels being painted this frame
     size_t buffer_size;
+    RenderColor clear_color;
+    DisplayList* frame;               // Commands for the next render
+    DisplayList* previous;            // What the last frame showed
+    TileBin* bins;
+    int tiles_x;
+    int tiles_y;
+    size_t* damaged_tiles;
+    size_t damaged_tile_count;
+    DamageList pending;
+    int full_damage;                  // Next frame differs from the last everywhere
+    DamageList frame_damage;          // This frame against the last one
+    RenderRect frame_rects[MAX_DAMAGE_RECTS];
+    DamageList repaint;               // Damage the painted buffer had missed
+    DamageList history[DAMAGE_HISTORY];   // frame_damage by sequence
+    uint64_t sequence;                // Frames rendered
+    FrameBuffer buffers[MAX_BUFFERS];
+    int buffer_count;                 // 1, or 3 when triple buffered
+    int back;                         // Buffer the next frame is painted into
+    int shown;                        // Buffer holding the last frame
+    int front;                        // Buffer the consumer reads (consumer thread only)
+    atomic_uint ready;                // Handoff slot
+    ThreadPool* pool;
 };
 
+static int tile_count(int pixels) {
+    return (pixels + TILE_SIZE - 1) / TILE_SIZE;
+}
+
+static void free_bins(Renderer* renderer) {
+    if (!renderer->bins) {
+        return;
+    }
+    size_t count = (size_t)renderer->tiles_x * (size_t)renderer->tiles_y;
+    for (size_t i = 0; i < count; i++) {
+        free(renderer->bins[i].commands);
+    }
+    free(renderer->bins);
+    renderer->bins = NULL;
+    free(renderer->damaged_tiles);
+    renderer->damaged_tiles = NULL;
+    renderer->tiles_x = 0;
+    renderer->tiles_y = 0;
+}
+
 Renderer* renderer_init(int width, int height) {
     if (width <= 0 || height <= 0) {
         return NULL;
@@ -26,7 +126,7 @@ Renderer* renderer_init(int width, int height) {
         return NULL;
     }
 
-    Renderer* renderer = (Renderer*)malloc(sizeof(Renderer));
+    Renderer* renderer = (Renderer*)calloc(1, sizeof(Renderer));
     if (!renderer) {
         return NULL;
     }
@@ -44,18 +144,23 @@ Renderer* renderer_init(int width, int height) {
     }
     
     renderer->buffer_size = buffer_size;
-    renderer->buffer = (unsigned char*)calloc(buffer_size, 1);
+    renderer->buffers[0].pixels = (unsigned char*)calloc(buffer_size, 1);
+    renderer->buffer_count = 1;
+    renderer->buffer = renderer->buffers[0].pixels;
+    renderer->frame = display_list_create();
+    renderer->previous = display_list_create();
 
-    if (!renderer->buffer) {
+    if (!renderer->buffer || !renderer->frame || !renderer->previous) {
+        display_list_destroy(renderer->frame);
+        display_list_destroy(renderer->previous);
+        free(renderer->buffers[0].pixels);
         free(renderer);
         return NULL;
     }
 
-    // In real implementation:
-    // 1. Initialize RmlUi context
-    // 2. Set up rendering backend (OpenGL, etc.)
-    // 3. Configure font system (FreeType)
-    // 4. Set up text shaping (HarfBuzz)
+    // Nothing has been painted yet
+    renderer->full_damage = 1;
+    atomic_init(&renderer->ready, 0);
 
     return renderer;
 }
@@ -65,30 +170,683 @@ void renderer_destroy(Renderer* renderer) {
         return;
     }
 
-    // In real implementation: Clean up RmlUi context
-    free(renderer->buffer);
+    free_bins(renderer);
+    display_list_destroy(renderer->frame);
+    display_list_destroy(renderer->previous);
+    for (int i = 0; i < renderer->buffer_count; i++) {
+        free(renderer->buffers[i].pixels);
+    }
     free(renderer);
 }
 
+int renderer_set_thread_pool(Renderer* renderer, ThreadPool* pool) {
+    if (!renderer) {
+        return -1;
+    }
+
+    renderer->pool = pool;
+    return 0;
+}
+
+int renderer_set_clear_color(Renderer* renderer, RenderColor color) {
+    if (!renderer) {
+        return -1;
+    }
+
+    if (memcmp(&renderer->clear_color, &color, sizeof(color)) != 0) {
+        renderer->clear_color = color;
+        renderer->full_damage = 1;
+    }
+    return 0;
+}
+
+void renderer_clear_commands(Renderer* renderer) {
+    if (renderer) {
+        display_list_clear(renderer->frame);
+    }
+}
+
+int renderer_fill_rect(Renderer* renderer, int x, int y, int width, int height, RenderColor color) {
+    if (!renderer) {
+        return -1;
+    }
+
+    return display_list_fill_rect(renderer->frame, x, y, width, height, color);
+}
+
+int renderer_fill_gradient(Renderer* renderer, int x, int y, int width, int height,
+                           RenderColor from, RenderColor to, RenderGradientDirection direction) {
+    if (!renderer) {
+        return -1;
+    }
+
+    return display_list_fill_gradient(renderer->frame, x, y, width, height, from, to, direction);
+}
+
+int renderer_stroke_border(Renderer* renderer, int x, int y, int width, int height,
+                           const int widths[4], RenderColor color) {
+    if (!renderer) {
+        return -1;
+    }
+
+    return display_list_stroke_border(renderer->frame, x, y, width, height, widths, color);
+}
+
+int renderer_draw_glyph(Renderer* renderer, int x, int y, const unsigned char* mask,
+                        int width, int height, int stride, RenderColor color) {
+    if (!renderer) {
+        return -1;
+    }
+
+    return display_list_draw_glyph(renderer->frame, x, y, mask, width, height, stride, color);
+}
+
+int renderer_draw_image(Renderer* renderer, int x, int y, int width, int height,
+                        const unsigned char* pixels, int image_width, int image_height, int stride) {
+    if (!renderer) {
+        return -1;
+    }
+
+    return display_list_draw_image(renderer->frame, x, y, width, height, pixels, image_width, image_height, stride);
+}
+
+int renderer_draw_display_list(Renderer* renderer, const DisplayList* list, int dx, int dy) {
+    if (!renderer) {
+        return -1;
+    }
+
+    return display_list_append(renderer->frame, list, dx, dy, 1.0f);
+}
+
+// Colors are recorded with straight alpha; the framebuffer is premultiplied
+static void premultiply_color(RenderColor color, uint8_t out[4]) {
+    uint8_t straight[4] = { color.r, color.g, color.b, color.a };
+    pixel_premultiply(out, straight, 1);
+}
+
+// Intersect a rectangle with a clip; 64-bit so far-off geometry can't overflow
+static int clip_rect(long long x, long long y, long long width, long long height,
+                     const ClipRect* clip, ClipRect* out) {
+    long long x0 = x > clip->x0 ? x : clip->x0;
+    long long y0 = y > clip->y0 ? y : clip->y0;
+    long long x1 = x + width < clip->x1 ? x + width : clip->x1;
+    long long y1 = y + height < clip->y1 ? y + height : clip->y1;
+    if (x0 >= x1 || y0 >= y1) {
+        return 0;
+    }
+    out->x0 = (int)x0;
+    out->y0 = (int)y0;
+    out->x1 = (int)x1;
+    out->y1 = (int)y1;
+    return 1;
+}
+
+// Overwrite an area with a color, no blending
+static void store_span(Renderer* renderer, const ClipRect* area, RenderColor color) {
+    size_t pitch = (size_t)renderer->width * 4;
+    unsigned char* first = renderer->buffer + (size_t)area->y0 * pitch + (size_t)area->x0 * 4;
+    size_t row_bytes = (size_t)(area->x1 - area->x0) * 4;
+    uint8_t pixel[4];
+    premultiply_color(color, pixel);
+
+    // Write the first row, then copy it down
+    pixel_fill(first, (size_t)(area->x1 - area->x0), pixel);
+    for (int y = area->y0 + 1; y < area->y1; y++) {
+        memcpy(first + (size_t)(y - area->y0) * pitch, first, row_bytes);
+    }
+}
+
+static void fill_span(Renderer* renderer, const ClipRect* area, RenderColor color) {
+    if (color.a == 255) {
+        store_span(renderer, area, color);
+        return;
+    }
+    if (color.a == 0) {
+        return;
+    }
+
+    size_t pitch = (size_t)renderer->width * 4;
+    uint8_t pixel[4];
+    premultiply_color(color, pixel);
+    for (int y = area->y0; y < area->y1; y++) {
+        unsigned char* row = renderer->buffer + (size_t)y * pitch + (size_t)area->x0 * 4;
+        pixel_blend_solid(row, (size_t)(area->x1 - area->x0), pixel);
+    }
+}
+
+static unsigned char lerp_channel(unsigned char from, unsigned char to, long long step, long long steps) {
+    return (unsigned char)(from + ((long long)(to - from) * step) / steps);
+}
+
+static RenderColor gradient_color(const DisplayOp* command, long long step, long long steps) {
+    RenderColor color;
+    color.r = lerp_channel(command->color.r, command->color_to.r, step, steps);
+    color.g = lerp_channel(command->color.g, command->color_to.g, step, steps);
+    color.b = lerp_channel(command->color.b, command->color_to.b, step, steps);
+    color.a = lerp_channel(command->color.a, command->color_to.a, step, steps);
+    return color;
+}
+
+static void draw_gradient(Renderer* renderer, const DisplayOp* command, const ClipRect* area) {
+    size_t pitch = (size_t)renderer->width * 4;
+    int horizontal = command->direction == RENDER_GRADIENT_HORIZONTAL;
+    long long steps = (horizontal ? command->width : command->height) - 1;
+    if (steps < 1) {
+        steps = 1;
+    }
+    size_t count = (size_t)(area->x1 - area->x0);
+
+    if (!horizontal) {
+        for (int y = area->y0; y < area->y1; y++) {
+            uint8_t pixel[4];
+            premultiply_color(gradient_color(command, (long long)y - command->y, steps), pixel);
+            pixel_blend_solid(renderer->buffer + (size_t)y * pitch + (size_t)area->x0 * 4, count, pixel);
+        }
+        return;
+    }
+
+    // Every row of a horizontal gradient is the same; build it once
+    uint8_t colors[TILE_SIZE * 4];
+    for (int x = area->x0; x < area->x1; x++) {
+        RenderColor color = gradient_color(command, (long long)x - command->x, steps);
+        premultiply_color(color, colors + (size_t)(x - area->x0) * 4);
+    }
+    for (int y = area->y0; y < area->y1; y++) {
+        pixel_blend_over(renderer->buffer + (size_t)y * pitch + (size_t)area->x0 * 4, colors, count);
+    }
+}
+
+static void draw_border(Renderer* renderer, const DisplayOp* command, const ClipRect* tile) {
+    long long edges[4][4];
+    display_op_areas(command, edges);
+
+    for (int side = 0; side < 4; side++) {
+        ClipRect area;
+        if (clip_rect(edges[side][0], edges[side][1], edges[side][2], edges[side][3], tile, &area)) {
+            fill_span(renderer, &area, command->color);
+        }
+    }
+}
+
+static void draw_glyph(Renderer* renderer, const DisplayOp* command, const ClipRect* area) {
+    size_t pitch = (size_t)renderer->width * 4;
+    size_t count = (size_t)(area->x1 - area->x0);
+    uint8_t color[4];
+    premultiply_color(command->color, color);
+
+    int scaled = command->width != command->source_width || command->height != command->source_height;
+    uint8_t coverage[TILE_SIZE];
+
+    for (int y = area->y0; y < area->y1; y++) {
+        unsigned char* row = renderer->buffer + (size_t)y * pitch + (size_t)area->x0 * 4;
+        long long sy = y - command->y;
+        if (!scaled) {
+            const unsigned char* mask = command->pixels + (size_t)sy * (size_t)command->stride;
+            pixel_blend_mask(row, mask + (area->x0 - command->x), count, color);
+            continue;
+        }
+
+        // Glyphs replayed at another scale are resampled like images
+        sy = (sy * command->source_height) / command->height;
+        const unsigned char* mask = command->pixels + (size_t)sy * (size_t)command->stride;
+        for (int x = area->x0; x < area->x1; x++) {
+            long long sx = ((long long)(x - command->x) * command->source_width) / command->width;
+            coverage[x - area->x0] = mask[sx];
+        }
+        pixel_blend_mask(row, coverage, count, color);
+    }
+}
+
+static void draw_image(Renderer* renderer, const DisplayOp* command, const ClipRect* area) {
+    size_t pitch = (size_t)renderer->width * 4;
+    size_t count = (size_t)(area->x1 - area->x0);
+    uint8_t texels[TILE_SIZE * 4];
+
+    for (int y = area->y0; y < area->y1; y++) {
+        unsigned char* row = renderer->buffer + (size_t)y * pitch + (size_t)area->x0 * 4;
+        long long sy = ((long long)(y - command->y) * command->source_height) / command->height;
+        const unsigned char* source = command->pixels + (size_t)sy * (size_t)command->stride;
+        for (int x = area->x0; x < area->x1; x++) {
+            long long sx = ((long long)(x - command->x) * command->source_width) / command->width;
+            memcpy(texels + (size_t)(x - area->x0) * 4, source + (size_t)sx * 4, 4);
+        }
+        pixel_premultiply(texels, texels, count);
+        pixel_blend_over(row, texels, count);
+    }
+}
+
+static void draw_command(Renderer* renderer, const DisplayOp* command, const ClipRect* tile) {
+    if (command->type == DISPLAY_OP_BORDER) {
+        draw_border(renderer, command, tile);
+        return;
+    }
+
+    ClipRect area;
+    if (!clip_rect(command->x, command->y, command->width, command->height, tile, &area)) {
+        return;
+    }
+
+    switch (command->type) {
+        case DISPLAY_OP_FILL:
+            fill_span(renderer, &area, command->color);
+            break;
+        case DISPLAY_OP_GRADIENT:
+            draw_gradient(renderer, command, &area);
+            break;
+        case DISPLAY_OP_GLYPH:
+            draw_glyph(renderer, command, &area);
+            break;
+        case DISPLAY_OP_IMAGE:
+            draw_image(renderer, command, &area);
+            break;
+        default:
+            break;
+    }
+}
+
+static void tile_rect(Renderer* renderer, int tile_x, int tile_y, ClipRect* out) {
+    out->x0 = tile_x * TILE_SIZE;
+    out->y0 = tile_y * TILE_SIZE;
+    out->x1 = out->x0 + TILE_SIZE < renderer->width ? out->x0 + TILE_SIZE : renderer->width;
+    out->y1 = out->y0 + TILE_SIZE < renderer->height ? out->y0 + TILE_SIZE : renderer->height;
+}
+
+static int bin_push(TileBin* bin, unsigned int command) {
+    if (bin->count == bin->capacity) {
+        size_t capacity = bin->capacity ? bin->capacity * 2 : 16;
+        unsigned int* commands = (unsigned int*)realloc(bin->commands, capacity * sizeof(unsigned int));
+        if (!commands) {
+            return -1;
+        }
+        bin->commands = commands;
+        bin->capacity = capacity;
+    }
+    bin->commands[bin->count++] = command;
+    return 0;
+}
+
+static int bin_rect(Renderer* renderer, long long x, long long y, long long width, long long height,
+                    unsigned int command) {
+    ClipRect screen = { 0, 0, renderer->width, renderer->height };
+    ClipRect area;
+    if (!clip_rect(x, y, width, height, &screen, &area)) {
+        return 0;
+    }
+
+    for (int ty = area.y0 / TILE_SIZE; ty <= (area.y1 - 1) / TILE_SIZE; ty++) {
+        for (int tx = area.x0 / TILE_SIZE; tx <= (area.x1 - 1) / TILE_SIZE; tx++) {
+            TileBin* bin = &renderer->bins[(size_t)ty * (size_t)renderer->tiles_x + (size_t)tx];
+            // A border's edges may share tiles; keep one entry per tile
+            if (bin->count > 0 && bin->commands[bin->count - 1] == command) {
+                continue;
+            }
+            if (bin_push(bin, command) != 0) {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static long long rect_area(const ClipRect* rect) {
+    return (long long)(rect->x1 - rect->x0) * (long long)(rect->y1 - rect->y0);
+}
+
+static ClipRect rect_union(const ClipRect* a, const ClipRect* b) {
+    ClipRect out;
+    out.x0 = a->x0 < b->x0 ? a->x0 : b->x0;
+    out.y0 = a->y0 < b->y0 ? a->y0 : b->y0;
+    out.x1 = a->x1 > b->x1 ? a->x1 : b->x1;
+    out.y1 = a->y1 > b->y1 ? a->y1 : b->y1;
+    return out;
+}
+
+static int rects_overlap(const ClipRect* a, const ClipRect* b) {
+    return a->x0 < b->x1 && b->x0 < a->x1 && a->y0 < b->y1 && b->y0 < a->y1;
+}
+
+static void damage_remove(DamageList* list, size_t index) {
+    list->rects[index] = list->rects[--list->count];
+}
+
+static void damage_list_add(DamageList* list, ClipRect rect) {
+    // Overlapping rectangles are merged so no pixel is repainted twice
+    for (size_t i = 0; i < list->count; ) {
+        if (rects_overlap(&list->rects[i], &rect)) {
+            rect = rect_union(&list->rects[i], &rect);
+            damage_remove(list, i);
+            i = 0;
+            continue;
+        }
+        i++;
+    }
+
+    // When the list is full, fold the new rectangle into whichever existing
+    // one grows the least, and keep going since the union may now overlap
+    while (list->count == MAX_DAMAGE_RECTS) {
+        size_t best = 0;
+        long long best_growth = -1;
+        for (size_t i = 0; i < list->count; i++) {
+            ClipRect merged = rect_union(&list->rects[i], &rect);
+            long long growth = rect_area(&merged) - rect_area(&list->rects[i]) - rect_area(&rect);
+            if (best_growth < 0 || growth < best_growth) {
+                best = i;
+                best_growth = growth;
+            }
+        }
+        rect = rect_union(&list->rects[best], &rect);
+        damage_remove(list, best);
+        for (size_t i = 0; i < list->count; ) {
+            if (rects_overlap(&list->rects[i], &rect)) {
+                rect = rect_union(&list->rects[i], &rect);
+                damage_remove(list, i);
+                i = 0;
+                continue;
+            }
+            i++;
+        }
+    }
+
+    list->rects[list->count++] = rect;
+}
+
+static void damage_add(Renderer* renderer, long long x, long long y, long long width, long long height) {
+    if (renderer->full_damage) {
+        return;
+    }
+
+    ClipRect screen = { 0, 0, renderer->width, renderer->height };
+    ClipRect rect;
+    if (clip_rect(x, y, width, height, &screen, &rect)) {
+        damage_list_add(&renderer->pending, rect);
+    }
+}
+
+static void damage_command(Renderer* renderer, const DisplayOp* command) {
+    long long areas[4][4];
+    int count = display_op_areas(command, areas);
+    for (int i = 0; i < count; i++) {
+        damage_add(renderer, areas[i][0], areas[i][1], areas[i][2], areas[i][3]);
+    }
+}
+
+// Damage every command that differs from the one painted at the same
+// position last frame. Commands are memset before being filled in, so
+// memcmp sees no padding garbage.
+static void damage_changed_commands(Renderer* renderer) {
+    const DisplayList* frame = renderer->frame;
+    const DisplayList* shown = renderer->previous;
+    size_t count = frame->count > shown->count ? frame->count : shown->count;
+
+    for (size_t i = 0; i < count && !renderer->full_damage; i++) {
+        const DisplayOp* current = i < frame->count ? &frame->ops[i] : NULL;
+        const DisplayOp* previous = i < shown->count ? &shown->ops[i] : NULL;
+        if (current && previous && memcmp(current, previous, sizeof(DisplayOp)) == 0) {
+            continue;
+        }
+        if (previous) {
+            damage_command(renderer, previous);
+        }
+        if (current) {
+            damage_command(renderer, current);
+        }
+    }
+}
+
+int renderer_add_damage(Renderer* renderer, int x, int y, int width, int height) {
+    if (!renderer || width < 0 || height < 0) {
+        return -1;
+    }
+
+    damage_add(renderer, x, y, width, height);
+    return 0;
+}
+
+const RenderRect* renderer_get_damage(Renderer* renderer, size_t* count) {
+    if (!renderer || !count) {
+        return NULL;
+    }
+
+    *count = renderer->frame_damage.count;
+    return renderer->frame_rects;
+}
+
+static void raster_tile(void* context, size_t index, int worker) {
+    Renderer* renderer = (Renderer*)context;
+    size_t tile_index = renderer->damaged_tiles[index];
+    TileBin* bin = &renderer->bins[tile_index];
+    ClipRect tile;
+    tile_rect(renderer, (int)(tile_index % (size_t)renderer->tiles_x),
+              (int)(tile_index / (size_t)renderer->tiles_x), &tile);
+
+    // Damage rectangles never overlap, so each pixel is repainted at most once
+    for (size_t d = 0; d < renderer->repaint.count; d++) {
+        const ClipRect* damage = &renderer->repaint.rects[d];
+        ClipRect area;
+        if (!clip_rect(damage->x0, damage->y0, damage->x1 - damage->x0, damage->y1 - damage->y0, &tile, &area)) {
+            continue;
+        }
+
+        store_span(renderer, &area, renderer->clear_color);
+        for (size_t i = 0; i < bin->count; i++) {
+            draw_command(renderer, &renderer->frame->ops[bin->commands[i]], &area);
+        }
+    }
+}
+
+// Move pending damage into the frame list and the history, under a new
+// frame number
+static void collect_damage(Renderer* renderer) {
+    if (renderer->full_damage) {
+        ClipRect screen = { 0, 0, renderer->width, renderer->height };
+        renderer->pending.rects[0] = screen;
+        renderer->pending.count = 1;
+        renderer->full_damage = 0;
+    }
+
+    renderer->frame_damage = renderer->pending;
+    for (size_t i = 0; i < renderer->frame_damage.count; i++) {
+        const ClipRect* rect = &renderer->frame_damage.rects[i];
+        renderer->frame_rects[i].x = rect->x0;
+        renderer->frame_rects[i].y = rect->y0;
+        renderer->frame_rects[i].width = rect->x1 - rect->x0;
+        renderer->frame_rects[i].height = rect->y1 - rect->y0;
+    }
+    renderer->pending.count = 0;
+
+    renderer->sequence++;
+    renderer->history[renderer->sequence % DAMAGE_HISTORY] = renderer->frame_damage;
+}
+
+// Work out what the target buffer needs repainting: the damage of every
+// frame since the one it holds, or everything if that is too far back.
+// Then collect the tiles it covers.
+static void plan_repaint(Renderer* renderer, const FrameBuffer* target) {
+    uint64_t behind = renderer->sequence - target->sequence;
+    if (target->sequence == 0 || behind > DAMAGE_HISTORY) {
+        ClipRect screen = { 0, 0, renderer->width, renderer->height };
+        renderer->repaint.rects[0] = screen;
+        renderer->repaint.count = 1;
+    } else if (behind == 1) {
+        renderer->repaint = renderer->frame_damage;
+    } else {
+        renderer->repaint.count = 0;
+        for (uint64_t frame = target->sequence + 1; frame <= renderer->sequence; frame++) {
+            const DamageList* damage = &renderer->history[frame % DAMAGE_HISTORY];
+            for (size_t i = 0; i < damage->count; i++) {
+                damage_list_add(&renderer->repaint, damage->rects[i]);
+            }
+        }
+    }
+
+    renderer->damaged_tile_count = 0;
+    for (int ty = 0; ty < renderer->tiles_y; ty++) {
+        for (int tx = 0; tx < renderer->tiles_x; tx++) {
+            ClipRect tile;
+            tile_rect(renderer, tx, ty, &tile);
+            for (size_t d = 0; d < renderer->repaint.count; d++) {
+                if (rects_overlap(&tile, &renderer->repaint.rects[d])) {
+                    renderer->damaged_tiles[renderer->damaged_tile_count++] =
+                        (size_t)ty * (size_t)renderer->tiles_x + (size_t)tx;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static int bin_commands(Renderer* renderer) {
+    int tiles_x = tile_count(renderer->width);
+    int tiles_y = tile_count(renderer->height);
+    size_t tiles = (size_t)tiles_x * (size_t)tiles_y;
+
+    if (!renderer->bins || renderer->tiles_x != tiles_x || renderer->tiles_y != tiles_y) {
+        free_bins(renderer);
+        renderer->bins = (TileBin*)calloc(tiles, sizeof(TileBin));
+        renderer->damaged_tiles = (size_t*)malloc(tiles * sizeof(size_t));
+        if (!renderer->bins || !renderer->damaged_tiles) {
+            free(renderer->bins);
+            free(renderer->damaged_tiles);
+            renderer->bins = NULL;
+            renderer->damaged_tiles = NULL;
+            return -1;
+        }
+        renderer->tiles_x = tiles_x;
+        renderer->tiles_y = tiles_y;
+    }
+
+    for (size_t i = 0; i < tiles; i++) {
+        renderer->bins[i].count = 0;
+    }
+
+    // Commands are binned in recording order, so each tile paints them in
+    // the same order the caller issued them
+    for (size_t i = 0; i < renderer->frame->count; i++) {
+        // A border is binned only into tiles under its edges, not the whole box
+        long long areas[4][4];
+        int count = display_op_areas(&renderer->frame->ops[i], areas);
+        for (int a = 0; a < count; a++) {
+            if (bin_rect(renderer, areas[a][0], areas[a][1], areas[a][2], areas[a][3], (unsigned int)i) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
 int renderer_render(Renderer* renderer, DOMDocument* document) {
     if (!renderer || !document) {
         return -1;
     }
 
-    // In real implementation:
-    // 1. Convert DOM to RmlUi document
-    // 2. Apply CSS styles
-    // 3. Perform layout
-    // 4. Render to buffer
-    // 5. Handle images (wasm-image-decoder)
-    // 6. Render text (FreeType + HarfBuzz)
+    // The frame is whatever was recorded through the draw command API,
+    // normally by painter_paint for this document
+    if (bin_commands(renderer) != 0) {
+        return -1;
+    }
+
+    damage_changed_commands(renderer);
+    int remembered = display_list_copy(renderer->previous, renderer->frame);
+    collect_damage(renderer);
+    if (remembered != 0) {
+        // Without a copy of this frame the next diff would be wrong
+        renderer->full_damage = 1;
+    }
+
+    FrameBuffer* target = &renderer->buffers[renderer->back];
+    plan_repaint(renderer, target);
+    renderer->buffer = target->pixels;
+    if (thread_pool_parallel_for(renderer->pool, renderer->damaged_tile_count, raster_tile, renderer) != 0) {
+        target->sequence = 0;
+        return -1;
+    }
+    target->width = renderer->width;
+    target->height = renderer->height;
+    target->sequence = renderer->sequence;
+    renderer->shown = renderer->back;
+
+    // Publish the frame and take back whichever buffer was waiting in the
+    // slot; the release half makes the pixels visible to the consumer
+    if (renderer->buffer_count > 1) {
+        unsigned int slot = atomic_exchange_explicit(&renderer->ready, (unsigned int)renderer->back | SLOT_FRESH,
+                                                     memory_order_acq_rel);
+        renderer->back = (int)(slot & SLOT_INDEX);
+    }
+    return 0;
+}
 
-    // For now, just clear the buffer
-    memset(renderer->buffer, 0, renderer->buffer_size);
+int renderer_set_triple_buffering(Renderer* renderer, int enabled) {
+    if (!renderer) {
+        return -1;
+    }
+
+    int count = enabled ? MAX_BUFFERS : 1;
+    if (count == renderer->buffer_count) {
+        return 0;
+    }
 
+    // Allocate before freeing anything, so failure changes nothing
+    unsigned char* added[MAX_BUFFERS] = { NULL };
+    for (int i = 1; i < count; i++) {
+        added[i] = (unsigned char*)calloc(renderer->buffer_size, 1);
+        if (!added[i]) {
+            for (int j = 1; j < i; j++) {
+                free(added[j]);
+            }
+            return -1;
+        }
+    }
+
+    // The buffer holding the last frame becomes buffer 0
+    FrameBuffer kept = renderer->buffers[renderer->shown];
+    for (int i = 0; i < renderer->buffer_count; i++) {
+        if (i != renderer->shown) {
+            free(renderer->buffers[i].pixels);
+        }
+    }
+    memset(renderer->buffers, 0, sizeof(renderer->buffers));
+    renderer->buffers[0] = kept;
+    for (int i = 1; i < count; i++) {
+        renderer->buffers[i].pixels = added[i];
+    }
+
+    // Buffer 0 goes to the consumer, so a frame taken before the next
+    // render is the last one shown; 1 waits in the slot and 2 is painted next
+    renderer->buffer_count = count;
+    renderer->shown = 0;
+    renderer->front = 0;
+    renderer->back = count > 1 ? 2 : 0;
+    renderer->buffer = renderer->buffers[renderer->back].pixels;
+    atomic_store_explicit(&renderer->ready, 1, memory_order_release);
     return 0;
 }
 
+int renderer_acquire_frame(Renderer* renderer, RenderFrame* frame) {
+    if (!renderer || !frame || renderer->buffer_count < 2) {
+        return -1;
+    }
+
+    int taken = 0;
+    if (atomic_load_explicit(&renderer->ready, memory_order_acquire) & SLOT_FRESH) {
+        unsigned int slot = atomic_exchange_explicit(&renderer->ready, (unsigned int)renderer->front,
+                                                     memory_order_acq_rel);
+        renderer->front = (int)(slot & SLOT_INDEX);
+        taken = 1;
+    }
+
+    const FrameBuffer* buffer = &renderer->buffers[renderer->front];
+    frame->pixels = buffer->sequence ? buffer->pixels : NULL;
+    frame->width = buffer->width;
+    frame->height = buffer->height;
+    frame->sequence = buffer->sequence;
+    return taken;
+}
+
+uint64_t renderer_get_frame_sequence(Renderer* renderer) {
+    return renderer ? renderer->sequence : 0;
+}
+
 int renderer_resize(Renderer* renderer, int width, int height) {
     if (!renderer || width <= 0 || height <= 0) {
         return -1;
@@ -107,15 +865,36 @@ int renderer_resize(Renderer* renderer, int width, int height) {
         return -1;
     }
 
-    unsigned char* new_buffer = (unsigned char*)realloc(renderer->buffer, new_size);
-    if (!new_buffer) {
-        return -1;
+    // Allocate every buffer before freeing any, so failure changes nothing
+    unsigned char* new_buffers[MAX_BUFFERS] = { NULL };
+    for (int i = 0; i < renderer->buffer_count; i++) {
+        new_buffers[i] = (unsigned char*)calloc(new_size, 1);
+        if (!new_buffers[i]) {
+            for (int j = 0; j < i; j++) {
+                free(new_buffers[j]);
+            }
+            return -1;
+        }
     }
 
     renderer->width = width;
     renderer->height = height;
-    renderer->buffer = new_buffer;
     renderer->buffer_size = new_size;
+    for (int i = 0; i < renderer->buffer_count; i++) {
+        free(renderer->buffers[i].pixels);
+        renderer->buffers[i].pixels = new_buffers[i];
+        renderer->buffers[i].width = 0;
+        renderer->buffers[i].height = 0;
+        renderer->buffers[i].sequence = 0;
+    }
+    renderer->buffer = renderer->buffers[renderer->back].pixels;
+
+    // Tile bins are rebuilt for the new grid on the next render, and the
+    // old contents no longer line up with the rows
+    free_bins(renderer);
+    renderer->full_damage = 1;
+    renderer->pending.count = 0;
+    renderer->frame_damage.count = 0;
 
     return 0;
 }
@@ -132,5 +911,5 @@ const unsigned char* renderer_get_buffer(Renderer* renderer, int* width, int* he
         *height = renderer->height;
     }
 
-    return renderer->buffer;
+    return renderer->buffers[renderer->shown].pixels;
 }
@@ -0,0 +1,323 @@
+#include "rendering/text_run_cache.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+
+// Text run cache
+// A hash table with an LRU list, like the bytecode cache. Layout measures
+// text word by word, so the same short runs come back constantly, and from
+// every layout worker at once: lookups take the lock briefly, while runs
+// are measured outside it and inserted afterwards unless another thread
+// got there first.
+
+#define DEFAULT_MAX_RUNS 4096
+#define SIZE_STEPS 64.0f            // Font sizes are keyed in 1/64 px, as in the glyph cache
+
+typedef struct TextRun {
+    uint64_t hash;
+    uint32_t size;                  // 1/64 px
+    uint8_t bold;
+    uint8_t italic;
+    size_t length;                  // Bytes of text
+    size_t count;                   // Characters
+    float width;
+    float* advances;                // count entries, allocated with the run
+    char* text;                     // length bytes, after the advances
+    struct TextRun* hash_next;
+    struct TextRun* lru_prev;
+    struct TextRun* lru_next;
+} TextRun;
+
+struct TextRunCache {
+    pthread_mutex_t lock;
+    TextRun** buckets;
+    size_t bucket_count;
+    TextRun* lru_head;              // Most recently used
+    TextRun* lru_tail;              // Least recently used
+    size_t max_runs;
+    TextRunCacheStats stats;
+};
+
+// Hashing
+
+static uint64_t mix64(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint64_t run_hash(const char* text, size_t length, uint32_t size, int bold, int italic) {
+    uint64_t h = mix64(((uint64_t)size << 2) ^ ((uint64_t)bold << 1) ^ (uint64_t)italic ^ (length << 34));
+    const unsigned char* p = (const unsigned char*)text;
+
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ mix64(word)) * 0x9E3779B97F4A7C15ULL;
+        h = (h << 27) | (h >> 37);
+        p += 8;
+        length -= 8;
+    }
+
+    uint64_t tail = 0;
+    for (size_t i = 0; i < length; i++) {
+        tail |= (uint64_t)p[i] << (8 * i);
+    }
+    return mix64(h ^ mix64(tail));
+}
+
+// Runs are measured with the size they are keyed by, so two sizes that
+// share a key can never disagree about a width
+static FontSpec keyed_font(uint32_t size, int bold, int italic) {
+    FontSpec font;
+    font.size = (float)size / SIZE_STEPS;
+    font.weight = bold ? 700 : 400;
+    font.italic = italic;
+    return font;
+}
+
+// LRU list and table (caller holds the lock)
+
+static void lru_unlink(TextRunCache* cache, TextRun* run) {
+    if (run->lru_prev) {
+        run->lru_prev->lru_next = run->lru_next;
+    } else {
+        cache->lru_head = run->lru_next;
+    }
+    if (run->lru_next) {
+        run->lru_next->lru_prev = run->lru_prev;
+    } else {
+        cache->lru_tail = run->lru_prev;
+    }
+    run->lru_prev = NULL;
+    run->lru_next = NULL;
+}
+
+static void lru_push_front(TextRunCache* cache, TextRun* run) {
+    run->lru_prev = NULL;
+    run->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = run;
+    }
+    cache->lru_head = run;
+    if (!cache->lru_tail) {
+        cache->lru_tail = run;
+    }
+}
+
+static TextRun* table_find(TextRunCache* cache, uint64_t hash, const char* text, size_t length,
+                           uint32_t size, int bold, int italic) {
+    TextRun* run = cache->buckets[hash & (cache->bucket_count - 1)];
+    while (run && !(run->hash == hash && run->size == size && run->bold == bold && run->italic == italic &&
+                    run->length == length && memcmp(run->text, text, length) == 0)) {
+        run = run->hash_next;
+    }
+    return run;
+}
+
+static void table_remove(TextRunCache* cache, TextRun* run) {
+    TextRun** link = &cache->buckets[run->hash & (cache->bucket_count - 1)];
+    while (*link != run) {
+        link = &(*link)->hash_next;
+    }
+    *link = run->hash_next;
+    lru_unlink(cache, run);
+    cache->stats.runs--;
+    free(run);
+}
+
+static void table_insert(TextRunCache* cache, TextRun* run) {
+    size_t bucket = run->hash & (cache->bucket_count - 1);
+    run->hash_next = cache->buckets[bucket];
+    cache->buckets[bucket] = run;
+    lru_push_front(cache, run);
+    cache->stats.runs++;
+
+    while (cache->stats.runs > cache->max_runs && cache->lru_tail != run) {
+        table_remove(cache, cache->lru_tail);
+        cache->stats.evictions++;
+    }
+}
+
+// Measure a run into a new entry (no lock needed)
+static TextRun* run_create(uint64_t hash, const char* text, size_t length, uint32_t size, int bold, int italic) {
+    size_t count = 0;
+    for (size_t offset = 0; offset < length; count++) {
+        font_decode_utf8(text, length, &offset);
+    }
+
+    TextRun* run = (TextRun*)malloc(sizeof(TextRun) + count * sizeof(float) + length);
+    if (!run) {
+        return NULL;
+    }
+    memset(run, 0, sizeof(TextRun));
+    run->hash = hash;
+    run->size = size;
+    run->bold = (uint8_t)bold;
+    run->italic = (uint8_t)italic;
+    run->length = length;
+    run->count = count;
+    run->advances = (float*)(run + 1);
+    run->text = (char*)(run->advances + count);
+    if (length > 0) {
+        memcpy(run->text, text, length);
+    }
+
+    FontSpec font = keyed_font(size, bold, italic);
+    size_t offset = 0;
+    for (size_t i = 0; i < count; i++) {
+        run->advances[i] = font_get_advance(&font, font_decode_utf8(text, length, &offset));
+        run->width += run->advances[i];
+    }
+    return run;
+}
+
+TextRunCache* text_run_cache_create(size_t max_runs) {
+    TextRunCache* cache = (TextRunCache*)calloc(1, sizeof(TextRunCache));
+    if (!cache) {
+        return NULL;
+    }
+
+    if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->max_runs = max_runs > 0 ? max_runs : DEFAULT_MAX_RUNS;
+    cache->bucket_count = 16;
+    while (cache->bucket_count < cache->max_runs) {
+        cache->bucket_count *= 2;
+    }
+    cache->buckets = (TextRun**)calloc(cache->bucket_count, sizeof(TextRun*));
+    if (!cache->buckets) {
+        pthread_mutex_destroy(&cache->lock);
+        free(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void text_run_cache_destroy(TextRunCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    text_run_cache_clear(cache);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->buckets);
+    free(cache);
+}
+
+// Copy what the caller asked for out of a run (caller holds the lock)
+static void run_read(const TextRun* run, float* width, float* advances, size_t capacity, size_t* count) {
+    if (width) {
+        *width = run->width;
+    }
+    if (advances) {
+        memcpy(advances, run->advances, (run->count < capacity ? run->count : capacity) * sizeof(float));
+    }
+    if (count) {
+        *count = run->count;
+    }
+}
+
+// Look a run up, measuring and caching it on a miss
+static int run_lookup(TextRunCache* cache, const char* text, size_t length, const FontSpec* font,
+                      float* width, float* advances, size_t capacity, size_t* count) {
+    if (!cache || (!text && length > 0) || !font || !(font->size > 0.0f) || !isfinite(font->size)) {
+        return -1;
+    }
+
+    // Nothing to measure, and not worth a slot
+    if (length == 0) {
+        if (width) {
+            *width = 0.0f;
+        }
+        if (count) {
+            *count = 0;
+        }
+        return 0;
+    }
+
+    uint32_t size = (uint32_t)lroundf(font->size * SIZE_STEPS);
+    int bold = font->weight >= 600;
+    int italic = font->italic != 0;
+    uint64_t hash = run_hash(text, length, size, bold, italic);
+
+    pthread_mutex_lock(&cache->lock);
+    TextRun* run = table_find(cache, hash, text, length, size, bold, italic);
+    if (run) {
+        lru_unlink(cache, run);
+        lru_push_front(cache, run);
+        cache->stats.hits++;
+        run_read(run, width, advances, capacity, count);
+        pthread_mutex_unlock(&cache->lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&cache->lock);
+
+    TextRun* created = run_create(hash, text, length, size, bold, italic);
+    if (!created) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    cache->stats.misses++;
+    run = table_find(cache, hash, text, length, size, bold, italic);
+    if (run) {
+        free(created);      // Measured by another thread meanwhile
+    } else {
+        run = created;
+        table_insert(cache, run);
+    }
+    run_read(run, width, advances, capacity, count);
+    pthread_mutex_unlock(&cache->lock);
+    return 0;
+}
+
+float text_run_cache_measure(TextRunCache* cache, const char* text, size_t length, const FontSpec* font) {
+    float width = 0.0f;
+    run_lookup(cache, text, length, font, &width, NULL, 0, NULL);
+    return width;
+}
+
+size_t text_run_cache_get_advances(TextRunCache* cache, const char* text, size_t length, const FontSpec* font,
+                                   float* advances, size_t capacity) {
+    size_t count = 0;
+    run_lookup(cache, text, length, font, NULL, advances, capacity, &count);
+    return count;
+}
+
+void text_run_cache_clear(TextRunCache* cache) {
+    if (!cache) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    TextRun* run = cache->lru_head;
+    while (run) {
+        TextRun* next = run->lru_next;
+        free(run);
+        run = next;
+    }
+    memset(cache->buckets, 0, cache->bucket_count * sizeof(TextRun*));
+    cache->lru_head = NULL;
+    cache->lru_tail = NULL;
+    cache->stats.runs = 0;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void text_run_cache_get_stats(TextRunCache* cache, TextRunCacheStats* stats) {
+    if (!cache || !stats) {
+        return;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    *stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+}
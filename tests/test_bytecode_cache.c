@@ -0,0 +1,212 @@
+#include "js/bytecode_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <pthread.h>
+
+static void remove_dir(const char* path) {
+    DIR* dir = opendir(path);
+    if (dir) {
+        struct dirent* ent;
+        char file[512];
+        while ((ent = readdir(dir)) != NULL) {
+            if (ent->d_name[0] == '.') {
+                continue;
+            }
+            snprintf(file, sizeof(file), "%s/%s", path, ent->d_name);
+            unlink(file);
+        }
+        closedir(dir);
+    }
+    rmdir(path);
+}
+
+void test_key() {
+    printf("Testing cache keys...\n");
+    const char* src = "var x = 1;";
+    JSBytecodeKey a = js_bytecode_cache_key(src, strlen(src), "<eval>");
+    JSBytecodeKey b = js_bytecode_cache_key(src, strlen(src), "<eval>");
+    JSBytecodeKey c = js_bytecode_cache_key(src, strlen(src), "other.js");
+    JSBytecodeKey d = js_bytecode_cache_key("var x = 2;", 10, "<eval>");
+    assert(a.hi == b.hi && a.lo == b.lo);
+    assert(a.hi != c.hi || a.lo != c.lo);
+    assert(a.hi != d.hi || a.lo != d.lo);
+    printf("  PASSED\n");
+}
+
+void test_memory_tier() {
+    printf("Testing memory tier and LRU eviction...\n");
+    JSBytecodeCacheConfig config = { 0 };
+    config.memory_budget = 300;
+    JSBytecodeCache* cache = js_bytecode_cache_create(&config);
+    assert(cache != NULL);
+
+    uint8_t blob[100];
+    JSBytecodeKey keys[4];
+    for (int i = 0; i < 4; i++) {
+        char src[16];
+        snprintf(src, sizeof(src), "script%d", i);
+        keys[i] = js_bytecode_cache_key(src, strlen(src), NULL);
+        memset(blob, i, sizeof(blob));
+        assert(js_bytecode_cache_store(cache, keys[i], blob, sizeof(blob)) == 0);
+    }
+
+    // Oldest entry was evicted to stay within budget
+    assert(js_bytecode_cache_acquire(cache, keys[0]) == NULL);
+
+    JSBytecodeEntry* entry = js_bytecode_cache_acquire(cache, keys[3]);
+    assert(entry != NULL);
+    size_t size = 0;
+    const uint8_t* data = js_bytecode_entry_data(entry, &size);
+    assert(size == sizeof(blob) && data[0] == 3);
+    js_bytecode_cache_release(cache, entry);
+
+    JSBytecodeCacheStats stats;
+    js_bytecode_cache_get_stats(cache, &stats);
+    assert(stats.memory_hits == 1 && stats.misses == 1);
+    assert(stats.memory_bytes <= config.memory_budget);
+
+    js_bytecode_cache_destroy(cache);
+    printf("  PASSED\n");
+}
+
+void test_disk_tier() {
+    printf("Testing disk tier persistence...\n");
+    char dir[] = "/tmp/jb_bytecode_XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+
+    JSBytecodeCacheConfig config = { 0 };
+    config.disk_path = dir;
+    JSBytecodeKey key = js_bytecode_cache_key("lib()", 5, "lib.js");
+    const uint8_t blob[] = { 1, 2, 3, 4, 5, 6, 7 };
+
+    JSBytecodeCache* writer = js_bytecode_cache_create(&config);
+    assert(writer != NULL);
+    assert(js_bytecode_cache_store(writer, key, blob, sizeof(blob)) == 0);
+    js_bytecode_cache_destroy(writer);
+
+    // A fresh cache (another process) finds it on disk
+    JSBytecodeCache* reader = js_bytecode_cache_create(&config);
+    assert(reader != NULL);
+    JSBytecodeEntry* entry = js_bytecode_cache_acquire(reader, key);
+    assert(entry != NULL);
+    size_t size = 0;
+    const uint8_t* data = js_bytecode_entry_data(entry, &size);
+    assert(size == sizeof(blob) && memcmp(data, blob, size) == 0);
+    js_bytecode_cache_release(reader, entry);
+
+    JSBytecodeCacheStats stats;
+    js_bytecode_cache_get_stats(reader, &stats);
+    assert(stats.disk_hits == 1);
+    js_bytecode_cache_destroy(reader);
+
+    // Files from another engine version are discarded
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%016llx%016llx.jbc", dir,
+             (unsigned long long)key.hi, (unsigned long long)key.lo);
+    FILE* file = fopen(path, "r+b");
+    assert(file != NULL);
+    fseek(file, 8, SEEK_SET);
+    fputc('X', file);
+    fclose(file);
+
+    reader = js_bytecode_cache_create(&config);
+    assert(js_bytecode_cache_acquire(reader, key) == NULL);
+    assert(access(path, F_OK) != 0);
+    js_bytecode_cache_destroy(reader);
+
+    remove_dir(dir);
+    printf("  PASSED\n");
+}
+
+typedef struct {
+    const char* dir;
+    JSBytecodeKey key;
+    uint8_t* blob;
+} DiskWriter;
+
+#define WRITER_BLOB_SIZE (256 * 1024)
+
+static void* write_repeatedly(void* arg) {
+    DiskWriter* writer = (DiskWriter*)arg;
+    JSBytecodeCacheConfig config = { 0 };
+    config.disk_path = writer->dir;
+
+    // One cache per thread, like separate processes sharing a directory
+    JSBytecodeCache* cache = js_bytecode_cache_create(&config);
+    assert(cache != NULL);
+    for (int i = 0; i < 50; i++) {
+        assert(js_bytecode_cache_store(cache, writer->key, writer->blob, WRITER_BLOB_SIZE) == 0);
+        JSBytecodeEntry* entry = js_bytecode_cache_acquire(cache, writer->key);
+        assert(entry != NULL);
+        js_bytecode_cache_release(cache, entry);
+    }
+    js_bytecode_cache_destroy(cache);
+    return NULL;
+}
+
+void test_concurrent_disk_writers() {
+    printf("Testing concurrent writers of one cache file...\n");
+    char dir[] = "/tmp/jb_bytecode_XXXXXX";
+    assert(mkdtemp(dir) != NULL);
+
+    JSBytecodeKey key = js_bytecode_cache_key("shared()", 8, "shared.js");
+    DiskWriter writers[4];
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        writers[i].dir = dir;
+        writers[i].key = key;
+        writers[i].blob = (uint8_t*)malloc(WRITER_BLOB_SIZE);
+        assert(writers[i].blob != NULL);
+        memset(writers[i].blob, 'a' + i, WRITER_BLOB_SIZE);
+        assert(pthread_create(&threads[i], NULL, write_repeatedly, &writers[i]) == 0);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+        free(writers[i].blob);
+    }
+
+    // The file is one writer's blob in full, and no temporary file is left
+    JSBytecodeCacheConfig config = { 0 };
+    config.disk_path = dir;
+    JSBytecodeCache* reader = js_bytecode_cache_create(&config);
+    assert(reader != NULL);
+    JSBytecodeEntry* entry = js_bytecode_cache_acquire(reader, key);
+    assert(entry != NULL);
+    size_t size = 0;
+    const uint8_t* data = js_bytecode_entry_data(entry, &size);
+    assert(size == WRITER_BLOB_SIZE);
+    for (size_t i = 1; i < size; i++) {
+        assert(data[i] == data[0]);
+    }
+    js_bytecode_cache_release(reader, entry);
+    js_bytecode_cache_destroy(reader);
+
+    int files = 0;
+    DIR* listing = opendir(dir);
+    assert(listing != NULL);
+    struct dirent* ent;
+    while ((ent = readdir(listing)) != NULL) {
+        files += ent->d_name[0] != '.';
+    }
+    closedir(listing);
+    assert(files == 1);
+
+    remove_dir(dir);
+    printf("  PASSED\n");
+}
+
+int main() {
+    printf("Running bytecode cache tests...\n\n");
+
+    test_key();
+    test_memory_tier();
+    test_disk_tier();
+    test_concurrent_disk_writers();
+
+    printf("\nAll bytecode cache tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,522 @@
+#include "css/stylesheet.h"
+#include "css/style.h"
+#include "core/thread_pool.h"
+#include "dom/dom.h"
+#include "html/parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+static CSSStylesheet* parse_sheet(const char* css) {
+    return css_stylesheet_parse(css, strlen(css));
+}
+
+// Parse a page, add one author stylesheet and resolve
+static StyleEngine* style_page(DOMDocument* doc, const char* html, const char* css) {
+    assert(html_parser_parse(doc, html) == 0);
+    StyleEngine* engine = style_engine_create(doc);
+    assert(engine != NULL);
+    if (css) {
+        assert(style_engine_add_stylesheet(engine, parse_sheet(css)) == 0);
+    }
+    assert(style_engine_resolve(engine) == 0);
+    return engine;
+}
+
+static const ComputedStyle* style_of(StyleEngine* engine, DOMDocument* doc, const char* id) {
+    DOMElement* element = dom_document_get_element_by_id(doc, id);
+    assert(element != NULL);
+    return style_engine_get_style(engine, element);
+}
+
+static int is_color(CSSColor color, int r, int g, int b, int a) {
+    return color.r == r && color.g == g && color.b == b && color.a == a;
+}
+
+void test_stylesheet_parsing() {
+    printf("Testing stylesheet parsing...\n");
+
+    CSSStylesheet* sheet = parse_sheet(
+        "/* comment */ p { color: red }"
+        "div.a > span + em, #x { margin: 1px 2px }"
+        "@media screen { p { color: blue } }"
+        "a:hover { color: green }"          // Unsupported pseudo-class
+        "p::before { color: green }"        // Pseudo-element
+        "q { colour: red; bogus }"          // No valid declarations
+        "[data-x^=\"a b\"] { display: none !important }"
+        "li:first-child:empty { padding: 0 }");
+    assert(sheet != NULL);
+    assert(css_stylesheet_get_rule_count(sheet) == 4);
+    css_stylesheet_destroy(sheet);
+
+    sheet = parse_sheet("");
+    assert(sheet != NULL);
+    assert(css_stylesheet_get_rule_count(sheet) == 0);
+    css_stylesheet_destroy(sheet);
+
+    // An unterminated block still yields its declarations
+    sheet = parse_sheet("p { color: red; margin: 4px");
+    assert(sheet != NULL);
+    assert(css_stylesheet_get_rule_count(sheet) == 1);
+    css_stylesheet_destroy(sheet);
+
+    printf("  PASSED\n");
+}
+
+void test_cascade() {
+    printf("Testing cascade order...\n");
+
+    DOMDocument* doc = dom_document_create();
+    StyleEngine* engine = style_page(doc,
+        "<html><body>"
+        "<p id=\"a\" class=\"note\">a</p>"
+        "<p id=\"b\" class=\"note\" style=\"color: #00ff00\">b</p>"
+        "<p id=\"c\" class=\"note\" style=\"color: blue\">c</p>"
+        "<div id=\"d\">d</div>"
+        "</body></html>",
+        "p { color: red }"
+        ".note { color: rgb(0, 0, 128) }"
+        "p { color: black }"
+        "#c { color: purple !important }"
+        "div { color: red !important }"
+        "div { color: green }");
+
+    // The class beats both type rules regardless of order
+    assert(is_color(style_of(engine, doc, "a")->color, 0, 0, 128, 255));
+    // Inline style beats any normal rule
+    assert(is_color(style_of(engine, doc, "b")->color, 0, 255, 0, 255));
+    // An important rule beats a normal inline style
+    assert(is_color(style_of(engine, doc, "c")->color, 128, 0, 128, 255));
+    // Important beats a later normal declaration
+    assert(is_color(style_of(engine, doc, "d")->color, 255, 0, 0, 255));
+
+    style_engine_destroy(engine);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_inheritance_and_units() {
+    printf("Testing inheritance and units...\n");
+
+    DOMDocument* doc = dom_document_create();
+    StyleEngine* engine = style_page(doc,
+        "<html><body>"
+        "<div id=\"outer\"><div id=\"inner\"><span id=\"leaf\">x</span></div></div>"
+        "<h1 id=\"title\">t</h1>"
+        "</body></html>",
+        "html { font-size: 20px }"
+        "body { margin: 0 }"
+        "#outer { font-size: 1.5em; color: #123456; border: 2px solid; padding: 1em }"
+        "#inner { font-size: 50%; margin-left: 2rem; width: 40%; border-color: red }"
+        "#leaf { font-weight: bolder; line-height: 150%; background: currentColor }");
+
+    const ComputedStyle* outer = style_of(engine, doc, "outer");
+    assert(outer->display == CSS_DISPLAY_BLOCK);
+    assert(outer->font_size == 30.0f);
+    assert(outer->padding[0].type == CSS_LENGTH_PX && outer->padding[0].value == 30.0f);
+    // The border color defaults to the element's color
+    assert(outer->border_width[3] == 2.0f);
+    assert(is_color(outer->border_color, 0x12, 0x34, 0x56, 255));
+
+    const ComputedStyle* inner = style_of(engine, doc, "inner");
+    assert(inner->font_size == 15.0f);
+    assert(inner->margin[3].type == CSS_LENGTH_PX && inner->margin[3].value == 40.0f);
+    assert(inner->width.type == CSS_LENGTH_PERCENT && inner->width.value == 40.0f);
+    assert(inner->height.type == CSS_LENGTH_AUTO);
+    // Color is inherited, border properties are not
+    assert(is_color(inner->color, 0x12, 0x34, 0x56, 255));
+    assert(inner->border_width[0] == 0.0f);
+
+    const ComputedStyle* leaf = style_of(engine, doc, "leaf");
+    assert(leaf->display == CSS_DISPLAY_INLINE);
+    assert(leaf->font_weight == 700);
+    assert(leaf->line_height.type == CSS_LENGTH_PX && leaf->line_height.value == 22.5f);
+    assert(is_color(leaf->background_color, 0x12, 0x34, 0x56, 255));
+
+    // User agent defaults scale with the author's root font size
+    const ComputedStyle* title = style_of(engine, doc, "title");
+    assert(title->font_size == 40.0f);
+    assert(title->font_weight == 700);
+    assert(title->margin[0].value == 0.67f * 40.0f);
+
+    style_engine_destroy(engine);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_selectors() {
+    printf("Testing selector matching...\n");
+
+    DOMDocument* doc = dom_document_create();
+    StyleEngine* engine = style_page(doc,
+        "<html><body>"
+        "<ul id=\"list\"><li id=\"one\">1</li><li id=\"two\" lang=\"en-GB\">2</li><li id=\"three\"></li></ul>"
+        "<section><p id=\"para\" data-kind=\"warn big\">p</p><em id=\"after\">e</em></section>"
+        "</body></html>",
+        "li:first-child { color: red }"
+        "li + li { color: green }"
+        "li:last-child:empty { color: blue }"
+        "[lang|=en] { font-style: italic }"
+        "section > p[data-kind~=warn] { font-weight: 900 }"
+        "body p ~ em { text-align: center }"
+        "ul > em { text-align: right }"
+        ":root { background-color: white }");
+
+    assert(is_color(style_of(engine, doc, "one")->color, 255, 0, 0, 255));
+    assert(is_color(style_of(engine, doc, "two")->color, 0, 128, 0, 255));
+    assert(style_of(engine, doc, "two")->font_style == CSS_FONT_STYLE_ITALIC);
+    assert(is_color(style_of(engine, doc, "three")->color, 0, 0, 255, 255));
+    assert(style_of(engine, doc, "para")->font_weight == 900);
+    assert(style_of(engine, doc, "after")->text_align == CSS_TEXT_ALIGN_CENTER);
+
+    DOMElement* root = dom_document_get_element(doc);
+    assert(is_color(style_engine_get_style(engine, root)->background_color, 255, 255, 255, 255));
+
+    style_engine_destroy(engine);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_rule_buckets() {
+    printf("Testing rule buckets...\n");
+
+    // Hundreds of rules keyed on classes and ids nothing in the page uses
+    size_t capacity = 64 * 1024;
+    char* css = (char*)malloc(capacity);
+    assert(css != NULL);
+    size_t length = 0;
+    for (int i = 0; i < 500; i++) {
+        length += (size_t)snprintf(css + length, capacity - length,
+                                   ".unused%d { color: red } #missing%d { color: red }", i, i);
+    }
+    length += (size_t)snprintf(css + length, capacity - length, ".hit { color: green }");
+
+    DOMDocument* doc = dom_document_create();
+    StyleEngine* engine = style_page(doc,
+        "<html><body><p id=\"target\" class=\"hit other\">x</p></body></html>", css);
+    free(css);
+
+    assert(is_color(style_of(engine, doc, "target")->color, 0, 128, 0, 255));
+
+    // Only the matching class bucket and the few user agent rules for each
+    // tag are tested, not the thousand unrelated ones
+    StyleStats stats;
+    assert(style_engine_get_stats(engine, &stats) == 0);
+    assert(stats.elements_styled == 3);
+    assert(stats.selectors_tested < 20);
+
+    style_engine_destroy(engine);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_style_sharing() {
+    printf("Testing style sharing...\n");
+
+    DOMDocument* doc = dom_document_create();
+    StyleEngine* engine = style_page(doc,
+        "<html><body><ul>"
+        "<li id=\"a\" class=\"item\">1</li>"
+        "<li id=\"b\" class=\"item\">2</li>"
+        "<li id=\"c\" class=\"item\">3</li>"
+        "<li id=\"d\" class=\"item special\">4</li>"
+        "<li id=\"e\" class=\"item\" style=\"color: red\">5</li>"
+        "</ul><ol>"
+        "<li id=\"f\" class=\"pos\">1</li><li id=\"g\" class=\"pos\">2</li>"
+        "</ol></body></html>",
+        ".item { color: blue }"
+        ".special { font-weight: bold }"
+        "ol > .pos:first-child { color: red }");
+
+    const ComputedStyle* a = style_of(engine, doc, "a");
+    // Siblings with the same tag and classes share one style object
+    assert(style_of(engine, doc, "b") == a);
+    assert(style_of(engine, doc, "c") == a);
+    assert(style_of(engine, doc, "d") != a);
+    assert(style_of(engine, doc, "d")->font_weight == 700);
+    assert(is_color(style_of(engine, doc, "e")->color, 255, 0, 0, 255));
+
+    // A positional rule keeps siblings from sharing
+    assert(is_color(style_of(engine, doc, "f")->color, 255, 0, 0, 255));
+    assert(is_color(style_of(engine, doc, "g")->color, 0, 0, 0, 255));
+
+    StyleStats stats;
+    assert(style_engine_get_stats(engine, &stats) == 0);
+    assert(stats.styles_shared >= 2);
+    assert(stats.unique_styles < stats.elements_styled);
+
+    // Resolving an unchanged document does no work
+    assert(style_engine_resolve(engine) == 0);
+    assert(style_engine_get_stats(engine, &stats) == 0);
+    assert(stats.elements_styled == 0);
+
+    style_engine_destroy(engine);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_restyle_after_mutation() {
+    printf("Testing restyle after mutation...\n");
+
+    DOMDocument* doc = dom_document_create();
+    StyleEngine* engine = style_page(doc,
+        "<html><body>"
+        "<div id=\"box\">x</div>"
+        "<div id=\"hidden\" hidden><p id=\"inside\">y</p></div>"
+        "<div id=\"toggle\" class=\"gone\"><p id=\"content\">z</p></div>"
+        "</body></html>",
+        ".on { color: green } .gone { display: none }");
+
+    DOMElement* box = dom_document_get_element_by_id(doc, "box");
+    assert(is_color(style_engine_get_style(engine, box)->color, 0, 0, 0, 255));
+
+    // Elements inside display: none have no style
+    assert(style_of(engine, doc, "hidden")->display == CSS_DISPLAY_NONE);
+    assert(style_of(engine, doc, "inside") == NULL);
+
+    assert(dom_element_set_attribute(box, "class", "on") == 0);
+    assert(style_engine_resolve(engine) == 0);
+    assert(is_color(style_engine_get_style(engine, box)->color, 0, 128, 0, 255));
+
+    // Hiding a subtree releases the styles inside it
+    DOMElement* toggle = dom_document_get_element_by_id(doc, "toggle");
+    assert(style_of(engine, doc, "content") == NULL);
+    assert(dom_element_set_attribute(toggle, "class", "") == 0);
+    assert(style_engine_resolve(engine) == 0);
+    assert(style_of(engine, doc, "content") != NULL);
+    assert(dom_element_set_attribute(toggle, "class", "gone") == 0);
+    assert(style_engine_resolve(engine) == 0);
+    assert(style_of(engine, doc, "content") == NULL);
+
+    // Replacing the stylesheets restyles everything
+    style_engine_clear_stylesheets(engine);
+    assert(style_engine_add_stylesheet(engine, parse_sheet("div { color: blue }")) == 0);
+    assert(style_engine_resolve(engine) == 0);
+    assert(is_color(style_engine_get_style(engine, box)->color, 0, 0, 255, 255));
+    assert(style_of(engine, doc, "content") != NULL);
+    assert(style_of(engine, doc, "inside") == NULL);
+
+    style_engine_destroy(engine);
+    // Styles are gone once the engine is
+    assert(dom_node_get_style_cache((DOMNode*)box) == NULL);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+static size_t restyled(StyleEngine* engine) {
+    StyleStats stats;
+    assert(style_engine_resolve(engine) == 0);
+    assert(style_engine_get_stats(engine, &stats) == 0);
+    return stats.elements_styled;
+}
+
+void test_targeted_invalidation() {
+    printf("Testing targeted invalidation...\n");
+
+    char html[8192];
+    size_t length = (size_t)snprintf(html, sizeof(html), "<html><body><ul id=\"list\">");
+    for (int i = 0; i < 50; i++) {
+        length += (size_t)snprintf(html + length, sizeof(html) - length, "<li id=\"item%d\"><b>%d</b></li>", i, i);
+    }
+    snprintf(html + length, sizeof(html) - length,
+             "</ul><div id=\"panel\"><p id=\"body\">x</p></div><p id=\"next\">y</p></body></html>");
+
+    DOMDocument* doc = dom_document_create();
+    StyleEngine* engine = style_page(doc, html,
+        ".active { background-color: red }"
+        ".open p { display: none }"
+        "#special { color: red }"
+        "[data-state=on] b { color: blue }");
+
+    // Toggling a class only restyles the element carrying it
+    DOMElement* item = dom_document_get_element_by_id(doc, "item7");
+    assert(dom_element_set_attribute(item, "class", "active") == 0);
+    assert(restyled(engine) == 1);
+    assert(is_color(style_engine_get_style(engine, item)->background_color, 255, 0, 0, 255));
+    assert(dom_element_set_attribute(item, "class", "") == 0);
+    assert(restyled(engine) == 1);
+    assert(style_engine_get_style(engine, item)->background_color.a == 0);
+
+    // Classes and attributes no selector mentions restyle nothing
+    assert(dom_element_set_attribute(item, "class", "unused") == 0);
+    assert(dom_element_set_attribute(item, "title", "hello") == 0);
+    assert(restyled(engine) == 0);
+
+    // A class in an ancestor compound restyles the subtree
+    DOMElement* panel = dom_document_get_element_by_id(doc, "panel");
+    assert(dom_element_set_attribute(panel, "class", "open") == 0);
+    assert(restyled(engine) == 2);
+    assert(style_of(engine, doc, "body")->display == CSS_DISPLAY_NONE);
+    assert(style_of(engine, doc, "next")->font_style == CSS_FONT_STYLE_NORMAL);
+
+    // Ids and attribute selectors; children follow inherited changes
+    DOMElement* bold = (DOMElement*)dom_node_get_first_child((DOMNode*)item);
+    assert(dom_element_set_attribute(item, "id", "special") == 0);
+    assert(restyled(engine) == 2);
+    assert(is_color(style_engine_get_style(engine, bold)->color, 255, 0, 0, 255));
+    assert(dom_element_set_attribute(item, "data-state", "on") == 0);
+    assert(restyled(engine) == 2);
+    assert(is_color(style_engine_get_style(engine, bold)->color, 0, 0, 255, 255));
+
+    // Inserted nodes are styled on their own
+    DOMElement* added = dom_document_create_element(doc, "li");
+    assert(dom_node_append_child((DOMNode*)dom_document_get_element_by_id(doc, "list"), (DOMNode*)added) == 0);
+    assert(restyled(engine) == 1);
+    assert(style_engine_get_style(engine, added)->display == CSS_DISPLAY_BLOCK);
+
+    style_engine_destroy(engine);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_structural_invalidation() {
+    printf("Testing structural invalidation...\n");
+
+    DOMDocument* doc = dom_document_create();
+    StyleEngine* engine = style_page(doc,
+        "<html><body><ul id=\"list\"><li id=\"a\">1</li><li id=\"b\">2</li></ul>"
+        "<div id=\"box\"></div><p id=\"p1\">1</p><p id=\"p2\">2</p></body></html>",
+        "li:last-child { color: red }"
+        "div:empty { color: green }"
+        ".open ~ p { font-style: italic }");
+
+    assert(is_color(style_of(engine, doc, "b")->color, 255, 0, 0, 255));
+    assert(is_color(style_of(engine, doc, "box")->color, 0, 128, 0, 255));
+
+    // Appending moves :last-child to the new item
+    DOMElement* added = dom_document_create_element(doc, "li");
+    assert(dom_node_append_child((DOMNode*)dom_document_get_element_by_id(doc, "list"), (DOMNode*)added) == 0);
+    assert(style_engine_resolve(engine) == 0);
+    assert(is_color(style_of(engine, doc, "b")->color, 0, 0, 0, 255));
+    assert(is_color(style_engine_get_style(engine, added)->color, 255, 0, 0, 255));
+
+    // Removing it moves it back
+    assert(dom_node_remove_child((DOMNode*)dom_document_get_element_by_id(doc, "list"), (DOMNode*)added) == 0);
+    assert(style_engine_resolve(engine) == 0);
+    assert(is_color(style_of(engine, doc, "b")->color, 255, 0, 0, 255));
+
+    // A class before a sibling combinator restyles the later siblings
+    DOMElement* list = dom_document_get_element_by_id(doc, "list");
+    assert(dom_element_set_attribute(list, "class", "open") == 0);
+    assert(style_engine_resolve(engine) == 0);
+    assert(style_of(engine, doc, "p1")->font_style == CSS_FONT_STYLE_ITALIC);
+    assert(style_of(engine, doc, "p2")->font_style == CSS_FONT_STYLE_ITALIC);
+
+    // Text ends :empty
+    DOMElement* box = dom_document_get_element_by_id(doc, "box");
+    assert(dom_node_set_text_content((DOMNode*)box, "text") == 0);
+    assert(style_engine_resolve(engine) == 0);
+    assert(is_color(style_engine_get_style(engine, box)->color, 0, 0, 0, 255));
+
+    style_engine_destroy(engine);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+// Sections of lists and paragraphs, enough for many independent subtrees
+static char* nested_page(int sections) {
+    size_t size = (size_t)sections * 256 + 32;
+    char* html = (char*)malloc(size);
+    assert(html != NULL);
+    size_t used = (size_t)snprintf(html, size, "<html><body>");
+    for (int s = 0; s < sections; s++) {
+        used += (size_t)snprintf(html + used, size - used,
+                                 "<section class=\"s%d\"><h2>t</h2>"
+                                 "<ul><li class=\"a\">x</li><li class=\"b\">y</li><li>z</li></ul>"
+                                 "<div class=\"%s\"><p>p <em>e</em></p><p hidden>h</p></div></section>",
+                                 s % 3, s % 2 ? "odd" : "even");
+    }
+    snprintf(html + used, size - used, "</body></html>");
+    return html;
+}
+
+static void assert_same_styles(StyleEngine* a, DOMNode* x, StyleEngine* b, DOMNode* y) {
+    for (; x || y; x = dom_node_get_next_sibling(x), y = dom_node_get_next_sibling(y)) {
+        assert(x && y && dom_node_get_type(x) == dom_node_get_type(y));
+        if (dom_node_get_type(x) == NODE_ELEMENT) {
+            const ComputedStyle* sa = style_engine_get_style(a, (DOMElement*)x);
+            const ComputedStyle* sb = style_engine_get_style(b, (DOMElement*)y);
+            assert((sa == NULL) == (sb == NULL));
+            assert(!sa || memcmp(sa, sb, sizeof(ComputedStyle)) == 0);
+        }
+        assert_same_styles(a, dom_node_get_first_child(x), b, dom_node_get_first_child(y));
+    }
+}
+
+void test_parallel_resolve() {
+    printf("Testing parallel resolve...\n");
+
+    const char* css =
+        "section { margin: 4px } .s1 { color: red } .odd p { font-size: 12px }"
+        "li:first-child { color: blue } li + li { font-style: italic } .even em { font-weight: bold }";
+    char* html = nested_page(200);
+    ThreadPool* pool = thread_pool_create(4);
+    assert(pool != NULL);
+
+    // A single-threaded reference, a parallel engine, and a parallel
+    // engine over a lazily parsed document
+    DOMDocument* docs[3];
+    StyleEngine* engines[3];
+    StyleStats stats[3];
+    for (int i = 0; i < 3; i++) {
+        docs[i] = dom_document_create();
+        assert(docs[i] != NULL);
+        assert((i == 2 ? html_parser_parse_lazy(docs[i], html) : html_parser_parse(docs[i], html)) == 0);
+        engines[i] = style_engine_create(docs[i]);
+        assert(engines[i] != NULL);
+        assert(style_engine_add_stylesheet(engines[i], parse_sheet(css)) == 0);
+        if (i > 0) {
+            assert(style_engine_set_thread_pool(engines[i], pool) == 0);
+        }
+        assert(style_engine_resolve(engines[i]) == 0);
+        assert(style_engine_get_stats(engines[i], &stats[i]) == 0);
+    }
+    assert(stats[0].elements_styled == 200 * 10 + 2);
+    for (int i = 1; i < 3; i++) {
+        assert(memcmp(&stats[i], &stats[0], sizeof(StyleStats)) == 0);
+        assert_same_styles(engines[0], (DOMNode*)docs[0], engines[i], (DOMNode*)docs[i]);
+    }
+
+    // Incremental restyles match too
+    for (int i = 0; i < 3; i++) {
+        DOMNode* section = dom_node_get_first_child((DOMNode*)dom_document_get_element(docs[i]));
+        section = dom_node_get_first_child(section);
+        for (int s = 0; s < 7; s++) {
+            section = dom_node_get_next_sibling(section);
+        }
+        assert(dom_element_set_attribute((DOMElement*)section, "class", "s1") == 0);
+        assert(style_engine_resolve(engines[i]) == 0);
+        assert(style_engine_get_stats(engines[i], &stats[i]) == 0);
+    }
+    for (int i = 1; i < 3; i++) {
+        assert(memcmp(&stats[i], &stats[0], sizeof(StyleStats)) == 0);
+        assert_same_styles(engines[0], (DOMNode*)docs[0], engines[i], (DOMNode*)docs[i]);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        style_engine_destroy(engines[i]);
+        dom_document_destroy(docs[i]);
+    }
+    thread_pool_destroy(pool);
+    free(html);
+    printf("  PASSED\n");
+}
+
+int main() {
+    printf("Running CSS tests...\n\n");
+
+    test_stylesheet_parsing();
+    test_cascade();
+    test_inheritance_and_units();
+    test_selectors();
+    test_rule_buckets();
+    test_style_sharing();
+    test_restyle_after_mutation();
+    test_targeted_invalidation();
+    test_structural_invalidation();
+    test_parallel_resolve();
+
+    printf("\nAll CSS tests passed!\n");
+    return 0;
+}
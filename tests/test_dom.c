@@ -68,6 +68,357 @@ void test_inner_html() {
     printf("  PASSED\n");
 }
 
+void test_bindings_and_release() {
+    printf("Testing node bindings and detached release...\n");
+    DOMDocument* doc = dom_document_create();
+    assert(doc != NULL);
+
+    DOMElement* root = dom_document_create_element(doc, "html");
+    DOMElement* detached = dom_document_create_element(doc, "div");
+    DOMElement* child = dom_document_create_element(doc, "span");
+    assert(root != NULL && detached != NULL && child != NULL);
+    assert(dom_node_append_child((DOMNode*)detached, (DOMNode*)child) == 0);
+
+    // A node cannot become its own ancestor
+    assert(dom_node_append_child((DOMNode*)child, (DOMNode*)detached) != 0);
+
+    int token = 0;
+    dom_node_set_binding((DOMNode*)child, &token);
+    assert(dom_node_get_binding((DOMNode*)child) == &token);
+
+    // Attached trees are never released
+    assert(dom_node_release((DOMNode*)root) == 0);
+
+    // A detached tree survives while a binding points into it
+    assert(dom_node_release((DOMNode*)detached) == 0);
+    dom_node_set_binding((DOMNode*)child, NULL);
+    assert(dom_node_release((DOMNode*)child) == 1);
+
+    // Unattached elements are reclaimed by dom_document_destroy
+    assert(dom_document_create_element(doc, "p") != NULL);
+
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_tree_navigation_and_collections() {
+    printf("Testing tree navigation and live collections...\n");
+    DOMDocument* doc = dom_document_create();
+    assert(doc != NULL);
+
+    DOMElement* root = dom_document_create_element(doc, "html");
+    DOMElement* first = dom_document_create_element(doc, "div");
+    DOMElement* second = dom_document_create_element(doc, "P");
+    assert(root != NULL && first != NULL && second != NULL);
+    assert(dom_node_append_child((DOMNode*)doc, (DOMNode*)root) == 0);
+    assert(dom_document_get_element(doc) == root);
+    assert(dom_node_append_child((DOMNode*)root, (DOMNode*)second) == 0);
+    assert(dom_node_insert_before((DOMNode*)root, (DOMNode*)first, (DOMNode*)second) == 0);
+
+    assert(dom_node_get_parent((DOMNode*)first) == (DOMNode*)root);
+    assert(dom_node_get_parent((DOMNode*)root) == (DOMNode*)doc);
+    assert(dom_node_get_first_child((DOMNode*)root) == (DOMNode*)first);
+    assert(dom_node_get_last_child((DOMNode*)root) == (DOMNode*)second);
+    assert(dom_node_get_next_sibling((DOMNode*)first) == (DOMNode*)second);
+    assert(dom_node_get_previous_sibling((DOMNode*)second) == (DOMNode*)first);
+    assert(dom_node_get_owner_document((DOMNode*)second) == doc);
+
+    assert(dom_element_set_attribute(first, "class", "item lead") == 0);
+    assert(dom_element_set_attribute(second, "class", "item") == 0);
+    assert(dom_node_set_text_content((DOMNode*)first, "Hello, ") == 0);
+    assert(dom_node_set_text_content((DOMNode*)second, "world") == 0);
+
+    char* text = dom_node_get_text_content((DOMNode*)root);
+    assert(text != NULL && strcmp(text, "Hello, world") == 0);
+    free(text);
+
+    DOMCollection* children = dom_collection_create((DOMNode*)root, DOM_COLLECTION_CHILDREN, NULL);
+    DOMCollection* paragraphs = dom_collection_create((DOMNode*)doc, DOM_COLLECTION_BY_TAG_NAME, "p");
+    DOMCollection* items = dom_collection_create((DOMNode*)doc, DOM_COLLECTION_BY_CLASS_NAME, "item");
+    DOMCollection* leads = dom_collection_create((DOMNode*)doc, DOM_COLLECTION_BY_CLASS_NAME, "lead item");
+    assert(children != NULL && paragraphs != NULL && items != NULL && leads != NULL);
+
+    assert(dom_collection_length(children) == 2);
+    assert(dom_collection_item(children, 1) == (DOMNode*)second);
+    assert(dom_collection_item(children, 2) == NULL);
+    assert(dom_collection_length(paragraphs) == 1);
+    assert(dom_collection_length(items) == 2);
+    assert(dom_collection_length(leads) == 1);
+
+    // Collections follow later mutations
+    uint64_t version = dom_document_get_version(doc);
+    DOMElement* third = dom_document_create_element(doc, "p");
+    assert(dom_node_append_child((DOMNode*)root, (DOMNode*)third) == 0);
+    assert(dom_document_get_version(doc) > version);
+    assert(dom_collection_length(children) == 3);
+    assert(dom_collection_item(paragraphs, 1) == (DOMNode*)third);
+
+    assert(dom_node_remove_child((DOMNode*)root, (DOMNode*)first) == 0);
+    assert(dom_node_remove_child((DOMNode*)root, (DOMNode*)first) != 0);
+    assert(dom_node_get_parent((DOMNode*)first) == NULL);
+    assert(dom_collection_item(children, 0) == (DOMNode*)second);
+    assert(dom_collection_length(items) == 1);
+
+    dom_collection_destroy(children);
+    dom_collection_destroy(paragraphs);
+    dom_collection_destroy(items);
+    dom_collection_destroy(leads);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+static void count_release(void* value, void* user_data) {
+    (void)value;
+    (*(int*)user_data)++;
+}
+
+void test_length_aware_strings_and_script_cache() {
+    printf("Testing length-aware strings and the script string cache...\n");
+    DOMDocument* doc = dom_document_create();
+    assert(doc != NULL);
+
+    // Lengths bound the input; nothing past them is read
+    DOMElement* root = dom_document_create_element_len(doc, "divXXX", 3);
+    assert(root != NULL && strcmp(dom_element_get_tag_name(root), "div") == 0);
+    assert(dom_element_set_attribute_len(root, "idXX", 2, "main--", 4) == 0);
+    assert(dom_document_get_element_by_id_len(doc, "main--", 4) == root);
+    assert(dom_document_get_element_by_id_len(doc, "main--", 3) == NULL);
+
+    size_t length = 0;
+    const char* value = dom_element_get_attribute_len(root, "id", 2, &length);
+    assert(value != NULL && length == 4 && strcmp(value, "main") == 0);
+
+    // Names from script may hold NULs; they match only the full name
+    assert(dom_element_get_attribute_len(root, "a\0bcdefghijklmnop", 18, NULL) == NULL);
+    assert(dom_element_get_attribute_len(root, "id\0", 3, NULL) == NULL);
+    assert(dom_element_set_attribute_len(root, "id\0x", 4, "nul", 3) == 0);
+    value = dom_element_get_attribute_len(root, "id\0x", 4, &length);
+    assert(value != NULL && length == 3 && strcmp(value, "nul") == 0);
+    value = dom_element_get_attribute_len(root, "id", 2, &length);
+    assert(value != NULL && length == 4 && strcmp(value, "main") == 0);
+
+    assert(dom_node_set_text_content_len((DOMNode*)root, "Hello!!", 5) == 0);
+    DOMNode* text = dom_node_get_first_child((DOMNode*)root);
+    assert(text != NULL && dom_node_get_type(text) == NODE_TEXT);
+    value = dom_node_get_value(text, &length);
+    assert(value != NULL && length == 5 && strcmp(value, "Hello") == 0);
+
+    // Caching needs a release hook
+    int token = 0;
+    assert(dom_node_set_script_value(text, &token) != 0);
+
+    int released = 0;
+    dom_document_set_script_cache(doc, count_release, &released);
+    assert(dom_element_set_attribute_script_value(root, "id", 2, &token) == 0);
+    assert(dom_element_get_attribute_script_value(root, "id", 2) == &token);
+    assert(dom_element_set_attribute_script_value(root, "missing", 7, &token) != 0);
+    assert(dom_node_set_script_value(text, &token) == 0);
+    assert(dom_node_get_script_value(text) == &token);
+
+    // Changing a value releases its cached string
+    assert(dom_element_set_attribute(root, "id", "other") == 0);
+    assert(released == 1);
+    assert(dom_element_get_attribute_script_value(root, "id", 2) == NULL);
+
+    // So does destroying the node
+    assert(dom_node_set_text_content((DOMNode*)root, "") == 0);
+    assert(released == 2);
+    assert(dom_node_get_first_child((DOMNode*)root) == NULL);
+
+    // Unhooking releases whatever is still cached
+    assert(dom_element_set_attribute_script_value(root, "id", 2, &token) == 0);
+    dom_document_set_script_cache(doc, NULL, NULL);
+    assert(released == 3);
+    assert(dom_element_get_attribute_script_value(root, "id", 2) == NULL);
+
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_inner_html_fragments() {
+    printf("Testing innerHTML fragments and insertAdjacentHTML...\n");
+    DOMDocument* doc = dom_document_create();
+    assert(doc != NULL);
+
+    DOMElement* root = dom_document_create_element(doc, "div");
+    assert(root != NULL);
+
+    // Mixed content keeps every text run next to the elements
+    assert(dom_element_set_inner_html(root, "Hello <b id=\"b\">bold</b> world<br>!") == 0);
+    DOMNode* first = dom_node_get_first_child((DOMNode*)root);
+    assert(first != NULL && dom_node_get_type(first) == NODE_TEXT);
+    DOMNode* bold = dom_node_get_next_sibling(first);
+    assert(bold != NULL && strcmp(dom_node_get_name(bold), "b") == 0);
+    assert(dom_node_get_parent(bold) == (DOMNode*)root);
+    assert(dom_document_get_element_by_id(doc, "b") == (DOMElement*)bold);
+    char* text = dom_node_get_text_content((DOMNode*)root);
+    assert(text != NULL && strcmp(text, "Helloboldworld!") == 0);
+    free(text);
+
+    // Replacing the content drops the old children
+    assert(dom_element_set_inner_html(root, "<p>one</p><p>two</p></div><p>three</p>") == 0);
+    DOMCollection* paragraphs = dom_collection_create((DOMNode*)root, DOM_COLLECTION_CHILDREN, NULL);
+    assert(paragraphs != NULL);
+    assert(dom_collection_length(paragraphs) == 3);
+    assert(dom_document_get_element_by_id(doc, "b") == NULL);
+
+    // Script content is text
+    DOMElement* script = dom_document_create_element(doc, "script");
+    assert(dom_element_set_inner_html(script, "if (a < b) x();") == 0);
+    text = dom_node_get_text_content((DOMNode*)script);
+    assert(text != NULL && strcmp(text, "if (a < b) x();") == 0);
+    free(text);
+
+    DOMNode* middle = (DOMNode*)dom_collection_item(paragraphs, 1);
+    assert(dom_element_insert_adjacent_html((DOMElement*)middle, DOM_ADJACENT_BEFORE_BEGIN,
+                                            "<i>a</i>", 8) == 0);
+    assert(dom_element_insert_adjacent_html((DOMElement*)middle, DOM_ADJACENT_AFTER_BEGIN, "b", 1) == 0);
+    assert(dom_element_insert_adjacent_html((DOMElement*)middle, DOM_ADJACENT_BEFORE_END, "c", 1) == 0);
+    assert(dom_element_insert_adjacent_html((DOMElement*)middle, DOM_ADJACENT_AFTER_END,
+                                            "<i>d</i>", 8) == 0);
+    assert(dom_collection_length(paragraphs) == 5);
+    text = dom_node_get_text_content((DOMNode*)root);
+    assert(text != NULL && strcmp(text, "oneabtwocdthree") == 0);
+    free(text);
+
+    // The document element has no parent element to insert into
+    assert(dom_element_insert_adjacent_html(root, DOM_ADJACENT_AFTER_END, "x", 1) != 0);
+
+    // Appending a fragment moves its children and leaves it empty
+    DOMNode* fragment = dom_document_create_fragment(doc);
+    assert(fragment != NULL && dom_node_get_type(fragment) == NODE_DOCUMENT_FRAGMENT);
+    assert(dom_node_append_child(fragment, dom_document_create_text_node(doc, "x")) == 0);
+    assert(dom_node_append_child(fragment, dom_document_create_text_node_len(doc, "yz", 1)) == 0);
+    assert(dom_node_append_child((DOMNode*)script, fragment) == 0);
+    assert(dom_node_get_first_child(fragment) == NULL);
+    assert(dom_node_get_parent(fragment) == NULL);
+    text = dom_node_get_text_content((DOMNode*)script);
+    assert(text != NULL && strcmp(text, "if (a < b) x();xy") == 0);
+    free(text);
+
+    dom_collection_destroy(paragraphs);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+static int paint_releases;
+
+static void count_paint_release(void* value, void* user_data) {
+    paint_releases++;
+    free(value);
+}
+
+void test_paint_cache_invalidation() {
+    printf("Testing paint cache invalidation...\n");
+    DOMDocument* doc = dom_document_create();
+    DOMElement* root = dom_document_create_element(doc, "div");
+    DOMElement* left = dom_document_create_element(doc, "p");
+    DOMElement* right = dom_document_create_element(doc, "p");
+    dom_node_append_child((DOMNode*)doc, (DOMNode*)root);
+    dom_node_append_child((DOMNode*)root, (DOMNode*)left);
+    dom_node_append_child((DOMNode*)root, (DOMNode*)right);
+
+    // No hook, no cache
+    assert(dom_node_set_paint_cache((DOMNode*)left, NULL) == -1);
+
+    paint_releases = 0;
+    dom_document_set_paint_cache(doc, count_paint_release, NULL);
+    assert(dom_node_set_paint_cache((DOMNode*)root, malloc(1)) == 0);
+    assert(dom_node_set_paint_cache((DOMNode*)left, malloc(1)) == 0);
+    assert(dom_node_set_paint_cache((DOMNode*)right, malloc(1)) == 0);
+
+    // Mutating one subtree drops its cache and its ancestors', not siblings'
+    dom_element_set_attribute(right, "class", "active");
+    assert(dom_node_get_paint_cache((DOMNode*)right) == NULL);
+    assert(dom_node_get_paint_cache((DOMNode*)root) == NULL);
+    assert(dom_node_get_paint_cache((DOMNode*)left) != NULL);
+    assert(paint_releases == 2);
+
+    // Replacing a cache releases the old value
+    assert(dom_node_set_paint_cache((DOMNode*)left, malloc(1)) == 0);
+    assert(paint_releases == 3);
+
+    // Child list changes invalidate the parent
+    assert(dom_node_set_paint_cache((DOMNode*)root, malloc(1)) == 0);
+    dom_node_remove_child((DOMNode*)root, (DOMNode*)right);
+    assert(dom_node_get_paint_cache((DOMNode*)root) == NULL);
+    assert(dom_node_get_paint_cache((DOMNode*)left) != NULL);
+    assert(paint_releases == 4);
+
+    // Destroying the document releases what is left
+    dom_document_destroy(doc);
+    assert(paint_releases == 5);
+    printf("  PASSED\n");
+}
+
+static DOMMutation last_mutation;
+static char last_old_value[32];
+static int mutation_count;
+
+static void record_mutation(const DOMMutation* mutation, void* user_data) {
+    last_mutation = *mutation;
+    last_old_value[0] = '\0';
+    if (mutation->old_value) {
+        memcpy(last_old_value, mutation->old_value, mutation->old_value_length);
+        last_old_value[mutation->old_value_length] = '\0';
+    }
+    mutation_count++;
+}
+
+void test_mutation_observer_and_style_marks() {
+    printf("Testing mutation observer and style marks...\n");
+    DOMDocument* doc = dom_document_create();
+    DOMElement* root = dom_document_create_element(doc, "div");
+    DOMElement* child = dom_document_create_element(doc, "p");
+    dom_node_append_child((DOMNode*)doc, (DOMNode*)root);
+    dom_element_set_attribute(root, "class", "a");
+
+    mutation_count = 0;
+    dom_document_set_mutation_observer(doc, record_mutation, NULL);
+
+    // Attribute records carry the value being replaced
+    dom_element_set_attribute(root, "class", "b");
+    assert(mutation_count == 1);
+    assert(last_mutation.type == DOM_MUTATION_ATTRIBUTE);
+    assert(last_mutation.target == (DOMNode*)root);
+    assert(last_mutation.name_length == 5 && strncmp(last_mutation.name, "class", 5) == 0);
+    assert(strcmp(last_old_value, "a") == 0);
+    assert(last_mutation.value_length == 1 && last_mutation.value[0] == 'b');
+
+    dom_node_append_child((DOMNode*)root, (DOMNode*)child);
+    assert(last_mutation.type == DOM_MUTATION_CHILD_LIST);
+    assert(last_mutation.target == (DOMNode*)root && last_mutation.added == (DOMNode*)child);
+
+    dom_node_remove_child((DOMNode*)root, (DOMNode*)child);
+    assert(last_mutation.removed == (DOMNode*)child && last_mutation.added == NULL);
+
+    // Wholesale replacement names no single child
+    dom_element_set_inner_html(root, "<span>x</span>");
+    assert(last_mutation.type == DOM_MUTATION_CHILD_LIST);
+    assert(last_mutation.added == NULL && last_mutation.removed == NULL);
+
+    DOMNode* text = dom_node_get_first_child(dom_node_get_first_child((DOMNode*)root));
+    dom_node_set_text_content(text, "y");
+    assert(last_mutation.type == DOM_MUTATION_CHARACTER_DATA && last_mutation.target == text);
+
+    int count = mutation_count;
+    dom_document_set_mutation_observer(doc, NULL, NULL);
+    dom_element_set_attribute(root, "id", "x");
+    assert(mutation_count == count);
+
+    // Marking a node flags its ancestors up to the document
+    DOMNode* span = dom_node_get_first_child((DOMNode*)root);
+    dom_node_mark_style_dirty(span, DOM_STYLE_DIRTY_SELF);
+    assert(dom_node_get_style_dirty(span) == DOM_STYLE_DIRTY_SELF);
+    assert(dom_node_get_style_dirty((DOMNode*)root) == DOM_STYLE_DIRTY_CHILDREN);
+    assert(dom_node_get_style_dirty((DOMNode*)doc) == DOM_STYLE_DIRTY_CHILDREN);
+    dom_node_clear_style_dirty(span);
+    assert(dom_node_get_style_dirty(span) == 0);
+
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
 int main() {
     printf("Running DOM tests...\n\n");
 
@@ -75,6 +426,12 @@ int main() {
     test_element_creation();
     test_attributes();
     test_inner_html();
+    test_bindings_and_release();
+    test_tree_navigation_and_collections();
+    test_length_aware_strings_and_script_cache();
+    test_inner_html_fragments();
+    test_paint_cache_invalidation();
+    test_mutation_observer_and_style_marks();
 
     printf("\nAll DOM tests passed!\n");
     return 0;
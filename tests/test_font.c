@@ -0,0 +1,362 @@
+#include "rendering/font.h"
+#include "rendering/glyph_cache.h"
+#include "rendering/text_run_cache.h"
+#include "rendering/renderer.h"
+#include "layout/layout.h"
+#include "css/stylesheet.h"
+#include "html/parser.h"
+#include "core/thread_pool.h"
+#include "dom/dom.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+static FontSpec make_font(float size, int weight, int italic) {
+    FontSpec font;
+    font.size = size;
+    font.weight = weight;
+    font.italic = italic;
+    return font;
+}
+
+void test_builtin_font() {
+    printf("Testing built-in font metrics and rasterization...\n");
+    FontSpec regular = make_font(20.0f, 400, 0);
+    FontSpec bold = make_font(20.0f, 700, 0);
+    FontSpec italic = make_font(20.0f, 400, 1);
+
+    // Proportional advances; bold strokes are wider
+    assert(font_get_advance(&regular, 'i') < font_get_advance(&regular, 'm'));
+    assert(font_get_advance(&regular, ' ') == 6.0f);
+    assert(font_get_advance(&regular, 0xA0) == font_get_advance(&regular, ' '));
+    assert(font_get_advance(&bold, 'm') > font_get_advance(&regular, 'm'));
+    assert(font_get_advance(&italic, 'm') == font_get_advance(&regular, 'm'));
+    assert(font_get_advance(&regular, 0x4E2D) > 0.0f);        // Drawn as a box
+    assert(font_get_ascent(&regular) == 16.0f && font_get_descent(&regular) == 4.0f);
+
+    // 'H' inks six columns of cells two px wide, rows 0-6 above the baseline
+    FontGlyphMetrics metrics;
+    assert(font_get_glyph_metrics(&regular, 'H', 0, &metrics) == 0);
+    assert(metrics.width == 12 && metrics.height == 14);
+    assert(metrics.left == 1 && metrics.top == 14);
+    assert(metrics.advance == 14.0f);
+
+    unsigned char mask[32 * 32];
+    assert(font_rasterize_glyph(&regular, 'H', 0, mask, 32) == 0);
+    assert(mask[0] == 255 && mask[3] == 255 && mask[4] == 0);
+    assert(mask[6 * 32 + 4] == 255);                            // Crossbar
+
+    // A quarter pixel pen offset spreads coverage over one more column
+    assert(font_get_glyph_metrics(&regular, 'H', 2, &metrics) == 0);
+    assert(metrics.width == 13);
+    assert(font_rasterize_glyph(&regular, 'H', 2, mask, 32) == 0);
+    assert(mask[0] == 128 && mask[1] == 255 && mask[4] == 128);
+
+    // Descenders reach below the baseline; blank glyphs have no mask
+    assert(font_get_glyph_metrics(&regular, 'g', 0, &metrics) == 0);
+    assert(metrics.top - metrics.height == -2);
+    assert(font_get_glyph_metrics(&regular, ' ', 0, &metrics) == 0);
+    assert(metrics.width == 0 && metrics.advance == 6.0f);
+    assert(font_get_glyph_metrics(&regular, 'H', FONT_SUBPIXEL_STEPS, &metrics) == -1);
+
+    // UTF-8 decoding
+    const char* text = "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80\xC3";
+    size_t length = strlen(text);
+    size_t offset = 0;
+    assert(font_decode_utf8(text, length, &offset) == 'a' && offset == 1);
+    assert(font_decode_utf8(text, length, &offset) == 0xE9 && offset == 3);
+    assert(font_decode_utf8(text, length, &offset) == 0x20AC && offset == 6);
+    assert(font_decode_utf8(text, length, &offset) == 0x1F600 && offset == 10);
+    assert(font_decode_utf8(text, length, &offset) == 0xFFFD && offset == 11);
+    offset = 0;
+    assert(font_decode_utf8("\xC0\xAF", 2, &offset) == 0xFFFD && offset == 1);
+
+    printf("  PASSED\n");
+}
+
+void test_glyph_cache_hits() {
+    printf("Testing glyph cache hits...\n");
+    GlyphCache* cache = glyph_cache_create(0, 0);
+    assert(cache != NULL);
+    FontSpec font = make_font(16.0f, 400, 0);
+
+    CachedGlyph first;
+    CachedGlyph again;
+    assert(glyph_cache_get(cache, &font, 'A', 0, &first) == 0);
+    assert(glyph_cache_get(cache, &font, 'A', 0, &again) == 0);
+    assert(first.mask != NULL && first.mask == again.mask);
+    assert(first.stride == 256 && first.advance == font_get_advance(&font, 'A'));
+
+    // The atlas holds what the rasterizer produces
+    FontGlyphMetrics metrics;
+    unsigned char mask[32 * 32];
+    assert(font_get_glyph_metrics(&font, 'A', 0, &metrics) == 0);
+    assert(first.width == metrics.width && first.height == metrics.height);
+    assert(first.left == metrics.left && first.top == metrics.top);
+    font_rasterize_glyph(&font, 'A', 0, mask, 32);
+    for (int y = 0; y < first.height; y++) {
+        assert(memcmp(first.mask + y * first.stride, mask + y * 32, (size_t)first.width) == 0);
+    }
+
+    // Every part of the key is significant
+    CachedGlyph other;
+    assert(glyph_cache_get(cache, &font, 'A', 1, &other) == 0 && other.mask != first.mask);
+    FontSpec larger = make_font(17.0f, 400, 0);
+    FontSpec bold = make_font(16.0f, 700, 0);
+    FontSpec italic = make_font(16.0f, 400, 1);
+    assert(glyph_cache_get(cache, &larger, 'A', 0, &other) == 0 && other.mask != first.mask);
+    assert(glyph_cache_get(cache, &bold, 'A', 0, &other) == 0 && other.mask != first.mask);
+    assert(glyph_cache_get(cache, &italic, 'A', 0, &other) == 0 && other.mask != first.mask);
+
+    // Weights on the same side of bold share glyphs
+    FontSpec medium = make_font(16.0f, 500, 0);
+    assert(glyph_cache_get(cache, &medium, 'A', 0, &other) == 0 && other.mask == first.mask);
+
+    // Blank glyphs are cached without atlas space
+    assert(glyph_cache_get(cache, &font, ' ', 0, &other) == 0);
+    assert(other.mask == NULL && other.width == 0 && other.advance == font_get_advance(&font, ' '));
+
+    GlyphCacheStats stats;
+    glyph_cache_get_stats(cache, &stats);
+    assert(stats.misses == 6 && stats.hits == 2);
+    assert(stats.glyphs == 6 && stats.pages == 1 && stats.evictions == 0);
+
+    // Glyphs bigger than a page are refused
+    FontSpec huge = make_font(400.0f, 400, 0);
+    assert(glyph_cache_get(cache, &huge, 'A', 0, &other) == -1);
+
+    glyph_cache_destroy(cache);
+    printf("  PASSED\n");
+}
+
+void test_glyph_cache_eviction() {
+    printf("Testing glyph cache LRU eviction...\n");
+    // At 20px these capitals are 12-14 px square, so a 16 px page holds one
+    GlyphCache* cache = glyph_cache_create(16, 2);
+    FontSpec font = make_font(20.0f, 400, 0);
+    CachedGlyph a, b, c, d, e, glyph;
+    GlyphCacheStats stats;
+
+    assert(glyph_cache_get(cache, &font, 'A', 0, &a) == 0);
+    assert(glyph_cache_get(cache, &font, 'B', 0, &b) == 0);
+    assert(a.mask != b.mask);
+
+    // Every page is in use this frame, so the limit gives way
+    assert(glyph_cache_get(cache, &font, 'C', 0, &c) == 0);
+    glyph_cache_get_stats(cache, &stats);
+    assert(stats.pages == 3 && stats.evictions == 0);
+
+    // Pages drawn from last frame may still be on screen
+    glyph_cache_begin_frame(cache);
+    assert(glyph_cache_get(cache, &font, 'D', 0, &d) == 0);
+    glyph_cache_get_stats(cache, &stats);
+    assert(stats.pages == 4 && stats.evictions == 0);
+
+    // Two frames on, the least recently used page is cleared for E; A was
+    // drawn this frame and survives
+    glyph_cache_begin_frame(cache);
+    assert(glyph_cache_get(cache, &font, 'A', 0, &glyph) == 0 && glyph.mask == a.mask);
+    assert(glyph_cache_get(cache, &font, 'E', 0, &e) == 0);
+    assert(e.mask == b.mask);
+    glyph_cache_get_stats(cache, &stats);
+    assert(stats.pages == 4 && stats.evictions == 1);
+
+    // B was dropped and is rasterized again, taking C's page (older than D's)
+    assert(glyph_cache_get(cache, &font, 'B', 0, &glyph) == 0 && glyph.mask == c.mask);
+    assert(glyph_cache_get(cache, &font, 'A', 0, &glyph) == 0 && glyph.mask == a.mask);
+    assert(glyph_cache_get(cache, &font, 'D', 0, &glyph) == 0 && glyph.mask == d.mask);
+    glyph_cache_get_stats(cache, &stats);
+    assert(stats.misses == 6 && stats.hits == 3);
+    assert(stats.evictions == 2 && stats.pages == 4 && stats.glyphs == 4);
+
+    glyph_cache_destroy(cache);
+    printf("  PASSED\n");
+}
+
+void test_draw_text() {
+    printf("Testing drawing text from the atlas...\n");
+    DOMDocument* doc = dom_document_create();
+    Renderer* renderer = renderer_init(96, 32);
+    GlyphCache* cache = glyph_cache_create(0, 0);
+    TextRunCache* runs = text_run_cache_create(0);
+    FontSpec font = make_font(20.0f, 400, 0);
+    RenderColor white = { 255, 255, 255, 255 };
+    RenderColor black = { 0, 0, 0, 255 };
+    renderer_set_clear_color(renderer, white);
+
+    float advance = 0.0f;
+    glyph_cache_begin_frame(cache);
+    assert(glyph_cache_draw_text(cache, renderer, 2.25f, 24, "HH H", 4, &font, black, &advance) == 0);
+    assert(advance == text_run_cache_measure(runs, "HH H", 4, &font));
+    assert(renderer_render(renderer, doc) == 0);
+
+    // The first H's left stem covers x 4-6 fully from y 10 down to the
+    // baseline; its crossbar spans y 16-17
+    int width;
+    const unsigned char* buffer = renderer_get_buffer(renderer, &width, NULL);
+    const unsigned char* stem = buffer + ((size_t)16 * (size_t)width + 4) * 4;
+    const unsigned char* gap = buffer + ((size_t)12 * (size_t)width + 9) * 4;
+    assert(stem[0] == 0 && stem[3] == 255);
+    assert(gap[0] == 255);
+
+    // The same text next frame rasterizes nothing and damages nothing
+    GlyphCacheStats stats;
+    glyph_cache_get_stats(cache, &stats);
+    assert(stats.misses == 2 && stats.hits == 2);       // Advances are whole px, so every H shares one offset
+    renderer_clear_commands(renderer);
+    glyph_cache_begin_frame(cache);
+    assert(glyph_cache_draw_text(cache, renderer, 2.25f, 24, "HH H", 4, &font, black, NULL) == 0);
+    assert(renderer_render(renderer, doc) == 0);
+    size_t count = 0;
+    renderer_get_damage(renderer, &count);
+    assert(count == 0);
+    glyph_cache_get_stats(cache, &stats);
+    assert(stats.misses == 2 && stats.hits == 6);
+
+    text_run_cache_destroy(runs);
+    glyph_cache_destroy(cache);
+    renderer_destroy(renderer);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_text_run_cache() {
+    printf("Testing text run cache...\n");
+    TextRunCache* cache = text_run_cache_create(3);
+    assert(cache != NULL);
+    FontSpec font = make_font(10.0f, 400, 0);
+    FontSpec bold = make_font(10.0f, 700, 0);
+
+    float width = text_run_cache_measure(cache, "hello", 5, &font);
+    float expected = 0.0f;
+    for (const char* p = "hello"; *p; p++) {
+        expected += font_get_advance(&font, (unsigned char)*p);
+    }
+    assert(fabsf(width - expected) < 0.001f);
+    assert(text_run_cache_measure(cache, "hello", 5, &font) == width);
+    assert(text_run_cache_measure(cache, "hello", 5, &bold) > width);
+    assert(text_run_cache_measure(cache, "", 0, &font) == 0.0f);
+
+    // Advances are per character, not per byte
+    float advances[8];
+    assert(text_run_cache_get_advances(cache, "h\xC3\xA9llo", 6, &font, advances, 8) == 5);
+    assert(advances[0] == font_get_advance(&font, 'h'));
+    assert(advances[1] == font_get_advance(&font, 0xE9));
+    assert(text_run_cache_get_advances(cache, "hello", 5, &font, advances, 2) == 5);
+    assert(advances[1] == font_get_advance(&font, 'e'));
+
+    TextRunCacheStats stats;
+    text_run_cache_get_stats(cache, &stats);
+    assert(stats.misses == 3 && stats.hits == 2 && stats.runs == 3 && stats.evictions == 0);
+
+    // The least recently used run goes first: "hello" was just used, so
+    // the bold run is dropped
+    text_run_cache_measure(cache, "world", 5, &font);
+    text_run_cache_get_stats(cache, &stats);
+    assert(stats.evictions == 1);
+    text_run_cache_measure(cache, "hello", 5, &font);
+    text_run_cache_measure(cache, "hello", 5, &bold);
+    text_run_cache_get_stats(cache, &stats);
+    assert(stats.hits == 3 && stats.misses == 5);
+
+    text_run_cache_clear(cache);
+    text_run_cache_get_stats(cache, &stats);
+    assert(stats.runs == 0);
+    text_run_cache_destroy(cache);
+    printf("  PASSED\n");
+}
+
+typedef struct {
+    TextRunCache* cache;
+    float widths[64];
+} ConcurrentRuns;
+
+static const char* const words[] = { "alpha", "beta", "gamma", "delta" };
+
+static void measure_task(void* context, size_t index, int worker) {
+    ConcurrentRuns* runs = (ConcurrentRuns*)context;
+    FontSpec font = make_font(12.0f, 400, 0);
+    const char* word = words[index % 4];
+    runs->widths[index] = text_run_cache_measure(runs->cache, word, strlen(word), &font);
+}
+
+void test_text_run_cache_concurrent() {
+    printf("Testing text run cache from several threads...\n");
+    ThreadPool* pool = thread_pool_create(4);
+    ConcurrentRuns runs;
+    runs.cache = text_run_cache_create(0);
+
+    for (int round = 0; round < 20; round++) {
+        text_run_cache_clear(runs.cache);
+        assert(thread_pool_parallel_for(pool, 64, measure_task, &runs) == 0);
+        for (size_t i = 4; i < 64; i++) {
+            assert(runs.widths[i] == runs.widths[i % 4]);
+        }
+        TextRunCacheStats stats;
+        text_run_cache_get_stats(runs.cache, &stats);
+        assert(stats.runs == 4);
+    }
+
+    text_run_cache_destroy(runs.cache);
+    thread_pool_destroy(pool);
+    printf("  PASSED\n");
+}
+
+static float measure_with_cache(const char* text, size_t length, const ComputedStyle* style, void* user_data) {
+    FontSpec font = make_font(style->font_size, style->font_weight, style->font_style == CSS_FONT_STYLE_ITALIC);
+    return text_run_cache_measure((TextRunCache*)user_data, text, length, &font);
+}
+
+void test_layout_measures_runs_once() {
+    printf("Testing layout measures repeated text once...\n");
+    char html[4096] = "<html><body><p id=\"first\">Save draft</p>";
+    for (int i = 1; i < 100; i++) {
+        strcat(html, "<p>Save draft</p>");
+    }
+    strcat(html, "</body></html>");
+
+    DOMDocument* doc = dom_document_create();
+    assert(html_parser_parse(doc, html) == 0);
+    StyleEngine* styles = style_engine_create(doc);
+    const char* css = "* { font-size: 10px; line-height: 20px }";
+    style_engine_add_stylesheet(styles, css_stylesheet_parse(css, strlen(css)));
+    LayoutEngine* layout = layout_engine_create(doc, styles);
+    TextRunCache* cache = text_run_cache_create(0);
+    assert(layout_engine_set_text_measure(layout, measure_with_cache, cache) == 0);
+    assert(layout_engine_layout(layout, 400.0f) == 0);
+
+    // "Save", " " and "draft" are measured once; every other paragraph hits
+    TextRunCacheStats stats;
+    text_run_cache_get_stats(cache, &stats);
+    assert(stats.misses == 3 && stats.runs == 3);
+    assert(stats.hits == 3 * 100 - 3);
+
+    DOMElement* p = dom_document_get_element_by_id(doc, "first");
+    LayoutFragment fragment;
+    assert(layout_engine_get_fragment(layout, p, 0, &fragment) == 0);
+    FontSpec font = make_font(10.0f, 400, 0);
+    assert(fragment.rect.width == text_run_cache_measure(cache, "Save draft", 10, &font));
+
+    layout_engine_destroy(layout);
+    text_run_cache_destroy(cache);
+    style_engine_destroy(styles);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+int main() {
+    printf("Running font tests...\n\n");
+
+    test_builtin_font();
+    test_glyph_cache_hits();
+    test_glyph_cache_eviction();
+    test_draw_text();
+    test_text_run_cache();
+    test_text_run_cache_concurrent();
+    test_layout_measures_runs_once();
+
+    printf("\nAll font tests passed!\n");
+    return 0;
+}
@@ -98,12 +98,134 @@ void test_complex_html() {
     printf("  PASSED\n");
 }
 
+void test_lazy_parsing() {
+    printf("Testing lazy tape-backed parsing...\n");
+
+    DOMDocument* doc = dom_document_create();
+    assert(doc != NULL);
+
+    const char* html =
+        "<!DOCTYPE html>"
+        "<html>"
+        "<body>"
+        "  <ul id=\"list\">"
+        "    <li class=\"item first\">One</li>"
+        "    <li class=\"item\">Two</li>"
+        "  </ul>"
+        "  <div id=\"target\" data-x='1'><span>Deep</span></div>"
+        "</body>"
+        "</html>";
+
+    assert(html_parser_parse_lazy(doc, html) == 0);
+
+    DOMElement* root = dom_document_get_element(doc);
+    assert(root != NULL);
+    assert(strcmp(dom_element_get_tag_name(root), "html") == 0);
+
+    DOMElement* target = dom_document_get_element_by_id(doc, "target");
+    assert(target != NULL);
+    assert(strcmp(dom_element_get_tag_name(target), "div") == 0);
+    assert(strcmp(dom_element_get_attribute(target, "data-x"), "1") == 0);
+
+    // Repeated lookups return the already materialized node
+    assert(dom_document_get_element_by_id(doc, "target") == target);
+
+    DOMElement* span = dom_element_query_selector(target, "span");
+    assert(span != NULL);
+
+    DOMElement* item = dom_element_query_selector(root, ".first");
+    assert(item != NULL);
+    assert(strcmp(dom_element_get_tag_name(item), "li") == 0);
+
+    assert(dom_document_get_element_by_id(doc, "missing") == NULL);
+
+    // A lazy parse needs an empty document
+    assert(html_parser_parse_lazy(doc, "<p></p>") != 0);
+
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+// Compare two trees node by node: type, name and text
+static int trees_equal(DOMNode* a, DOMNode* b) {
+    while (a && b) {
+        if (dom_node_get_type(a) != dom_node_get_type(b)) {
+            return 0;
+        }
+        const char* name_a = dom_node_get_name(a);
+        const char* name_b = dom_node_get_name(b);
+        if ((name_a || name_b) && (!name_a || !name_b || strcmp(name_a, name_b) != 0)) {
+            return 0;
+        }
+        size_t len_a = 0;
+        size_t len_b = 0;
+        const char* value_a = dom_node_get_value(a, &len_a);
+        const char* value_b = dom_node_get_value(b, &len_b);
+        if (len_a != len_b || (len_a > 0 && memcmp(value_a, value_b, len_a) != 0)) {
+            return 0;
+        }
+        if (!trees_equal(dom_node_get_first_child(a), dom_node_get_first_child(b))) {
+            return 0;
+        }
+        a = dom_node_get_next_sibling(a);
+        b = dom_node_get_next_sibling(b);
+    }
+    return a == b;
+}
+
+static int lazy_matches_eager(const char* html) {
+    DOMDocument* eager = dom_document_create();
+    DOMDocument* lazy = dom_document_create();
+    assert(eager != NULL && lazy != NULL);
+    assert(html_parser_parse(eager, html) == 0);
+    assert(html_parser_parse_lazy(lazy, html) == 0);
+
+    int equal = trees_equal(dom_node_get_first_child((DOMNode*)eager), dom_node_get_first_child((DOMNode*)lazy));
+    dom_document_destroy(eager);
+    dom_document_destroy(lazy);
+    return equal;
+}
+
+void test_lazy_matches_eager() {
+    printf("Testing lazy and eager parses build the same tree...\n");
+
+    // A '<' that starts no tag is dropped from the text
+    const char* cases[] = {
+        "<p>1 < 2</p><p>ok</p>",
+        "<div>a <<b>bold</b> c</div>",
+        "<ul><li>x <</li><li>y</li></ul>",
+        "<p>trailing <",
+        "< <p>lead</p>",
+        "<div><!-- note --><br>text<img src=x><span>s</span></div>",
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        assert(lazy_matches_eager(cases[i]));
+    }
+
+    // Random markup built from tags, text and stray '<'
+    const char* pieces[] = { "<p>", "</p>", "<div>", "</div>", "<b>", "</b>", "<br>", "<", " < ", "x", " 1 ", ">" };
+    unsigned int seed = 12345;
+    char html[256];
+    for (int round = 0; round < 2000; round++) {
+        html[0] = '\0';
+        for (int j = 0; j < 12; j++) {
+            seed = seed * 1103515245u + 12345u;
+            strcat(html, pieces[(seed >> 16) % (sizeof(pieces) / sizeof(pieces[0]))]);
+        }
+        assert(lazy_matches_eager(html));
+    }
+
+    printf("  PASSED\n");
+}
+
 int main() {
     printf("Running HTML Parser tests...\n\n");
 
     test_html_parsing();
     test_dom_manipulation_from_js();
     test_complex_html();
+    test_lazy_parsing();
+    test_lazy_matches_eager();
 
     printf("\nAll HTML Parser tests passed!\n");
     return 0;
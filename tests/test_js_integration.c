@@ -1,6 +1,9 @@
 #include "core/engine.h"
 #include "dom/dom.h"
 #include "js/js_engine.h"
+#include "js/bytecode_cache.h"
+#include "js/script_compiler.h"
+#include "js/engine_pool.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -45,11 +48,589 @@ void test_js_errors() {
     printf("  PASSED\n");
 }
 
+void test_js_shared_prototypes() {
+    printf("Testing shared DOM wrapper prototypes...\n");
+
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+
+    assert(browser_engine_load_html(engine, "<html><body><div id=\"app\"><p class=\"x\">Hi</p></div></body></html>") == 0);
+
+    const char* script =
+        "var a = document.createElement('div');"
+        "var b = document.getElementById('app');"
+        "if (a.setAttribute !== b.setAttribute) throw new Error('prototype not shared');"
+        "if (Object.getPrototypeOf(a) !== Object.getPrototypeOf(b)) throw new Error('different prototypes');"
+        "if (b.querySelector('.x') === null) throw new Error('querySelector missing');"
+        "var threw = false;"
+        "try { a.getAttribute.call({}, 'id'); } catch (e) { threw = true; }"
+        "if (!threw) throw new Error('foreign this accepted');";
+    assert(browser_engine_execute_script(engine, script) == 0);
+
+    browser_engine_destroy(engine);
+    printf("  PASSED\n");
+}
+
+void test_js_wrapper_identity() {
+    printf("Testing DOM wrapper identity...\n");
+
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+
+    assert(browser_engine_load_html(engine, "<html><body><div id=\"x\" class=\"c\"></div></body></html>") == 0);
+
+    const char* script =
+        "var a = document.getElementById('x');"
+        "a.expando = 42;"
+        "if (a !== document.getElementById('x')) throw new Error('identity lost');"
+        "if (a !== document.querySelector('.c')) throw new Error('identity lost via querySelector');"
+        "if (document.getElementById('x').expando !== 42) throw new Error('expando lost');"
+        "for (var i = 0; i < 10000; i++) { var e = document.createElement('div'); e.setAttribute('i', '' + i); }";
+    assert(browser_engine_execute_script(engine, script) == 0);
+
+    browser_engine_destroy(engine);
+    printf("  PASSED\n");
+}
+
+void test_js_dom_tree_and_collections() {
+    printf("Testing DOM tree bindings and live collections...\n");
+
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+
+    assert(browser_engine_load_html(engine,
+        "<html><body><ul id=\"list\"><li class=\"a b\">One</li><li class=\"b\">Two</li></ul></body></html>") == 0);
+
+    const char* script =
+        "function check(ok, what) { if (!ok) throw new Error(what); }"
+        "var list = document.getElementById('list');"
+        "var items = list.children;"
+        "var bs = document.getElementsByClassName('b');"
+        "var lis = document.getElementsByTagName('LI');"
+        "check(items.length === 2 && bs.length === 2 && lis.length === 2, 'initial lengths');"
+        "check(items[0] === items.item(0) && items[0].textContent === 'One', 'indexed access');"
+        "check(items[2] === undefined && items.item(2) === null, 'out of range');"
+        "check(document.getElementsByClassName('b a').length === 1, 'class list match');"
+        "check(items[0].nextSibling === items[1] && items[1].previousSibling === items[0], 'siblings');"
+        "check(list.parentNode.tagName === 'BODY' && list.firstChild === items[0], 'parent and first child');"
+        "check(document.documentElement.parentNode === document, 'document parent');"
+        "var li = document.createElement('li');"
+        "li.setAttribute('class', 'b');"
+        "li.textContent = 'Three';"
+        "check(list.appendChild(li) === li && li.parentNode === list, 'appendChild');"
+        "check(items.length === 3 && bs.length === 3 && lis[2] === li, 'collections are live');"
+        "check(list.textContent === 'OneTwoThree', 'textContent');"
+        "list.insertBefore(li, items[0]);"
+        "check(items[0] === li && list.childNodes.length === 3, 'insertBefore');"
+        "list.removeChild(items[1]);"
+        "check(items.length === 2 && li.nextSibling.textContent === 'Two', 'removeChild');"
+        "check(li.firstChild.nodeType === 3 && li.firstChild.nodeName === '#text', 'text nodes');"
+        "var seen = [];"
+        "for (var item of items) seen.push(item.textContent);"
+        "items.forEach(function (item) { seen.push(item.nodeName); });"
+        "check(seen.join() === 'Three,Two,LI,LI', 'iteration');"
+        "var threw = false;"
+        "try { li.appendChild(list); } catch (e) { threw = true; }"
+        "check(threw, 'cycle rejected');";
+    assert(browser_engine_execute_script(engine, script) == 0);
+
+    browser_engine_destroy(engine);
+    printf("  PASSED\n");
+}
+
+void test_js_string_passing() {
+    printf("Testing length-aware strings and cached DOM strings...\n");
+
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+
+    assert(browser_engine_load_html(engine,
+        "<html><body><p id=\"p\" title=\"first\">Hello</p></body></html>") == 0);
+
+    const char* script =
+        "function check(ok, what) { if (!ok) throw new Error(what); }"
+        "var p = document.getElementById('p');"
+        "check(p.getAttribute('title') === 'first' && p.getAttribute('title') === 'first', 'cached read');"
+        "p.setAttribute('title', 'second');"
+        "check(p.getAttribute('title') === 'second', 'stale attribute');"
+        "check(p.textContent === 'Hello' && p.firstChild.textContent === 'Hello', 'cached text');"
+        "p.firstChild.textContent = 'Bye';"
+        "check(p.textContent === 'Bye', 'stale text');"
+        "p.setAttribute('data-raw', 'a\\u0000b');"
+        "check(p.getAttribute('data-raw').length === 3, 'embedded NUL in attribute');"
+        "p.textContent = 'x\\u0000y';"
+        "check(p.textContent === 'x\\u0000y', 'embedded NUL in text');"
+        "check(document.getElementById('p\\u0000') === null, 'id compared by length');";
+    assert(browser_engine_execute_script(engine, script) == 0);
+
+    browser_engine_destroy(engine);
+    printf("  PASSED\n");
+}
+
+void test_js_inner_html() {
+    printf("Testing innerHTML parsing and insertAdjacentHTML...\n");
+
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+
+    assert(browser_engine_load_html(engine, "<html><body><div id=\"app\"></div></body></html>") == 0);
+
+    const char* script =
+        "function check(ok, what) { if (!ok) throw new Error(what); }"
+        "var app = document.getElementById('app');"
+        "app.innerHTML = 'Hi <b class=\"x\">there</b> you';"
+        "check(app.childNodes.length === 3 && app.children.length === 1, 'parsed children');"
+        "check(app.querySelector('.x').textContent === 'there', 'parsed element');"
+        "check(app.textContent === 'Hithereyou', 'text runs kept');"
+        "var b = app.children[0];"
+        "b.insertAdjacentHTML('beforebegin', '<i>1</i>');"
+        "b.insertAdjacentHTML('afterend', '<i>2</i>');"
+        "b.insertAdjacentHTML('afterbegin', '[');"
+        "b.insertAdjacentHTML('beforeEnd', ']');"
+        "check(app.textContent === 'Hi1[there]2you', 'adjacent insertion');"
+        "check(app.getElementsByTagName('i').length === 2, 'adjacent elements');"
+        "var threw = false;"
+        "try { b.insertAdjacentHTML('nowhere', 'x'); } catch (e) { threw = e instanceof SyntaxError; }"
+        "check(threw, 'bad position rejected');"
+        "var t = document.createTextNode('!');"
+        "app.appendChild(t);"
+        "check(t.parentNode === app && app.lastChild === t && app.textContent.slice(-1) === '!', 'createTextNode');"
+        "app.innerHTML = '';"
+        "check(app.firstChild === null && b.parentNode === null, 'cleared');";
+    assert(browser_engine_execute_script(engine, script) == 0);
+
+    browser_engine_destroy(engine);
+    printf("  PASSED\n");
+}
+
+void test_js_bytecode_cache() {
+    printf("Testing bytecode cache reuse across engines...\n");
+
+    JSBytecodeCache* cache = js_bytecode_cache_create(NULL);
+    assert(cache != NULL);
+
+    const char* script = "function lib(n) { return n * 2; } var r = lib(21); if (r !== 42) throw new Error('bad');";
+    for (int i = 0; i < 2; i++) {
+        BrowserEngine* engine = browser_engine_init();
+        assert(engine != NULL);
+        assert(browser_engine_set_bytecode_cache(engine, cache) == 0);
+        assert(browser_engine_execute_script(engine, script) == 0);
+        assert(browser_engine_execute_script(engine, "this is not valid javascript!!!") != 0);
+        browser_engine_destroy(engine);
+    }
+
+    JSBytecodeCacheStats stats;
+    js_bytecode_cache_get_stats(cache, &stats);
+    assert(stats.stores == 1);
+    assert(stats.memory_hits == 1);
+
+    js_bytecode_cache_destroy(cache);
+    printf("  PASSED\n");
+}
+
+void test_js_parallel_script_compile() {
+    printf("Testing off-thread compilation of inline scripts...\n");
+
+    const char* html =
+        "<html><body>"
+        "<script>var order = []; order.push(1);</script>"
+        "<div id=\"a\"></div>"
+        "<script type=\"text/javascript\">if (1 < 2) { order.push(2); }</script>"
+        "<script>this is not valid javascript!!!</script>"
+        "<script type=\"text/template\">order.push(99);</script>"
+        "<script>order.push(document.getElementById('a') ? 3 : -1);</script>"
+        "</body></html>";
+    const char* check = "if (order.join(',') !== '1,2,3') throw new Error(order.join(','));";
+
+    JSCompilePool* pool = js_compile_pool_create(4);
+    assert(pool != NULL);
+
+    // Off-thread and main-thread compilation must agree
+    for (int i = 0; i < 2; i++) {
+        BrowserEngine* engine = browser_engine_init();
+        assert(engine != NULL);
+        assert(browser_engine_set_compile_pool(engine, i == 0 ? pool : NULL) == 0);
+        assert(browser_engine_load_html(engine, html) == 0);
+        assert(browser_engine_execute_script(engine, check) == 0);
+        browser_engine_destroy(engine);
+    }
+
+    // A script that fails to compile off-thread reports its error like an
+    // inline one, and the page's other scripts still run
+    for (int i = 0; i < 2; i++) {
+        BrowserEngine* engine = browser_engine_init();
+        assert(engine != NULL);
+        assert(browser_engine_set_compile_pool(engine, i == 0 ? pool : NULL) == 0);
+        assert(browser_engine_load_html(engine,
+            "<html><body><script>var after = 1;</script><script>var x = ;</script></body></html>") == 0);
+        assert(browser_engine_get_error(engine) != NULL);
+        assert(strstr(browser_engine_get_error(engine), "SyntaxError") != NULL);
+        assert(browser_engine_execute_script(engine, "if (after !== 1) throw new Error('skipped');") == 0);
+        browser_engine_destroy(engine);
+    }
+
+    JSCompileJob* job = js_compile_pool_submit(pool, "var x = ;", 9, "<bad>");
+    assert(job != NULL);
+    assert(js_compile_job_wait(job) == -1);
+    assert(js_compile_job_error(job) != NULL);
+    js_compile_job_free(job);
+
+    js_compile_pool_destroy(pool);
+    printf("  PASSED\n");
+}
+
+void test_js_engine_pool() {
+    printf("Testing pre-warmed JS engine pool...\n");
+
+    JSEnginePool* pool = js_engine_pool_create(2, 2, NULL);
+    assert(pool != NULL);
+
+    for (int i = 0; i < 4; i++) {
+        BrowserEngine* engine = browser_engine_init_with_pool(pool);
+        assert(engine != NULL);
+
+        // Globals from the previous page must not leak into this one
+        assert(browser_engine_execute_script(engine, "if (typeof leaked !== 'undefined') throw new Error('leak');") == 0);
+        assert(browser_engine_execute_script(engine,
+            "var leaked = 1; var el = document.createElement('div'); el.setAttribute('id', 'x');"
+            "if (!(el instanceof Object) || el.getAttribute('id') !== 'x') throw new Error('bad');") == 0);
+        browser_engine_destroy(engine);
+    }
+
+    JSEnginePoolStats stats;
+    js_engine_pool_get_stats(pool, &stats);
+    assert(stats.hits == 4);
+    assert(stats.misses == 0);
+    assert(stats.idle == 2);
+
+    // Hold more engines than the pool keeps
+    BrowserEngine* engines[3];
+    for (int i = 0; i < 3; i++) {
+        engines[i] = browser_engine_init_with_pool(pool);
+        assert(engines[i] != NULL);
+    }
+    for (int i = 0; i < 3; i++) {
+        browser_engine_destroy(engines[i]);
+    }
+    js_engine_pool_get_stats(pool, &stats);
+    assert(stats.misses == 1);
+    assert(stats.discarded == 1);
+    assert(stats.idle == 2);
+
+    js_engine_pool_destroy(pool);
+    printf("  PASSED\n");
+}
+
+void test_js_memory_limits() {
+    printf("Testing JS memory limits and heap statistics...\n");
+
+    JSEngineConfig config = {
+        .memory_limit = 4 * 1024 * 1024,
+        .gc_threshold = 256 * 1024,
+        .max_stack_size = 256 * 1024,
+    };
+    BrowserEngine* engine = browser_engine_init_with_config(&config);
+    assert(engine != NULL);
+
+    JSEngineHeapStats stats;
+    assert(browser_engine_get_heap_stats(engine, &stats) == 0);
+    assert(stats.malloc_limit == (int64_t)config.memory_limit);
+    assert(stats.obj_count > 0);
+    assert(stats.malloc_size > 0 && stats.malloc_size < stats.malloc_limit);
+
+    // Running past the limit fails the script but leaves the engine usable
+    assert(browser_engine_execute_script(engine,
+        "var big = []; for (var i = 0; i < 10000000; i++) big.push({ i: i });") != 0);
+    assert(browser_engine_execute_script(engine, "big = null;") == 0);
+
+    // Runaway recursion hits the stack limit instead of the native stack
+    assert(browser_engine_execute_script(engine, "function f() { return f() + 1; } f();") != 0);
+
+    assert(browser_engine_execute_script(engine, "var cycle = {}; cycle.self = cycle; cycle = null;") == 0);
+    assert(browser_engine_run_gc(engine) == 0);
+    assert(browser_engine_get_heap_stats(engine, &stats) == 0);
+    assert(stats.explicit_gc_count == 1);
+
+    browser_engine_destroy(engine);
+    printf("  PASSED\n");
+}
+
+void test_js_execution_budget() {
+    printf("Testing script execution budgets...\n");
+
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+
+    // Per-eval time budget stops a runaway loop, even one inside try/catch
+    JSEngineBudget budget = { .eval_time_ns = 20 * 1000 * 1000 };
+    assert(browser_engine_set_script_budget(engine, &budget) == 0);
+    assert(browser_engine_execute_script(engine, "try { for (;;) {} } catch (e) {}") == JS_ENGINE_BUDGET_EXCEEDED);
+    assert(browser_engine_execute_script(engine, "var ok = 1 + 1;") == 0);
+
+    // Per-eval instruction budget
+    budget = (JSEngineBudget){ .eval_instructions = 1000000 };
+    assert(browser_engine_set_script_budget(engine, &budget) == 0);
+    assert(browser_engine_execute_script(engine, "while (true) {}") == JS_ENGINE_BUDGET_EXCEEDED);
+    assert(browser_engine_execute_script(engine, "for (var i = 0; i < 1000; i++) {}") == 0);
+
+    // Page budget is shared by all evals until the next page load
+    budget = (JSEngineBudget){ .page_instructions = 1000000 };
+    assert(browser_engine_set_script_budget(engine, &budget) == 0);
+    assert(browser_engine_load_html(engine, "<html><body></body></html>") == 0);
+    assert(browser_engine_execute_script(engine, "while (true) {}") == JS_ENGINE_BUDGET_EXCEEDED);
+    assert(browser_engine_execute_script(engine, "var x = 1;") == JS_ENGINE_BUDGET_EXCEEDED);
+    assert(browser_engine_load_html(engine, "<html><body></body></html>") == 0);
+    assert(browser_engine_execute_script(engine, "var x = 1;") == 0);
+
+    assert(browser_engine_set_script_budget(engine, NULL) == 0);
+    browser_engine_destroy(engine);
+    printf("  PASSED\n");
+}
+
+void test_js_event_loop() {
+    printf("Testing event loop with virtual time...\n");
+
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+
+    // Microtasks drain after the script, before any timer
+    assert(browser_engine_execute_script(engine,
+        "var log = [];"
+        "setTimeout(function (tag) { log.push(tag); }, 100, 't100');"
+        "setTimeout(function () { log.push('t10'); }, 10);"
+        "var cancelled = setTimeout(function () { log.push('never'); }, 5);"
+        "clearTimeout(cancelled);"
+        "Promise.resolve().then(function () { log.push('promise'); });"
+        "queueMicrotask(function () { log.push('micro'); });") == 0);
+    assert(browser_engine_execute_script(engine,
+        "if (log.join(',') !== 'promise,micro') throw new Error(log.join(','));") == 0);
+
+    // Advancing time runs only what falls due
+    assert(browser_engine_advance_time(engine, 50) == 0);
+    assert(browser_engine_execute_script(engine,
+        "if (log.join(',') !== 'promise,micro,t10') throw new Error(log.join(','));") == 0);
+    assert(browser_engine_run_until_idle(engine, 1000) == 0);
+    assert(browser_engine_execute_script(engine,
+        "if (log.join(',') !== 'promise,micro,t10,t100') throw new Error(log.join(','));") == 0);
+
+    // Intervals repeat until they clear themselves; frames get a timestamp
+    assert(browser_engine_execute_script(engine,
+        "var ticks = 0; var frameTime = -1;"
+        "var iv = setInterval(function () { if (++ticks === 3) clearInterval(iv); }, 20);"
+        "requestAnimationFrame(function (t) { frameTime = t; });") == 0);
+    assert(browser_engine_run_until_idle(engine, 1000) == 0);
+    assert(browser_engine_execute_script(engine,
+        "if (ticks !== 3 || frameTime <= 0) throw new Error(ticks + ' ' + frameTime);") == 0);
+
+    // A page that never settles reports pending work at the timeout
+    assert(browser_engine_execute_script(engine,
+        "(function spin() { setTimeout(spin, 0); })();") == 0);
+    assert(browser_engine_run_until_idle(engine, 1000) == 1);
+
+    browser_engine_destroy(engine);
+    printf("  PASSED\n");
+}
+
+void test_js_profiler() {
+    printf("Testing sampling JS profiler...\n");
+
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+
+    assert(browser_engine_profiler_start(engine, 200) == 0);
+    assert(browser_engine_profiler_start(engine, 200) != 0);
+    assert(browser_engine_execute_script(engine,
+        "function hot(n) { var s = 0; for (var i = 0; i < n; i++) s += i % 7; return s; }"
+        "function outer() { var end = Date.now() + 200; while (Date.now() < end) hot(10000); }"
+        "outer();") == 0);
+    assert(browser_engine_profiler_stop(engine) == 0);
+
+    char* collapsed = browser_engine_profiler_export(engine, 0);
+    assert(collapsed != NULL);
+    assert(strstr(collapsed, "outer;hot ") != NULL);
+    free(collapsed);
+
+    char* json = browser_engine_profiler_export(engine, 1);
+    assert(json != NULL);
+    assert(strstr(json, "\"name\":\"hot\"") != NULL);
+    assert(strstr(json, "\"samples\":0") == NULL);
+    free(json);
+
+    browser_engine_destroy(engine);
+
+    // Samples never run page code, even with the global Error replaced
+    engine = browser_engine_init();
+    assert(engine != NULL);
+    assert(browser_engine_profiler_start(engine, 200) == 0);
+    assert(browser_engine_execute_script(engine,
+        "var called = 0; Error = function () { called++; };"
+        "function hot(n) { var s = 0; for (var i = 0; i < n; i++) s += i % 7; return s; }"
+        "var end = Date.now() + 100; while (Date.now() < end) hot(10000);") == 0);
+    assert(browser_engine_profiler_stop(engine) == 0);
+    assert(browser_engine_execute_script(engine, "if (called !== 0) throw new TypeError(called);") == 0);
+    collapsed = browser_engine_profiler_export(engine, 0);
+    assert(collapsed != NULL);
+    assert(strstr(collapsed, "hot ") != NULL);
+    free(collapsed);
+
+    browser_engine_destroy(engine);
+    printf("  PASSED\n");
+}
+
+typedef struct {
+    int calls;
+    int levels[8];
+    char text[256];
+} ConsoleCapture;
+
+static void capture_console(JSConsoleLevel level, const char* message, size_t length, void* user_data) {
+    ConsoleCapture* capture = (ConsoleCapture*)user_data;
+    if (capture->calls < 8) {
+        capture->levels[capture->calls] = level;
+    }
+    capture->calls++;
+    strncat(capture->text, message, length);
+    strcat(capture->text, "|");
+}
+
+void test_js_console_sink() {
+    printf("Testing buffered console sink...\n");
+
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+
+    ConsoleCapture capture;
+    memset(&capture, 0, sizeof(capture));
+    assert(browser_engine_set_console_sink(engine, capture_console, &capture, 64) == 0);
+
+    // Delivered as one batch when the script ends
+    assert(browser_engine_execute_script(engine,
+        "console.log('a', 1); console.warn('w'); console.error('e'); console.debug('d');") == 0);
+    assert(capture.calls == 4);
+    assert(strcmp(capture.text, "a 1|w|e|d|") == 0);
+    assert(capture.levels[0] == JS_CONSOLE_LOG);
+    assert(capture.levels[1] == JS_CONSOLE_WARN);
+    assert(capture.levels[2] == JS_CONSOLE_ERROR);
+    assert(capture.levels[3] == JS_CONSOLE_DEBUG);
+
+    // Messages past the buffer are dropped and counted
+    memset(&capture, 0, sizeof(capture));
+    assert(browser_engine_execute_script(engine,
+        "for (var i = 0; i < 10; i++) console.log('0123456789');") == 0);
+    assert(capture.calls == 5);
+    assert(browser_engine_console_dropped(engine) == 5);
+
+    browser_engine_destroy(engine);
+
+    // A pooled engine forgets the previous page's sink
+    JSEnginePool* pool = js_engine_pool_create(1, 1, NULL);
+    assert(pool != NULL);
+    engine = browser_engine_init_with_pool(pool);
+    assert(engine != NULL);
+    memset(&capture, 0, sizeof(capture));
+    assert(browser_engine_set_console_sink(engine, capture_console, &capture, 64) == 0);
+    assert(browser_engine_execute_script(engine, "console.log('first page');") == 0);
+    browser_engine_destroy(engine);
+
+    engine = browser_engine_init_with_pool(pool);
+    assert(engine != NULL);
+    assert(browser_engine_execute_script(engine, "console.log('second page');") == 0);
+    assert(capture.calls == 1);
+    assert(browser_engine_console_dropped(engine) == 0);
+    browser_engine_destroy(engine);
+    js_engine_pool_destroy(pool);
+
+    printf("  PASSED\n");
+}
+
+typedef struct {
+    int loads;
+} ModuleStore;
+
+static char* provide_module(const char* module_name, size_t* length, void* user_data) {
+    ModuleStore* store = (ModuleStore*)user_data;
+    const char* source = NULL;
+
+    if (strcmp(module_name, "lib/math.js") == 0) {
+        source = "import { base } from './base.js'; export function triple(n) { return n * base; }";
+    } else if (strcmp(module_name, "lib/base.js") == 0) {
+        source = "export const base = 3;";
+    }
+    if (!source) {
+        return NULL;
+    }
+
+    store->loads++;
+    *length = strlen(source);
+    char* copy = (char*)malloc(*length + 1);
+    memcpy(copy, source, *length + 1);
+    return copy;
+}
+
+void test_js_modules() {
+    printf("Testing ES module loading and module bytecode reuse...\n");
+
+    JSBytecodeCache* cache = js_bytecode_cache_create(NULL);
+    assert(cache != NULL);
+    ModuleStore store = { 0 };
+
+    const char* entry = "import { triple } from './lib/math.js'; globalThis.result = triple(14);";
+    for (int i = 0; i < 2; i++) {
+        BrowserEngine* engine = browser_engine_init();
+        assert(engine != NULL);
+        assert(browser_engine_set_bytecode_cache(engine, cache) == 0);
+        assert(browser_engine_set_module_provider(engine, provide_module, &store) == 0);
+        assert(browser_engine_execute_module(engine, entry, "main.js") == 0);
+        assert(browser_engine_execute_script(engine, "if (result !== 42) throw new Error(result);") == 0);
+        assert(browser_engine_execute_module(engine, "import './missing.js';", "main2.js") != 0);
+        browser_engine_destroy(engine);
+    }
+    assert(store.loads == 4);
+
+    // The entry module, both dependencies and the check script are compiled
+    // by the first engine and read back by the second; main2.js fails to
+    // compile, so it is never stored
+    JSBytecodeCacheStats stats;
+    js_bytecode_cache_get_stats(cache, &stats);
+    assert(stats.stores == 4);
+    assert(stats.memory_hits == 4);
+
+    // Inline module scripts run after classic scripts
+    BrowserEngine* engine = browser_engine_init();
+    assert(engine != NULL);
+    assert(browser_engine_set_module_provider(engine, provide_module, &store) == 0);
+    assert(browser_engine_load_html(engine,
+        "<html><body>"
+        "<script type=\"module\">import { triple } from './lib/math.js'; order.push(triple(1));</script>"
+        "<script>var order = ['classic'];</script>"
+        "</body></html>") == 0);
+    assert(browser_engine_execute_script(engine,
+        "if (order.join(',') !== 'classic,3') throw new Error(order.join(','));") == 0);
+    browser_engine_destroy(engine);
+
+    js_bytecode_cache_destroy(cache);
+    printf("  PASSED\n");
+}
+
 int main() {
     printf("Running JavaScript Integration tests...\n\n");
 
     test_js_dom_integration();
     test_js_errors();
+    test_js_shared_prototypes();
+    test_js_wrapper_identity();
+    test_js_dom_tree_and_collections();
+    test_js_string_passing();
+    test_js_inner_html();
+    test_js_bytecode_cache();
+    test_js_parallel_script_compile();
+    test_js_engine_pool();
+    test_js_memory_limits();
+    test_js_execution_budget();
+    test_js_event_loop();
+    test_js_profiler();
+    test_js_console_sink();
+    test_js_modules();
 
     printf("\nAll JavaScript Integration tests passed!\n");
     return 0;
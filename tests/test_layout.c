@@ -0,0 +1,423 @@
+#include "layout/layout.h"
+#include "css/stylesheet.h"
+#include "css/style.h"
+#include "core/thread_pool.h"
+#include "dom/dom.h"
+#include "html/parser.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+typedef struct {
+    DOMDocument* doc;
+    StyleEngine* styles;
+    LayoutEngine* layout;
+} Page;
+
+// Parse a body with one author stylesheet and lay it out. With the built-in
+// metrics and 10px text every character is 5px wide.
+static Page layout_page(const char* body, const char* css, float width) {
+    Page page;
+    page.doc = dom_document_create();
+    assert(page.doc != NULL);
+    size_t size = strlen(body) + 32;
+    char* html = (char*)malloc(size);
+    assert(html != NULL);
+    snprintf(html, size, "<html><body>%s</body></html>", body);
+    assert(html_parser_parse(page.doc, html) == 0);
+    free(html);
+    page.styles = style_engine_create(page.doc);
+    assert(page.styles != NULL);
+    CSSStylesheet* sheet = css_stylesheet_parse(css, strlen(css));
+    assert(sheet != NULL);
+    assert(style_engine_add_stylesheet(page.styles, sheet) == 0);
+    page.layout = layout_engine_create(page.doc, page.styles);
+    assert(page.layout != NULL);
+    assert(layout_engine_layout(page.layout, width) == 0);
+    return page;
+}
+
+static void destroy_page(Page* page) {
+    layout_engine_destroy(page->layout);
+    style_engine_destroy(page->styles);
+    dom_document_destroy(page->doc);
+}
+
+static LayoutGeometry geometry_of(Page* page, const char* id) {
+    LayoutGeometry geometry;
+    DOMElement* element = dom_document_get_element_by_id(page->doc, id);
+    assert(element != NULL);
+    assert(layout_engine_get_geometry(page->layout, element, &geometry) == 0);
+    return geometry;
+}
+
+static LayoutFragment fragment_of(Page* page, const char* id, size_t index) {
+    LayoutFragment fragment;
+    DOMElement* element = dom_document_get_element_by_id(page->doc, id);
+    assert(element != NULL);
+    assert(layout_engine_get_fragment(page->layout, element, index, &fragment) == 0);
+    return fragment;
+}
+
+static size_t fragment_count(Page* page, const char* id) {
+    return layout_engine_get_fragment_count(page->layout, dom_document_get_element_by_id(page->doc, id));
+}
+
+static int near(float a, float b) {
+    return a - b < 0.01f && b - a < 0.01f;
+}
+
+#define BASE_CSS "body { margin: 0 } p { margin: 0 } * { font-size: 10px; line-height: 20px }"
+
+void test_block_layout() {
+    printf("Testing block layout...\n");
+
+    Page page = layout_page(
+        "<div id=\"a\"></div><div id=\"b\"></div><div id=\"c\"></div><div id=\"d\"></div>"
+        "<div hidden><div id=\"e\"></div></div>",
+        BASE_CSS
+        "div { height: 10px }"
+        "#a { margin-bottom: 20px }"
+        "#b { margin-top: 30px; padding: 5px; border: 2px solid black }"
+        "#c { width: 50%; margin: 0 auto }"
+        "#d { width: 40px; margin-left: auto; margin-top: -4px }",
+        200.0f);
+
+    LayoutGeometry a = geometry_of(&page, "a");
+    assert(near(a.border_box.x, 0) && near(a.border_box.y, 0));
+    assert(near(a.border_box.width, 200) && near(a.border_box.height, 10));
+
+    // Adjacent margins collapse to the larger one
+    LayoutGeometry b = geometry_of(&page, "b");
+    assert(near(b.border_box.y, 40));
+    assert(near(b.border_box.width, 200) && near(b.border_box.height, 24));
+    assert(near(b.content_box.x, 7) && near(b.content_box.y, 47));
+    assert(near(b.content_box.width, 186) && near(b.content_box.height, 10));
+    assert(near(b.padding[0], 5) && near(b.border[3], 2) && near(b.margin[0], 30));
+
+    // Percentages resolve against the containing block; auto margins centre
+    LayoutGeometry c = geometry_of(&page, "c");
+    assert(near(c.border_box.x, 50) && near(c.border_box.width, 100));
+    assert(near(c.border_box.y, 64));
+
+    // A negative margin pulls the box up; a lone auto margin pushes it over
+    LayoutGeometry d = geometry_of(&page, "d");
+    assert(near(d.border_box.x, 160) && near(d.border_box.y, 70));
+    assert(near(layout_engine_get_document_height(page.layout), 80));
+
+    // Elements without a box
+    LayoutGeometry geometry;
+    assert(layout_engine_get_geometry(page.layout, dom_document_get_element_by_id(page.doc, "e"), &geometry) == -1);
+    DOMElement* detached = dom_document_create_element(page.doc, "div");
+    assert(layout_engine_get_geometry(page.layout, detached, &geometry) == -1);
+    assert(dom_node_release((DOMNode*)detached) == 1);
+
+    destroy_page(&page);
+    printf("  PASSED\n");
+}
+
+void test_line_breaking() {
+    printf("Testing line breaking...\n");
+
+    Page page = layout_page(
+        "<p id=\"wrap\">  aaaa   bbbb\ncccc </p>"
+        "<p id=\"center\">ab</p>"
+        "<p id=\"right\">ab</p>"
+        "<p id=\"br\">a<br>b</p>"
+        "<pre id=\"pre\">x  y\nz</pre>"
+        "<p id=\"nowrap\">aaaa bbbb cccc</p>",
+        BASE_CSS
+        "p { width: 60px }"
+        "pre { margin: 0 }"
+        "#center { text-align: center }"
+        "#right { text-align: right }"
+        "#nowrap { white-space: nowrap }",
+        200.0f);
+
+    // Whitespace collapses and the space a line breaks at is dropped
+    assert(fragment_count(&page, "wrap") == 2);
+    LayoutFragment first = fragment_of(&page, "wrap", 0);
+    assert(first.length == 9 && memcmp(first.text, "aaaa bbbb", 9) == 0);
+    assert(near(first.rect.x, 0) && near(first.rect.width, 45));
+    assert(first.line == 0);
+    LayoutFragment second = fragment_of(&page, "wrap", 1);
+    assert(second.length == 4 && memcmp(second.text, "cccc", 4) == 0);
+    assert(second.line == 1);
+    assert(near(second.rect.y - first.rect.y, 20));
+    assert(near(geometry_of(&page, "wrap").border_box.height, 40));
+
+    assert(near(fragment_of(&page, "center", 0).rect.x, 25));
+    assert(near(fragment_of(&page, "right", 0).rect.x, 50));
+
+    // <br> forces a break
+    assert(fragment_count(&page, "br") == 2);
+    assert(fragment_of(&page, "br", 1).line == 1);
+
+    // pre keeps spaces and newlines
+    assert(fragment_count(&page, "pre") == 2);
+    LayoutFragment pre = fragment_of(&page, "pre", 0);
+    assert(pre.length == 4 && memcmp(pre.text, "x  y", 4) == 0);
+    assert(fragment_of(&page, "pre", 1).line == 1);
+
+    // nowrap overflows instead of breaking
+    assert(fragment_count(&page, "nowrap") == 1);
+    assert(near(fragment_of(&page, "nowrap", 0).rect.width, 70));
+
+    destroy_page(&page);
+    printf("  PASSED\n");
+}
+
+void test_inline_boxes() {
+    printf("Testing inline boxes...\n");
+
+    Page page = layout_page(
+        "<p id=\"p\">aa<b id=\"bold\">bb cc</b><span id=\"ib\">xyz</span></p>"
+        "<p id=\"mixed\">before<div id=\"inner\">block</div>after</p>",
+        BASE_CSS
+        "#ib { display: inline-block; padding: 2px }"
+        "#mixed { display: block }",
+        200.0f);
+
+    // Inline elements span their fragments
+    LayoutGeometry bold = geometry_of(&page, "bold");
+    assert(near(bold.border_box.x, 10) && near(bold.border_box.width, 25));
+
+    // Inline-blocks shrink to fit and sit on the baseline
+    LayoutGeometry ib = geometry_of(&page, "ib");
+    assert(near(ib.border_box.x, 35) && near(ib.border_box.width, 19));
+    assert(near(ib.border_box.height, 24));
+    size_t count = fragment_count(&page, "p");
+    LayoutFragment box = fragment_of(&page, "p", count - 1);
+    assert(box.text == NULL && box.node == (DOMNode*)dom_document_get_element_by_id(page.doc, "ib"));
+
+    // Inline content around a block is stacked in lines above and below it
+    LayoutGeometry inner = geometry_of(&page, "inner");
+    LayoutGeometry mixed = geometry_of(&page, "mixed");
+    assert(near(inner.border_box.y - mixed.border_box.y, 20));
+    assert(near(inner.border_box.height, 20));
+    assert(near(mixed.border_box.height, 60));
+    assert(fragment_count(&page, "mixed") == 2);
+    assert(fragment_of(&page, "mixed", 1).line == 1);
+
+    destroy_page(&page);
+    printf("  PASSED\n");
+}
+
+static float wide_measure(const char* text, size_t length, const ComputedStyle* style, void* user_data) {
+    (*(int*)user_data)++;
+    return (float)length * style->font_size;
+}
+
+void test_incremental_layout() {
+    printf("Testing incremental layout...\n");
+
+    // Twenty sections of five paragraphs
+    size_t size = 20 * 200 + 64;
+    char* html = (char*)malloc(size);
+    assert(html != NULL);
+    size_t used = 0;
+    for (int s = 0; s < 20; s++) {
+        used += (size_t)snprintf(html + used, size - used, "<div>");
+        for (int p = 0; p < 5; p++) {
+            used += (size_t)snprintf(html + used, size - used, "<p id=\"p%d\">paragraph %d</p>", s * 5 + p, p);
+        }
+        used += (size_t)snprintf(html + used, size - used, "</div>");
+    }
+    Page page = layout_page(html, BASE_CSS ".wide { width: 50px }", 400.0f);
+    free(html);
+
+    LayoutStats stats;
+    assert(layout_engine_get_stats(page.layout, &stats) == 0);
+    assert(stats.boxes_laid_out == 122);     // html, body, 20 divs, 100 paragraphs
+    assert(stats.boxes_reused == 0);
+    assert(stats.lines == 100);
+
+    // Nothing changed
+    assert(layout_engine_layout(page.layout, 400.0f) == 0);
+    assert(layout_engine_get_stats(page.layout, &stats) == 0);
+    assert(stats.boxes_laid_out == 0 && stats.lines == 0);
+
+    // A text change lays out the path to the root; the siblings on that
+    // path keep their boxes and just move
+    float below = geometry_of(&page, "p99").border_box.y;
+    DOMElement* target = dom_document_get_element_by_id(page.doc, "p42");
+    assert(dom_node_set_text_content((DOMNode*)target, "a much longer paragraph that wraps") == 0);
+    LayoutGeometry geometry;
+    assert(layout_engine_get_geometry(page.layout, target, &geometry) == -1);
+    assert(layout_engine_layout(page.layout, 400.0f) == 0);
+    assert(layout_engine_get_stats(page.layout, &stats) == 0);
+    assert(stats.boxes_laid_out == 4);       // html, body, div, p42
+    assert(stats.boxes_reused == 19 + 4);    // Other divs, other paragraphs in the div
+    assert(stats.lines == 1);
+    assert(near(geometry_of(&page, "p99").border_box.y, below));
+
+    // A narrower box wraps and pushes later boxes down
+    assert(dom_element_set_attribute(target, "class", "wide") == 0);
+    assert(layout_engine_layout(page.layout, 400.0f) == 0);
+    assert(layout_engine_get_stats(page.layout, &stats) == 0);
+    assert(stats.boxes_laid_out == 4 && stats.lines > 1);
+    assert(geometry_of(&page, "p99").border_box.y > below);
+    assert(fragment_count(&page, "p42") == stats.lines);
+
+    // A new viewport width changes every containing block
+    assert(layout_engine_layout(page.layout, 300.0f) == 0);
+    assert(layout_engine_get_stats(page.layout, &stats) == 0);
+    assert(stats.boxes_laid_out == 122 && stats.boxes_reused == 0);
+    assert(near(geometry_of(&page, "p0").border_box.width, 300));
+
+    // A new measure function lays everything out again
+    int calls = 0;
+    assert(layout_engine_set_text_measure(page.layout, wide_measure, &calls) == 0);
+    assert(layout_engine_layout(page.layout, 300.0f) == 0);
+    assert(layout_engine_get_stats(page.layout, &stats) == 0);
+    assert(stats.boxes_laid_out == 122 && calls > 0);
+    LayoutFragment fragment = fragment_of(&page, "p0", 0);
+    assert(near(fragment.rect.width, 110));  // "paragraph 0" at 10px per character
+
+    destroy_page(&page);
+    printf("  PASSED\n");
+}
+
+static void assert_same_layout(LayoutEngine* a, DOMNode* x, LayoutEngine* b, DOMNode* y) {
+    for (; x || y; x = dom_node_get_next_sibling(x), y = dom_node_get_next_sibling(y)) {
+        assert(x && y && dom_node_get_type(x) == dom_node_get_type(y));
+        if (dom_node_get_type(x) == NODE_ELEMENT) {
+            LayoutGeometry ga, gb;
+            int result = layout_engine_get_geometry(a, (DOMElement*)x, &ga);
+            assert(layout_engine_get_geometry(b, (DOMElement*)y, &gb) == result);
+            assert(result != 0 || memcmp(&ga, &gb, sizeof(LayoutGeometry)) == 0);
+
+            size_t count = layout_engine_get_fragment_count(a, (DOMElement*)x);
+            assert(layout_engine_get_fragment_count(b, (DOMElement*)y) == count);
+            for (size_t i = 0; i < count; i++) {
+                LayoutFragment fa, fb;
+                assert(layout_engine_get_fragment(a, (DOMElement*)x, i, &fa) == 0);
+                assert(layout_engine_get_fragment(b, (DOMElement*)y, i, &fb) == 0);
+                assert(memcmp(&fa.rect, &fb.rect, sizeof(LayoutRect)) == 0);
+                assert(fa.length == fb.length && fa.line == fb.line);
+                assert(fa.length == 0 || memcmp(fa.text, fb.text, fa.length) == 0);
+            }
+        }
+        assert_same_layout(a, dom_node_get_first_child(x), b, dom_node_get_first_child(y));
+    }
+}
+
+void test_parallel_layout() {
+    printf("Testing parallel layout...\n");
+
+    // Sections of wrapped text, lists and inline-blocks
+    size_t size = 300 * 256 + 32;
+    char* html = (char*)malloc(size);
+    assert(html != NULL);
+    size_t used = (size_t)snprintf(html, size, "<html><body>");
+    for (int s = 0; s < 300; s++) {
+        used += (size_t)snprintf(html + used, size - used,
+                                 "<section id=\"s%d\"><h2>title %d</h2><p>some words that wrap %s</p>"
+                                 "<ul><li>one</li><li><span class=\"ib\">two</span> three</li></ul></section>",
+                                 s, s, s % 2 ? "over a narrow column of text" : "");
+    }
+    snprintf(html + used, size - used, "</body></html>");
+    const char* css = BASE_CSS "section { margin: 6px 10% } .ib { display: inline-block; padding: 1px }";
+    ThreadPool* pool = thread_pool_create(4);
+    assert(pool != NULL);
+
+    // A single-threaded reference, a parallel engine, and a parallel
+    // engine over a lazily parsed document
+    DOMDocument* docs[3];
+    StyleEngine* styles[3];
+    LayoutEngine* layouts[3];
+    LayoutStats stats[3];
+    for (int i = 0; i < 3; i++) {
+        docs[i] = dom_document_create();
+        assert(docs[i] != NULL);
+        assert((i == 2 ? html_parser_parse_lazy(docs[i], html) : html_parser_parse(docs[i], html)) == 0);
+        styles[i] = style_engine_create(docs[i]);
+        assert(styles[i] != NULL);
+        assert(style_engine_add_stylesheet(styles[i], css_stylesheet_parse(css, strlen(css))) == 0);
+        layouts[i] = layout_engine_create(docs[i], styles[i]);
+        assert(layouts[i] != NULL);
+        if (i > 0) {
+            assert(style_engine_set_thread_pool(styles[i], pool) == 0);
+            assert(layout_engine_set_thread_pool(layouts[i], pool) == 0);
+        }
+        assert(layout_engine_layout(layouts[i], 180.0f) == 0);
+        assert(layout_engine_get_stats(layouts[i], &stats[i]) == 0);
+    }
+    assert(stats[0].boxes_laid_out == 2 + 300 * 7);
+    for (int i = 1; i < 3; i++) {
+        assert(memcmp(&stats[i], &stats[0], sizeof(LayoutStats)) == 0);
+        assert(layout_engine_get_document_height(layouts[i]) == layout_engine_get_document_height(layouts[0]));
+        assert_same_layout(layouts[0], (DOMNode*)docs[0], layouts[i], (DOMNode*)docs[i]);
+    }
+
+    // A text change and a new viewport width
+    for (int i = 0; i < 3; i++) {
+        DOMElement* section = dom_document_get_element_by_id(docs[i], "s150");
+        assert(dom_node_set_text_content(dom_node_get_first_child((DOMNode*)section), "a longer title that wraps") == 0);
+        assert(layout_engine_layout(layouts[i], 180.0f) == 0);
+        assert(layout_engine_get_stats(layouts[i], &stats[i]) == 0);
+        assert(stats[i].boxes_laid_out == 4);
+    }
+    for (int i = 0; i < 3; i++) {
+        assert(layout_engine_layout(layouts[i], 240.0f) == 0);
+        assert(layout_engine_get_stats(layouts[i], &stats[i]) == 0);
+    }
+    for (int i = 1; i < 3; i++) {
+        assert(memcmp(&stats[i], &stats[0], sizeof(LayoutStats)) == 0);
+        assert_same_layout(layouts[0], (DOMNode*)docs[0], layouts[i], (DOMNode*)docs[i]);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        layout_engine_destroy(layouts[i]);
+        style_engine_destroy(styles[i]);
+        dom_document_destroy(docs[i]);
+    }
+    thread_pool_destroy(pool);
+    free(html);
+    printf("  PASSED\n");
+}
+
+void test_emptied_inline_box() {
+    printf("Testing inline elements that lose their fragments...\n");
+
+    const char* css = BASE_CSS ".gone { display: none }";
+
+    // Text cleared
+    Page page = layout_page("<p>x <span id=\"s\">hello</span></p>", css, 400.0f);
+    DOMElement* span = dom_document_get_element_by_id(page.doc, "s");
+    assert(dom_node_set_text_content((DOMNode*)span, "") == 0);
+    assert(layout_engine_layout(page.layout, 400.0f) == 0);
+    Page fresh = layout_page("<p>x <span id=\"s\"></span></p>", css, 400.0f);
+    assert_same_layout(page.layout, (DOMNode*)page.doc, fresh.layout, (DOMNode*)fresh.doc);
+    LayoutGeometry geometry = geometry_of(&page, "s");
+    assert(geometry.border_box.width == 0.0f && geometry.border_box.height == 0.0f);
+    destroy_page(&page);
+    destroy_page(&fresh);
+
+    // Only child hidden
+    page = layout_page("<p>x <span id=\"s\"><b id=\"b\">hello</b></span></p>", css, 400.0f);
+    DOMElement* bold = dom_document_get_element_by_id(page.doc, "b");
+    assert(dom_element_set_attribute(bold, "class", "gone") == 0);
+    assert(layout_engine_layout(page.layout, 400.0f) == 0);
+    fresh = layout_page("<p>x <span id=\"s\"><b id=\"b\" class=\"gone\">hello</b></span></p>", css, 400.0f);
+    assert_same_layout(page.layout, (DOMNode*)page.doc, fresh.layout, (DOMNode*)fresh.doc);
+    destroy_page(&page);
+    destroy_page(&fresh);
+
+    printf("  PASSED\n");
+}
+
+int main() {
+    printf("Running layout tests...\n\n");
+
+    test_block_layout();
+    test_line_breaking();
+    test_inline_boxes();
+    test_incremental_layout();
+    test_parallel_layout();
+    test_emptied_inline_box();
+
+    printf("\nAll layout tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include "rendering/pixel_ops.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define MAX_PIXELS 263
+
+static const PixelISA all_isas[] = { PIXEL_ISA_SCALAR, PIXEL_ISA_SSE2, PIXEL_ISA_AVX2 };
+
+static unsigned int seed = 12345;
+
+static uint8_t random_byte(void) {
+    seed = seed * 1103515245u + 12345u;
+    return (uint8_t)(seed >> 16);
+}
+
+static void random_bytes(uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        data[i] = random_byte();
+    }
+}
+
+// Premultiplied pixels never have a color channel above alpha
+static void random_premultiplied(uint8_t* data, size_t count) {
+    random_bytes(data, count * 4);
+    pixel_ops_set_isa(PIXEL_ISA_SCALAR);
+    pixel_premultiply(data, data, count);
+}
+
+void test_known_values() {
+    printf("Testing known pixel values...\n");
+
+    assert(pixel_ops_set_isa(PIXEL_ISA_SCALAR) == 0);
+    assert(strcmp(pixel_ops_isa_name(PIXEL_ISA_AVX2), "avx2") == 0);
+
+    uint8_t pixels[8];
+    uint8_t red[4] = { 255, 0, 0, 255 };
+    pixel_fill(pixels, 2, red);
+    assert(pixels[4] == 255 && pixels[5] == 0 && pixels[7] == 255);
+
+    // Half-transparent blue over opaque red
+    uint8_t blue[4] = { 0, 0, 128, 128 };
+    pixel_blend_solid(pixels, 2, blue);
+    assert(pixels[0] == 127 && pixels[1] == 0 && pixels[2] == 128 && pixels[3] == 255);
+
+    // Zero coverage leaves the destination alone; full coverage is a plain blend
+    uint8_t mask[2] = { 0, 255 };
+    uint8_t white[4] = { 255, 255, 255, 255 };
+    pixel_blend_mask(pixels, mask, 2, white);
+    assert(pixels[0] == 127 && pixels[4] == 255 && pixels[5] == 255);
+
+    uint8_t straight[4] = { 200, 100, 50, 128 };
+    pixel_premultiply(pixels, straight, 1);
+    assert(pixels[0] == 100 && pixels[1] == 50 && pixels[2] == 25 && pixels[3] == 128);
+
+    pixel_swap_rb(pixels, straight, 1);
+    assert(pixels[0] == 50 && pixels[1] == 100 && pixels[2] == 200 && pixels[3] == 128);
+
+    uint8_t rgb[3];
+    pixel_rgba_to_rgb(rgb, straight, 1);
+    assert(rgb[0] == 200 && rgb[1] == 100 && rgb[2] == 50);
+    pixel_rgb_to_rgba(pixels, rgb, 1);
+    assert(pixels[0] == 200 && pixels[2] == 50 && pixels[3] == 255);
+
+    // 2x1 black-to-white scaled to 4x1: edges clamp, middle interpolates
+    uint8_t source[8] = { 0, 0, 0, 255, 255, 255, 255, 255 };
+    uint8_t scaled[16];
+    pixel_scale_bilinear(scaled, 16, 0, 0, 4, 1, 4, 1, source, 2, 1, 8);
+    assert(scaled[0] == 0 && scaled[3] == 255);
+    assert(scaled[4] == 64 && scaled[8] == 191);
+    assert(scaled[12] == 255);
+
+    // A window matches the same pixels of the full image
+    uint8_t window[8];
+    pixel_scale_bilinear(window, 8, 1, 0, 2, 1, 4, 1, source, 2, 1, 8);
+    assert(memcmp(window, scaled + 4, 8) == 0);
+
+    printf("  PASSED\n");
+}
+
+void test_isa_selection() {
+    printf("Testing instruction set selection...\n");
+
+    PixelISA original = pixel_ops_get_isa();
+    assert(pixel_ops_set_isa(PIXEL_ISA_SCALAR) == 0);
+    assert(pixel_ops_get_isa() == PIXEL_ISA_SCALAR);
+    assert(pixel_ops_set_isa((PixelISA)42) == -1);
+    assert(pixel_ops_get_isa() == PIXEL_ISA_SCALAR);
+    assert(pixel_ops_set_isa(original) == 0);
+    printf("  Default: %s\n", pixel_ops_isa_name(original));
+
+    printf("  PASSED\n");
+}
+
+// Run one kernel on every supported instruction set and compare to scalar
+static void compare_kernel(const char* name, void (*run)(uint8_t* dst, const uint8_t* input, size_t count),
+                           size_t input_size, size_t output_size) {
+    uint8_t* input = (uint8_t*)malloc(MAX_PIXELS * input_size);
+    uint8_t* expected = (uint8_t*)malloc(MAX_PIXELS * output_size);
+    uint8_t* actual = (uint8_t*)malloc(MAX_PIXELS * output_size);
+    uint8_t* initial = (uint8_t*)malloc(MAX_PIXELS * output_size);
+
+    // Odd lengths exercise the leftover paths after the vector loops
+    for (size_t count = 0; count <= MAX_PIXELS; count += count < 40 ? 1 : 37) {
+        random_bytes(input, count * input_size);
+        random_premultiplied(initial, MAX_PIXELS * output_size / 4);
+
+        pixel_ops_set_isa(PIXEL_ISA_SCALAR);
+        memcpy(expected, initial, MAX_PIXELS * output_size);
+        run(expected, input, count);
+
+        for (size_t i = 1; i < sizeof(all_isas) / sizeof(all_isas[0]); i++) {
+            if (pixel_ops_set_isa(all_isas[i]) != 0) {
+                continue;
+            }
+            memcpy(actual, initial, MAX_PIXELS * output_size);
+            run(actual, input, count);
+            if (memcmp(actual, expected, MAX_PIXELS * output_size) != 0) {
+                printf("  %s differs on %s with %zu pixels\n", name, pixel_ops_isa_name(all_isas[i]), count);
+                assert(0);
+            }
+        }
+    }
+
+    free(input);
+    free(expected);
+    free(actual);
+    free(initial);
+}
+
+static void run_fill(uint8_t* dst, const uint8_t* input, size_t count) {
+    pixel_fill(dst, count, input);
+}
+
+static void run_blend_solid(uint8_t* dst, const uint8_t* input, size_t count) {
+    uint8_t color[4];
+    memcpy(color, input, 4);
+    // Colors must be premultiplied, so clamp the channels to alpha
+    for (int c = 0; c < 3; c++) {
+        if (color[c] > color[3]) {
+            color[c] = color[3];
+        }
+    }
+    pixel_blend_solid(dst, count, color);
+}
+
+static void run_blend_over(uint8_t* dst, const uint8_t* input, size_t count) {
+    uint8_t* src = (uint8_t*)malloc(count * 4 + 1);
+    memcpy(src, input, count * 4);
+    for (size_t i = 0; i < count; i++) {
+        for (int c = 0; c < 3; c++) {
+            if (src[i * 4 + c] > src[i * 4 + 3]) {
+                src[i * 4 + c] = src[i * 4 + 3];
+            }
+        }
+    }
+    pixel_blend_over(dst, src, count);
+    free(src);
+}
+
+static void run_blend_mask(uint8_t* dst, const uint8_t* input, size_t count) {
+    uint8_t color[4] = { 30, 200, 90, 210 };
+    uint8_t* mask = (uint8_t*)malloc(count + 1);
+    for (size_t i = 0; i < count; i++) {
+        // Plenty of empty coverage, as in real glyphs
+        mask[i] = input[i * 4] < 96 ? 0 : input[i * 4 + 1];
+    }
+    pixel_blend_mask(dst, mask, count, color);
+    free(mask);
+}
+
+static void run_premultiply(uint8_t* dst, const uint8_t* input, size_t count) {
+    pixel_premultiply(dst, input, count);
+}
+
+static void run_premultiply_in_place(uint8_t* dst, const uint8_t* input, size_t count) {
+    memcpy(dst, input, count * 4);
+    pixel_premultiply(dst, dst, count);
+}
+
+static void run_swap_rb(uint8_t* dst, const uint8_t* input, size_t count) {
+    pixel_swap_rb(dst, input, count);
+}
+
+static void run_rgba_to_rgb(uint8_t* dst, const uint8_t* input, size_t count) {
+    pixel_rgba_to_rgb(dst, input, count);
+}
+
+static void run_rgb_to_rgba(uint8_t* dst, const uint8_t* input, size_t count) {
+    pixel_rgb_to_rgba(dst, input, count);
+}
+
+void test_isas_match_scalar() {
+    printf("Testing SIMD kernels match the scalar kernels...\n");
+
+    PixelISA original = pixel_ops_get_isa();
+    compare_kernel("fill", run_fill, 4, 4);
+    compare_kernel("blend_solid", run_blend_solid, 4, 4);
+    compare_kernel("blend_over", run_blend_over, 4, 4);
+    compare_kernel("blend_mask", run_blend_mask, 4, 4);
+    compare_kernel("premultiply", run_premultiply, 4, 4);
+    compare_kernel("premultiply in place", run_premultiply_in_place, 4, 4);
+    compare_kernel("swap_rb", run_swap_rb, 4, 4);
+    // Bytes past count pixels must come out untouched, as scalar leaves them
+    compare_kernel("rgba_to_rgb", run_rgba_to_rgb, 4, 4);
+    compare_kernel("rgb_to_rgba", run_rgb_to_rgba, 3, 4);
+    pixel_ops_set_isa(original);
+
+    printf("  PASSED\n");
+}
+
+void test_bilinear_matches_scalar() {
+    printf("Testing SIMD bilinear scaling matches scalar...\n");
+
+    PixelISA original = pixel_ops_get_isa();
+    int src_width = 37;
+    int src_height = 23;
+    size_t src_stride = (size_t)src_width * 4 + 12;
+    uint8_t* source = (uint8_t*)malloc(src_stride * (size_t)src_height);
+    random_premultiplied(source, src_stride * (size_t)src_height / 4);
+
+    // Upscale, downscale, and a window more than one column chunk wide
+    const int sizes[][6] = {
+        { 101, 59, 0, 0, 101, 59 },
+        { 13, 9, 0, 0, 13, 9 },
+        { 700, 40, 17, 5, 300, 30 },
+        { 37, 23, 0, 0, 37, 23 }
+    };
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        int width = sizes[s][4];
+        int height = sizes[s][5];
+        size_t stride = (size_t)width * 4;
+        uint8_t* expected = (uint8_t*)calloc(stride * (size_t)height, 1);
+        uint8_t* actual = (uint8_t*)calloc(stride * (size_t)height, 1);
+
+        pixel_ops_set_isa(PIXEL_ISA_SCALAR);
+        pixel_scale_bilinear(expected, stride, sizes[s][2], sizes[s][3], width, height,
+                             sizes[s][0], sizes[s][1], source, src_width, src_height, src_stride);
+
+        // Same-size scaling is a copy
+        if (sizes[s][0] == src_width && sizes[s][1] == src_height) {
+            for (int y = 0; y < height; y++) {
+                assert(memcmp(expected + (size_t)y * stride, source + (size_t)y * src_stride, stride) == 0);
+            }
+        }
+
+        for (size_t i = 1; i < sizeof(all_isas) / sizeof(all_isas[0]); i++) {
+            if (pixel_ops_set_isa(all_isas[i]) != 0) {
+                continue;
+            }
+            memset(actual, 0, stride * (size_t)height);
+            pixel_scale_bilinear(actual, stride, sizes[s][2], sizes[s][3], width, height,
+                                 sizes[s][0], sizes[s][1], source, src_width, src_height, src_stride);
+            assert(memcmp(actual, expected, stride * (size_t)height) == 0);
+        }
+
+        free(expected);
+        free(actual);
+    }
+
+    // Nonsense geometry is ignored
+    uint8_t untouched[4] = { 1, 2, 3, 4 };
+    pixel_scale_bilinear(untouched, 4, -1, 0, 1, 1, 10, 10, source, src_width, src_height, src_stride);
+    pixel_scale_bilinear(untouched, 4, 0, 0, 1, 1, 0, 10, source, src_width, src_height, src_stride);
+    assert(untouched[0] == 1 && untouched[3] == 4);
+
+    free(source);
+    pixel_ops_set_isa(original);
+    printf("  PASSED\n");
+}
+
+int main() {
+    printf("Running pixel ops tests...\n\n");
+
+    test_isa_selection();
+    test_known_values();
+    test_isas_match_scalar();
+    test_bilinear_matches_scalar();
+
+    printf("\nAll pixel ops tests passed!\n");
+    return 0;
+}
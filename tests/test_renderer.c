@@ -0,0 +1,673 @@
+#include "rendering/renderer.h"
+#include "rendering/display_list.h"
+#include "rendering/painter.h"
+#include "css/stylesheet.h"
+#include "html/parser.h"
+#include "core/thread_pool.h"
+#include "dom/dom.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+static const unsigned char* pixel_at(Renderer* renderer, int x, int y) {
+    int width;
+    const unsigned char* buffer = renderer_get_buffer(renderer, &width, NULL);
+    return buffer + ((size_t)y * (size_t)width + (size_t)x) * 4;
+}
+
+static int pixel_is(Renderer* renderer, int x, int y, int r, int g, int b, int a) {
+    const unsigned char* p = pixel_at(renderer, x, y);
+    return p[0] == r && p[1] == g && p[2] == b && p[3] == a;
+}
+
+static void count_task(void* context, size_t index, int worker) {
+    int* hits = (int*)context;
+    __atomic_fetch_add(&hits[index], 1, __ATOMIC_RELAXED);
+}
+
+void test_thread_pool_parallel_for() {
+    printf("Testing thread pool parallel_for...\n");
+
+    ThreadPool* pool = thread_pool_create(4);
+    assert(pool != NULL);
+    assert(thread_pool_get_worker_count(pool) == 5);
+
+    int hits[1000];
+    for (int round = 0; round < 20; round++) {
+        memset(hits, 0, sizeof(hits));
+        assert(thread_pool_parallel_for(pool, 1000, count_task, hits) == 0);
+        for (int i = 0; i < 1000; i++) {
+            assert(hits[i] == 1);
+        }
+    }
+
+    // Without a pool everything runs on the caller
+    memset(hits, 0, sizeof(hits));
+    assert(thread_pool_parallel_for(NULL, 10, count_task, hits) == 0);
+    assert(hits[9] == 1);
+    assert(thread_pool_get_worker_count(NULL) == 1);
+
+    thread_pool_destroy(pool);
+    printf("  PASSED\n");
+}
+
+void test_draw_commands() {
+    printf("Testing draw commands...\n");
+    DOMDocument* doc = dom_document_create();
+    Renderer* renderer = renderer_init(200, 150);
+    assert(renderer != NULL);
+
+    RenderColor white = { 255, 255, 255, 255 };
+    RenderColor red = { 255, 0, 0, 255 };
+    RenderColor half_blue = { 0, 0, 255, 128 };
+    RenderColor black = { 0, 0, 0, 255 };
+    assert(renderer_set_clear_color(renderer, white) == 0);
+
+    // Solid rectangle crossing a tile boundary, then a translucent one on top
+    assert(renderer_fill_rect(renderer, 50, 50, 40, 40, red) == 0);
+    assert(renderer_fill_rect(renderer, 80, 80, 20, 20, half_blue) == 0);
+
+    // Vertical gradient from black to white
+    RenderColor from = { 0, 0, 0, 255 };
+    RenderColor to = { 255, 255, 255, 255 };
+    assert(renderer_fill_gradient(renderer, 150, 0, 10, 101, from, to, RENDER_GRADIENT_VERTICAL) == 0);
+
+    // Border with distinct side widths
+    int widths[4] = { 1, 2, 3, 4 };
+    assert(renderer_stroke_border(renderer, 0, 100, 40, 40, widths, black) == 0);
+
+    // 2x2 glyph mask with full and half coverage
+    unsigned char mask[4] = { 255, 0, 0, 128 };
+    assert(renderer_draw_glyph(renderer, 10, 10, mask, 2, 2, 2, black) == 0);
+
+    // 2x1 image upscaled to 4x2
+    unsigned char image[8] = { 0, 255, 0, 255, 0, 0, 255, 255 };
+    assert(renderer_draw_image(renderer, 20, 10, 4, 2, image, 2, 1, 8) == 0);
+
+    // Degenerate geometry is rejected
+    assert(renderer_fill_rect(renderer, 0, 0, 0, 10, red) == -1);
+
+    assert(renderer_render(renderer, doc) == 0);
+
+    assert(pixel_is(renderer, 0, 0, 255, 255, 255, 255));
+    assert(pixel_is(renderer, 50, 50, 255, 0, 0, 255));
+    assert(pixel_is(renderer, 89, 70, 255, 0, 0, 255));
+    assert(pixel_is(renderer, 90, 70, 255, 255, 255, 255));
+    assert(pixel_is(renderer, 85, 85, 127, 0, 128, 255));
+    assert(pixel_is(renderer, 95, 95, 127, 127, 255, 255));
+
+    assert(pixel_is(renderer, 155, 0, 0, 0, 0, 255));
+    assert(pixel_is(renderer, 155, 50, 127, 127, 127, 255));
+    assert(pixel_is(renderer, 155, 100, 255, 255, 255, 255));
+
+    assert(pixel_is(renderer, 20, 100, 0, 0, 0, 255));
+    assert(pixel_is(renderer, 20, 101, 255, 255, 255, 255));
+    assert(pixel_is(renderer, 3, 120, 0, 0, 0, 255));
+    assert(pixel_is(renderer, 4, 120, 255, 255, 255, 255));
+    assert(pixel_is(renderer, 38, 120, 0, 0, 0, 255));
+    assert(pixel_is(renderer, 37, 120, 255, 255, 255, 255));
+    assert(pixel_is(renderer, 20, 137, 0, 0, 0, 255));
+    assert(pixel_is(renderer, 20, 136, 255, 255, 255, 255));
+
+    assert(pixel_is(renderer, 10, 10, 0, 0, 0, 255));
+    assert(pixel_is(renderer, 11, 10, 255, 255, 255, 255));
+    assert(pixel_is(renderer, 11, 11, 127, 127, 127, 255));
+
+    assert(pixel_is(renderer, 21, 11, 0, 255, 0, 255));
+    assert(pixel_is(renderer, 22, 10, 0, 0, 255, 255));
+    assert(pixel_is(renderer, 24, 10, 255, 255, 255, 255));
+
+    // Clearing commands leaves only the clear color
+    renderer_clear_commands(renderer);
+    assert(renderer_render(renderer, doc) == 0);
+    assert(pixel_is(renderer, 50, 50, 255, 255, 255, 255));
+
+    renderer_destroy(renderer);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_damage_tracking() {
+    printf("Testing damage tracking...\n");
+    DOMDocument* doc = dom_document_create();
+    Renderer* renderer = renderer_init(256, 256);
+    assert(renderer != NULL);
+
+    RenderColor white = { 255, 255, 255, 255 };
+    RenderColor red = { 255, 0, 0, 255 };
+    RenderColor green = { 0, 255, 0, 255 };
+    renderer_set_clear_color(renderer, white);
+
+    // The first frame repaints everything
+    renderer_fill_rect(renderer, 10, 10, 20, 20, red);
+    renderer_fill_rect(renderer, 100, 100, 50, 50, red);
+    assert(renderer_render(renderer, doc) == 0);
+    size_t count = 0;
+    const RenderRect* damage = renderer_get_damage(renderer, &count);
+    assert(damage != NULL && count == 1);
+    assert(damage[0].x == 0 && damage[0].y == 0 && damage[0].width == 256 && damage[0].height == 256);
+
+    // Poke a pixel outside any damage: an unchanged frame must leave it alone
+    unsigned char* sentinel = (unsigned char*)pixel_at(renderer, 200, 20);
+    sentinel[0] = 1;
+    renderer_clear_commands(renderer);
+    renderer_fill_rect(renderer, 10, 10, 20, 20, red);
+    renderer_fill_rect(renderer, 100, 100, 50, 50, red);
+    assert(renderer_render(renderer, doc) == 0);
+    renderer_get_damage(renderer, &count);
+    assert(count == 0);
+    assert(sentinel[0] == 1);
+
+    // Changing one command damages only its rectangle
+    renderer_clear_commands(renderer);
+    renderer_fill_rect(renderer, 10, 10, 20, 20, red);
+    renderer_fill_rect(renderer, 100, 100, 50, 50, green);
+    assert(renderer_render(renderer, doc) == 0);
+    damage = renderer_get_damage(renderer, &count);
+    assert(count == 1);
+    assert(damage[0].x == 100 && damage[0].y == 100 && damage[0].width == 50 && damage[0].height == 50);
+    assert(pixel_is(renderer, 120, 120, 0, 255, 0, 255));
+    assert(sentinel[0] == 1);
+
+    // Moving a command damages both where it was and where it is now
+    renderer_clear_commands(renderer);
+    renderer_fill_rect(renderer, 40, 10, 20, 20, red);
+    renderer_fill_rect(renderer, 100, 100, 50, 50, green);
+    assert(renderer_render(renderer, doc) == 0);
+    damage = renderer_get_damage(renderer, &count);
+    assert(count == 2);
+    assert(pixel_is(renderer, 15, 15, 255, 255, 255, 255));
+    assert(pixel_is(renderer, 45, 15, 255, 0, 0, 255));
+
+    // Explicit damage repaints even when the commands match
+    assert(renderer_add_damage(renderer, 190, 10, 20, 20) == 0);
+    assert(renderer_render(renderer, doc) == 0);
+    renderer_get_damage(renderer, &count);
+    assert(count == 1);
+    assert(sentinel[0] == 255);
+
+    // Many scattered changes are merged into a short, non-overlapping list
+    renderer_clear_commands(renderer);
+    for (int i = 0; i < 100; i++) {
+        renderer_fill_rect(renderer, (i * 37) % 250, (i * 71) % 250, 3, 3, red);
+    }
+    assert(renderer_render(renderer, doc) == 0);
+    damage = renderer_get_damage(renderer, &count);
+    assert(count >= 1 && count <= 16);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t j = i + 1; j < count; j++) {
+            assert(damage[i].x + damage[i].width <= damage[j].x || damage[j].x + damage[j].width <= damage[i].x ||
+                   damage[i].y + damage[i].height <= damage[j].y || damage[j].y + damage[j].height <= damage[i].y);
+        }
+    }
+    for (int i = 0; i < 100; i++) {
+        assert(pixel_is(renderer, (i * 37) % 250 + 1, (i * 71) % 250 + 1, 255, 0, 0, 255));
+    }
+    assert(pixel_is(renderer, 45, 15, 255, 255, 255, 255));
+
+    // Resizing damages everything again
+    assert(renderer_resize(renderer, 128, 128) == 0);
+    assert(renderer_render(renderer, doc) == 0);
+    damage = renderer_get_damage(renderer, &count);
+    assert(count == 1 && damage[0].width == 128 && damage[0].height == 128);
+
+    renderer_destroy(renderer);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_display_list_replay() {
+    printf("Testing display list replay...\n");
+    DOMDocument* doc = dom_document_create();
+    Renderer* renderer = renderer_init(128, 128);
+    assert(renderer != NULL);
+
+    RenderColor white = { 255, 255, 255, 255 };
+    RenderColor red = { 255, 0, 0, 255 };
+    RenderColor blue = { 0, 0, 255, 255 };
+    renderer_set_clear_color(renderer, white);
+
+    // Two independently cached subtrees
+    DisplayList* header = display_list_create();
+    DisplayList* body = display_list_create();
+    assert(header && body);
+    int widths[4] = { 1, 1, 1, 1 };
+    assert(display_list_fill_rect(header, 0, 0, 20, 10, red) == 0);
+    assert(display_list_stroke_border(header, 0, 0, 20, 10, widths, blue) == 0);
+    assert(display_list_fill_rect(body, 0, 0, 30, 30, blue) == 0);
+    assert(display_list_get_count(header) == 2);
+
+    RenderRect bounds;
+    assert(display_list_get_bounds(header, &bounds) == 0);
+    assert(bounds.x == 0 && bounds.y == 0 && bounds.width == 20 && bounds.height == 10);
+
+    assert(renderer_draw_display_list(renderer, header, 5, 5) == 0);
+    assert(renderer_draw_display_list(renderer, body, 40, 40) == 0);
+    assert(renderer_render(renderer, doc) == 0);
+    assert(pixel_is(renderer, 5, 5, 0, 0, 255, 255));
+    assert(pixel_is(renderer, 10, 10, 255, 0, 0, 255));
+    assert(pixel_is(renderer, 50, 50, 0, 0, 255, 255));
+
+    // Replaying the same lists costs no repaint
+    size_t count;
+    renderer_clear_commands(renderer);
+    renderer_draw_display_list(renderer, header, 5, 5);
+    renderer_draw_display_list(renderer, body, 40, 40);
+    assert(renderer_render(renderer, doc) == 0);
+    renderer_get_damage(renderer, &count);
+    assert(count == 0);
+
+    // Re-recording one subtree damages only that subtree
+    display_list_clear(body);
+    assert(display_list_fill_rect(body, 0, 0, 30, 30, red) == 0);
+    renderer_clear_commands(renderer);
+    renderer_draw_display_list(renderer, header, 5, 5);
+    renderer_draw_display_list(renderer, body, 40, 40);
+    assert(renderer_render(renderer, doc) == 0);
+    const RenderRect* damage = renderer_get_damage(renderer, &count);
+    assert(count == 1 && damage[0].x == 40 && damage[0].y == 40 && damage[0].width == 30);
+    assert(pixel_is(renderer, 50, 50, 255, 0, 0, 255));
+
+    display_list_destroy(header);
+    display_list_destroy(body);
+    renderer_destroy(renderer);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_display_list_serialization() {
+    printf("Testing display list serialization...\n");
+    DOMDocument* doc = dom_document_create();
+
+    RenderColor black = { 0, 0, 0, 255 };
+    RenderColor green = { 0, 200, 0, 255 };
+    unsigned char mask[3 * 4];
+    for (int i = 0; i < 12; i++) {
+        mask[i] = (unsigned char)(i * 20);
+    }
+    unsigned char image[2 * 2 * 4 + 8];   // Rows padded to 12 bytes
+    for (int i = 0; i < (int)sizeof(image); i++) {
+        image[i] = (unsigned char)(i * 9);
+    }
+
+    DisplayList* list = display_list_create();
+    int widths[4] = { 2, 1, 2, 1 };
+    assert(display_list_fill_gradient(list, 2, 2, 20, 10, black, green, RENDER_GRADIENT_HORIZONTAL) == 0);
+    assert(display_list_stroke_border(list, 0, 0, 30, 30, widths, black) == 0);
+    assert(display_list_draw_glyph(list, 5, 15, mask, 3, 3, 4, green) == 0);
+    assert(display_list_draw_image(list, 12, 15, 4, 4, image, 2, 2, 12) == 0);
+
+    size_t size;
+    unsigned char* data = display_list_serialize(list, &size);
+    assert(data != NULL);
+    DisplayList* copy = display_list_deserialize(data, size);
+    assert(copy != NULL);
+    assert(display_list_get_count(copy) == 4);
+
+    // Truncated or corrupted input is rejected
+    assert(display_list_deserialize(data, size - 1) == NULL);
+    data[0] = 'X';
+    assert(display_list_deserialize(data, size) == NULL);
+    free(data);
+
+    // The copy rasterizes exactly like the original
+    Renderer* original = renderer_init(64, 64);
+    Renderer* restored = renderer_init(64, 64);
+    renderer_draw_display_list(original, list, 0, 0);
+    renderer_draw_display_list(restored, copy, 0, 0);
+    assert(renderer_render(original, doc) == 0);
+    assert(renderer_render(restored, doc) == 0);
+    assert(memcmp(renderer_get_buffer(original, NULL, NULL), renderer_get_buffer(restored, NULL, NULL), 64 * 64 * 4) == 0);
+
+    // Replaying at 2x doubles the geometry
+    DisplayList* scaled = display_list_create();
+    assert(display_list_append(scaled, copy, 0, 0, 2.0f) == 0);
+    RenderRect bounds;
+    assert(display_list_get_bounds(scaled, &bounds) == 0);
+    assert(bounds.width == 60 && bounds.height == 60);
+    renderer_clear_commands(restored);
+    renderer_draw_display_list(restored, scaled, 0, 0);
+    assert(renderer_render(restored, doc) == 0);
+    // Bottom border is 4px at 2x, left border 2px
+    assert(pixel_is(restored, 3, 56, 0, 0, 0, 255));
+    assert(pixel_is(restored, 3, 55, 0, 0, 0, 0));
+    assert(pixel_is(restored, 1, 40, 0, 0, 0, 255));
+    assert(pixel_is(restored, 2, 40, 0, 0, 0, 0));
+    assert(display_list_append(scaled, copy, 0, 0, 0.0f) == -1);
+
+    display_list_destroy(scaled);
+    display_list_destroy(copy);
+    display_list_destroy(list);
+    renderer_destroy(original);
+    renderer_destroy(restored);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+static void record_scene(Renderer* renderer, const unsigned char* mask, const unsigned char* image) {
+    renderer_clear_commands(renderer);
+    for (int i = 0; i < 300; i++) {
+        RenderColor color = { (unsigned char)(i * 7), (unsigned char)(i * 13), (unsigned char)(i * 29),
+                              (unsigned char)(64 + i % 192) };
+        int x = (i * 37) % 500 - 50;
+        int y = (i * 53) % 400 - 50;
+        switch (i % 5) {
+            case 0:
+                renderer_fill_rect(renderer, x, y, 90, 70, color);
+                break;
+            case 1: {
+                RenderColor to = { color.b, color.r, color.g, 255 };
+                renderer_fill_gradient(renderer, x, y, 120, 60, color, to,
+                                       i % 2 ? RENDER_GRADIENT_HORIZONTAL : RENDER_GRADIENT_VERTICAL);
+                break;
+            }
+            case 2: {
+                int widths[4] = { 1 + i % 3, 2, 1 + i % 4, 3 };
+                renderer_stroke_border(renderer, x, y, 150, 100, widths, color);
+                break;
+            }
+            case 3:
+                renderer_draw_glyph(renderer, x, y, mask, 16, 16, 16, color);
+                break;
+            default:
+                renderer_draw_image(renderer, x, y, 70, 45, image, 8, 8, 32);
+                break;
+        }
+    }
+}
+
+void test_parallel_matches_serial() {
+    printf("Testing parallel rasterization matches serial...\n");
+    DOMDocument* doc = dom_document_create();
+
+    unsigned char mask[256];
+    unsigned char image[256];
+    for (int i = 0; i < 256; i++) {
+        mask[i] = (unsigned char)(i * 5);
+        image[i] = (unsigned char)(i * 11);
+    }
+
+    Renderer* serial = renderer_init(420, 333);
+    Renderer* parallel = renderer_init(420, 333);
+    assert(serial && parallel);
+
+    ThreadPool* pool = thread_pool_create(3);
+    assert(pool != NULL);
+    assert(renderer_set_thread_pool(parallel, pool) == 0);
+
+    record_scene(serial, mask, image);
+    record_scene(parallel, mask, image);
+    assert(renderer_render(serial, doc) == 0);
+    for (int round = 0; round < 5; round++) {
+        assert(renderer_render(parallel, doc) == 0);
+        assert(memcmp(renderer_get_buffer(serial, NULL, NULL),
+                      renderer_get_buffer(parallel, NULL, NULL), 420 * 333 * 4) == 0);
+    }
+
+    // Resizing rebuilds the tile grid
+    assert(renderer_resize(serial, 130, 70) == 0);
+    assert(renderer_resize(parallel, 130, 70) == 0);
+    assert(renderer_render(serial, doc) == 0);
+    assert(renderer_render(parallel, doc) == 0);
+    assert(memcmp(renderer_get_buffer(serial, NULL, NULL),
+                  renderer_get_buffer(parallel, NULL, NULL), 130 * 70 * 4) == 0);
+
+    renderer_destroy(serial);
+    renderer_destroy(parallel);
+    thread_pool_destroy(pool);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+// A static bar and a square that moves every other frame, so half the
+// frames change nothing
+static void record_moving_square(Renderer* renderer, int frame) {
+    RenderColor blue = { 0, 0, 255, 255 };
+    RenderColor red = { 255, 0, 0, 200 };
+    renderer_clear_commands(renderer);
+    renderer_fill_rect(renderer, 0, 90, 200, 10, blue);
+    renderer_fill_rect(renderer, (frame / 2 * 17) % 170, 20 + (frame / 2) % 3 * 10, 30, 30, red);
+}
+
+void test_triple_buffering() {
+    printf("Testing triple buffered frame handoff...\n");
+    DOMDocument* doc = dom_document_create();
+    Renderer* reference = renderer_init(200, 100);
+    Renderer* triple = renderer_init(200, 100);
+    RenderColor white = { 255, 255, 255, 255 };
+    renderer_set_clear_color(reference, white);
+    renderer_set_clear_color(triple, white);
+    size_t size = 200 * 100 * 4;
+
+    RenderFrame frame;
+    assert(renderer_acquire_frame(triple, &frame) == -1);
+    assert(renderer_set_triple_buffering(triple, 1) == 0);
+    assert(renderer_acquire_frame(triple, &frame) == 0);
+    assert(frame.pixels == NULL && frame.sequence == 0);
+    assert(renderer_get_frame_sequence(triple) == 0);
+
+    // The consumer takes some frames and skips others; the one it took at
+    // frame 3 is held until 12, so it comes back far behind and is
+    // repainted in full
+    unsigned char* frames[32];
+    const RenderFrame* held = NULL;
+    RenderFrame taken;
+    for (int f = 1; f <= 30; f++) {
+        record_moving_square(reference, f);
+        record_moving_square(triple, f);
+        assert(renderer_render(reference, doc) == 0);
+        assert(renderer_render(triple, doc) == 0);
+        assert(renderer_get_frame_sequence(triple) == (uint64_t)f);
+
+        frames[f] = (unsigned char*)malloc(size);
+        memcpy(frames[f], renderer_get_buffer(reference, NULL, NULL), size);
+        assert(memcmp(renderer_get_buffer(triple, NULL, NULL), frames[f], size) == 0);
+
+        // Damage is still reported against the previous frame
+        size_t reference_count, triple_count;
+        const RenderRect* reference_damage = renderer_get_damage(reference, &reference_count);
+        const RenderRect* triple_damage = renderer_get_damage(triple, &triple_count);
+        assert(reference_count == triple_count);
+        assert(memcmp(reference_damage, triple_damage, triple_count * sizeof(RenderRect)) == 0);
+
+        if (f <= 3 || f == 12 || f == 13 || f == 25) {
+            assert(renderer_acquire_frame(triple, &taken) == 1);
+            assert(taken.sequence == (uint64_t)f && taken.width == 200 && taken.height == 100);
+            assert(renderer_acquire_frame(triple, &frame) == 0 && frame.pixels == taken.pixels);
+            held = &taken;
+        }
+        // A held frame is never painted over
+        if (held) {
+            assert(memcmp(held->pixels, frames[held->sequence], size) == 0);
+        }
+    }
+
+    // Frames the consumer skipped are dropped; it gets the newest
+    assert(renderer_acquire_frame(triple, &frame) == 1 && frame.sequence == 30);
+    assert(memcmp(frame.pixels, frames[30], size) == 0);
+
+    // Back to one buffer, picking up where the frames left off
+    assert(renderer_set_triple_buffering(triple, 0) == 0);
+    record_moving_square(reference, 31);
+    record_moving_square(triple, 31);
+    assert(renderer_render(reference, doc) == 0);
+    assert(renderer_render(triple, doc) == 0);
+    assert(memcmp(renderer_get_buffer(triple, NULL, NULL), renderer_get_buffer(reference, NULL, NULL), size) == 0);
+    assert(renderer_acquire_frame(triple, &frame) == -1);
+
+    for (int f = 1; f <= 30; f++) {
+        free(frames[f]);
+    }
+    renderer_destroy(reference);
+    renderer_destroy(triple);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+#define HANDOFF_FRAMES 1000
+
+typedef struct {
+    Renderer* renderer;
+    int done;
+    uint64_t taken;
+    uint64_t last;
+    int torn;
+} FrameConsumer;
+
+// Frame n has a 10px red band at row n % 90 and its number in pixel (0, 0)
+static void record_numbered_frame(Renderer* renderer, uint64_t n) {
+    RenderColor red = { 255, 0, 0, 255 };
+    RenderColor number = { (unsigned char)(n & 255), (unsigned char)(n >> 8), 0, 255 };
+    renderer_clear_commands(renderer);
+    renderer_fill_rect(renderer, 0, (int)(n % 90), 200, 10, red);
+    renderer_fill_rect(renderer, 0, 0, 1, 1, number);
+}
+
+static int frame_consistent(const RenderFrame* frame) {
+    const unsigned char* first = frame->pixels;
+    if (first[0] != (frame->sequence & 255) || first[1] != ((frame->sequence >> 8) & 255)) {
+        return 0;
+    }
+    int band = (int)(frame->sequence % 90);
+    for (int y = 1; y < frame->height; y++) {
+        for (int x = 1; x < frame->width; x += 37) {
+            const unsigned char* p = frame->pixels + ((size_t)y * (size_t)frame->width + (size_t)x) * 4;
+            int red = y >= band && y < band + 10;
+            if (p[0] != 255 || p[1] != (red ? 0 : 255)) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static void* consume_frames(void* arg) {
+    FrameConsumer* consumer = (FrameConsumer*)arg;
+    for (;;) {
+        int done = __atomic_load_n(&consumer->done, __ATOMIC_ACQUIRE);
+        RenderFrame frame;
+        int result = renderer_acquire_frame(consumer->renderer, &frame);
+        if (result == 1) {
+            if (frame.sequence <= consumer->last || !frame_consistent(&frame)) {
+                consumer->torn++;
+            }
+            consumer->last = frame.sequence;
+            consumer->taken++;
+        } else if (done) {
+            return NULL;
+        }
+    }
+}
+
+void test_frame_handoff_threads() {
+    printf("Testing frame handoff to a consumer thread...\n");
+    DOMDocument* doc = dom_document_create();
+    Renderer* renderer = renderer_init(200, 100);
+    RenderColor white = { 255, 255, 255, 255 };
+    renderer_set_clear_color(renderer, white);
+    assert(renderer_set_triple_buffering(renderer, 1) == 0);
+
+    FrameConsumer consumer = { renderer, 0, 0, 0, 0 };
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, consume_frames, &consumer) == 0);
+
+    for (uint64_t n = 1; n <= HANDOFF_FRAMES; n++) {
+        record_numbered_frame(renderer, n);
+        assert(renderer_render(renderer, doc) == 0);
+    }
+    __atomic_store_n(&consumer.done, 1, __ATOMIC_RELEASE);
+    pthread_join(thread, NULL);
+
+    // Every frame taken was whole and newer than the one before, and the
+    // last frame was not lost
+    assert(consumer.torn == 0);
+    assert(consumer.taken > 0 && consumer.last == HANDOFF_FRAMES);
+
+    renderer_destroy(renderer);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+void test_painter() {
+    printf("Testing painting a laid-out document...\n");
+    DOMDocument* doc = dom_document_create();
+    const char* html = "<html><body><div id=\"box\">Hello</div></body></html>";
+    assert(html_parser_parse(doc, html) == 0);
+    StyleEngine* styles = style_engine_create(doc);
+    const char* css = "body { margin: 0; } "
+                      "#box { margin: 10px; padding: 10px; width: 100px; background-color: #0000ff; "
+                      "border: 4px solid #ff0000; color: #00ff00; font-size: 20px; }";
+    CSSStylesheet* sheet = css_stylesheet_parse(css, strlen(css));
+    assert(sheet != NULL);
+    assert(style_engine_add_stylesheet(styles, sheet) == 0);
+    LayoutEngine* layout = layout_engine_create(doc, styles);
+    assert(layout_engine_layout(layout, 200.0f) == 0);
+    Renderer* renderer = renderer_init(200, 100);
+    RenderColor white = { 255, 255, 255, 255 };
+    renderer_set_clear_color(renderer, white);
+    Painter* painter = painter_create();
+    assert(painter != NULL);
+
+    assert(painter_paint(painter, renderer, doc, styles, layout) == 0);
+    assert(renderer_render(renderer, doc) == 0);
+
+    DOMElement* box = dom_document_get_element_by_id(doc, "box");
+    LayoutGeometry geometry;
+    assert(layout_engine_get_geometry(layout, box, &geometry) == 0);
+    int left = (int)geometry.border_box.x;
+    int top = (int)geometry.border_box.y;
+    assert(left == 10 && top == 10);
+    assert(pixel_is(renderer, left - 1, top - 1, 255, 255, 255, 255));
+    assert(pixel_is(renderer, left + 1, top + 1, 255, 0, 0, 255));
+    assert(pixel_is(renderer, left + 6, top + 6, 0, 0, 255, 255));
+
+    // Some of the fragment's pixels are the text color
+    LayoutFragment fragment;
+    assert(layout_engine_get_fragment(layout, box, 0, &fragment) == 0);
+    int inked = 0;
+    for (int y = (int)fragment.rect.y; y < (int)(fragment.rect.y + fragment.rect.height); y++) {
+        for (int x = (int)fragment.rect.x; x < (int)(fragment.rect.x + fragment.rect.width); x++) {
+            const unsigned char* p = pixel_at(renderer, x, y);
+            inked += p[1] > p[0] && p[1] > p[2];
+        }
+    }
+    assert(inked > 0);
+
+    // Painting the unchanged page again reuses every glyph and damages nothing
+    GlyphCacheStats before;
+    GlyphCacheStats after;
+    painter_get_glyph_stats(painter, &before);
+    assert(painter_paint(painter, renderer, doc, styles, layout) == 0);
+    assert(renderer_render(renderer, doc) == 0);
+    painter_get_glyph_stats(painter, &after);
+    assert(after.misses == before.misses && after.hits > before.hits);
+    size_t count = 0;
+    renderer_get_damage(renderer, &count);
+    assert(count == 0);
+
+    renderer_destroy(renderer);
+    painter_destroy(painter);
+    layout_engine_destroy(layout);
+    style_engine_destroy(styles);
+    dom_document_destroy(doc);
+    printf("  PASSED\n");
+}
+
+int main() {
+    printf("Running renderer tests...\n\n");
+
+    test_thread_pool_parallel_for();
+    test_draw_commands();
+    test_damage_tracking();
+    test_display_list_replay();
+    test_display_list_serialization();
+    test_parallel_matches_serial();
+    test_triple_buffering();
+    test_frame_handoff_threads();
+    test_painter();
+
+    printf("\nAll renderer tests passed!\n");
+    return 0;
+}